@@ -19,10 +19,35 @@ author = 'This page is maintained by the Flux community.'
 man_pages = [
     ('man3/flux_sign_wrap', 'flux_sign_wrap', 'Wrap signed credential', [author], 3),
     ('man3/flux_sign_wrap', 'flux_sign_wrap_as', 'Wrap signed credential', [author], 3),
+    ('man3/flux_sign_wrap', 'flux_sign_wrap_r', 'Wrap signed credential', [author], 3),
+    ('man3/flux_sign_wrap', 'flux_sign_wrap_bin', 'Wrap signed credential', [author], 3),
     ('man3/flux_sign_unwrap', 'flux_sign_unwrap', 'Unwrap signed credential', [author], 3),
     ('man3/flux_sign_unwrap', 'flux_sign_unwrap_anymech', 'Unwrap signed credential', [author], 3),
+    ('man3/flux_sign_unwrap', 'flux_sign_unwrap_r', 'Unwrap signed credential', [author], 3),
+    ('man3/flux_sign_unwrap', 'flux_sign_unwrap_batch', 'Unwrap signed credential', [author], 3),
+    ('man3/flux_sign_unwrap', 'flux_sign_unwrap_batch_r', 'Unwrap signed credential', [author], 3),
+    ('man3/flux_sign_unwrap', 'flux_sign_unwrap_bin', 'Unwrap signed credential', [author], 3),
+    ('man3/flux_sign_unwrap', 'flux_sign_unwrap_buf', 'Unwrap signed credential', [author], 3),
+    ('man3/flux_sign_unwrap', 'flux_sign_cache_open', 'Unwrap signed credential', [author], 3),
+    ('man3/flux_sign_wrap_init', 'flux_sign_wrap_init', 'Stream signed credential', [author], 3),
+    ('man3/flux_sign_wrap_init', 'flux_sign_wrap_update', 'Stream signed credential', [author], 3),
+    ('man3/flux_sign_wrap_init', 'flux_sign_wrap_final', 'Stream signed credential', [author], 3),
+    ('man3/flux_sign_wrap_init', 'flux_sign_unwrap_init', 'Stream signed credential', [author], 3),
+    ('man3/flux_sign_wrap_init', 'flux_sign_unwrap_update', 'Stream signed credential', [author], 3),
+    ('man3/flux_sign_wrap_init', 'flux_sign_unwrap_final', 'Stream signed credential', [author], 3),
+    ('man3/flux_sign_wrap_init', 'flux_sign_stream_destroy', 'Stream signed credential', [author], 3),
+    ('man3/flux_sign_wrap_async', 'flux_sign_wrap_async', 'Asynchronous signed credential', [author], 3),
+    ('man3/flux_sign_wrap_async', 'flux_sign_unwrap_async', 'Asynchronous signed credential', [author], 3),
+    ('man3/flux_sign_wrap_async', 'flux_sign_async_fd', 'Asynchronous signed credential', [author], 3),
+    ('man3/flux_sign_wrap_async', 'flux_sign_async_next', 'Asynchronous signed credential', [author], 3),
+    ('man3/flux_sign_wrap_async', 'flux_sign_wrap_get', 'Asynchronous signed credential', [author], 3),
+    ('man3/flux_sign_wrap_async', 'flux_sign_unwrap_get', 'Asynchronous signed credential', [author], 3),
+    ('man3/flux_sign_wrap_async', 'flux_sign_future_wait', 'Asynchronous signed credential', [author], 3),
+    ('man3/flux_sign_wrap_async', 'flux_sign_future_arg', 'Asynchronous signed credential', [author], 3),
+    ('man3/flux_sign_wrap_async', 'flux_sign_future_destroy', 'Asynchronous signed credential', [author], 3),
     ('man3/flux_security_create', 'flux_security_create', 'Create Flux security context', [author], 3),
     ('man3/flux_security_create', 'flux_security_destroy', 'Destroy Flux security context', [author], 3),
+    ('man3/flux_security_create', 'flux_security_share', 'Share Flux security context between threads', [author], 3),
     ('man3/flux_security_last_error', 'flux_security_last_error', 'Get last error string', [author], 3),
     ('man3/flux_security_last_error', 'flux_security_last_errnum', 'Get last error number', [author], 3),
     ('man3/flux_security_aux_set', 'flux_security_aux_set', 'Attach data to security context', [author], 3),
@@ -21,6 +21,7 @@
 #include <ctype.h>
 #include <stdbool.h>
 #include <limits.h>
+#include <fcntl.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -198,22 +199,117 @@ struct cgroup_info *cgroup_info_create (void)
         || strncmp (basename (cgroup->path), "flux-", 5) == 0)
         cgroup->use_cgroup_kill = true;
 
+    /*  cgroup.kill was added in Linux 5.14. It is absent in the root
+     *  cgroup, but the IMP never uses cgroup kill there.
+     */
+    if (cgroup->use_cgroup_kill && cgroup->unified) {
+        char path[PATH_MAX + 16];
+        int len = sizeof (path);
+        if (snprintf (path, len, "%s/cgroup.kill", cgroup->path) < len
+            && access (path, W_OK) == 0)
+            cgroup->have_cgroup_kill = true;
+    }
+
     return cgroup;
 }
 
-int cgroup_kill (struct cgroup_info *cgroup, int sig)
+/*  Write string 'val' to cgroup control file 'name' in cgroup 'dir'.
+ */
+static int cgroup_write (const char *dir, const char *name, const char *val)
 {
-    int count = 0;
-    int rc = 0;
-    int saved_errno = 0;
-    char path [PATH_MAX+14]; /* cgroup->path[PATH_MAX] + "/cgroup.procs" */
+    char path[PATH_MAX + 32];
+    int pathlen = sizeof (path);
+    int fd;
+    int len = strlen (val);
+    int saved_errno;
+
+    if (snprintf (path, pathlen, "%s/%s", dir, name) >= pathlen) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    if ((fd = open (path, O_WRONLY | O_CLOEXEC)) < 0)
+        return -1;
+    if (write (fd, val, len) != len) {
+        saved_errno = errno;
+        close (fd);
+        errno = saved_errno;
+        return -1;
+    }
+    return close (fd);
+}
+
+/*  Create the leaf cgroup for IMP children and move the IMP into it,
+ *  so that a subsequent fork(2) places the child there.
+ */
+static int cgroup_child_enter (struct cgroup_info *cg)
+{
+    int len = sizeof (cg->child_path);
+
+    if (!cg->use_cgroup_kill || !cg->unified)
+        return -1;
+    if (snprintf (cg->child_path,
+                  len,
+                  "%s/imp-child",
+                  cg->path) >= len) {
+        errno = EOVERFLOW;
+        goto error;
+    }
+    if (mkdir (cg->child_path, 0755) < 0 && errno != EEXIST)
+        goto error;
+    if (cgroup_write (cg->child_path, "cgroup.procs", "0") < 0) {
+        int saved_errno = errno;
+        (void) rmdir (cg->child_path);
+        errno = saved_errno;
+        goto error;
+    }
+    cg->child_events = true;
+    return 0;
+error:
+    imp_debug ("cgroup: not using child cgroup: %s", strerror (errno));
+    cg->child_path[0] = '\0';
+    return -1;
+}
+
+pid_t cgroup_fork (struct cgroup_info *cg)
+{
+    bool moved = cgroup_child_enter (cg) == 0;
+    pid_t pid = fork ();
+
+    if (pid != 0 && moved) {
+        int saved_errno = errno;
+
+        /*  Parent (or failed fork): move the IMP back to its own cgroup.
+         *  If that fails the IMP keeps the leaf populated, so its
+         *  cgroup.events can no longer be used to detect emptiness.
+         */
+        if (cgroup_write (cg->path, "cgroup.procs", "0") < 0) {
+            imp_warn ("cgroup: failed to move IMP back to %s: %s",
+                      cg->path,
+                      strerror (errno));
+            cg->child_events = false;
+        }
+        errno = saved_errno;
+    }
+    return pid;
+}
+
+/*  Send signal to all pids listed in 'dir'/cgroup.procs except
+ *  'current_pid'. Signaled pids are added to *countp, and the errno
+ *  of the last failed kill(2), if any, is returned in *errp.
+ */
+static int cgroup_procs_kill (const char *dir,
+                              pid_t current_pid,
+                              int sig,
+                              int *countp,
+                              int *errp)
+{
+    char path [PATH_MAX+14]; /* dir[PATH_MAX] + "/cgroup.procs" */
     FILE *fp;
     unsigned long child;
-    pid_t current_pid = getpid ();
 
     /* Note: path is guaranteed to have enough space to append "/cgroup.procs"
      */
-    (void) snprintf (path, sizeof (path), "%s/cgroup.procs", cgroup->path);
+    (void) snprintf (path, sizeof (path), "%s/cgroup.procs", dir);
 
     if (!(fp = fopen (path, "r")))
         return -1;
@@ -222,44 +318,120 @@ int cgroup_kill (struct cgroup_info *cgroup, int sig)
         if (pid == current_pid)
             continue;
         if (kill (pid, sig) < 0) {
-            saved_errno = errno;
-            rc = -1;
+            *errp = errno;
             imp_warn ("Failed to send signal %d to pid %lu",
                       sig,
                       child);
             continue;
         }
-        count++;
+        (*countp)++;
     }
     fclose (fp);
-    if (rc < 0 && count == 0) {
-        count = -1;
+    return 0;
+}
+
+int cgroup_kill (struct cgroup_info *cgroup, int sig)
+{
+    int count = 0;
+    int saved_errno = 0;
+    pid_t current_pid = getpid ();
+
+    if (cgroup_procs_kill (cgroup->path,
+                           current_pid,
+                           sig,
+                           &count,
+                           &saved_errno) < 0)
+        return -1;
+
+    if (cgroup->child_path[0] == '\0')
+        goto out;
+
+    /*  Writing "1" to cgroup.kill SIGKILLs every process in the leaf and
+     *  its descendants in one step, including processes forked while the
+     *  kill is in progress, so no per-pid scan is required. Fall back to
+     *  cgroup.procs if the write fails for any reason other than the leaf
+     *  having been removed already.
+     */
+    if (sig == SIGKILL && cgroup->have_cgroup_kill) {
+        if (cgroup_write (cgroup->child_path, "cgroup.kill", "1") == 0) {
+            count++;
+            goto out;
+        }
+        if (errno == ENOENT)
+            goto out;
+        imp_debug ("cgroup: %s: cgroup.kill: %s",
+                   cgroup->child_path,
+                   strerror (errno));
+    }
+
+    /*  The child leaf may already have been removed, ignore ENOENT.
+     */
+    if (cgroup_procs_kill (cgroup->child_path,
+                           current_pid,
+                           sig,
+                           &count,
+                           &saved_errno) < 0
+        && errno != ENOENT)
+        saved_errno = errno;
+out:
+    if (saved_errno != 0 && count == 0) {
         errno = saved_errno;
+        return -1;
     }
     return count;
 }
 
-int cgroup_wait_for_empty (struct cgroup_info *cgroup)
+int cgroup_events_populated (int fd)
 {
-    int n;
+    char buf[256];
+    char *p;
+    ssize_t n;
 
-    /*  Only wait for empty cgroup if cgroup kill is enabled.
-     */
-    if (!cgroup->use_cgroup_kill)
-        return 0;
+    if ((n = pread (fd, buf, sizeof (buf) - 1, 0)) < 0)
+        return -1;
+    buf[n] = '\0';
+    for (p = buf; p != NULL && *p != '\0'; p = strchr (p, '\n')) {
+        if (*p == '\n')
+            p++;
+        if (strncmp (p, "populated ", 10) == 0)
+            return p[10] == '0' ? 0 : 1;
+    }
+    errno = ENOENT;
+    return -1;
+}
 
-    while ((n = cgroup_kill (cgroup, 0)) > 0) {
-        /*  Note: inotify/poll() do not work on the cgroup.procs virtual
-         *  file. Therefore, wait at most 1s and check to see if the cgroup
-         *  is empty again. If the job execution system requests a signal to
-         *  be delivered then the sleep will be interrupted, in which case a
-         *  a small delay is added in hopes that any terminated processes
-         *  will have been removed from cgroup.procs by then.
-         */
-        if (usleep (1e6) < 0 && errno == EINTR)
-            usleep (2000);
+int cgroup_events_open (struct cgroup_info *cgroup)
+{
+    char path[PATH_MAX + 16];
+    int len = sizeof (path);
+
+    if (!cgroup->child_events) {
+        errno = ENOENT;
+        return -1;
+    }
+    if (snprintf (path,
+                  len,
+                  "%s/cgroup.events",
+                  cgroup->child_path) >= len) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    return open (path, O_RDONLY | O_CLOEXEC);
+}
+
+void cgroup_child_remove (struct cgroup_info *cgroup)
+{
+    /*  Failure is not fatal since the leaf is cleaned up along with
+     *  the parent cgroup.
+     */
+    if (cgroup->child_path[0] != '\0') {
+        if (rmdir (cgroup->child_path) < 0)
+            imp_debug ("cgroup: rmdir %s: %s",
+                       cgroup->child_path,
+                       strerror (errno));
+        cgroup->child_path[0] = '\0';
+        cgroup->child_events = false;
     }
-    return 0;
 }
 
 /* vi: ts=4 sw=4 expandtab
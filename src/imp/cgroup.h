@@ -11,11 +11,18 @@
 #ifndef HAVE_IMP_CGROUP_H
 #define HAVE_IMP_CGROUP_H 1
 
+#include <sys/types.h>
+#include <limits.h>
+#include <stdbool.h>
+
 struct cgroup_info {
     char mount_dir[PATH_MAX + 1];
     char path[PATH_MAX + 1];
+    char child_path[PATH_MAX + 1];  /* leaf cgroup for IMP children or "" */
     bool unified;
     bool use_cgroup_kill;
+    bool have_cgroup_kill;          /* cgroup v2 cgroup.kill is available */
+    bool child_events;              /* child_path/cgroup.events is usable */
 };
 
 struct cgroup_info *cgroup_info_create (void);
@@ -23,12 +30,34 @@ struct cgroup_info *cgroup_info_create (void);
 void cgroup_info_destroy (struct cgroup_info *cgroup);
 
 /*  Send signal to all pids (excluding the current pid) in the
- *  current cgroup.
+ *  current cgroup.  If sig is SIGKILL and cgroup.kill is available,
+ *  the child leaf cgroup is killed atomically with a single write to
+ *  its cgroup.kill, which counts as one signaled process in the return
+ *  value.
  */
 int cgroup_kill (struct cgroup_info *cgroup, int sig);
 
-/*  Wait for all processes in cgroup (except this one) to exit.
+/*  fork(2) the IMP child.  If the IMP owns its cgroup (use_cgroup_kill)
+ *  and the unified hierarchy is in use, the child and all its descendants
+ *  are placed in a leaf cgroup below the IMP's cgroup, so that the IMP
+ *  itself does not keep the leaf populated.  If the leaf cannot be used,
+ *  this is equivalent to fork(2).
+ */
+pid_t cgroup_fork (struct cgroup_info *cgroup);
+
+/*  Open the cgroup.events file of the child leaf cgroup for use with
+ *  poll(2). The kernel raises POLLPRI each time the "populated" key
+ *  changes. Returns -1 with errno set to ENOENT if the leaf is not in use.
+ */
+int cgroup_events_open (struct cgroup_info *cgroup);
+
+/*  Return the value of the "populated" key from the cgroup.events file
+ *  open on 'fd', or -1 on error.
+ */
+int cgroup_events_populated (int fd);
+
+/*  Remove the (empty) child leaf cgroup, if any.
  */
-int cgroup_wait_for_empty (struct cgroup_info *cgroup);
+void cgroup_child_remove (struct cgroup_info *cgroup);
 
 #endif /* !HAVE_IMP_CGROUP_H */
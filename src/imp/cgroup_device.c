@@ -19,7 +19,8 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdlib.h>
-#include <assert.h>
+#include <stdint.h>
+#include <sys/types.h>
 #include <linux/bpf.h>
 #include <sys/syscall.h>
 
@@ -71,6 +72,34 @@
         .src_reg = 0, \
         .off     = (foff), \
         .imm     = (fimm) })
+#define DEV_INSN_JGE_IMM(dst, fimm, foff) \
+    ((struct bpf_insn){ \
+        .code    = BPF_JMP | BPF_JGE | BPF_K, \
+        .dst_reg = (dst), \
+        .src_reg = 0, \
+        .off     = (foff), \
+        .imm     = (fimm) })
+#define DEV_INSN_JA(foff) \
+    ((struct bpf_insn){ \
+        .code    = BPF_JMP | BPF_JA, \
+        .dst_reg = 0, \
+        .src_reg = 0, \
+        .off     = (foff), \
+        .imm     = 0 })
+#define DEV_INSN_RSH32_REG(dst, src) \
+    ((struct bpf_insn){ \
+        .code    = BPF_ALU | BPF_RSH | BPF_X, \
+        .dst_reg = (dst), \
+        .src_reg = (src), \
+        .off     = 0, \
+        .imm     = 0 })
+#define DEV_INSN_MOV32_IMM(dst, fimm) \
+    ((struct bpf_insn){ \
+        .code    = BPF_ALU | BPF_MOV | BPF_K, \
+        .dst_reg = (dst), \
+        .src_reg = 0, \
+        .off     = 0, \
+        .imm     = (fimm) })
 #define DEV_INSN_MOV64_IMM(dst, fimm) \
     ((struct bpf_insn){ \
         .code    = BPF_ALU64 | BPF_MOV | BPF_K, \
@@ -86,13 +115,58 @@
         .off     = 0, \
         .imm     = 0 })
 
-/* Number of BPF instructions emitted per device_allow_entry.
- * Each entry is 10 instructions without a minor check, 11 with one.
+/* Search ranges at or below this size are emitted as a linear chain of
+ * compares, which is cheaper than further bisection.
  */
-static int entry_insn_count (const struct device_allow_entry *e)
-{
-    return e->minor == -1 ? 10 : 11;
-}
+#define SEARCH_LINEAR_MAX 3
+
+/* Register assignment for the generated program */
+#define REG_MAJOR   BPF_REG_2
+#define REG_MINOR   BPF_REG_3
+#define REG_ACCESS  BPF_REG_4   /* requested BPF_DEVCG_ACC_* bits */
+#define REG_TYPE    BPF_REG_5   /* BPF_DEVCG_DEV_* */
+
+/* A normalized allow rule.  'allow' is a bitmap indexed by the requested
+ * access mask (0-7): bit N is set if a request for access N is allowed.
+ * A bitmap is used rather than an access mask since separate entries
+ * for the same device, e.g. "r" and "w", allow either access but not
+ * both at once.
+ */
+struct dev_rule {
+    int type;
+    int major;
+    int minor;          /* -1 = wildcard */
+    unsigned int allow;
+};
+
+/* All rules for one (type, major) pair.  The exact-minor rules are
+ * rules[first..first+count-1], and 'wild' is the wildcard-minor bitmap
+ * (0 if none), already merged into each exact rule.
+ */
+struct dev_major {
+    int type;
+    int major;
+    unsigned int wild;
+    int first;
+    int count;
+};
+
+struct prog_fixup {
+    size_t insn;
+    int label;
+};
+
+/* Growable instruction buffer with forward-jump labels */
+struct prog {
+    struct bpf_insn *insns;
+    size_t count;
+    size_t size;
+    ssize_t *labels;
+    int nlabels;
+    struct prog_fixup *fixups;
+    size_t nfixups;
+    int errnum;
+};
 
 /* Convert access string ("rwm") to BPF_DEVCG_ACC_* bitmask */
 static int access_to_mask (const char *access)
@@ -108,73 +182,336 @@ static int access_to_mask (const char *access)
     return mask;
 }
 
-/* Build a BPF cgroup device filter program from a device_allow list.
- * The program allows accesses matching any entry and denies all others.
- * Returns allocated insn array with *countp set, or NULL with errno set.
- *
- * Program structure per entry:
- *   check device type (lower 16 bits of access_type)
- *   check major
- *   check minor (if not wildcard)
- *   check access (upper 16 bits of access_type)
- *   if all match: return 1 (allow)
- * Default: return 0 (deny)
+/* Return the bitmap of requests allowed by access mask 'mask',
+ * i.e. all subsets of 'mask'.
  */
-static struct bpf_insn *
-bpf_prog_build (struct device_allow *da, size_t *countp)
+static unsigned int mask_to_allow (int mask)
 {
-    size_t n_insns = 3 + 2;  /* prologue (3) + epilogue (2) */
-    struct bpf_insn *insns;
-    size_t pos = 0;
+    unsigned int allow = 0;
+    for (int req = 0; req < 8; req++) {
+        if ((req & ~mask) == 0)
+            allow |= 1U << req;
+    }
+    return allow;
+}
+
+static int dev_rule_cmp (const void *a, const void *b)
+{
+    const struct dev_rule *r1 = a;
+    const struct dev_rule *r2 = b;
+    if (r1->type != r2->type)
+        return r1->type < r2->type ? -1 : 1;
+    if (r1->major != r2->major)
+        return r1->major < r2->major ? -1 : 1;
+    if (r1->minor != r2->minor)
+        return r1->minor < r2->minor ? -1 : 1;
+    return 0;
+}
+
+/* Normalize the device_allow list into sorted, de-duplicated rules grouped
+ * by (type, major), with wildcard-minor entries merged into exact ones.
+ * Exact rules made redundant by the wildcard are dropped.
+ */
+static int rules_compile (struct device_allow *da,
+                          struct dev_rule **rulesp,
+                          struct dev_major **majorsp,
+                          int *nmajorsp)
+{
+    struct dev_rule *rules;
+    struct dev_major *majors;
+    int nrules = 0;
+    int nmajors = 0;
+    int n = 0;
+
+    if (!(rules = calloc (da->count + 1, sizeof (*rules)))
+        || !(majors = calloc (da->count + 1, sizeof (*majors)))) {
+        free (rules);
+        return -1;
+    }
+    for (int i = 0; i < da->count; i++) {
+        const struct device_allow_entry *e = &da->entries[i];
+
+        /* Device numbers are unsigned, so these can never match */
+        if (e->major < 0 || e->minor < -1)
+            continue;
+        rules[nrules].type = (e->type == 'b') ? BPF_DEVCG_DEV_BLOCK
+                                              : BPF_DEVCG_DEV_CHAR;
+        rules[nrules].major = e->major;
+        rules[nrules].minor = e->minor;
+        rules[nrules].allow = mask_to_allow (access_to_mask (e->access));
+        nrules++;
+    }
+    if (nrules > 0)
+        qsort (rules, nrules, sizeof (*rules), dev_rule_cmp);
+
+    for (int i = 0; i < nrules; i++) {
+        struct dev_major *m;
+        struct dev_rule *r = &rules[i];
+
+        if (nmajors == 0
+            || majors[nmajors - 1].type != r->type
+            || majors[nmajors - 1].major != r->major) {
+            m = &majors[nmajors++];
+            m->type = r->type;
+            m->major = r->major;
+            m->first = n;
+        }
+        m = &majors[nmajors - 1];
+
+        /* Wildcard sorts first within a major */
+        if (r->minor == -1)
+            m->wild |= r->allow;
+        else if (m->count > 0 && rules[n - 1].minor == r->minor)
+            rules[n - 1].allow |= r->allow;
+        else {
+            rules[n++] = *r;
+            m->count++;
+        }
+    }
+    for (int i = 0; i < nmajors; i++) {
+        struct dev_major *m = &majors[i];
+        int count = 0;
+
+        for (int j = m->first; j < m->first + m->count; j++) {
+            rules[j].allow |= m->wild;
+            if (rules[j].allow != m->wild)
+                rules[m->first + count++] = rules[j];
+        }
+        m->count = count;
+    }
+    *rulesp = rules;
+    *majorsp = majors;
+    *nmajorsp = nmajors;
+    return 0;
+}
+
+static void prog_emit (struct prog *p, struct bpf_insn insn)
+{
+    if (p->count == p->size) {
+        size_t size = p->size ? p->size * 2 : 64;
+        struct bpf_insn *new;
+        if (!(new = realloc (p->insns, size * sizeof (*new)))) {
+            p->errnum = errno;
+            return;
+        }
+        p->insns = new;
+        p->size = size;
+    }
+    p->insns[p->count++] = insn;
+}
+
+static int prog_label (struct prog *p)
+{
+    ssize_t *new;
+    if (!(new = realloc (p->labels, (p->nlabels + 1) * sizeof (*new)))) {
+        p->errnum = errno;
+        return -1;
+    }
+    p->labels = new;
+    p->labels[p->nlabels] = -1;
+    return p->nlabels++;
+}
+
+static void prog_label_set (struct prog *p, int label)
+{
+    if (label >= 0)
+        p->labels[label] = p->count;
+}
+
+/* Emit jump 'insn' to 'label', to be resolved by prog_finalize().
+ */
+static void prog_jump (struct prog *p, struct bpf_insn insn, int label)
+{
+    struct prog_fixup *new;
+    size_t size = (p->nfixups + 1) * sizeof (*new);
 
-    for (int i = 0; i < da->count; i++)
-        n_insns += entry_insn_count (&da->entries[i]);
+    if (!(new = realloc (p->fixups, size))) {
+        p->errnum = errno;
+        return;
+    }
+    p->fixups = new;
+    p->fixups[p->nfixups].insn = p->count;
+    p->fixups[p->nfixups].label = label;
+    p->nfixups++;
+    prog_emit (p, insn);
+}
 
-    if (!(insns = calloc (n_insns, sizeof (*insns))))
+static int prog_finalize (struct prog *p)
+{
+    if (p->errnum) {
+        errno = p->errnum;
+        return -1;
+    }
+    for (size_t i = 0; i < p->nfixups; i++) {
+        ssize_t target = p->labels[p->fixups[i].label];
+        ssize_t off = target - (ssize_t) p->fixups[i].insn - 1;
+        if (target < 0 || off < 0 || off > INT16_MAX) {
+            errno = E2BIG;
+            return -1;
+        }
+        p->insns[p->fixups[i].insn].off = off;
+    }
+    return 0;
+}
+
+/* Return 1 if the requested access is set in bitmap 'allow', else 0.
+ */
+static void emit_allow (struct prog *p, unsigned int allow)
+{
+    if (allow == 0xff)
+        prog_emit (p, DEV_INSN_MOV64_IMM (BPF_REG_0, 1));
+    else {
+        prog_emit (p, DEV_INSN_MOV32_IMM (BPF_REG_0, allow));
+        prog_emit (p, DEV_INSN_RSH32_REG (BPF_REG_0, REG_ACCESS));
+        prog_emit (p, DEV_INSN_AND32_IMM (BPF_REG_0, 1));
+    }
+    prog_emit (p, DEV_INSN_EXIT ());
+}
+
+/* Binary search on minor over rules[lo..hi-1], jump to 'miss' if absent.
+ */
+static void emit_minor_search (struct prog *p,
+                               const struct dev_rule *rules,
+                               int lo,
+                               int hi,
+                               int miss)
+{
+    if (hi - lo > SEARCH_LINEAR_MAX) {
+        int mid = lo + (hi - lo) / 2;
+        int right = prog_label (p);
+
+        prog_jump (p, DEV_INSN_JGE_IMM (REG_MINOR, rules[mid].minor, 0), right);
+        emit_minor_search (p, rules, lo, mid, miss);
+        prog_label_set (p, right);
+        emit_minor_search (p, rules, mid, hi, miss);
+        return;
+    }
+    for (int i = lo; i < hi; i++) {
+        int next = prog_label (p);
+
+        prog_jump (p, DEV_INSN_JNE_IMM (REG_MINOR, rules[i].minor, 0), next);
+        emit_allow (p, rules[i].allow);
+        prog_label_set (p, next);
+    }
+    prog_jump (p, DEV_INSN_JA (0), miss);
+}
+
+static void emit_major (struct prog *p,
+                        const struct dev_rule *rules,
+                        const struct dev_major *m,
+                        int deny)
+{
+    int miss = m->wild ? prog_label (p) : deny;
+
+    emit_minor_search (p, rules, m->first, m->first + m->count, miss);
+    if (m->wild) {
+        prog_label_set (p, miss);
+        emit_allow (p, m->wild);
+    }
+}
+
+/* Binary search on major over majors[lo..hi-1], jump to 'deny' if absent.
+ */
+static void emit_major_search (struct prog *p,
+                               const struct dev_rule *rules,
+                               const struct dev_major *majors,
+                               int lo,
+                               int hi,
+                               int deny)
+{
+    if (hi - lo > SEARCH_LINEAR_MAX) {
+        int mid = lo + (hi - lo) / 2;
+        int right = prog_label (p);
+
+        prog_jump (p,
+                   DEV_INSN_JGE_IMM (REG_MAJOR, majors[mid].major, 0),
+                   right);
+        emit_major_search (p, rules, majors, lo, mid, deny);
+        prog_label_set (p, right);
+        emit_major_search (p, rules, majors, mid, hi, deny);
+        return;
+    }
+    for (int i = lo; i < hi; i++) {
+        int next = prog_label (p);
+
+        prog_jump (p, DEV_INSN_JNE_IMM (REG_MAJOR, majors[i].major, 0), next);
+        emit_major (p, rules, &majors[i], deny);
+        prog_label_set (p, next);
+    }
+    prog_jump (p, DEV_INSN_JA (0), deny);
+}
+
+/* Entries are compiled into a decision tree:
+ *   dispatch on device type (lower 16 bits of access_type)
+ *   binary search on major
+ *   binary search on exact minors, falling back to the wildcard minor
+ *   test the requested access (upper 16 bits of access_type) against
+ *     the bitmap of allowed requests and return 1 (allow) or 0 (deny)
+ * so any access, allowed or denied, runs O(log n) instructions.
+ * Default: return 0 (deny)
+ */
+struct bpf_insn *cgroup_device_prog_build (struct device_allow *da,
+                                           size_t *countp)
+{
+    struct prog p = { 0 };
+    struct dev_rule *rules = NULL;
+    struct dev_major *majors = NULL;
+    int nmajors;
+    int deny;
+    int saved_errno;
+
+    if (!da || !countp) {
+        errno = EINVAL;
         return NULL;
+    }
+    if (rules_compile (da, &rules, &majors, &nmajors) < 0)
+        return NULL;
+
+    deny = prog_label (&p);
 
     /* Prologue: load context fields into dedicated registers.
-     *   r2 = major, r3 = minor, r4 = access_type
+     *   r2 = major, r3 = minor, r4 = access bits, r5 = device type
      * Offsets match struct bpf_cgroup_dev_ctx field order.
      */
-    insns[pos++] = DEV_INSN_LDX_W (BPF_REG_2, BPF_REG_1, 4); /* major */
-    insns[pos++] = DEV_INSN_LDX_W (BPF_REG_3, BPF_REG_1, 8); /* minor */
-    insns[pos++] = DEV_INSN_LDX_W (BPF_REG_4, BPF_REG_1, 0); /* access_type */
+    prog_emit (&p, DEV_INSN_LDX_W (REG_MAJOR, BPF_REG_1, 4));
+    prog_emit (&p, DEV_INSN_LDX_W (REG_MINOR, BPF_REG_1, 8));
+    prog_emit (&p, DEV_INSN_LDX_W (REG_ACCESS, BPF_REG_1, 0));
+    prog_emit (&p, DEV_INSN_MOV32_REG (REG_TYPE, REG_ACCESS));
+    prog_emit (&p, DEV_INSN_AND32_IMM (REG_TYPE, 0xffff));
+    prog_emit (&p, DEV_INSN_RSH32_IMM (REG_ACCESS, 16));
+    prog_emit (&p, DEV_INSN_AND32_IMM (REG_ACCESS, 0x7));
 
-    for (int i = 0; i < da->count; i++) {
-        const struct device_allow_entry *e = &da->entries[i];
-        int n = entry_insn_count (e);
-        int dev_type = (e->type == 'b') ? BPF_DEVCG_DEV_BLOCK
-                                        : BPF_DEVCG_DEV_CHAR;
-        int allowed = access_to_mask (e->access);
-        int deny_mask = ~allowed & 0x7;
-
-        /* Check device type (lower 16 bits of access_type) */
-        insns[pos++] = DEV_INSN_MOV32_REG (BPF_REG_5, BPF_REG_4);
-        insns[pos++] = DEV_INSN_AND32_IMM (BPF_REG_5, 0xffff);
-        insns[pos++] = DEV_INSN_JNE_IMM (BPF_REG_5, dev_type, n - 3);
-        /* Check major */
-        insns[pos++] = DEV_INSN_JNE_IMM (BPF_REG_2, e->major, n - 4);
-        /* Check minor if not wildcard */
-        if (e->minor != -1)
-            insns[pos++] = DEV_INSN_JNE_IMM (BPF_REG_3, e->minor, n - 5);
-        /* Check access: deny if requested bits exceed allowed */
-        insns[pos++] = DEV_INSN_MOV32_REG (BPF_REG_5, BPF_REG_4);
-        insns[pos++] = DEV_INSN_RSH32_IMM (BPF_REG_5, 16);
-        insns[pos++] = DEV_INSN_AND32_IMM (BPF_REG_5, deny_mask);
-        insns[pos++] = DEV_INSN_JNE_IMM (BPF_REG_5, 0, 2);
-        /* Allow */
-        insns[pos++] = DEV_INSN_MOV64_IMM (BPF_REG_0, 1);
-        insns[pos++] = DEV_INSN_EXIT ();
+    for (int i = 0; i < nmajors; ) {
+        int next = prog_label (&p);
+        int j = i;
+
+        while (j < nmajors && majors[j].type == majors[i].type)
+            j++;
+        prog_jump (&p, DEV_INSN_JNE_IMM (REG_TYPE, majors[i].type, 0), next);
+        emit_major_search (&p, rules, majors, i, j, deny);
+        prog_label_set (&p, next);
+        i = j;
     }
 
     /* Epilogue: default deny */
-    insns[pos++] = DEV_INSN_MOV64_IMM (BPF_REG_0, 0);
-    insns[pos++] = DEV_INSN_EXIT ();
+    prog_label_set (&p, deny);
+    prog_emit (&p, DEV_INSN_MOV64_IMM (BPF_REG_0, 0));
+    prog_emit (&p, DEV_INSN_EXIT ());
+
+    if (prog_finalize (&p) < 0) {
+        free (p.insns);
+        p.insns = NULL;
+    }
+    else
+        *countp = p.count;
 
-    assert (pos == n_insns);
-    *countp = n_insns;
-    return insns;
+    saved_errno = errno;
+    free (p.labels);
+    free (p.fixups);
+    free (rules);
+    free (majors);
+    errno = saved_errno;
+    return p.insns;
 }
 
 static int cgroup_open (struct cgroup_info *cgroup)
@@ -205,7 +542,7 @@ int cgroup_device_apply (struct cgroup_info *cgroup,
                   strerror (errno));
         return -1;
     }
-    if (!(insns = bpf_prog_build (da, &n_insns))) {
+    if (!(insns = cgroup_device_prog_build (da, &n_insns))) {
         imp_warn ("device: failed to build BPF program: %s", strerror (errno));
         goto done;
     }
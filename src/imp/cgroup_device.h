@@ -11,9 +11,20 @@
 #ifndef HAVE_IMP_CGROUP_DEVICE_H
 #define HAVE_IMP_CGROUP_DEVICE_H 1
 
+#include <stddef.h>
+
 #include "cgroup.h"
 #include "exec/device.h"
 
+struct bpf_insn;
+
+/* Build a BPF cgroup device filter program from a device_allow list.
+ * The program allows accesses matching any entry and denies all others.
+ * Returns allocated insn array with *countp set, or NULL with errno set.
+ */
+struct bpf_insn *cgroup_device_prog_build (struct device_allow *da,
+                                           size_t *countp);
+
 /* Attach a BPF device policy program to the job cgroup.
  * Does nothing and returns 0 if da is NULL.
  * Returns 0 on success, -1 on error with errno set.
@@ -55,6 +55,7 @@
 
 #include "src/libutil/strlcpy.h"
 #include "src/libutil/macros.h"
+#include "src/libutil/hash.h"
 #include "imp_log.h"
 #include "device.h"
 
@@ -112,16 +113,115 @@ static void strip_trailing_whitespace (char *s)
     }
 }
 
+/* A named device class from /proc/devices. A name may be registered
+ * with more than one major.
+ */
+struct device_class {
+    char *name;
+    int *majors;
+    int count;
+};
+
+/* Device classes from /proc/devices indexed by type, then by name.
+ * /proc/devices is read at most once per policy, on first use.
+ */
+struct device_classes {
+    bool loaded;
+    int errnum;         /* errno from reading /proc/devices, or 0 */
+    hash_t chr;
+    hash_t blk;
+};
+
+static void device_class_destroy (struct device_class *dc)
+{
+    if (dc) {
+        int saved_errno = errno;
+        free (dc->name);
+        free (dc->majors);
+        free (dc);
+        errno = saved_errno;
+    }
+}
+
+static int device_class_add (hash_t h, const char *name, int major)
+{
+    struct device_class *dc;
+    int *majors;
+
+    if (!(dc = hash_find (h, name))) {
+        if (!(dc = calloc (1, sizeof (*dc)))
+            || !(dc->name = strdup (name))
+            || !hash_insert (h, dc->name, dc)) {
+            device_class_destroy (dc);
+            return -1;
+        }
+    }
+    if (!(majors = realloc (dc->majors, (dc->count + 1) * sizeof (int))))
+        return -1;
+    dc->majors = majors;
+    dc->majors[dc->count++] = major;
+    return 0;
+}
+
+static int device_classes_load (struct device_classes *dcs)
+{
+    FILE *fp;
+    char line[256];
+    hash_t section = NULL;
+
+    dcs->loaded = true;
+    if (!(dcs->chr = hash_create (0,
+                                  (hash_key_f) hash_key_string,
+                                  (hash_cmp_f) strcmp,
+                                  (hash_del_f) device_class_destroy))
+        || !(dcs->blk = hash_create (0,
+                                     (hash_key_f) hash_key_string,
+                                     (hash_cmp_f) strcmp,
+                                     (hash_del_f) device_class_destroy)))
+        return -1;
+    if (!(fp = fopen ("/proc/devices", "r"))) {
+        dcs->errnum = errno;
+        return 0;
+    }
+    while (fgets (line, sizeof (line), fp)) {
+        strip_trailing_whitespace (line);
+        if (streq (line, "Character devices:"))
+            section = dcs->chr;
+        else if (streq (line, "Block devices:"))
+            section = dcs->blk;
+        else if (section) {
+            int maj;
+            char devname[64];
+
+            if (sscanf (line, " %d %63s", &maj, devname) == 2
+                && device_class_add (section, devname, maj) < 0)
+                goto error;
+        }
+    }
+    fclose (fp);
+    return 0;
+error:
+    ERRNO_SAFE_WRAP (fclose, fp);
+    return -1;
+}
+
+static void device_classes_clear (struct device_classes *dcs)
+{
+    if (dcs->chr)
+        hash_destroy (dcs->chr);
+    if (dcs->blk)
+        hash_destroy (dcs->blk);
+    memset (dcs, 0, sizeof (*dcs));
+}
+
 static int device_class_append (struct device_allow *da,
+                                struct device_classes *dcs,
                                 const char *spec,
                                 const char *access)
 {
     const char *name;
     char type;
-    FILE *fp;
-    char line[256];
-    bool in_target_section = false;
-    int count = 0;
+    struct device_class *dc;
 
     if (strstarts (spec, "char-")) {
         name = spec + 5;
@@ -137,47 +237,32 @@ static int device_class_append (struct device_allow *da,
                   access);
         return 0;
     }
-    if (!(fp = fopen ("/proc/devices", "r"))) {
+    if (!dcs->loaded && device_classes_load (dcs) < 0)
+        return -1;
+    if (dcs->errnum) {
         imp_warn ("device: ignore %s (%s): /proc/devices: %s",
                   spec,
                   access,
-                  strerror (errno));
+                  strerror (dcs->errnum));
         return 0;
     }
-    while (fgets (line, sizeof (line), fp)) {
-        strip_trailing_whitespace (line);
-        if (streq (line, "Character devices:"))
-            in_target_section = type == 'c' ? true : false;
-        else if (streq (line, "Block devices:"))
-            in_target_section = type == 'b' ? true : false;
-        else if (in_target_section) {
-            int maj;
-            char devname[64];
-
-            if (sscanf (line, " %d %63s", &maj, devname) == 2
-                && streq (devname, name)) {
-                struct device_allow_entry entry;
-
-                entry.type = type;
-                entry.major = maj;
-                entry.minor = -1;
-                strlcpy (entry.access, access, sizeof (entry.access));
-                if (device_entry_append (da, entry) < 0)
-                    goto error;
-                count++;
-            }
-        }
-    }
-    if (count == 0) {
+    if (!(dc = hash_find (type == 'c' ? dcs->chr : dcs->blk, name))) {
         imp_warn ("device: ignore %s (%s): not found in /proc/devices",
                   spec,
                   access);
+        return 0;
     }
-    fclose (fp);
-    return count;
-error:
-    ERRNO_SAFE_WRAP (fclose, fp);
-    return -1;
+    for (int i = 0; i < dc->count; i++) {
+        struct device_allow_entry entry;
+
+        entry.type = type;
+        entry.major = dc->majors[i];
+        entry.minor = -1;
+        strlcpy (entry.access, access, sizeof (entry.access));
+        if (device_entry_append (da, entry) < 0)
+            return -1;
+    }
+    return dc->count;
 }
 
 static int device_path_append (struct device_allow *da,
@@ -213,6 +298,7 @@ static int device_path_append (struct device_allow *da,
 
 
 static int device_append (struct device_allow *da,
+                          struct device_classes *dcs,
                           const char *spec,
                           const char *access)
 {
@@ -224,7 +310,7 @@ static int device_append (struct device_allow *da,
                   access);
     }
     else if (strstarts (spec, "char-") || strstarts (spec, "block-"))
-        count = device_class_append (da, spec, access);
+        count = device_class_append (da, dcs, spec, access);
     else if (strstarts (spec, "/dev/"))
         count = device_path_append (da, spec, access);
     else
@@ -272,6 +358,7 @@ int device_allow_from_options (json_t *options, struct device_allow **dap)
     const char *policy = "auto";
     json_t *allow;
     struct device_allow *da = NULL;
+    struct device_classes dcs = { 0 };
 
     if (!dap) {
         errno = EINVAL;
@@ -289,6 +376,7 @@ int device_allow_from_options (json_t *options, struct device_allow **dap)
     if (!streq (policy, "strict")) {
         for (size_t i = 0; i < ARRAY_SIZE (standard_devices); i++) {
             if (device_append (da,
+                               &dcs,
                                standard_devices[i].spec,
                                standard_devices[i].access) < 0)
                 goto error;
@@ -306,13 +394,15 @@ int device_allow_from_options (json_t *options, struct device_allow **dap)
                 errno = EINVAL;
                 goto error;
             }
-            if (device_append (da, spec, access) < 0)
+            if (device_append (da, &dcs, spec, access) < 0)
                 goto error;
         }
     }
+    device_classes_clear (&dcs);
     *dap = da;
     return 0;
 error:
+    ERRNO_SAFE_WRAP (device_classes_clear, &dcs);
     device_allow_destroy (da);
     return -1;
 allow_all:
@@ -138,7 +138,24 @@ static struct imp_exec *imp_exec_create (struct imp_state *imp)
     return exec;
 }
 
-static void imp_exec_unwrap (struct imp_exec *exec, const char *J)
+/* Open the shared cache of verified signatures, if configured.
+ * The cache is only an optimization, so failure to open it is not fatal.
+ */
+static void imp_exec_cache_open (struct imp_exec *exec)
+{
+    const cf_t *path = cf_get_in (exec->conf, "verify-cache-path");
+    const cf_t *size = cf_get_in (exec->conf, "verify-cache-size");
+
+    if (!path)
+        return;
+    if (flux_sign_cache_open (exec->sec,
+                              cf_string (path),
+                              size ? cf_int64 (size) : 1024) < 0)
+        imp_warn ("exec: verify cache disabled: %s",
+                  flux_security_last_error (exec->sec));
+}
+
+static void imp_exec_unwrap (struct imp_exec *exec, const char *J, int flags)
 {
     int64_t userid;
 
@@ -147,7 +164,7 @@ static void imp_exec_unwrap (struct imp_exec *exec, const char *J)
                           &exec->spec,
                           &exec->specsz,
                           &userid,
-                          0) < 0)
+                          flags) < 0)
         imp_die (1, "exec: signature validation failed: %s",
                  flux_security_last_error (exec->sec));
 
@@ -180,7 +197,7 @@ static void imp_exec_init_kv (struct imp_exec *exec, struct kv *kv)
                  "exec: failed to decode device containment policy: %s",
                  strerror (errno));
 
-    imp_exec_unwrap (exec, exec->J);
+    imp_exec_unwrap (exec, exec->J, 0);
 }
 
 static void imp_exec_init_stream (struct imp_exec *exec, FILE *fp)
@@ -212,7 +229,10 @@ static void imp_exec_init_stream (struct imp_exec *exec, FILE *fp)
                            "options", &options) < 0)
         imp_die (1, "exec: invalid json input: %s", err.text);
 
-    imp_exec_unwrap (exec, exec->J);
+    /* In privsep mode, the privileged parent verifies J before using it,
+     * so the unprivileged child only needs to parse it.
+     */
+    imp_exec_unwrap (exec, exec->J, imp->ps ? FLUX_SIGN_NOVERIFY : 0);
 
     if (device_allow_from_options (options, &exec->da) < 0)
         imp_die (1,
@@ -255,6 +275,8 @@ int imp_exec_privileged (struct imp_state *imp, struct kv *kv)
         imp_die (1, "exec: user %s not in allowed-users list",
                     exec->imp_pwd->pw_name);
 
+    imp_exec_cache_open (exec);
+
     /* Init IMP input from kv object */
     imp_exec_init_kv (exec, kv);
 
@@ -290,7 +312,7 @@ int imp_exec_privileged (struct imp_state *imp, struct kv *kv)
     /* Block signals so parent IMP isn't unduly terminated */
     imp_sigblock_all ();
 
-    if ((child = fork ()) < 0)
+    if ((child = cgroup_fork (imp->cgroup)) < 0)
         imp_die (1, "exec: fork: %s", strerror (errno));
 
     imp_set_signal_child (child);
@@ -318,10 +340,8 @@ int imp_exec_privileged (struct imp_state *imp, struct kv *kv)
     imp_setup_signal_forwarding (imp);
 
     /* Parent: wait for child to exit */
-    while (waitpid (child, &status, 0) != child) {
-        if (errno != EINTR)
-            imp_die (1, "waitpid: %s", strerror (errno));
-    }
+    if (imp_wait_child (child, &status) < 0)
+        imp_die (1, "waitpid: %s", strerror (errno));
 
     rc = sd_notify (0, "STOPPING=1");
     if (rc < 0)
@@ -343,7 +363,7 @@ int imp_exec_privileged (struct imp_state *imp, struct kv *kv)
                     status);
     }
 
-    if (cgroup_wait_for_empty (exec->imp->cgroup) < 0)
+    if (imp_wait_cgroup () < 0)
         imp_warn ("error waiting for processes in job cgroup");
 
     sd_notify (0, "STATUS=cgroup is now empty, exiting");
@@ -22,6 +22,7 @@
 #include <ctype.h>
 #include <stdbool.h>
 #include <limits.h>
+#include <fcntl.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -61,82 +62,191 @@ static int parse_pid (const char *s, pid_t *ppid)
     return 0;
 }
 
-static pid_t pid_ppid (pid_t pid)
+struct pid_tree_entry {
+    pid_t pid;
+    pid_t ppid;
+};
+
+struct pid_tree {
+    struct pid_tree_entry *entries;
+    int count;
+    int size;
+};
+
+/*  Read the parent pid of 'pid' from /proc/PID/stat with a single read(2)
+ *  into the caller's buffer 'buf' of size 'bufsz'.
+ */
+static pid_t pid_ppid (pid_t pid, char *buf, int bufsz)
 {
     char path [64];
-    char *line = NULL;
     const int len = sizeof (path);
-    int n;
-    size_t size = 0;
-    FILE *fp = NULL;
-    pid_t ppid = -1;
+    ssize_t n;
+    int fd;
     int saved_errno;
+    pid_t ppid;
+    char *p;
 
-    /*  /proc/%ju/status is guaranteed to fit in 64 bytes
+    /*  /proc/%ju/stat is guaranteed to fit in 64 bytes
      */
-    (void) snprintf (path, len, "/proc/%ju/status", (uintmax_t) pid);
-    if (!(fp = fopen (path, "r")))
+    (void) snprintf (path, len, "/proc/%ju/stat", (uintmax_t) pid);
+    if ((fd = open (path, O_RDONLY | O_CLOEXEC)) < 0)
         return (pid_t) -1;
-
-    while ((n = getline (&line, &size, fp)) >= 0) {
-        if (strncmp (line, "PPid:", 5) == 0) {
-            char *p = line + 5;
-            while (isspace (*p))
-                ++p;
-            if (parse_pid (p, &ppid) < 0)
-                imp_warn ("parse_pid (%s): %s", p, strerror (errno));
-            break;
-        }
-    }
+    n = read (fd, buf, bufsz - 1);
     saved_errno = errno;
-    free (line);
-    fclose (fp);
+    close (fd);
     errno = saved_errno;
+    if (n < 0)
+        return (pid_t) -1;
+    buf[n] = '\0';
+
+    /*  Format is "pid (comm) state ppid ...". comm may contain spaces
+     *  and parentheses, but no later field does, so skip past the last
+     *  ')' and the single character state.
+     */
+    if (!(p = strrchr (buf, ')'))
+        || sscanf (p + 1, " %*c %d", &ppid) != 1) {
+        errno = EINVAL;
+        return (pid_t) -1;
+    }
     return ppid;
 }
 
-int pid_kill_children_fallback (pid_t parent, int sig)
+static int pid_tree_entry_cmp (const void *a, const void *b)
 {
-    int count = 0;
-    int rc = 0;
-    int saved_errno = 0;
-    DIR *dirp = NULL;
+    const struct pid_tree_entry *e1 = a;
+    const struct pid_tree_entry *e2 = b;
+    if (e1->ppid != e2->ppid)
+        return e1->ppid < e2->ppid ? -1 : 1;
+    return e1->pid < e2->pid ? -1 : e1->pid > e2->pid;
+}
+
+void pid_tree_destroy (struct pid_tree *t)
+{
+    if (t) {
+        int saved_errno = errno;
+        free (t->entries);
+        free (t);
+        errno = saved_errno;
+    }
+}
+
+struct pid_tree *pid_tree_create (void)
+{
+    struct pid_tree *t;
+
+    if (!(t = calloc (1, sizeof (*t))))
+        return NULL;
+    if (pid_tree_update (t) < 0) {
+        pid_tree_destroy (t);
+        return NULL;
+    }
+    return t;
+}
+
+int pid_tree_update (struct pid_tree *t)
+{
+    char buf [256];
+    DIR *dirp;
     struct dirent *dent;
     pid_t pid;
     pid_t ppid;
 
-    if (parent <= (pid_t) 0 || sig < 0) {
+    if (!t) {
         errno = EINVAL;
         return -1;
     }
-
     if (!(dirp = opendir ("/proc")))
         return -1;
 
+    t->count = 0;
     while ((dent = readdir (dirp))) {
         if (parse_pid (dent->d_name, &pid) < 0)
             continue;
-        if ((ppid = pid_ppid (pid)) < 0) {
-            /* ENOENT is an expected error since a process on the system
-             *  could have exited between when we read the /proc dirents
-             *  and when we are checking for /proc/PID/status.
+        if ((ppid = pid_ppid (pid, buf, sizeof (buf))) < 0) {
+            /* ENOENT/ESRCH are expected errors since a process on the
+             *  system could have exited between when we read the /proc
+             *  dirents and when we are checking for /proc/PID/stat.
              */
-            if (errno != ENOENT) {
-                saved_errno = errno;
-                rc = -1;
-                imp_warn ("Failed to get ppid of %lu: %s\n",
+            if (errno != ENOENT && errno != ESRCH)
+                imp_warn ("Failed to get ppid of %lu: %s",
                           (unsigned long) pid,
                           strerror (errno));
-
-            }
             continue;
         }
-        if (ppid != parent)
+        if (t->count == t->size) {
+            int size = t->size ? t->size * 2 : 1024;
+            struct pid_tree_entry *new;
+            if (!(new = realloc (t->entries, size * sizeof (*new)))) {
+                int saved_errno = errno;
+                closedir (dirp);
+                errno = saved_errno;
+                return -1;
+            }
+            t->entries = new;
+            t->size = size;
+        }
+        t->entries[t->count].pid = pid;
+        t->entries[t->count].ppid = ppid;
+        t->count++;
+    }
+    closedir (dirp);
+
+    /*  Sort by ppid so that all children of a process are adjacent
+     */
+    if (t->count > 0)
+        qsort (t->entries,
+               t->count,
+               sizeof (t->entries[0]),
+               pid_tree_entry_cmp);
+    return 0;
+}
+
+/*  Send signal to the children of 'parent' in the snapshot, as for
+ *  pid_tree_kill_children(). If 'stalep' is non-NULL, set it to the
+ *  number of snapshot entries that were no longer children of 'parent'.
+ */
+static int tree_kill_children (struct pid_tree *t,
+                               pid_t parent,
+                               int sig,
+                               int *stalep)
+{
+    char buf [256];
+    int count = 0;
+    int stale = 0;
+    int rc = 0;
+    int saved_errno = 0;
+    int lo = 0;
+    int hi;
+
+    if (!t || parent <= (pid_t) 0 || sig < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /*  Find the first entry with ppid == parent
+     */
+    hi = t->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (t->entries[mid].ppid < parent)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for (int i = lo; i < t->count && t->entries[i].ppid == parent; i++) {
+        pid_t pid = t->entries[i].pid;
+
+        /*  The snapshot may be stale. Skip pids that have exited or
+         *  have since been reused by an unrelated process.
+         */
+        if (pid_ppid (pid, buf, sizeof (buf)) != parent) {
+            stale++;
             continue;
+        }
         if (kill (pid, sig) < 0) {
             saved_errno = errno;
             rc = -1;
-            imp_warn ("Failed to send signal %d to pid %lu: %s\n",
+            imp_warn ("Failed to send signal %d to pid %lu: %s",
                       sig,
                       (unsigned long) pid,
                       strerror (errno));
@@ -144,7 +254,8 @@ int pid_kill_children_fallback (pid_t parent, int sig)
         }
         count++;
     }
-    closedir (dirp);
+    if (stalep)
+        *stalep = stale;
     if (rc < 0 && count == 0) {
         count = -1;
         errno = saved_errno;
@@ -152,49 +263,131 @@ int pid_kill_children_fallback (pid_t parent, int sig)
     return count;
 }
 
-int pid_kill_children (pid_t pid, int sig)
+int pid_tree_kill_children (struct pid_tree *t, pid_t parent, int sig)
 {
-    int count = 0;
-    int rc = 0;
-    int saved_errno = 0;
-    char path [128];
-    FILE *fp;
-    unsigned long child;
+    return tree_kill_children (t, parent, sig, NULL);
+}
 
-    if (pid <= (pid_t) 0 || sig < 0) {
+int pid_kill_children_fallback (pid_t parent, int sig)
+{
+    /*  The snapshot is retained across calls, so that repeated signal
+     *  deliveries do not each rescan all of /proc. It is refreshed when
+     *  it yields no live child of 'parent' (a miss), and before the next
+     *  call when some of its entries for 'parent' were found to be stale.
+     *  N.B. a retained snapshot does not see a child created after it was
+     *  taken while an older child is still running. The IMP, the only
+     *  caller, creates its child before any signal is forwarded.
+     */
+    static struct pid_tree *tree = NULL;
+    static bool refresh = false;
+    int stale = 0;
+    int count;
+
+    if (parent <= (pid_t) 0 || sig < 0) {
         errno = EINVAL;
         return -1;
     }
+    if (!tree) {
+        if (!(tree = pid_tree_create ()))
+            return -1;
+        refresh = false;
+    }
+    else if (refresh) {
+        if (pid_tree_update (tree) < 0)
+            return -1;
+        refresh = false;
+    }
+    else {
+        count = tree_kill_children (tree, parent, sig, &stale);
+        if (count > 0) {
+            refresh = stale > 0;
+            return count;
+        }
+        if (pid_tree_update (tree) < 0)
+            return -1;
+    }
+    count = tree_kill_children (tree, parent, sig, &stale);
+    refresh = stale > 0;
+    return count;
+}
+
+/*  Send signal to the children listed in /proc/PID/task/TID/children.
+ */
+static int task_kill_children (pid_t pid,
+                               pid_t tid,
+                               int sig,
+                               int *countp,
+                               int *errp)
+{
+    char path [128];
+    FILE *fp;
+    unsigned long child;
 
     (void) snprintf (path, sizeof (path),
                     "/proc/%ju/task/%ju/children",
                     (uintmax_t) pid,
-                    (uintmax_t) pid);
+                    (uintmax_t) tid);
 
-    if (!(fp = fopen (path, "r"))) {
-        if (errno == ENOENT)
-            return pid_kill_children_fallback (pid, sig);
+    if (!(fp = fopen (path, "r")))
         return -1;
-    }
     while (fscanf (fp, " %lu", &child) == 1) {
         if (child <= 1 || child > INT32_MAX || (pid_t)child == pid) {
             imp_warn ("Ignoring suspect pid %lu from %s", child, path);
             continue;
         }
         if (kill ((pid_t) child, sig) < 0) {
-            saved_errno = errno;
-            rc = -1;
+            *errp = errno;
             imp_warn ("Failed to send signal %d to pid %lu",
                       sig,
                       child);
             continue;
         }
-        count++;
+        (*countp)++;
     }
     fclose (fp);
-    if (rc < 0 && count == 0) {
-        count = -1;
+    return 0;
+}
+
+int pid_kill_children (pid_t pid, int sig)
+{
+    int count = 0;
+    int saved_errno = 0;
+    char path [128];
+    DIR *dirp;
+    struct dirent *dent;
+    pid_t tid;
+
+    if (pid <= (pid_t) 0 || sig < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /*  The main task children file is missing if the kernel was built
+     *  without CONFIG_PROC_CHILDREN.
+     */
+    if (task_kill_children (pid, pid, sig, &count, &saved_errno) < 0) {
+        if (errno == ENOENT)
+            return pid_kill_children_fallback (pid, sig);
+        return -1;
+    }
+
+    /*  Children created by other threads are only listed in the
+     *  children file of the thread that created them.
+     */
+    (void) snprintf (path, sizeof (path), "/proc/%ju/task", (uintmax_t) pid);
+    if ((dirp = opendir (path))) {
+        while ((dent = readdir (dirp))) {
+            if (parse_pid (dent->d_name, &tid) < 0 || tid == pid)
+                continue;
+            /*  Threads may exit during the scan, ignore errors
+             */
+            (void) task_kill_children (pid, tid, sig, &count, &saved_errno);
+        }
+        closedir (dirp);
+    }
+    if (saved_errno != 0 && count == 0) {
         errno = saved_errno;
+        return -1;
     }
     return count;
 }
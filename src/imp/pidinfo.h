@@ -11,7 +11,10 @@
 #ifndef HAVE_PIDINFO_H
 #define HAVE_PIDINFO_H 1
 
-/*  Send signal to any children of pid.
+#include <sys/types.h>
+
+/*  Send signal to any children of pid, including children created by
+ *  any thread of pid.
  *  Returns the number of children signaled or -1 if an error occurred.
  */
 int pid_kill_children (pid_t pid, int sig);
@@ -21,4 +24,23 @@ int pid_kill_children (pid_t pid, int sig);
  */
 int pid_kill_children_fallback (pid_t parent, int sig);
 
+/*  Snapshot of the parent/child relationships of all processes in /proc,
+ *  indexed by parent pid.
+ */
+struct pid_tree;
+
+struct pid_tree *pid_tree_create (void);
+
+void pid_tree_destroy (struct pid_tree *t);
+
+/*  Rescan /proc, reusing the memory of the existing snapshot.
+ */
+int pid_tree_update (struct pid_tree *t);
+
+/*  Send signal to all children of 'parent' in the snapshot. Each child
+ *  is checked to still be a child of 'parent' before it is signaled.
+ *  Returns the number of children signaled or -1 if an error occurred.
+ */
+int pid_tree_kill_children (struct pid_tree *t, pid_t parent, int sig);
+
 #endif /* !HAVE_PIDINFO_H */
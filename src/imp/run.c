@@ -191,7 +191,7 @@ imp_run (struct imp_state *imp,
      */
     imp_sigblock_all ();
 
-    if ((child = fork ()) < 0)
+    if ((child = cgroup_fork (imp->cgroup)) < 0)
         imp_die (1, "run: fork: %s", strerror (errno));
 
     imp_set_signal_child (-child);
@@ -235,10 +235,8 @@ imp_run (struct imp_state *imp,
     imp_setup_signal_forwarding (imp);
 
     /* Parent: wait for child to exit */
-    while (waitpid (child, &status, 0) != child) {
-        if (errno != EINTR)
-            imp_die (1, "waitpid: %s", strerror (errno));
-    }
+    if (imp_wait_child (child, &status) < 0)
+        imp_die (1, "waitpid: %s", strerror (errno));
 
     rc = sd_notify (0, "STOPPING=1");
     if (rc < 0)
@@ -260,7 +258,7 @@ imp_run (struct imp_state *imp,
                     status);
     }
 
-    if (cgroup_wait_for_empty (imp->cgroup) < 0)
+    if (imp_wait_cgroup () < 0)
         imp_warn ("error waiting for processes in cgroup");
 
     sd_notify (0, "STATUS=cgroup is now empty, exiting");
@@ -16,13 +16,43 @@
 #include <signal.h>
 #include <errno.h>
 #include <string.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
 
 #include "signals.h"
 #include "pidinfo.h"
+#include "cgroup.h"
 #include "imp_log.h"
 
 static const struct imp_state *imp_state = NULL;
 static pid_t imp_child = (pid_t) -1;
+static int imp_child_pidfd = -1;
+static int imp_sigfd = -1;
+
+/*  glibc < 2.36 has no wrappers for pidfd_open(2) (Linux 5.3) and
+ *  pidfd_send_signal(2) (Linux 5.1).
+ */
+static int sys_pidfd_open (pid_t pid)
+{
+#ifdef __NR_pidfd_open
+    return syscall (__NR_pidfd_open, pid, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+static int sys_pidfd_send_signal (int pidfd, int sig)
+{
+#ifdef __NR_pidfd_send_signal
+    return syscall (__NR_pidfd_send_signal, pidfd, sig, NULL, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
 
 void imp_set_signal_child (pid_t child)
 {
@@ -89,13 +119,36 @@ static void fwd_signal (int signum)
         if (count < 0)
             imp_warn ("Failed to forward SIGKILL: %s", strerror (errno));
     }
+    else if (imp_child_pidfd >= 0) {
+        /*  Unlike kill(2), the pidfd can never refer to a recycled pid
+         *  once the child has been reaped (ESRCH is returned instead).
+         */
+        (void) sys_pidfd_send_signal (imp_child_pidfd, signum);
+    }
     else if (imp_child != -1)
         kill (imp_child, signum);
 }
 
+/*  Forward all pending signals read from the signalfd.
+ */
+static int signalfd_forward (void)
+{
+    struct signalfd_siginfo si;
+    ssize_t n;
+
+    while ((n = read (imp_sigfd, &si, sizeof (si))) == sizeof (si)) {
+        /*  SIGCHLD only serves to wake the caller to reap the child.
+         */
+        if (si.ssi_signo != SIGCHLD)
+            fwd_signal (si.ssi_signo);
+    }
+    if (n < 0 && errno != EAGAIN)
+        return -1;
+    return 0;
+}
+
 void imp_setup_signal_forwarding (struct imp_state *imp)
 {
-    struct sigaction sa;
     sigset_t mask;
     int i;
     int signals[] = {
@@ -108,31 +161,132 @@ void imp_setup_signal_forwarding (struct imp_state *imp)
         SIGTTIN,
         SIGTTOU,
         SIGUSR1,
+        SIGCHLD,
     };
     int nsignals =  sizeof (signals) / sizeof (signals[0]);
 
     imp_state = imp;
 
-    memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = fwd_signal;
-    sa.sa_flags = 0;
-    sigemptyset(&sa.sa_mask);
-
+    /*  All signals remain blocked. Forwarded signals (and SIGCHLD) are
+     *  instead consumed synchronously from a signalfd by imp_wait_child()
+     *  and imp_wait_cgroup().
+     */
     sigfillset (&mask);
-    for (i = 0; i < nsignals; i++) {
-        sigdelset (&mask, signals[i]);
-        if (sigaction(signals[i], &sa, NULL) < 0)
-            imp_warn ("sigaction (signal=%d): %s",
-                      signals[i],
-                      strerror (errno));
-    }
     if (sigprocmask (SIG_SETMASK, &mask, NULL) < 0)
        imp_die (1, "failed to block signals: %s", strerror (errno));
+
+    sigemptyset (&mask);
+    for (i = 0; i < nsignals; i++)
+        sigaddset (&mask, signals[i]);
+    if ((imp_sigfd = signalfd (-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) < 0)
+        imp_die (1, "signalfd: %s", strerror (errno));
+
+    /*  A pidfd cannot address a process group, so it is only used when
+     *  signals are forwarded to a single process. It is also used to
+     *  detect child exit, with SIGCHLD as the fallback on kernels
+     *  without pidfd_open(2).
+     */
+    if (imp_child > 0
+        && (imp_child_pidfd = sys_pidfd_open (imp_child)) < 0)
+        imp_debug ("pidfd_open: %s", strerror (errno));
+}
+
+int imp_wait_child (pid_t child, int *statusp)
+{
+    struct pollfd pfds[2] = {
+        { .fd = imp_sigfd,       .events = POLLIN },
+        { .fd = imp_child_pidfd, .events = POLLIN },
+    };
+    pid_t pid;
+
+    /*  Note: poll(2) ignores the pidfd entry if it is -1.
+     */
+    while ((pid = waitpid (child, statusp, WNOHANG)) == 0) {
+        if (poll (pfds, 2, -1) < 0)
+            return -1;
+        if ((pfds[0].revents & POLLIN) && signalfd_forward () < 0)
+            return -1;
+    }
+    if (pid < 0)
+        return -1;
+    /*  The child has been reaped, so stop forwarding signals to it.
+     *  A process group (imp_child < 0) may outlive its leader.
+     */
+    if (imp_child_pidfd >= 0) {
+        close (imp_child_pidfd);
+        imp_child_pidfd = -1;
+    }
+    if (imp_child > 0)
+        imp_child = -1;
+    return 0;
+}
+
+int imp_wait_cgroup (void)
+{
+    struct cgroup_info *cgroup = imp_state->cgroup;
+    struct pollfd pfds[2] = {
+        { .fd = imp_sigfd, .events = POLLIN },
+        { .fd = -1,        .events = POLLPRI },
+    };
+    int rc = -1;
+
+    /*  Only wait for empty cgroup if cgroup kill is enabled.
+     */
+    if (!cgroup->use_cgroup_kill)
+        return 0;
+
+    if ((pfds[1].fd = cgroup_events_open (cgroup)) < 0 && errno != ENOENT)
+        imp_warn ("cgroup: failed to open cgroup.events: %s",
+                  strerror (errno));
+
+    for (;;) {
+        int timeout = -1;
+
+        if (pfds[1].fd >= 0) {
+            int populated = cgroup_events_populated (pfds[1].fd);
+            if (populated < 0)
+                imp_warn ("cgroup: failed to read cgroup.events: %s",
+                          strerror (errno));
+            if (populated <= 0) {
+                close (pfds[1].fd);
+                pfds[1].fd = -1;
+            }
+        }
+        /*  Processes may remain in the IMP's own cgroup, and
+         *  cgroup.procs cannot be polled, so once cgroup.events is
+         *  unavailable or reports empty check cgroup.procs every 1s.
+         */
+        if (pfds[1].fd < 0) {
+            if (cgroup_kill (cgroup, 0) <= 0)
+                break;
+            timeout = 1000;
+        }
+        if (poll (pfds, 2, timeout) < 0)
+            goto out;
+        if ((pfds[0].revents & POLLIN) && signalfd_forward () < 0)
+            goto out;
+    }
+    cgroup_child_remove (cgroup);
+    rc = 0;
+out:
+    if (pfds[1].fd >= 0) {
+        int saved_errno = errno;
+        close (pfds[1].fd);
+        errno = saved_errno;
+    }
+    return rc;
 }
 
 void imp_raise (int sig)
 {
+    sigset_t mask;
+
+    /*  sig may be blocked by imp_setup_signal_forwarding()
+     */
     signal (sig, SIG_DFL);
+    sigemptyset (&mask);
+    sigaddset (&mask, sig);
+    (void) sigprocmask (SIG_UNBLOCK, &mask, NULL);
     if (raise (sig) == 0)
         pause ();
     /*  If we get here, either raise(3) failed or for some reason signal
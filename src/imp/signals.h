@@ -19,10 +19,23 @@
  */
 void imp_set_signal_child (pid_t pid);
 
-/*  Setup RFC 15 standard IMP signal forwarding
+/*  Setup RFC 15 standard IMP signal forwarding. Must be called in the
+ *  parent after imp_set_signal_child(). Signals are only forwarded while
+ *  blocked in imp_wait_child() or imp_wait_cgroup().
  */
 void imp_setup_signal_forwarding (struct imp_state *imp);
 
+/*  Forward signals until 'child' exits, then store its wait status
+ *  in 'statusp'. Returns -1 with errno set on failure.
+ */
+int imp_wait_child (pid_t child, int *statusp);
+
+/*  Forward signals until all processes in the job cgroup (except the
+ *  IMP) have exited. Returns 0 immediately if the IMP does not own
+ *  its cgroup.
+ */
+int imp_wait_cgroup (void);
+
 void imp_sigblock_all (void);
 
 void imp_sigunblock_all (void);
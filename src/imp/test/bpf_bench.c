@@ -0,0 +1,140 @@
+/************************************************************\
+ * Copyright 2026 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* bpf_bench - measure cgroup device BPF programs in userspace
+ *
+ * Usage: bpf_bench [ENTRIES [ITERATIONS]]
+ *
+ * Build a device filter for a synthetic policy of ENTRIES entries
+ * (default DEVICE_ALLOW_MAX_ENTRIES), then report the program size and
+ * the instructions executed and time taken per access for allowed and
+ * denied requests.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <linux/bpf.h>
+
+#include "cgroup_device.h"
+#include "test/bpf_eval.h"
+
+static double now (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void die (const char *msg)
+{
+    fprintf (stderr, "bpf_bench: %s: %s\n", msg, strerror (errno));
+    exit (1);
+}
+
+/* Evaluate 'ctx' 'iterations' times and print instructions executed
+ * and average time per evaluation.
+ */
+static void bench (const char *name,
+                   struct bpf_insn *insns,
+                   size_t count,
+                   struct bpf_cgroup_dev_ctx *ctx,
+                   int iterations)
+{
+    int result = -1;
+    int steps = 0;
+    double t0 = now ();
+
+    for (int i = 0; i < iterations; i++) {
+        if (bpf_eval (insns, count, ctx, &result, &steps) < 0)
+            die ("bpf_eval");
+    }
+    printf ("%-16s result=%-5s insns=%-4d %8.1f ns/eval\n",
+            name,
+            result ? "allow" : "deny",
+            steps,
+            (now () - t0) * 1e9 / iterations);
+}
+
+int main (int argc, char *argv[])
+{
+    int entries = argc > 1 ? atoi (argv[1]) : DEVICE_ALLOW_MAX_ENTRIES;
+    int iterations = argc > 2 ? atoi (argv[2]) : 100000;
+    struct device_allow da;
+    struct bpf_insn *insns;
+    size_t count;
+    double t0;
+    int last;
+
+    if (entries < 1 || iterations < 1) {
+        fprintf (stderr, "Usage: bpf_bench [ENTRIES [ITERATIONS]]\n");
+        exit (1);
+    }
+    if (!(da.entries = calloc (entries, sizeof (da.entries[0]))))
+        die ("calloc");
+
+    /* Synthetic policy: char devices, 16 minors per major (GPU-like)
+     */
+    for (int i = 0; i < entries; i++) {
+        da.entries[i].type = 'c';
+        da.entries[i].major = 200 + i / 16;
+        da.entries[i].minor = i % 16;
+        strcpy (da.entries[i].access, "rw");
+    }
+    da.count = entries;
+
+    t0 = now ();
+    if (!(insns = cgroup_device_prog_build (&da, &count)))
+        die ("cgroup_device_prog_build");
+    printf ("%d entries: %zu instructions, built in %.1f us\n",
+            entries,
+            count,
+            (now () - t0) * 1e6);
+
+    last = entries - 1;
+    struct bpf_cgroup_dev_ctx first_ctx = {
+        .access_type = (BPF_DEVCG_ACC_READ << 16) | BPF_DEVCG_DEV_CHAR,
+        .major = 200,
+        .minor = 0,
+    };
+    struct bpf_cgroup_dev_ctx last_ctx = {
+        .access_type = (BPF_DEVCG_ACC_READ << 16) | BPF_DEVCG_DEV_CHAR,
+        .major = 200 + last / 16,
+        .minor = last % 16,
+    };
+    struct bpf_cgroup_dev_ctx deny_ctx = {
+        .access_type = (BPF_DEVCG_ACC_READ << 16) | BPF_DEVCG_DEV_CHAR,
+        .major = 1,
+        .minor = 3,
+    };
+    struct bpf_cgroup_dev_ctx deny_access_ctx = {
+        .access_type = (BPF_DEVCG_ACC_MKNOD << 16) | BPF_DEVCG_DEV_CHAR,
+        .major = 200,
+        .minor = 0,
+    };
+    bench ("allow-first", insns, count, &first_ctx, iterations);
+    bench ("allow-last", insns, count, &last_ctx, iterations);
+    bench ("deny-device", insns, count, &deny_ctx, iterations);
+    bench ("deny-access", insns, count, &deny_access_ctx, iterations);
+
+    free (insns);
+    free (da.entries);
+    return 0;
+}
+
+/*
+ * vi: ts=4 sw=4 expandtab
+ */
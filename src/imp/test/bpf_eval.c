@@ -0,0 +1,156 @@
+/************************************************************\
+ * Copyright 2026 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+#include "bpf_eval.h"
+
+/* Kernel limit on instructions processed for unprivileged programs */
+#define BPF_EVAL_MAX_STEPS 1000000
+
+static int alu (int op, uint64_t *dst, uint64_t src, bool is64)
+{
+    uint64_t d = *dst;
+    int shift_max = is64 ? 64 : 32;
+
+    if (!is64) {
+        d = (uint32_t) d;
+        src = (uint32_t) src;
+    }
+    switch (op) {
+        case BPF_MOV: d = src; break;
+        case BPF_ADD: d += src; break;
+        case BPF_SUB: d -= src; break;
+        case BPF_AND: d &= src; break;
+        case BPF_OR:  d |= src; break;
+        case BPF_XOR: d ^= src; break;
+        case BPF_LSH:
+        case BPF_RSH:
+            if (src >= (uint64_t) shift_max)
+                return -1;
+            d = op == BPF_LSH ? d << src : d >> src;
+            break;
+        default:
+            return -1;
+    }
+    *dst = is64 ? d : (uint32_t) d;
+    return 0;
+}
+
+static int jmp_cond (int op, uint64_t dst, uint64_t src, bool *takenp)
+{
+    switch (op) {
+        case BPF_JA:   *takenp = true; break;
+        case BPF_JEQ:  *takenp = dst == src; break;
+        case BPF_JNE:  *takenp = dst != src; break;
+        case BPF_JGT:  *takenp = dst > src; break;
+        case BPF_JGE:  *takenp = dst >= src; break;
+        case BPF_JLT:  *takenp = dst < src; break;
+        case BPF_JLE:  *takenp = dst <= src; break;
+        case BPF_JSET: *takenp = (dst & src) != 0; break;
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+int bpf_eval (const struct bpf_insn *insns,
+              size_t count,
+              const struct bpf_cgroup_dev_ctx *ctx,
+              int *resultp,
+              int *stepsp)
+{
+    uint64_t regs[MAX_BPF_REG] = { 0 };
+    size_t pc = 0;
+    int steps = 0;
+
+    if (!insns || !ctx || !resultp) {
+        errno = EINVAL;
+        return -1;
+    }
+    while (pc < count) {
+        const struct bpf_insn *insn = &insns[pc++];
+        int class = BPF_CLASS (insn->code);
+        uint64_t src;
+        bool taken;
+
+        if (++steps > BPF_EVAL_MAX_STEPS) {
+            errno = ELOOP;
+            return -1;
+        }
+        if (insn->dst_reg >= MAX_BPF_REG || insn->src_reg >= MAX_BPF_REG)
+            goto inval;
+        if (BPF_SRC (insn->code) == BPF_X)
+            src = regs[insn->src_reg];
+        else
+            src = (uint64_t) (int64_t) insn->imm;
+
+        switch (class) {
+            case BPF_LDX:
+                /* Only 32-bit loads from the context (r1) are supported.
+                 */
+                if (insn->code != (BPF_LDX | BPF_W | BPF_MEM)
+                    || insn->src_reg != BPF_REG_1
+                    || insn->off < 0
+                    || insn->off % 4 != 0
+                    || (size_t) insn->off + 4 > sizeof (*ctx))
+                    goto inval;
+                {
+                    uint32_t val;
+                    memcpy (&val, (const char *) ctx + insn->off, 4);
+                    regs[insn->dst_reg] = val;
+                }
+                break;
+            case BPF_ALU:
+            case BPF_ALU64:
+                if (alu (BPF_OP (insn->code),
+                         &regs[insn->dst_reg],
+                         src,
+                         class == BPF_ALU64) < 0)
+                    goto inval;
+                break;
+            case BPF_JMP:
+                if (BPF_OP (insn->code) == BPF_EXIT) {
+                    *resultp = (int) regs[BPF_REG_0];
+                    if (stepsp)
+                        *stepsp = steps;
+                    return 0;
+                }
+                if (jmp_cond (BPF_OP (insn->code),
+                              regs[insn->dst_reg],
+                              src,
+                              &taken) < 0)
+                    goto inval;
+                if (taken) {
+                    if ((insn->off < 0 && (size_t) -insn->off > pc)
+                        || pc + insn->off > count)
+                        goto inval;
+                    pc += insn->off;
+                }
+                break;
+            default:
+                goto inval;
+        }
+    }
+    /* Fell off the end of the program without BPF_EXIT */
+inval:
+    errno = EINVAL;
+    return -1;
+}
+
+/* vi: ts=4 sw=4 expandtab
+ */
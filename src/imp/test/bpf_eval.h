@@ -0,0 +1,33 @@
+/************************************************************\
+ * Copyright 2026 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef HAVE_IMP_TEST_BPF_EVAL_H
+#define HAVE_IMP_TEST_BPF_EVAL_H 1
+
+#include <stddef.h>
+#include <linux/bpf.h>
+
+/* Userspace interpreter for the subset of BPF used by cgroup device
+ * programs (32-bit loads from the context, ALU/ALU64, conditional and
+ * unconditional jumps, exit).
+ *
+ * Run 'insns' with r1 pointing to 'ctx'. On success, set *resultp to
+ * the value of r0 at exit and, if stepsp is non-NULL, *stepsp to the
+ * number of instructions executed, then return 0.
+ * Returns -1 with errno set to EINVAL for an unsupported or malformed
+ * instruction, or ELOOP if the instruction limit is exceeded.
+ */
+int bpf_eval (const struct bpf_insn *insns,
+              size_t count,
+              const struct bpf_cgroup_dev_ctx *ctx,
+              int *resultp,
+              int *stepsp);
+
+#endif /* !HAVE_IMP_TEST_BPF_EVAL_H */
@@ -0,0 +1,322 @@
+/************************************************************\
+ * Copyright 2026 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <linux/bpf.h>
+
+#include "cgroup_device.h"
+#include "test/bpf_eval.h"
+
+#include "src/libtap/tap.h"
+
+/* Maximum instructions a lookup may execute in a DEVICE_ALLOW_MAX_ENTRIES
+ * policy. A linear program would need thousands.
+ */
+#define MAX_LOOKUP_STEPS 40
+
+struct prog {
+    struct bpf_insn *insns;
+    size_t count;
+};
+
+static struct device_allow *da_create (int count)
+{
+    struct device_allow *da;
+    if (!(da = calloc (1, sizeof (*da)))
+        || !(da->entries = calloc (count + 1, sizeof (da->entries[0]))))
+        BAIL_OUT ("out of memory");
+    return da;
+}
+
+static void da_destroy (struct device_allow *da)
+{
+    if (da) {
+        free (da->entries);
+        free (da);
+    }
+}
+
+static void da_add (struct device_allow *da,
+                    char type,
+                    int major,
+                    int minor,
+                    const char *access)
+{
+    struct device_allow_entry *e = &da->entries[da->count++];
+    e->type = type;
+    e->major = major;
+    e->minor = minor;
+    snprintf (e->access, sizeof (e->access), "%s", access);
+}
+
+static void prog_build (struct prog *p, struct device_allow *da)
+{
+    if (!(p->insns = cgroup_device_prog_build (da, &p->count)))
+        BAIL_OUT ("cgroup_device_prog_build: %s", strerror (errno));
+}
+
+static int access_mask (const char *access)
+{
+    int mask = 0;
+    if (strchr (access, 'r'))
+        mask |= BPF_DEVCG_ACC_READ;
+    if (strchr (access, 'w'))
+        mask |= BPF_DEVCG_ACC_WRITE;
+    if (strchr (access, 'm'))
+        mask |= BPF_DEVCG_ACC_MKNOD;
+    return mask;
+}
+
+/* Evaluate program for device type:major:minor with access and return
+ * 1 (allow), 0 (deny), or -1 on evaluator failure.
+ */
+static int check (struct prog *p,
+                  char type,
+                  int major,
+                  int minor,
+                  const char *access,
+                  int *stepsp)
+{
+    struct bpf_cgroup_dev_ctx ctx;
+    int dev_type = type == 'b' ? BPF_DEVCG_DEV_BLOCK : BPF_DEVCG_DEV_CHAR;
+    int result;
+
+    ctx.access_type = (access_mask (access) << 16) | dev_type;
+    ctx.major = major;
+    ctx.minor = minor;
+    if (bpf_eval (p->insns, p->count, &ctx, &result, stepsp) < 0) {
+        diag ("bpf_eval: %s", strerror (errno));
+        return -1;
+    }
+    return result;
+}
+
+static void test_empty (void)
+{
+    struct device_allow *da = da_create (0);
+    struct prog p;
+
+    prog_build (&p, da);
+    ok (check (&p, 'c', 1, 3, "r", NULL) == 0,
+        "empty policy denies c 1:3 r");
+    ok (check (&p, 'b', 8, 0, "", NULL) == 0,
+        "empty policy denies b 8:0 with no access bits");
+    free (p.insns);
+    da_destroy (da);
+}
+
+static void test_exact (void)
+{
+    struct device_allow *da = da_create (2);
+    struct prog p;
+
+    da_add (da, 'c', 1, 3, "rw");
+    da_add (da, 'b', 8, 1, "r");
+    prog_build (&p, da);
+
+    ok (check (&p, 'c', 1, 3, "r", NULL) == 1,
+        "c 1:3 r allowed");
+    ok (check (&p, 'c', 1, 3, "rw", NULL) == 1,
+        "c 1:3 rw allowed");
+    ok (check (&p, 'c', 1, 3, "m", NULL) == 0,
+        "c 1:3 m denied");
+    ok (check (&p, 'c', 1, 3, "rwm", NULL) == 0,
+        "c 1:3 rwm denied");
+    ok (check (&p, 'c', 1, 4, "r", NULL) == 0,
+        "c 1:4 r denied");
+    ok (check (&p, 'b', 1, 3, "r", NULL) == 0,
+        "b 1:3 r denied (type mismatch)");
+    ok (check (&p, 'b', 8, 1, "r", NULL) == 1,
+        "b 8:1 r allowed");
+    ok (check (&p, 'b', 8, 1, "w", NULL) == 0,
+        "b 8:1 w denied");
+    free (p.insns);
+    da_destroy (da);
+}
+
+static void test_wildcard (void)
+{
+    struct device_allow *da = da_create (3);
+    struct prog p;
+
+    da_add (da, 'c', 136, -1, "rw");
+    da_add (da, 'c', 136, 5, "m");
+    da_add (da, 'c', 136, 6, "r");  /* redundant with wildcard */
+    prog_build (&p, da);
+
+    ok (check (&p, 'c', 136, 0, "rw", NULL) == 1,
+        "c 136:0 rw allowed by wildcard");
+    ok (check (&p, 'c', 136, 0, "m", NULL) == 0,
+        "c 136:0 m denied");
+    ok (check (&p, 'c', 136, 5, "m", NULL) == 1,
+        "c 136:5 m allowed by exact entry");
+    ok (check (&p, 'c', 136, 5, "rw", NULL) == 1,
+        "c 136:5 rw allowed by wildcard");
+    ok (check (&p, 'c', 136, 5, "rm", NULL) == 0,
+        "c 136:5 rm denied (no single entry allows it)");
+    ok (check (&p, 'c', 136, 6, "w", NULL) == 1,
+        "c 136:6 w allowed by wildcard");
+    ok (check (&p, 'c', 137, 0, "r", NULL) == 0,
+        "c 137:0 r denied");
+    free (p.insns);
+    da_destroy (da);
+}
+
+static void test_split_access (void)
+{
+    struct device_allow *da = da_create (3);
+    struct prog p;
+
+    da_add (da, 'c', 1, 3, "r");
+    da_add (da, 'c', 1, 3, "w");
+    da_add (da, 'c', 1, 3, "w");
+    prog_build (&p, da);
+
+    ok (check (&p, 'c', 1, 3, "r", NULL) == 1,
+        "c 1:3 r allowed");
+    ok (check (&p, 'c', 1, 3, "w", NULL) == 1,
+        "c 1:3 w allowed");
+    ok (check (&p, 'c', 1, 3, "rw", NULL) == 0,
+        "c 1:3 rw denied by separate r and w entries");
+    free (p.insns);
+    da_destroy (da);
+}
+
+static void test_invalid_entries (void)
+{
+    struct device_allow *da = da_create (2);
+    struct prog p;
+    size_t count;
+
+    errno = 0;
+    ok (cgroup_device_prog_build (NULL, &count) == NULL && errno == EINVAL,
+        "cgroup_device_prog_build da=NULL fails with EINVAL");
+    errno = 0;
+    ok (cgroup_device_prog_build (da, NULL) == NULL && errno == EINVAL,
+        "cgroup_device_prog_build countp=NULL fails with EINVAL");
+
+    da_add (da, 'c', -1, 3, "rwm");
+    da_add (da, 'c', 1, -5, "rwm");
+    prog_build (&p, da);
+    ok (check (&p, 'c', 0xffffffff, 3, "r", NULL) == 0,
+        "negative major never matches");
+    ok (check (&p, 'c', 1, 0xfffffffb, "r", NULL) == 0,
+        "negative minor never matches");
+    free (p.insns);
+    da_destroy (da);
+}
+
+static void test_large (void)
+{
+    struct device_allow *da = da_create (DEVICE_ALLOW_MAX_ENTRIES);
+    struct prog p;
+    int steps;
+    int max_steps = 0;
+    int errors = 0;
+
+    /* Groups of 7 exact minors on major M, plus a wildcard on major M+1.
+     * Majors are spaced by 3 so that M+2 is never in the policy.
+     */
+    for (int i = 0; i < DEVICE_ALLOW_MAX_ENTRIES; i++) {
+        int major = 10 + (i / 8) * 3;
+        char type = (i / 8) % 2 ? 'c' : 'b';
+        if (i % 8 == 7)
+            da_add (da, type, major + 1, -1, "rw");
+        else
+            da_add (da, type, major, (i % 8) * 2, "rw");
+    }
+    prog_build (&p, da);
+    diag ("%d entries: %zu instructions", da->count, p.count);
+
+    for (int i = 0; i < da->count; i++) {
+        struct device_allow_entry *e = &da->entries[i];
+        int minor = e->minor < 0 ? 1000 : e->minor;
+        int deny_major = e->minor < 0 ? e->major + 1 : e->major + 2;
+
+        if (check (&p, e->type, e->major, minor, "rw", &steps) != 1
+            || check (&p, e->type, e->major, minor, "m", &steps) != 0)
+            errors++;
+        if (steps > max_steps)
+            max_steps = steps;
+        if (check (&p, e->type, deny_major, minor, "r", &steps) != 0
+            || (e->minor >= 0
+                && check (&p, e->type, e->major, minor + 1, "r", &steps) != 0))
+            errors++;
+        if (steps > max_steps)
+            max_steps = steps;
+    }
+    ok (errors == 0,
+        "%d entries evaluated as expected", da->count);
+    ok (max_steps <= MAX_LOOKUP_STEPS,
+        "worst case lookup executed %d instructions (<= %d)",
+        max_steps,
+        MAX_LOOKUP_STEPS);
+    free (p.insns);
+    da_destroy (da);
+}
+
+static void test_eval_errors (void)
+{
+    struct bpf_cgroup_dev_ctx ctx = { 0 };
+    int result;
+    struct bpf_insn no_exit[] = {
+        { .code = BPF_ALU64 | BPF_MOV | BPF_K, .dst_reg = BPF_REG_0 },
+    };
+    struct bpf_insn bad_load[] = {
+        { .code = BPF_LDX | BPF_W | BPF_MEM,
+          .dst_reg = BPF_REG_2,
+          .src_reg = BPF_REG_1,
+          .off = 12 },
+        { .code = BPF_JMP | BPF_EXIT },
+    };
+    struct bpf_insn loop[] = {
+        { .code = BPF_JMP | BPF_JA, .off = -1 },
+        { .code = BPF_JMP | BPF_EXIT },
+    };
+    struct bpf_insn call[] = {
+        { .code = BPF_JMP | BPF_CALL, .imm = 1 },
+        { .code = BPF_JMP | BPF_EXIT },
+    };
+
+    errno = 0;
+    ok (bpf_eval (no_exit, 1, &ctx, &result, NULL) < 0 && errno == EINVAL,
+        "bpf_eval fails with EINVAL on missing exit");
+    errno = 0;
+    ok (bpf_eval (bad_load, 2, &ctx, &result, NULL) < 0 && errno == EINVAL,
+        "bpf_eval fails with EINVAL on out of bounds load");
+    errno = 0;
+    ok (bpf_eval (loop, 2, &ctx, &result, NULL) < 0 && errno == ELOOP,
+        "bpf_eval fails with ELOOP on infinite loop");
+    errno = 0;
+    ok (bpf_eval (call, 2, &ctx, &result, NULL) < 0 && errno == EINVAL,
+        "bpf_eval fails with EINVAL on unsupported instruction");
+}
+
+int main (void)
+{
+    plan (NO_PLAN);
+
+    test_empty ();
+    test_exact ();
+    test_wildcard ();
+    test_split_access ();
+    test_invalid_entries ();
+    test_large ();
+    test_eval_errors ();
+
+    done_testing ();
+}
+
+/*
+ * vi: ts=4 sw=4 expandtab
+ */
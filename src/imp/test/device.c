@@ -186,6 +186,37 @@ static void test_block_class_entry (void)
     json_decref (opts);
 }
 
+static void test_multiple_class_entries (void)
+{
+    /* Several class specifiers resolved from one read of /proc/devices.
+     * mem (major 1) is a char class only, loop (major 7) a block class only.
+     */
+    json_t *allow = json_pack ("[[ss][ss][ss][ss][ss]]",
+                               "char-mem", "r",
+                               "block-loop", "rw",
+                               "char-pts", "rw",
+                               "char-mem", "w",
+                               "block-mem", "rwm");
+    json_t *opts = make_options ("strict", allow);
+    struct device_allow *da = NULL;
+    if (!opts)
+        BAIL_OUT ("make_options failed");
+
+    ok (device_allow_from_options (opts, &da) == 0 && da != NULL,
+        "from_options: strict with multiple classes returns 0");
+    ok (da && da_contains (da, 'c', 1, -1, "r")
+        && da_contains (da, 'c', 1, -1, "w"),
+        "from_options: char-mem resolved twice with each access");
+    ok (da && da_contains (da, 'b', 7, -1, "rw"),
+        "from_options: block-loop resolved after char-mem");
+    ok (da && da_contains (da, 'c', -2, -1, "rw"),
+        "from_options: char-pts resolved");
+    ok (da && !da_contains (da, 'b', 1, -1, "rwm"),
+        "from_options: block-mem not found in block devices");
+    device_allow_destroy (da);
+    json_decref (opts);
+}
+
 static void test_nonexistent_path (void)
 {
     /* Non-existent path is a warning, not an error (fail-closed: skip entry) */
@@ -502,6 +533,7 @@ int main (void)
     test_path_entry ();
     test_class_entry ();
     test_block_class_entry ();
+    test_multiple_class_entries ();
     test_nonexistent_path ();
     test_invalid_access ();
     test_unknown_specifier ();
@@ -140,8 +140,11 @@ static void pid_kill_tests (void)
     if ((pid = testchild_create (3)) < 0)
         BAIL_OUT ("testchild_create failed!");
 
+    ok (pid_kill_children_fallback (pid, 0) == 3,
+        "pid_kill_children_fallback (%d, 0) returned 3", (int) pid);
     ok (pid_kill_children_fallback (pid, SIGTERM) == 3,
-        "pid_kill_children_fallback (%d) returned 3", (int) pid);
+        "pid_kill_children_fallback (%d) returned 3 from reused snapshot",
+        (int) pid);
     ok (waitpid (pid, &status, 0) == pid,
         "waitpid returned %d",
         pid);
@@ -150,9 +153,62 @@ static void pid_kill_tests (void)
 
 }
 
+static void pid_tree_tests (void)
+{
+    struct pid_tree *t;
+    pid_t pid;
+    int status;
+
+    errno = 0;
+    ok (pid_tree_update (NULL) < 0 && errno == EINVAL,
+        "pid_tree_update (NULL) returns EINVAL");
+    errno = 0;
+    ok (pid_tree_kill_children (NULL, 1, 0) < 0 && errno == EINVAL,
+        "pid_tree_kill_children (NULL) returns EINVAL");
+
+    if ((pid = testchild_create (2)) < 0)
+        BAIL_OUT ("testchild_create failed!");
+
+    ok ((t = pid_tree_create ()) != NULL,
+        "pid_tree_create works");
+    ok (pid_tree_kill_children (t, pid, 0) == 2,
+        "pid_tree_kill_children (%d, 0) returned 2", (int) pid);
+    ok (pid_tree_kill_children (t, getpid (), 0) >= 1,
+        "pid_tree_kill_children (getpid (), 0) finds test child");
+    ok (pid_tree_kill_children (t, pid, SIGTERM) == 2,
+        "pid_tree_kill_children (%d, SIGTERM) returned 2", (int) pid);
+    ok (waitpid (pid, &status, 0) == pid,
+        "waitpid returned %d",
+        pid);
+    ok (WIFEXITED (status) && WEXITSTATUS (status) == SIGTERM + 128,
+        "child exited with 128 + SIGTERM");
+
+    /*  Stale snapshot: children of the reaped test child are skipped */
+    ok (pid_tree_kill_children (t, pid, 0) == 0,
+        "pid_tree_kill_children on stale snapshot returned 0");
+
+    /*  Reuse the snapshot for a new test child */
+    if ((pid = testchild_create (1)) < 0)
+        BAIL_OUT ("testchild_create failed!");
+    ok (pid_tree_kill_children (t, pid, 0) == 0,
+        "new child not found before pid_tree_update");
+    ok (pid_tree_update (t) == 0,
+        "pid_tree_update works");
+    ok (pid_tree_kill_children (t, pid, SIGTERM) == 1,
+        "pid_tree_kill_children (%d) returned 1 after update", (int) pid);
+    ok (waitpid (pid, &status, 0) == pid,
+        "waitpid returned %d",
+        pid);
+    ok (WIFEXITED (status) && WEXITSTATUS (status) == SIGTERM + 128,
+        "child exited with 128 + SIGTERM");
+
+    pid_tree_destroy (t);
+}
+
 int main (void)
 {
     pid_kill_tests ();
+    pid_tree_tests ();
     done_testing ();
 }
 
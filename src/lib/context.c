@@ -16,6 +16,8 @@
 #include <stdarg.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
 
 #include "src/libutil/cf.h"
 #include "src/libutil/aux.h"
@@ -23,31 +25,59 @@
 #include "context.h"
 #include "context_private.h"
 
+struct security_error {
+    char error[200];
+    int errnum;
+};
+
 struct flux_security {
     cf_t *config;
     int flags;
+    bool shared;
+    pthread_mutex_t lock;       // protects aux
     struct aux_item *aux;
-    char error[200];
-    int errnum;
+    struct security_error err;
 };
 
+/* Error state of a shared context is kept per thread, for the last
+ * shared context that raised an error in the thread.
+ */
+static __thread struct {
+    const flux_security_t *ctx;
+    struct security_error err;
+} thread_error;
+
+static struct security_error *error_state (flux_security_t *ctx)
+{
+    if (ctx->shared) {
+        if (thread_error.ctx != ctx) {
+            thread_error.ctx = ctx;
+            thread_error.err.error[0] = '\0';
+            thread_error.err.errnum = 0;
+        }
+        return &thread_error.err;
+    }
+    return &ctx->err;
+}
+
 /* Capture errno in ctx->errno, and an error message in ctx->error.
  * If 'fmt' is non-NULL, build message; otherwise use strerror (errno).
  */
 void security_error (flux_security_t *ctx, const char *fmt, ...)
 {
     if (ctx) {
-        size_t sz = sizeof (ctx->error);
-        ctx->errnum = errno;
+        struct security_error *err = error_state (ctx);
+        size_t sz = sizeof (err->error);
+        err->errnum = errno;
         if (fmt) {
             va_list ap;
             va_start (ap, fmt);
-            vsnprintf (ctx->error, sz, fmt, ap);
+            vsnprintf (err->error, sz, fmt, ap);
             va_end (ap);
         }
         else
-            snprintf (ctx->error, sz, "%s", strerror (ctx->errnum));
-        errno = ctx->errnum;
+            snprintf (err->error, sz, "%s", strerror (err->errnum));
+        errno = err->errnum;
     }
 }
 
@@ -76,6 +106,7 @@ flux_security_t *flux_security_create (int flags)
     if (!(ctx = calloc (1, sizeof (*ctx))))
         return NULL;
     ctx->flags = flags;
+    pthread_mutex_init (&ctx->lock, NULL);
     return ctx;
 }
 
@@ -84,18 +115,20 @@ void flux_security_destroy (flux_security_t *ctx)
     if (ctx) {
         aux_destroy (&ctx->aux);
         cf_destroy (ctx->config);
+        pthread_mutex_destroy (&ctx->lock);
         free (ctx);
     }
 }
 
 const char *flux_security_last_error (flux_security_t *ctx)
 {
-    return (ctx && *ctx->error) ? ctx->error : NULL;
+    struct security_error *err = ctx ? error_state (ctx) : NULL;
+    return (err && *err->error) ? err->error : NULL;
 }
 
 int flux_security_last_errnum (flux_security_t *ctx)
 {
-    return ctx ? ctx->errnum : 0;
+    return ctx ? error_state (ctx)->errnum : 0;
 }
 
 int flux_security_configure (flux_security_t *ctx, const char *pattern)
@@ -108,6 +141,11 @@ int flux_security_configure (flux_security_t *ctx, const char *pattern)
         errno = EINVAL;
         return -1;
     }
+    if (ctx->shared) {
+        errno = EBUSY;
+        security_error (ctx, "context is shared and cannot be reconfigured");
+        return -1;
+    }
     if (!pattern)
         pattern = INSTALLED_CF_PATTERN;
     if (!(cf = cf_create ())) {
@@ -150,14 +188,38 @@ error:
     return -1;
 }
 
+int flux_security_share (flux_security_t *ctx)
+{
+    if (!ctx) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!ctx->shared) {
+        if (sign_share (ctx) < 0)
+            return -1;
+        ctx->shared = true;
+    }
+    return 0;
+}
+
 int flux_security_aux_set (flux_security_t *ctx, const char *name,
                            void *data, flux_security_free_f freefun)
 {
+    int rc;
+
     if (!ctx) {
         errno = EINVAL;
         goto error;
     }
-    if (aux_set (&ctx->aux, name, data, freefun) < 0)
+    pthread_mutex_lock (&ctx->lock);
+    if (ctx->shared && name && aux_get (ctx->aux, name)) {
+        errno = EEXIST;
+        rc = -1;
+    }
+    else
+        rc = aux_set (&ctx->aux, name, data, freefun);
+    pthread_mutex_unlock (&ctx->lock);
+    if (rc < 0)
         goto error;
     return 0;
 error:
@@ -173,7 +235,10 @@ void *flux_security_aux_get (flux_security_t *ctx, const char *name)
         errno = EINVAL;
         goto error;
     }
-    if (!(val = aux_get (ctx->aux, name)))
+    pthread_mutex_lock (&ctx->lock);
+    val = aux_get (ctx->aux, name);
+    pthread_mutex_unlock (&ctx->lock);
+    if (!val)
         goto error;
     return val;
 error:
@@ -223,6 +288,27 @@ int security_set_config (flux_security_t *ctx, const cf_t *cf)
     return (0);
 }
 
+flux_security_t *security_clone (flux_security_t *ctx)
+{
+    flux_security_t *new;
+
+    if (!ctx || !ctx->config) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return NULL;
+    }
+    if (!(new = flux_security_create (ctx->flags))) {
+        security_error (ctx, NULL);
+        return NULL;
+    }
+    if (security_set_config (new, ctx->config) < 0) {
+        security_error (ctx, "%s", flux_security_last_error (new));
+        flux_security_destroy (new);
+        return NULL;
+    }
+    return new;
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
@@ -32,6 +32,16 @@ int flux_security_last_errnum (flux_security_t *ctx);
 
 int flux_security_configure (flux_security_t *ctx, const char *pattern);
 
+/* Make a configured context safe to share between threads, as described
+ * in sign.h.  Once shared, the context cannot be reconfigured.
+ */
+int flux_security_share (flux_security_t *ctx);
+
+/* Set or replace 'data' under 'name', with destructor 'freefun'.  If 'data'
+ * is NULL, the existing value is removed.  Once the context is shared,
+ * existing values may be in use by other threads, so they cannot be
+ * replaced or removed, and this fails with EEXIST.
+ */
 int flux_security_aux_set (flux_security_t *ctx, const char *name,
 		           void *data, flux_security_free_f freefun);
 
@@ -29,4 +29,17 @@ const cf_t *security_get_config (flux_security_t *ctx, const char *key);
  */
 int security_set_config (flux_security_t *ctx, const cf_t *cf);
 
+/* Create a new context with the flags and a copy of the configuration
+ * of 'ctx', but none of its aux items or error state.  The clone may be
+ * used independently of 'ctx', e.g. by another thread.
+ */
+flux_security_t *security_clone (flux_security_t *ctx);
+
+/* Create the sign state of 'ctx' and initialize its default and allowed
+ * mechanisms, so that no state is created on first use by threads sharing
+ * the context.  Implemented in sign.c.
+ * Return 0 on success, -1 on failure with errno and context error set.
+ */
+int sign_share (flux_security_t *ctx);
+
 #endif /* !_FLUX_SECURITY_CONTEXT_PRIVATE_H */
@@ -14,33 +14,159 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/param.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
 #include <sodium.h>
 
 #include "src/libutil/cf.h"
 #include "src/libutil/kv.h"
 #include "src/libutil/macros.h"
+#include "src/libutil/base64.h"
 
 #include "context.h"
 #include "context_private.h"
 #include "sign.h"
 #include "sign_mech.h"
+#include "sign_cache.h"
+
+/* flux_sign_unwrap_batch() worker.  Each worker verifies every 'stride'th
+ * item starting at 'first' using its own context, so that mechanism state,
+ * error state, and unwrap scratch buffers are private to the worker thread.
+ * Payloads and error strings are appended to 'buf', which is reused by the
+ * next batch.
+ */
+struct sign_worker {
+    flux_security_t *ctx;
+    char *buf;
+    int bufsz;
+    int len;
+    pthread_t thread;
+    bool started;
+
+    struct flux_sign_unwrap_item *items;
+    int *offsets;
+    int count;
+    int first;
+    int stride;
+    int flags;
+    int failed;
+};
+
+/* State of an asynchronous operation.  Futures move from the pending
+ * queue to a worker, then to the completed queue, from which they are
+ * removed by flux_sign_async_next().
+ */
+enum {
+    FUTURE_PENDING,
+    FUTURE_RUNNING,
+    FUTURE_COMPLETE,
+    FUTURE_RETRIEVED,
+};
+
+struct flux_sign_future {
+    flux_security_t *ctx;
+    struct sign_async *async;
+    struct flux_sign_future *next;  // next in pending or completed queue
+    int state;
+    bool destroyed;                 // destroyed while running
+    bool unwrap;
+    void *arg;
+
+    char *mech_type;
+    int flags;
+    void *input;                    // copy of payload or signed input
+    int inputsz;
+
+    void *buf;                      // wrap output or unwrap payload
+    int bufsz;
+    int outputsz;
+    int64_t userid;
+    int errnum;
+    char *error;
+};
+
+struct future_queue {
+    struct flux_sign_future *head;
+    struct flux_sign_future *tail;
+};
+
+/* A worker thread for asynchronous operations, with a private clone
+ * of the context.
+ */
+struct async_worker {
+    struct sign_async *async;
+    flux_security_t *ctx;
+    pthread_t thread;
+};
+
+/* 'fd' is an eventfd in semaphore mode whose count is the number of
+ * futures in the completed queue.
+ */
+struct sign_async {
+    pthread_mutex_t lock;       // protects everything below
+    pthread_cond_t pending_cond;
+    pthread_cond_t complete_cond;
+    bool shutdown;
+    int fd;
+    struct async_worker *workers;
+    int nworkers;               // workers with a running thread
+    struct future_queue pending;
+    struct future_queue completed;
+};
 
 struct sign {
     const cf_t *config;
+    pthread_mutex_t lock;       // serializes mechanism init and batches
     void *wrapbuf;
     int wrapbufsz;
     void *unwrapbuf;
     int unwrapbufsz;
+    void *hdrbuf;
+    int hdrbufsz;
+    void *framebuf;             // version 2 frame, before armoring
+    int framebufsz;
+    int wrap_version;           // version produced by string wrap functions
+    struct sign_worker *workers;
+    int nworkers;
+    int *offsets;
+    int offsetsz;
+    struct sign_cache *cache;   // verified signatures, or NULL if disabled
+    bool cache_borrowed;        // batch workers use the parent's cache
+    struct sign_async *async;   // created by first asynchronous operation
+
+    /* Last encoded header and its base64 encoding.  Successive headers
+     * usually differ only near the end (e.g. timestamps), so the base64
+     * of their common prefix can be copied rather than recomputed.
+     */
+    pthread_mutex_t enclock;
+    char *encsrc;
+    int encsrclen;
+    int encsrcsz;
+    char *encdst;
+    int encdstsz;
 };
 
+/* Version 1 is the HEADER.PAYLOAD.SIGNATURE text format.
+ * Version 2 is the binary frame described below, which may also be
+ * armored as text.
+ */
 static const int64_t sign_version = 1;
+static const int64_t sign_version2 = 2;
+
+static const char *auxname = "flux::sign";
 
 static const struct cf_option sign_opts[] = {
     {"max-ttl",             CF_INT64,       true},
     {"default-type",        CF_STRING,      true},
     {"allowed-types",       CF_ARRAY,       true},
+    {"batch-workers",       CF_INT64,       false},
+    {"verify-cache-size",   CF_INT64,       false},
+    {"wrap-version",        CF_INT64,       false},
     CF_OPTIONS_TABLE_END,
 };
 
@@ -52,6 +178,8 @@ static const struct sign_mech *lookup_mech (const char *name)
         return &sign_mech_munge;
     if (!strcmp (name, "curve"))
         return &sign_mech_curve;
+    if (!strcmp (name, "hmac"))
+        return &sign_mech_hmac;
     return NULL;
 }
 
@@ -70,12 +198,29 @@ static int grow_buf (void **buf, int *bufsz, int newsz)
     return 0;
 }
 
+static void async_destroy (struct sign_async *async);
+
 static void sign_destroy (struct sign *sign)
 {
     if (sign) {
         int saved_errno = errno;
+        async_destroy (sign->async);
+        for (int i = 0; i < sign->nworkers; i++) {
+            flux_security_destroy (sign->workers[i].ctx);
+            free (sign->workers[i].buf);
+        }
+        free (sign->workers);
+        free (sign->offsets);
         free (sign->wrapbuf);
         free (sign->unwrapbuf);
+        free (sign->hdrbuf);
+        free (sign->framebuf);
+        free (sign->encsrc);
+        free (sign->encdst);
+        pthread_mutex_destroy (&sign->enclock);
+        if (!sign->cache_borrowed)
+            sign_cache_destroy (sign->cache);
+        pthread_mutex_destroy (&sign->lock);
         free (sign);
         errno = saved_errno;
     }
@@ -114,11 +259,15 @@ static struct sign *sign_create (flux_security_t *ctx)
     const char *default_type;
     const cf_t *allowed_types;
     int64_t max_ttl;
+    int64_t cache_size;
+    const cf_t *entry;
 
     if (!(sign = calloc (1, sizeof (*sign)))) {
         security_error (ctx, NULL);
         return NULL;
     }
+    pthread_mutex_init (&sign->lock, NULL);
+    pthread_mutex_init (&sign->enclock, NULL);
     if (!(sign->config = security_get_config (ctx, "sign")))
         goto error;
     if (cf_check (sign->config, sign_opts, CF_STRICT | CF_ANYTAB, &e) < 0) {
@@ -137,8 +286,38 @@ static struct sign *sign_create (flux_security_t *ctx)
     if (!validate_mech_array (ctx, allowed_types))
         goto error;
     default_type = cf_string (cf_get_in (sign->config, "default-type"));
-    if (!lookup_mech (default_type))
+    if (!lookup_mech (default_type)) {
+        errno = EINVAL;
+        security_error (ctx, "sign: unknown default-type=%s", default_type);
+        goto error;
+    }
+    if (cf_int64 (cf_get_in (sign->config, "batch-workers")) < 0) {
+        errno = EINVAL;
+        security_error (ctx, "sign: batch-workers should not be negative");
+        goto error;
+    }
+    sign->wrap_version = sign_version;
+    if ((entry = cf_get_in (sign->config, "wrap-version"))) {
+        sign->wrap_version = cf_int64 (entry);
+        if (sign->wrap_version != sign_version
+            && sign->wrap_version != sign_version2) {
+            errno = EINVAL;
+            security_error (ctx, "sign: wrap-version should be 1 or 2");
+            goto error;
+        }
+    }
+    cache_size = cf_int64 (cf_get_in (sign->config, "verify-cache-size"));
+    if (cache_size < 0 || cache_size > SIGN_CACHE_MAXSIZE) {
+        errno = EINVAL;
+        security_error (ctx, "sign: verify-cache-size is out of range");
         goto error;
+    }
+    if (cache_size > 0) {
+        if (!(sign->cache = sign_cache_create (cache_size))) {
+            security_error (ctx, NULL);
+            goto error;
+        }
+    }
     return sign;
 error:
     sign_destroy (sign);
@@ -147,7 +326,6 @@ error:
 
 static struct sign *sign_init (flux_security_t *ctx)
 {
-    const char *auxname = "flux::sign";
     struct sign *sign = flux_security_aux_get (ctx, auxname);
 
     if (!sign) {
@@ -165,26 +343,104 @@ error_nomsg:
     return NULL;
 }
 
+/* Call mech->init, if defined.  Calls are serialized so that threads
+ * sharing a context never race to create mechanism state.
+ * Return 0 on success, -1 on failure with errno and context error set.
+ */
+static int mech_init (flux_security_t *ctx, struct sign *sign,
+                      const struct sign_mech *mech)
+{
+    int rc = 0;
+
+    if (mech->init) {
+        pthread_mutex_lock (&sign->lock);
+        rc = mech->init (ctx, sign->config);
+        pthread_mutex_unlock (&sign->lock);
+    }
+    return rc;
+}
+
+int sign_share (flux_security_t *ctx)
+{
+    struct sign *sign;
+    const struct sign_mech *mech;
+    const cf_t *el;
+
+    if (!(sign = sign_init (ctx)))
+        return -1;
+    mech = lookup_mech (cf_string (cf_get_in (sign->config, "default-type")));
+    if (mech_init (ctx, sign, mech) < 0)
+        return -1;
+    for (int i = 0; (el = cf_get_at (cf_get_in (sign->config,
+                                                "allowed-types"), i)); i++) {
+        if (mech_init (ctx, sign, lookup_mech (cf_string (el))) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* Return the length of the common prefix of a and b, each of length n.
+ */
+static int common_prefix (const char *a, const char *b, int n)
+{
+    const int chunk = 64;
+    int i = 0;
+
+    while (i + chunk <= n && memcmp (a + i, b + i, chunk) == 0)
+        i += chunk;
+    while (i < n && a[i] == b[i])
+        i++;
+    return i;
+}
+
 /* Convert header to base64, storing in buf/bufsz, growing as needed.
  * Any existing content is overwritten.  Result is NULL terminated.
+ * Since base64 encodes each 3 byte group independently, the encoding of
+ * the part of the header that is unchanged since the last call, rounded
+ * down to a 3 byte boundary, is copied from sign->encdst.  If another
+ * thread is using the saved encoding, the header is encoded in full.
  * Return 0 on success, -1 on failure with errno set.
  */
-static int header_encode_cpy (struct kv *header, void **buf, int *bufsz)
+static int header_encode_cpy (struct sign *sign, struct kv *header,
+                              void **buf, int *bufsz)
 {
     const char *src;
     int srclen;
     char *dst;
     size_t dstlen;
+    int n = 0;
 
     if (kv_encode (header, &src, &srclen) < 0)
         return -1;
-    dstlen = sodium_base64_encoded_len (srclen,
-                                        sodium_base64_VARIANT_ORIGINAL);
+    dstlen = base64_encode_length (srclen);
     if (grow_buf (buf, bufsz, dstlen) < 0)
         return -1;
     dst = *buf;
-    sodium_bin2base64 (dst, dstlen, (const unsigned char *)src, srclen,
-                       sodium_base64_VARIANT_ORIGINAL);
+    if (pthread_mutex_trylock (&sign->enclock) != 0)
+        return base64_encode (dst, dstlen, src, srclen);
+    if (sign->encsrclen > 0) {
+        n = common_prefix (src, sign->encsrc, MIN (srclen, sign->encsrclen));
+        n -= n % 3;
+        memcpy (dst, sign->encdst, n / 3 * 4);
+    }
+    if (base64_encode (dst + n / 3 * 4, dstlen - n / 3 * 4,
+                       src + n, srclen - n) < 0) {
+        sign->encsrclen = 0;
+        pthread_mutex_unlock (&sign->enclock);
+        return -1;
+    }
+    /* Save the changed part for next time.  On failure, just forget it.
+     */
+    if (grow_buf ((void **)&sign->encsrc, &sign->encsrcsz, srclen) < 0
+        || grow_buf ((void **)&sign->encdst, &sign->encdstsz, dstlen) < 0)
+        sign->encsrclen = 0;
+    else {
+        memcpy (sign->encsrc + n, src + n, srclen - n);
+        memcpy (sign->encdst + n / 3 * 4, dst + n / 3 * 4,
+                dstlen - n / 3 * 4);
+        sign->encsrclen = srclen;
+    }
+    pthread_mutex_unlock (&sign->enclock);
     return 0;
 }
 
@@ -201,15 +457,12 @@ static int payload_encode_cat (const void *pay, int paysz,
     char *dst;
 
     len = strlen (*buf);
-    dstlen = sodium_base64_encoded_len (paysz,
-                                        sodium_base64_VARIANT_ORIGINAL);
+    dstlen = base64_encode_length (paysz);
     if (grow_buf (buf, bufsz, dstlen + len + 1) < 0)
         return -1;
     dst = (char *)*buf + len;
     *dst++ = '.';
-    sodium_bin2base64 (dst, dstlen, pay, paysz,
-                       sodium_base64_VARIANT_ORIGINAL);
-    return 0;
+    return base64_encode (dst, dstlen, pay, paysz);
 }
 
 /* Append pre-encoded (string) signature with "." prefix to buf/bufsz,
@@ -234,15 +487,165 @@ static int signature_cat (const char *sig, void **buf, int *bufsz)
     return 0;
 }
 
-const char *flux_sign_wrap_as (flux_security_t *ctx,
-                               int64_t userid,
-                               const void *pay, int paysz,
-                               const char *mech_type, int flags)
+/* Version 2 frame:
+ *   MAGIC HDRLEN HEADER PAYLEN PAYLOAD SIGLEN SIGNATURE
+ * MAGIC is 4 bytes starting with \0, the lengths are 32-bit unsigned
+ * big-endian integers, HEADER is the kv encoded header (not base64),
+ * PAYLOAD is the raw payload, and SIGNATURE is the mechanism signature
+ * string (without \0) over everything preceding SIGLEN.  The armored
+ * form is FRAME_ARMOR followed by the whole frame in base64.
+ */
+static const char frame_magic[4] = { '\0', 'F', 'S', '2' };
+#define FRAME_ARMOR "v2:"
+#define FRAME_ARMOR_LEN 3
+#define FRAME_MINSIZE 16  // MAGIC plus 3 lengths
+
+static void put_u32 (char *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = (v >> 16) & 0xff;
+    p[2] = (v >> 8) & 0xff;
+    p[3] = v & 0xff;
+}
+
+static uint32_t get_u32 (const char *p)
+{
+    const uint8_t *u = (const uint8_t *)p;
+    return (uint32_t)u[0] << 24 | u[1] << 16 | u[2] << 8 | u[3];
+}
+
+/* Store MAGIC HDRLEN HEADER PAYLEN PAYLOAD in buf/bufsz, growing as
+ * needed, and set *lenp to its length.
+ * Return 0 on success, -1 on failure with errno set.
+ */
+static int frame_encode_cpy (struct kv *header, const void *pay, int paysz,
+                             void **buf, int *bufsz, int *lenp)
+{
+    const char *hdr;
+    int hdrlen;
+    char *p;
+
+    if (kv_encode (header, &hdr, &hdrlen) < 0)
+        return -1;
+    if (hdrlen > INT_MAX - FRAME_MINSIZE
+        || paysz > INT_MAX - FRAME_MINSIZE - hdrlen) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    if (grow_buf (buf, bufsz, FRAME_MINSIZE + hdrlen + paysz) < 0)
+        return -1;
+    p = *buf;
+    memcpy (p, frame_magic, sizeof (frame_magic));
+    p += sizeof (frame_magic);
+    put_u32 (p, hdrlen);
+    memcpy (p + 4, hdr, hdrlen);
+    p += 4 + hdrlen;
+    put_u32 (p, paysz);
+    if (paysz > 0)
+        memcpy (p + 4, pay, paysz);
+    p += 4 + paysz;
+    *lenp = p - (char *)*buf;
+    return 0;
+}
+
+/* Append SIGLEN SIGNATURE to the frame of length *lenp in buf/bufsz,
+ * growing as needed, and update *lenp.
+ * Return 0 on success, -1 on failure with errno set.
+ */
+static int frame_signature_cat (const char *sig, void **buf, int *bufsz,
+                                int *lenp)
+{
+    size_t siglen = strlen (sig);
+    char *p;
+
+    if (siglen > (size_t)(INT_MAX - 4 - *lenp)) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    if (grow_buf (buf, bufsz, *lenp + 4 + siglen) < 0)
+        return -1;
+    p = (char *)*buf + *lenp;
+    put_u32 (p, siglen);
+    memcpy (p + 4, sig, siglen);
+    *lenp += 4 + siglen;
+    return 0;
+}
+
+/* Store the armored form of 'frame' in buf/bufsz, growing as needed.
+ * Result is NULL terminated.
+ * Return 0 on success, -1 on failure with errno set.
+ */
+static int frame_armor_cpy (const void *frame, int framesz,
+                            void **buf, int *bufsz)
+{
+    size_t dstlen = base64_encode_length (framesz);
+
+    if (dstlen > (size_t)(INT_MAX - FRAME_ARMOR_LEN)) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    if (grow_buf (buf, bufsz, FRAME_ARMOR_LEN + dstlen) < 0)
+        return -1;
+    memcpy (*buf, FRAME_ARMOR, FRAME_ARMOR_LEN);
+    return base64_encode ((char *)*buf + FRAME_ARMOR_LEN, dstlen,
+                          frame, framesz);
+}
+
+/* Create the security header for a credential signed by 'userid' with
+ * 'mech', in format 'version', including any mechanism-specific data.
+ * Return header on success, or NULL with errno and context error set.
+ */
+static struct kv *header_create (flux_security_t *ctx,
+                                 int64_t userid,
+                                 int64_t version,
+                                 const struct sign_mech *mech,
+                                 int flags)
+{
+    struct kv *header;
+
+    if (!(header = kv_create ())
+        || kv_put (header, "version", KV_INT64, version) < 0
+        || kv_put (header, "mechanism", KV_STRING, mech->name) < 0
+        || kv_put (header, "userid", KV_INT64, userid) < 0) {
+        security_error (ctx, NULL);
+        kv_destroy (header);
+        return NULL;
+    }
+    /* Call mech->prep, which adds mechanism-specific data to header, if any.
+     */
+    if (mech->prep) {
+        if (mech->prep (ctx, header, flags) < 0) {
+            kv_destroy (header);
+            return NULL;
+        }
+    }
+    return header;
+}
+
+/* Sign payload, storing the result in buf/bufsz, growing as needed.
+ * If buf is NULL, the context wrap buffer is used.  The result is
+ * HEADER.PAYLOAD.SIGNATURE if 'version' is 1.  If 'version' is 2, it is
+ * a binary frame if 'binary' is true, otherwise an armored one.
+ * Set *lenp (if non-NULL) to the result length, excluding the
+ * terminating \0 of text results.
+ * Return the result on success, or NULL with errno and context error set.
+ */
+static const char *sign_wrap (flux_security_t *ctx,
+                              int64_t userid,
+                              const void *pay, int paysz,
+                              const char *mech_type, int flags,
+                              int version, bool binary,
+                              void **buf, int *bufsz, int *lenp)
 {
     struct sign *sign;
     struct kv *header = NULL;
     char *sig = NULL;
     const struct sign_mech *mech;
+    void *tmpbuf = NULL;
+    int tmpbufsz = 0;
+    void **framebuf;
+    int *framebufsz;
+    int len;
     int saved_errno;
 
     if (!ctx || userid < 0 || flags != 0
@@ -253,6 +656,22 @@ const char *flux_sign_wrap_as (flux_security_t *ctx,
     }
     if (!(sign = sign_init (ctx)))
         return NULL;
+    if (version == 0)
+        version = sign->wrap_version;
+    if (!buf) {
+        buf = &sign->wrapbuf;
+        bufsz = &sign->wrapbufsz;
+        framebuf = &sign->framebuf;
+        framebufsz = &sign->framebufsz;
+    }
+    else {
+        framebuf = &tmpbuf;
+        framebufsz = &tmpbufsz;
+    }
+    if (binary) {
+        framebuf = buf;
+        framebufsz = bufsz;
+    }
     if (!mech_type)
         mech_type = cf_string (cf_get_in (sign->config, "default-type"));
     if (!(mech = lookup_mech (mech_type))) {
@@ -260,51 +679,69 @@ const char *flux_sign_wrap_as (flux_security_t *ctx,
         security_error (ctx, "sign-wrap: unknown mechanism: %s", mech_type);
         return NULL;
     }
-    if (mech->init) {
-        if (mech->init (ctx, sign->config) < 0)
-            return NULL;
-    }
+    if (mech_init (ctx, sign, mech) < 0)
+        return NULL;
 
     /* Create security header.
      */
-    if (!(header = kv_create ()))
-        goto error;
-    if (kv_put (header, "version", KV_INT64, sign_version) < 0)
-        goto error;
-    if (kv_put (header, "mechanism", KV_STRING, mech->name) < 0)
-        goto error;
-    if (kv_put (header, "userid", KV_INT64, userid) < 0)
-        goto error;
-    /* Call mech->prep, which adds mechanism-specific data to header, if any.
-     */
-    if (mech->prep) {
-        if (mech->prep (ctx, header, flags) < 0)
+    if (!(header = header_create (ctx, userid, version, mech, flags)))
+        goto error_msg;
+    if (version == sign_version) {
+        /* Serialize to HEADER.PAYLOAD.SIGNATURE
+         */
+        if (header_encode_cpy (sign, header, buf, bufsz) < 0)
+            goto error;
+        if (payload_encode_cat (pay, paysz, buf, bufsz) < 0)
+            goto error;
+        if (!(sig = mech->sign (ctx, *buf, strlen (*buf), flags)))
             goto error_msg;
+        if (signature_cat (sig, buf, bufsz) < 0)
+            goto error;
+        len = strlen (*buf);
+    }
+    else {
+        /* Serialize to a frame, then armor it if required.
+         */
+        if (frame_encode_cpy (header, pay, paysz,
+                              framebuf, framebufsz, &len) < 0)
+            goto error;
+        if (!(sig = mech->sign (ctx, *framebuf, len, flags)))
+            goto error_msg;
+        if (frame_signature_cat (sig, framebuf, framebufsz, &len) < 0)
+            goto error;
+        if (!binary) {
+            if (frame_armor_cpy (*framebuf, len, buf, bufsz) < 0)
+                goto error;
+            len = strlen (*buf);
+        }
     }
-    /* Serialize to HEADER.PAYLOAD.SIGNATURE
-     */
-    if (header_encode_cpy (header, &sign->wrapbuf, &sign->wrapbufsz) < 0)
-        goto error;
-    if (payload_encode_cat (pay, paysz, &sign->wrapbuf, &sign->wrapbufsz) < 0)
-        goto error;
-    if (!(sig = mech->sign (ctx, sign->wrapbuf, strlen (sign->wrapbuf), flags)))
-        goto error_msg;
-    if (signature_cat (sig, &sign->wrapbuf, &sign->wrapbufsz) < 0)
-        goto error;
 
     free (sig);
+    free (tmpbuf);
     kv_destroy (header);
-    return sign->wrapbuf;
+    if (lenp)
+        *lenp = len;
+    return *buf;
 error:
     security_error (ctx, NULL);
 error_msg:
     kv_destroy (header);
     saved_errno = errno;
     free (sig);
+    free (tmpbuf);
     errno = saved_errno;
     return NULL;
 }
 
+const char *flux_sign_wrap_as (flux_security_t *ctx,
+                               int64_t userid,
+                               const void *pay, int paysz,
+                               const char *mech_type, int flags)
+{
+    return sign_wrap (ctx, userid, pay, paysz, mech_type, flags,
+                      0, false, NULL, NULL, NULL);
+}
+
 const char *flux_sign_wrap (flux_security_t *ctx,
                             const void *pay, int paysz,
                             const char *mech_type, int flags)
@@ -312,21 +749,60 @@ const char *flux_sign_wrap (flux_security_t *ctx,
     return flux_sign_wrap_as (ctx, getuid(), pay, paysz, mech_type, flags);
 }
 
-/* Decode HEADER portion of HEADER.PAYLOAD.SIGNATURE
+int flux_sign_wrap_r (flux_security_t *ctx,
+                      const void *pay, int paysz,
+                      const char *mech_type, int flags,
+                      char **buf, int *bufsz)
+{
+    if (!buf || !bufsz || *bufsz < 0 || (*bufsz > 0 && !*buf)) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    if (!sign_wrap (ctx, getuid (), pay, paysz, mech_type, flags,
+                    0, false, (void **)buf, bufsz, NULL))
+        return -1;
+    return 0;
+}
+
+int flux_sign_wrap_bin (flux_security_t *ctx,
+                        const void *pay, int paysz,
+                        const char *mech_type, int flags,
+                        const void **output, int *outputsz)
+{
+    const char *s;
+    int len;
+
+    if (!output || !outputsz) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    if (!(s = sign_wrap (ctx, getuid (), pay, paysz, mech_type, flags,
+                         sign_version2, true, NULL, NULL, &len)))
+        return -1;
+    *output = s;
+    *outputsz = len;
+    return 0;
+}
+
+/* Decode HEADER portion of the first 'inputsz' bytes of
+ * HEADER.PAYLOAD.SIGNATURE to buf/bufsz, expanding as needed, and return
+ * a view of it, which is valid until buf is next modified.
  * Return header on success or NULL on error with errno set.
  * Set 'endptr' to period ('.') delimiter following HEADER.
  */
-static struct kv *header_decode (const char *input, const char **endptr)
+static struct kv *header_decode (const char *input, int inputsz,
+                                 const char **endptr,
+                                 void **buf, int *bufsz)
 {
     const char *p;
     const char *src;
     size_t srclen;
-    void *dst;
     size_t dstlen;
     struct kv *header;
-    int saved_errno;
 
-    if (!(p = strchr (input, '.'))) {
+    if (!(p = memchr (input, '.', inputsz))) {
         errno = EINVAL;
         return NULL;
     }
@@ -340,32 +816,26 @@ static struct kv *header_decode (const char *input, const char **endptr)
     }
 
     dstlen = BASE64_DECODE_SIZE (srclen);
-    if (!(dst = malloc (dstlen)))
+    if (grow_buf (buf, bufsz, dstlen) < 0)
         return NULL;
-    if (sodium_base642bin (dst, dstlen, src, srclen,
-                           NULL, &dstlen, NULL,
-                           sodium_base64_VARIANT_ORIGINAL) < 0) {
+    if (base64_decode (*buf, dstlen, src, srclen, &dstlen) < 0) {
         errno = EINVAL;
-        goto error;
+        return NULL;
     }
-    if (!(header = kv_decode (dst, dstlen)))
-        goto error;
-    free (dst);
+    if (!(header = kv_view (*buf, dstlen)))
+        return NULL;
     *endptr = p;
     return header;
-error:
-    saved_errno = errno;
-    free (dst);
-    errno = saved_errno;
-    return NULL;
 }
 
-/* Decode PAYLOAD portion of PAYLOAD.SIGNATURE to buf/bufsz,
- * expanding as needed.  Any existing content is overwritten.
+/* Decode PAYLOAD portion of the first 'inputsz' bytes of
+ * PAYLOAD.SIGNATURE to buf/bufsz, expanding as needed.  Any existing
+ * content is overwritten.
  * Set 'endptr' to period ('.') delimiter following PAYLOAD.
  * Return 0 on success, -1 on failure with errno set.
  */
-static int payload_decode_cpy (const char *input, void **buf, int *bufsz,
+static int payload_decode_cpy (const char *input, int inputsz,
+                               void **buf, int *bufsz,
                                const char **endptr)
 {
     const char *p;
@@ -373,7 +843,7 @@ static int payload_decode_cpy (const char *input, void **buf, int *bufsz,
     size_t srclen;
     const char *src;
 
-    if (!(p = strchr (input, '.'))) {
+    if (!(p = memchr (input, '.', inputsz))) {
         errno = EINVAL;
         return -1;
     }
@@ -381,7 +851,7 @@ static int payload_decode_cpy (const char *input, void **buf, int *bufsz,
     srclen = p - input;
 
     /* Handle empty payload (e.g., "HEADER..SIGNATURE")
-     * Skip decoding to avoid passing NULL to sodium_base642bin()
+     * Skip decoding to avoid passing NULL to base64_decode()
      */
     if (srclen == 0) {
         *endptr = p;
@@ -391,9 +861,7 @@ static int payload_decode_cpy (const char *input, void **buf, int *bufsz,
     dstlen = BASE64_DECODE_SIZE (srclen);
     if (grow_buf (buf, bufsz, dstlen) < 0)
         return -1;
-    if (sodium_base642bin (*buf, dstlen, src, srclen,
-                           NULL, &dstlen, NULL,
-                           sodium_base64_VARIANT_ORIGINAL) < 0) {
+    if (base64_decode (*buf, dstlen, src, srclen, &dstlen) < 0) {
         errno = EINVAL;
         return -1;
     }
@@ -415,57 +883,44 @@ static bool mech_allowed (const char *name, const cf_t *allowed)
     return false;
 }
 
-static int sign_unwrap (flux_security_t *ctx,
-                        const char *input,
-                        const void **payload, int *payloadsz,
-                        const char **mech_typep,
-                        int64_t *useridp, int flags, bool check_allowed)
+/* Check the generic portion of a decoded security header: the version is
+ * 'expect_version', and the mechanism is known, and if 'check_allowed' is
+ * true, allowed by configuration.  Set *useridp to the header userid.
+ * Return the mechanism on success, or NULL with errno and context error set.
+ */
+static const struct sign_mech *header_check (flux_security_t *ctx,
+                                             struct sign *sign,
+                                             const struct kv *header,
+                                             int64_t expect_version,
+                                             bool check_allowed,
+                                             int64_t *useridp)
 {
-    struct sign *sign;
-    struct kv *header;
-    int len;
-    int64_t userid;
     int64_t version;
     const char *mechanism;
     const struct sign_mech *mech;
     const cf_t *allowed_types;
-    const char *endptr;
 
-    if (!ctx || !input || !(flags == 0 || flags == FLUX_SIGN_NOVERIFY)) {
-        errno = EINVAL;
-        security_error (ctx, NULL);
-        return -1;
-    }
-    if (!(sign = sign_init (ctx)))
-        return -1;
-    /* Parse and verify generic portion of security header.
-     */
-    if (!(header = header_decode (input, &endptr))) {
-        security_error (ctx, "sign-unwrap: header decode error: %s",
-                        strerror (errno));
-        return -1;
-    }
     if (kv_get (header, "version", KV_INT64, &version) < 0) {
         errno = EINVAL;
         security_error (ctx, "sign-unwrap: header version missing");
-        goto error;
+        return NULL;
     }
-    if (version != sign_version) {
+    if (version != expect_version) {
         errno = EINVAL;
         security_error (ctx, "sign-unwrap: header version=%d unknown",
                         (int)version);
-        goto error;
+        return NULL;
     }
     if (kv_get (header, "mechanism", KV_STRING, &mechanism) < 0) {
         errno = EINVAL;
         security_error (ctx, "sign-unwrap: header mechanism missing");
-        goto error;
+        return NULL;
     }
     if (!(mech = lookup_mech (mechanism))) {
         errno = EINVAL;
         security_error (ctx, "sign-unwrap: header mechanism=%s unknown",
                         mechanism);
-        goto error;
+        return NULL;
     }
     if (check_allowed) {
         allowed_types = cf_get_in (sign->config, "allowed-types");
@@ -473,38 +928,304 @@ static int sign_unwrap (flux_security_t *ctx,
             errno = EINVAL;
             security_error (ctx, "sign-unwrap: header mechanism=%s not allowed",
                             mechanism);
-            goto error;
+            return NULL;
         }
     }
-    if (kv_get (header, "userid", KV_INT64, &userid) < 0) {
+    if (kv_get (header, "userid", KV_INT64, useridp) < 0) {
         errno = EINVAL;
         security_error (ctx, "sign-unwrap: header userid missing");
-        goto error;
+        return NULL;
     }
-    /* Decode payload
-     */
-    len = payload_decode_cpy (endptr + 1, &sign->unwrapbuf, &sign->unwrapbufsz,
-                              &endptr);
-    if (len < 0) {
-        security_error (ctx, "sign-unwrap: payload decode error: %s",
-                        strerror (errno));
-        goto error;
+    return mech;
+}
+
+/* Call mech->verify on 'input'.  If the verified signature cache is enabled
+ * and holds an unexpired result for the first 'keysz' bytes at 'input',
+ * which must include the signature, call mech->recheck instead, if defined.
+ * The cache key includes the mech->trust digest, if defined, so that
+ * results verified under a different CA or key are not reused.
+ * Return 0 on success, -1 on failure with errno and context error set.
+ */
+static int sign_verify (flux_security_t *ctx,
+                        struct sign *sign,
+                        const struct sign_mech *mech,
+                        const struct kv *header,
+                        const char *input, int inputsz,
+                        const char *signature, int keysz, int flags)
+{
+    uint8_t key[SIGN_CACHE_KEYSZ];
+    uint8_t trust[SIGN_MECH_TRUSTSZ];
+    int trustsz = 0;
+    time_t expires = 0;
+    time_t now;
+
+    if (!sign->cache) {
+        return mech->verify (ctx, header, input, inputsz, signature, flags,
+                             &expires);
     }
-    /* Mech-specific verification (optional).
-     */
-    if (!(flags & FLUX_SIGN_NOVERIFY)) {
-        int inputsz = endptr - input;
-        const char *signature = endptr + 1;
-        if (mech->init) {
-            if (mech->init (ctx, sign->config) < 0)
-                goto error;
+    if ((now = time (NULL)) == (time_t)-1) {
+        security_error (ctx, NULL);
+        return -1;
+    }
+    if (mech->trust) {
+        if (mech->trust (ctx, header, trust) < 0)
+            return -1;
+        trustsz = sizeof (trust);
+    }
+    sign_cache_key (trust, trustsz, input, keysz, key);
+    if (sign_cache_lookup (sign->cache, key, mech->name, now) == 0) {
+        if (mech->recheck && mech->recheck (ctx, header, flags) < 0) {
+            sign_cache_remove (sign->cache, key);
+            return -1;
         }
-        if (mech->verify (ctx, header, input, inputsz, signature, flags) < 0)
-            goto error;
+        return 0;
     }
-    kv_destroy (header);
-    if (payload)
-        *payload = (len > 0 ? sign->unwrapbuf : NULL);
+    if (mech->verify (ctx, header, input, inputsz, signature, flags,
+                      &expires) < 0)
+        return -1;
+    if (expires >= now)
+        sign_cache_insert (sign->cache, key, mech->name, expires);
+    return 0;
+}
+
+/* Decode the armored frame 'src' of length 'srclen' to buf/bufsz,
+ * growing as needed, and set *framesz to its size.  The frame is
+ * followed by \0, so that its SIGNATURE is a string.
+ * Return 0 on success, -1 on failure with errno set.
+ */
+static int frame_unarmor_cpy (const char *src, size_t srclen,
+                              void **buf, int *bufsz, int *framesz)
+{
+    size_t dstlen = base64_decode_length (srclen);
+
+    if (dstlen > (size_t)(INT_MAX - 1)) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    if (grow_buf (buf, bufsz, dstlen + 1) < 0)
+        return -1;
+    if (base64_decode (*buf, dstlen, src, srclen, &dstlen) < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    ((char *)*buf)[dstlen] = '\0';
+    *framesz = dstlen;
+    return 0;
+}
+
+/* Parse version 2 'frame' of size 'framesz', returning a view of its
+ * header, and setting the location and size of PAYLOAD and SIGNATURE.
+ * The view is valid until 'frame' is modified.
+ * Return header on success or NULL on error with errno set.
+ */
+static struct kv *frame_decode (const char *frame, int framesz,
+                                const char **pay, int *paysz,
+                                const char **sig, int *sigsz)
+{
+    const char *p = frame;
+    size_t left = framesz;
+    const char *hdr;
+    uint32_t n;
+
+    if (framesz < FRAME_MINSIZE
+        || memcmp (p, frame_magic, sizeof (frame_magic)) != 0)
+        goto inval;
+    p += sizeof (frame_magic);
+    left -= sizeof (frame_magic);
+
+    n = get_u32 (p);                // HDRLEN, then HEADER
+    if (n > left - 12)
+        goto inval;
+    hdr = p + 4;
+    p += 4 + n;
+    left -= 4 + n;
+
+    n = get_u32 (p);                // PAYLEN, then PAYLOAD
+    if (n > left - 8)
+        goto inval;
+    *pay = p + 4;
+    *paysz = n;
+    p += 4 + n;
+    left -= 4 + n;
+
+    n = get_u32 (p);                // SIGLEN, then SIGNATURE
+    if (n != left - 4 || memchr (p + 4, '\0', n))
+        goto inval;
+    *sig = p + 4;
+    *sigsz = n;
+    return kv_view (hdr, *pay - 4 - hdr);
+inval:
+    errno = EINVAL;
+    return NULL;
+}
+
+/* Return true if 'input' of size 'inputsz' is a binary version 2 frame,
+ * as opposed to text, which cannot contain \0.
+ */
+static bool is_frame (const char *input, int inputsz)
+{
+    return inputsz > 0 && input[0] == '\0';
+}
+
+/* Decode and verify 'input', storing the payload in buf/bufsz, growing as
+ * needed.  If 'inputsz' is negative, 'input' is a NULL terminated version 1
+ * or armored version 2 string, otherwise it is one of those, or a binary
+ * version 2 frame, of that size, and need not be terminated.  Input is
+ * split in one bounded pass and the signature is copied to make it a
+ * string only if it is not already terminated.  If buf is NULL, the context
+ * unwrap buffers are used, otherwise the header is decoded to a temporary
+ * buffer.
+ * Return 0 on success, -1 on failure with errno and context error set.
+ */
+static int sign_unwrap (flux_security_t *ctx,
+                        const char *input, int inputsz,
+                        void **buf, int *bufsz,
+                        const void **payload, int *payloadsz,
+                        const char **mech_typep,
+                        int64_t *useridp, int flags, bool check_allowed)
+{
+    struct sign *sign;
+    struct kv *header = NULL;
+    void *hdrbuf = NULL;
+    int hdrbufsz = 0;
+    void **hdrbufp = &hdrbuf;
+    int *hdrbufszp = &hdrbufsz;
+    int len;
+    int64_t userid;
+    int64_t expect_version;
+    const struct sign_mech *mech;
+    const char *endptr;
+    const char *frame = NULL;
+    int framesz = 0;
+    const char *pay = NULL;
+    const char *sig = NULL;
+    int sigsz = 0;
+    bool sigcpy = true;
+
+    if (!ctx || !input || !(flags == 0 || flags == FLUX_SIGN_NOVERIFY)) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    if (!(sign = sign_init (ctx)))
+        return -1;
+    if (!buf) {
+        buf = &sign->unwrapbuf;
+        bufsz = &sign->unwrapbufsz;
+        hdrbufp = &sign->hdrbuf;
+        hdrbufszp = &sign->hdrbufsz;
+    }
+    if (inputsz < 0) {
+        inputsz = strlen (input);
+        sigcpy = false;
+    }
+    /* Parse and verify generic portion of security header.
+     */
+    if (is_frame (input, inputsz)) {
+        frame = input;
+        framesz = inputsz;
+    }
+    else if (inputsz >= FRAME_ARMOR_LEN
+             && !memcmp (input, FRAME_ARMOR, FRAME_ARMOR_LEN)) {
+        if (frame_unarmor_cpy (input + FRAME_ARMOR_LEN,
+                               inputsz - FRAME_ARMOR_LEN,
+                               hdrbufp, hdrbufszp, &framesz) < 0) {
+            security_error (ctx, "sign-unwrap: frame decode error: %s",
+                            strerror (errno));
+            goto error;
+        }
+        frame = *hdrbufp;
+        sigcpy = false;
+    }
+    if (frame) {
+        expect_version = sign_version2;
+        if (!(header = frame_decode (frame, framesz,
+                                     &pay, &len, &sig, &sigsz))) {
+            security_error (ctx, "sign-unwrap: frame decode error: %s",
+                            strerror (errno));
+            goto error;
+        }
+    }
+    else {
+        expect_version = sign_version;
+        if (!(header = header_decode (input, inputsz, &endptr,
+                                      hdrbufp, hdrbufszp))) {
+            security_error (ctx, "sign-unwrap: header decode error: %s",
+                            strerror (errno));
+            goto error;
+        }
+    }
+    if (!(mech = header_check (ctx, sign, header, expect_version,
+                               check_allowed, &userid)))
+        goto error;
+    /* Decode payload
+     */
+    if (frame) {
+        if (grow_buf (buf, bufsz, len) < 0) {
+            security_error (ctx, NULL);
+            goto error;
+        }
+        if (len > 0)
+            memcpy (*buf, pay, len);
+    }
+    else {
+        len = payload_decode_cpy (endptr + 1, input + inputsz - endptr - 1,
+                                  buf, bufsz, &endptr);
+        if (len < 0) {
+            security_error (ctx, "sign-unwrap: payload decode error: %s",
+                            strerror (errno));
+            goto error;
+        }
+    }
+    /* Mech-specific verification (optional).
+     */
+    if (!(flags & FLUX_SIGN_NOVERIFY)) {
+        const char *signed_input;
+        int signedsz;
+        const char *signature;
+        int keysz;
+
+        if (frame) {
+            signed_input = frame;
+            signedsz = sig - 4 - frame;
+            keysz = framesz;
+        }
+        else {
+            signed_input = input;
+            signedsz = endptr - input;
+            sig = endptr + 1;
+            sigsz = inputsz - signedsz - 1;
+            keysz = inputsz;
+            if (sigcpy && memchr (sig, '\0', sigsz)) {
+                errno = EINVAL;
+                security_error (ctx, "sign-unwrap: signature decode error");
+                goto error;
+            }
+        }
+        /* A signature at the end of a string or armored frame is \0
+         * terminated, otherwise copy it to make it a string, after the
+         * payload so that the header view is not disturbed.
+         */
+        if (sigcpy) {
+            if (grow_buf (buf, bufsz, len + sigsz + 1) < 0) {
+                security_error (ctx, NULL);
+                goto error;
+            }
+            memcpy ((char *)*buf + len, sig, sigsz);
+            ((char *)*buf)[len + sigsz] = '\0';
+            sig = (char *)*buf + len;
+        }
+        signature = sig;
+        if (mech_init (ctx, sign, mech) < 0)
+            goto error;
+        if (sign_verify (ctx, sign, mech, header, signed_input, signedsz,
+                         signature, keysz, flags) < 0)
+            goto error;
+    }
+    kv_destroy (header);
+    free (hdrbuf);
+    if (payload)
+        *payload = (len > 0 ? *buf : NULL);
     if (payloadsz)
         *payloadsz = len;
     if (mech_typep)
@@ -514,6 +1235,7 @@ static int sign_unwrap (flux_security_t *ctx,
     return 0;
 error:
     kv_destroy (header);
+    ERRNO_SAFE_WRAP (free, hdrbuf);
     return -1;
 }
 
@@ -522,7 +1244,7 @@ int flux_sign_unwrap_anymech (flux_security_t *ctx, const char *input,
                               const char **mech_type,
                               int64_t *userid, int flags)
 {
-    return sign_unwrap (ctx, input, payload, payloadsz,
+    return sign_unwrap (ctx, input, -1, NULL, NULL, payload, payloadsz,
                         mech_type, userid, flags, false);
 }
 
@@ -530,10 +1252,1318 @@ int flux_sign_unwrap (flux_security_t *ctx, const char *input,
                       const void **payload, int *payloadsz,
                       int64_t *userid, int flags)
 {
-    return sign_unwrap (ctx, input, payload, payloadsz,
+    return sign_unwrap (ctx, input, -1, NULL, NULL, payload, payloadsz,
+                        NULL, userid, flags, true);
+}
+
+int flux_sign_unwrap_r (flux_security_t *ctx, const char *input,
+                        void **buf, int *bufsz, int *payloadsz,
+                        int64_t *userid, int flags)
+{
+    if (!buf || !bufsz || *bufsz < 0 || (*bufsz > 0 && !*buf)) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    return sign_unwrap (ctx, input, -1, buf, bufsz, NULL, payloadsz,
+                        NULL, userid, flags, true);
+}
+
+int flux_sign_unwrap_bin (flux_security_t *ctx,
+                          const void *input, int inputsz,
+                          const void **payload, int *payloadsz,
+                          int64_t *userid, int flags)
+{
+    if (!input || !is_frame (input, inputsz)) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    return sign_unwrap (ctx, input, inputsz, NULL, NULL, payload, payloadsz,
+                        NULL, userid, flags, true);
+}
+
+int flux_sign_unwrap_buf (flux_security_t *ctx,
+                          const void *input, int inputsz,
+                          const void **payload, int *payloadsz,
+                          int64_t *userid, int flags)
+{
+    if (inputsz < 0) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    return sign_unwrap (ctx, input, inputsz, NULL, NULL, payload, payloadsz,
                         NULL, userid, flags, true);
 }
 
+/* Streams are processed in pieces of up to STREAM_CHUNK payload bytes,
+ * which encode to STREAM_CHUNK / 3 * 4 characters.  The header and
+ * signature of an unwrap stream are accumulated, up to STREAM_MAXSEG.
+ */
+#define STREAM_CHUNK 49152
+#define STREAM_MAXSEG (1024*1024)
+
+enum stream_phase {
+    STREAM_HEADER,
+    STREAM_PAYLOAD,
+    STREAM_SIGNATURE,
+    STREAM_DONE,
+    STREAM_FAILED,
+};
+
+struct flux_sign_stream {
+    flux_security_t *ctx;
+    struct sign *sign;
+    bool unwrap;
+    int flags;
+    flux_sign_write_f write;
+    void *arg;
+    enum stream_phase phase;
+
+    const struct sign_mech *mech;
+    void *state;                // mechanism stream state
+    bool have_state;
+
+    struct kv *header;          // unwrap: view of decoded header in hdrbuf
+    void *hdrbuf;
+    int hdrbufsz;
+    int64_t userid;
+
+    char *seg;                  // unwrap: header or signature text so far
+    int segsz;
+    int seglen;
+
+    uint8_t carry[4];           // payload bytes or characters not yet coded
+    int ncarry;
+    bool padded;                // unwrap: payload padding has been seen
+
+    void *out;                  // encoded or decoded output
+    int outsz;
+};
+
+void flux_sign_stream_destroy (flux_sign_stream_t *st)
+{
+    if (st) {
+        int saved_errno = errno;
+        if (st->have_state)
+            st->mech->stream_destroy (st->state);
+        kv_destroy (st->header);
+        free (st->hdrbuf);
+        free (st->seg);
+        free (st->out);
+        free (st);
+        errno = saved_errno;
+    }
+}
+
+static flux_sign_stream_t *stream_alloc (flux_security_t *ctx,
+                                         bool unwrap,
+                                         int flags,
+                                         flux_sign_write_f write,
+                                         void *arg)
+{
+    flux_sign_stream_t *st;
+    struct sign *sign;
+
+    if (!(sign = sign_init (ctx)))
+        return NULL;
+    if (!(st = calloc (1, sizeof (*st)))) {
+        security_error (ctx, NULL);
+        return NULL;
+    }
+    st->ctx = ctx;
+    st->sign = sign;
+    st->unwrap = unwrap;
+    st->flags = flags;
+    st->write = write;
+    st->arg = arg;
+    return st;
+}
+
+/* Create mechanism stream state for 'header'.
+ * Return 0 on success, -1 on failure with errno and context error set.
+ */
+static int stream_mech_create (flux_sign_stream_t *st,
+                               const struct kv *header, int flags)
+{
+    if (!st->mech->stream_create) {
+        errno = ENOTSUP;
+        security_error (st->ctx, "sign-stream: mechanism %s does not"
+                        " support streaming", st->mech->name);
+        return -1;
+    }
+    if (st->mech->stream_create (st->ctx, header, flags, &st->state) < 0)
+        return -1;
+    st->have_state = true;
+    return 0;
+}
+
+/* Return 0 if 'st' is a valid wrap or unwrap stream, as selected by
+ * 'unwrap', in a phase from 'first' to 'last', otherwise -1 with errno
+ * and context error set.
+ */
+static int stream_check (flux_sign_stream_t *st, bool unwrap,
+                         enum stream_phase first, enum stream_phase last)
+{
+    if (!st || st->unwrap != unwrap) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (st->phase < first || st->phase > last) {
+        errno = EINVAL;
+        security_error (st->ctx, "sign-stream: stream %s",
+                        st->phase == STREAM_FAILED ? "failed previously"
+                                                   : "is out of sequence");
+        return -1;
+    }
+    return 0;
+}
+
+/* Pass 'len' bytes to the writer.
+ * Return 0 on success, -1 on failure with errno and context error set.
+ */
+static int stream_write (flux_sign_stream_t *st, const void *buf, int len)
+{
+    if (len > 0 && st->write (buf, len, st->arg) < 0) {
+        security_error (st->ctx, "sign-stream: write: %s", strerror (errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* Pass 'len' bytes of signed text to the mechanism, and if wrapping,
+ * to the writer.
+ * Return 0 on success, -1 on failure with errno and context error set.
+ */
+static int stream_put (flux_sign_stream_t *st, const char *buf, int len)
+{
+    if (st->have_state
+        && st->mech->stream_update (st->ctx, st->state, buf, len) < 0)
+        return -1;
+    if (!st->unwrap)
+        return stream_write (st, buf, len);
+    return 0;
+}
+
+/* Encode 'len' payload bytes and pass them on.  'len' must be a multiple
+ * of 3, unless this is the end of the payload.
+ */
+static int stream_encode (flux_sign_stream_t *st, const void *buf, int len)
+{
+    size_t dstlen = base64_encode_length (len);
+
+    if (grow_buf (&st->out, &st->outsz, dstlen) < 0
+        || base64_encode (st->out, dstlen, buf, len) < 0) {
+        security_error (st->ctx, NULL);
+        return -1;
+    }
+    return stream_put (st, st->out, dstlen - 1);
+}
+
+/* Decode 'len' payload characters, a multiple of 4, and write them.
+ * Padding may only appear at the end of the payload.
+ */
+static int stream_decode (flux_sign_stream_t *st, const void *buf, int len)
+{
+    const char *src = buf;
+    size_t dstlen = base64_decode_length (len);
+
+    if (st->padded) {
+        errno = EINVAL;
+        goto error;
+    }
+    if (grow_buf (&st->out, &st->outsz, dstlen) < 0)
+        goto error;
+    if (base64_decode (st->out, dstlen, src, len, &dstlen) < 0) {
+        errno = EINVAL;
+        goto error;
+    }
+    st->padded = (src[len - 1] == '=');
+    return stream_write (st, st->out, dstlen);
+error:
+    security_error (st->ctx, "sign-unwrap: payload decode error: %s",
+                    strerror (errno));
+    return -1;
+}
+
+/* Feed 'len' bytes of 'buf' through 'fn' in pieces of 'unit' bytes,
+ * keeping any remainder in st->carry until the next call.
+ */
+static int stream_feed (flux_sign_stream_t *st,
+                        const char *buf, int len, int unit, int chunk,
+                        int (*fn)(flux_sign_stream_t *st,
+                                  const void *buf, int len))
+{
+    if (st->ncarry > 0) {
+        int n = MIN (unit - st->ncarry, len);
+        memcpy (st->carry + st->ncarry, buf, n);
+        st->ncarry += n;
+        buf += n;
+        len -= n;
+        if (st->ncarry < unit)
+            return 0;
+        st->ncarry = 0;
+        if (fn (st, st->carry, unit) < 0)
+            return -1;
+    }
+    while (len >= unit) {
+        int n = MIN (len - len % unit, chunk);
+        if (fn (st, buf, n) < 0)
+            return -1;
+        buf += n;
+        len -= n;
+    }
+    memcpy (st->carry, buf, len);
+    st->ncarry = len;
+    return 0;
+}
+
+/* Append 'len' bytes to st->seg.
+ */
+static int stream_seg_cat (flux_sign_stream_t *st, const char *buf, int len)
+{
+    if (len > STREAM_MAXSEG - st->seglen) {
+        errno = EINVAL;
+        security_error (st->ctx, "sign-unwrap: %s is too long",
+                        st->phase == STREAM_HEADER ? "header" : "signature");
+        return -1;
+    }
+    if (grow_buf ((void **)&st->seg, &st->segsz, st->seglen + len + 1) < 0) {
+        security_error (st->ctx, NULL);
+        return -1;
+    }
+    memcpy (st->seg + st->seglen, buf, len);
+    st->seglen += len;
+    st->seg[st->seglen] = '\0';
+    return 0;
+}
+
+flux_sign_stream_t *flux_sign_wrap_init (flux_security_t *ctx,
+                                         const char *mech_type, int flags,
+                                         flux_sign_write_f write, void *arg)
+{
+    flux_sign_stream_t *st;
+    struct kv *header = NULL;
+    int mflags = flags | SIGN_MECH_STREAM;
+
+    if (!ctx || !write || flags != 0) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return NULL;
+    }
+    if (!(st = stream_alloc (ctx, false, flags, write, arg)))
+        return NULL;
+    if (!mech_type)
+        mech_type = cf_string (cf_get_in (st->sign->config, "default-type"));
+    if (!(st->mech = lookup_mech (mech_type))) {
+        errno = EINVAL;
+        security_error (ctx, "sign-wrap: unknown mechanism: %s", mech_type);
+        goto error;
+    }
+    if (mech_init (ctx, st->sign, st->mech) < 0
+        || !(header = header_create (ctx, getuid (), sign_version,
+                                     st->mech, mflags))
+        || stream_mech_create (st, header, mflags) < 0)
+        goto error;
+    if (header_encode_cpy (st->sign, header, &st->out, &st->outsz) < 0) {
+        security_error (ctx, NULL);
+        goto error;
+    }
+    if (stream_put (st, st->out, strlen (st->out)) < 0
+        || stream_put (st, ".", 1) < 0)
+        goto error;
+    kv_destroy (header);
+    st->phase = STREAM_PAYLOAD;
+    return st;
+error:
+    kv_destroy (header);
+    flux_sign_stream_destroy (st);
+    return NULL;
+}
+
+int flux_sign_wrap_update (flux_sign_stream_t *st,
+                           const void *pay, int paysz)
+{
+    if (stream_check (st, false, STREAM_PAYLOAD, STREAM_PAYLOAD) < 0)
+        return -1;
+    if (paysz < 0 || (paysz > 0 && !pay)) {
+        errno = EINVAL;
+        security_error (st->ctx, NULL);
+        return -1;
+    }
+    if (stream_feed (st, pay, paysz, 3, STREAM_CHUNK, stream_encode) < 0) {
+        st->phase = STREAM_FAILED;
+        return -1;
+    }
+    return 0;
+}
+
+int flux_sign_wrap_final (flux_sign_stream_t *st)
+{
+    char *sig = NULL;
+    int siglen;
+
+    if (stream_check (st, false, STREAM_PAYLOAD, STREAM_PAYLOAD) < 0)
+        return -1;
+    if (st->ncarry > 0 && stream_encode (st, st->carry, st->ncarry) < 0)
+        goto error;
+    st->ncarry = 0;
+    if (!(sig = st->mech->stream_sign (st->ctx, st->state, st->flags)))
+        goto error;
+    siglen = strlen (sig);
+    if (grow_buf (&st->out, &st->outsz, siglen + 1) < 0) {
+        security_error (st->ctx, NULL);
+        goto error;
+    }
+    ((char *)st->out)[0] = '.';
+    memcpy ((char *)st->out + 1, sig, siglen);
+    if (stream_write (st, st->out, siglen + 1) < 0)
+        goto error;
+    free (sig);
+    st->phase = STREAM_DONE;
+    return 0;
+error:
+    ERRNO_SAFE_WRAP (free, sig);
+    st->phase = STREAM_FAILED;
+    return -1;
+}
+
+flux_sign_stream_t *flux_sign_unwrap_init (flux_security_t *ctx, int flags,
+                                           flux_sign_write_f write, void *arg)
+{
+    if (!ctx || !write || !(flags == 0 || flags == FLUX_SIGN_NOVERIFY)) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return NULL;
+    }
+    return stream_alloc (ctx, true, flags, write, arg);
+}
+
+/* The header, including its '.' delimiter, is in st->seg.
+ * Decode and check it, and set up signature verification.
+ */
+static int stream_header (flux_sign_stream_t *st)
+{
+    const char *endptr;
+
+    if (!(st->header = header_decode (st->seg, st->seglen, &endptr,
+                                      &st->hdrbuf, &st->hdrbufsz))) {
+        security_error (st->ctx, "sign-unwrap: header decode error: %s",
+                        strerror (errno));
+        return -1;
+    }
+    if (!(st->mech = header_check (st->ctx, st->sign, st->header,
+                                   sign_version, true, &st->userid)))
+        return -1;
+    if (!(st->flags & FLUX_SIGN_NOVERIFY)) {
+        if (mech_init (st->ctx, st->sign, st->mech) < 0
+            || stream_mech_create (st, st->header, st->flags) < 0
+            || stream_put (st, st->seg, st->seglen) < 0)
+            return -1;
+    }
+    st->seglen = 0;
+    return 0;
+}
+
+int flux_sign_unwrap_update (flux_sign_stream_t *st,
+                             const void *input, int inputsz)
+{
+    const char *p = input;
+    int len = inputsz;
+
+    if (stream_check (st, true, STREAM_HEADER, STREAM_SIGNATURE) < 0)
+        return -1;
+    if (inputsz < 0 || (inputsz > 0 && !input)) {
+        errno = EINVAL;
+        security_error (st->ctx, NULL);
+        return -1;
+    }
+    while (len > 0) {
+        const char *dot = NULL;
+        int n = len;
+
+        if (st->phase != STREAM_SIGNATURE
+            && (dot = memchr (p, '.', len)))
+            n = dot - p;
+        switch (st->phase) {
+            case STREAM_HEADER:
+                if (stream_seg_cat (st, p, dot ? n + 1 : n) < 0)
+                    goto error;
+                if (dot && stream_header (st) < 0)
+                    goto error;
+                break;
+            case STREAM_PAYLOAD:
+                if (stream_put (st, p, n) < 0
+                    || stream_feed (st, p, n, 4, STREAM_CHUNK / 3 * 4,
+                                    stream_decode) < 0)
+                    goto error;
+                if (dot && st->ncarry > 0) {
+                    errno = EINVAL;
+                    security_error (st->ctx, "sign-unwrap: payload decode"
+                                    " error: %s", strerror (errno));
+                    goto error;
+                }
+                break;
+            default:
+                if (stream_seg_cat (st, p, n) < 0)
+                    goto error;
+                break;
+        }
+        if (dot) {
+            st->phase++;
+            n++;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+error:
+    st->phase = STREAM_FAILED;
+    return -1;
+}
+
+int flux_sign_unwrap_final (flux_sign_stream_t *st, int64_t *userid)
+{
+    time_t expires = 0;
+
+    if (st && st->unwrap && st->phase < STREAM_SIGNATURE) {
+        errno = EINVAL;
+        security_error (st->ctx, "sign-unwrap: input is truncated");
+        st->phase = STREAM_FAILED;
+        return -1;
+    }
+    if (stream_check (st, true, STREAM_SIGNATURE, STREAM_SIGNATURE) < 0)
+        return -1;
+    if (!(st->flags & FLUX_SIGN_NOVERIFY)) {
+        if (stream_seg_cat (st, "", 0) < 0)
+            goto error;
+        if (memchr (st->seg, '\0', st->seglen)) {
+            errno = EINVAL;
+            security_error (st->ctx, "sign-unwrap: signature decode error");
+            goto error;
+        }
+        if (st->mech->stream_verify (st->ctx, st->header, st->state,
+                                     st->seg, st->flags, &expires) < 0)
+            goto error;
+    }
+    if (userid)
+        *userid = st->userid;
+    st->phase = STREAM_DONE;
+    return 0;
+error:
+    st->phase = STREAM_FAILED;
+    return -1;
+}
+
+/* Append len bytes of data to the worker buffer, growing it as needed.
+ * Return the offset of the data in the buffer, or -1 with errno set.
+ */
+static int worker_append (struct sign_worker *w, const void *data, int len)
+{
+    int offset = w->len;
+
+    if (w->bufsz - w->len < len) {
+        int newsz = w->bufsz > 0 ? w->bufsz : 4096;
+        while (newsz - w->len < len)
+            newsz *= 2;
+        if (grow_buf ((void **)&w->buf, &w->bufsz, newsz) < 0)
+            return -1;
+    }
+    if (len > 0)
+        memcpy (w->buf + offset, data, len);
+    w->len += len;
+    return offset;
+}
+
+static void *worker_run (void *arg)
+{
+    struct sign_worker *w = arg;
+    int i;
+
+    w->len = 0;
+    w->failed = 0;
+    for (i = w->first; i < w->count; i += w->stride) {
+        struct flux_sign_unwrap_item *item = &w->items[i];
+        const void *payload;
+        int payloadsz;
+
+        if (sign_unwrap (w->ctx, item->input, -1, NULL, NULL,
+                         &payload, &payloadsz,
+                         NULL, &item->userid, w->flags, true) < 0) {
+            const char *s = flux_security_last_error (w->ctx);
+            if (!s)
+                s = "unknown error";
+            item->errnum = flux_security_last_errnum (w->ctx);
+            item->payloadsz = 0;
+            w->offsets[i] = worker_append (w, s, strlen (s) + 1);
+            w->failed++;
+        }
+        else {
+            item->errnum = 0;
+            item->payloadsz = payloadsz;
+            if ((w->offsets[i] = worker_append (w, payload, payloadsz)) < 0) {
+                item->errnum = errno;
+                item->payloadsz = 0;
+                w->failed++;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Point the items handled by worker 'w' at their payloads or error strings,
+ * which have been placed at 'base', either w->buf or a copy of it.
+ */
+static void worker_resolve (struct sign_worker *w, const char *base)
+{
+    for (int i = w->first; i < w->count; i += w->stride) {
+        struct flux_sign_unwrap_item *item = &w->items[i];
+        const char *p = w->offsets[i] >= 0 ? base + w->offsets[i] : NULL;
+
+        if (item->errnum != 0) {
+            item->payload = NULL;
+            item->error = p ? p : "out of memory";
+        }
+        else {
+            item->payload = item->payloadsz > 0 ? p : NULL;
+            item->error = NULL;
+        }
+    }
+}
+
+/* Copy the results of the last batch from worker buffers to *buf, growing
+ * it as needed, and resolve item pointers into it.
+ * Return 0 on success, -1 on failure with errno set.
+ */
+static int batch_copy_results (struct sign *sign, int nworkers,
+                               void **buf, int *bufsz)
+{
+    int total = 0;
+    int i;
+
+    for (i = 0; i < nworkers; i++) {
+        if (sign->workers[i].len > INT_MAX - total) {
+            errno = EOVERFLOW;
+            return -1;
+        }
+        total += sign->workers[i].len;
+    }
+    if (total == 0)
+        total = 1;  // keep item pointers valid for an empty result
+    if (grow_buf (buf, bufsz, total) < 0)
+        return -1;
+    total = 0;
+    for (i = 0; i < nworkers; i++) {
+        struct sign_worker *w = &sign->workers[i];
+        char *base = (char *)*buf + total;
+
+        if (w->len > 0)
+            memcpy (base, w->buf, w->len);
+        worker_resolve (w, base);
+        total += w->len;
+    }
+    return 0;
+}
+
+/* Return the number of workers to use for a batch of 'count' items.
+ */
+static int batch_workers (struct sign *sign, int count)
+{
+    int64_t n = cf_int64 (cf_get_in (sign->config, "batch-workers"));
+
+    if (n == 0)
+        n = sysconf (_SC_NPROCESSORS_ONLN);
+    if (n > count)
+        n = count;
+    if (n < 1)
+        n = 1;
+    return n;
+}
+
+/* Create a clone of 'ctx' for use by a worker thread.  If the verified
+ * signature cache is enabled, the clone uses the cache of 'sign'.
+ * Return the clone on success, or NULL on failure with errno and context
+ * error set.
+ */
+static flux_security_t *worker_ctx_create (flux_security_t *ctx,
+                                           struct sign *sign)
+{
+    flux_security_t *wctx;
+    struct sign *wsign;
+
+    if (!(wctx = security_clone (ctx)))
+        return NULL;
+    if (sign->cache) {
+        if (!(wsign = sign_init (wctx))) {
+            security_error (ctx, "%s", flux_security_last_error (wctx));
+            flux_security_destroy (wctx);
+            return NULL;
+        }
+        sign_cache_destroy (wsign->cache);
+        wsign->cache = sign->cache;
+        wsign->cache_borrowed = true;
+    }
+    return wctx;
+}
+
+/* Ensure sign has 'nworkers' workers, and offsets for 'count' items.
+ * Workers are kept for reuse by later batches.
+ * Return 0 on success, -1 on failure with errno and context error set.
+ */
+static int batch_prepare (flux_security_t *ctx, struct sign *sign,
+                          int nworkers, int count)
+{
+    if (sign->offsetsz < count) {
+        int *new = realloc (sign->offsets, count * sizeof (new[0]));
+        if (!new)
+            goto error;
+        sign->offsets = new;
+        sign->offsetsz = count;
+    }
+    if (sign->nworkers < nworkers) {
+        struct sign_worker *new;
+
+        if (!(new = realloc (sign->workers, nworkers * sizeof (new[0]))))
+            goto error;
+        sign->workers = new;
+        while (sign->nworkers < nworkers) {
+            struct sign_worker *w = &sign->workers[sign->nworkers];
+
+            memset (w, 0, sizeof (*w));
+            if (!(w->ctx = worker_ctx_create (ctx, sign)))
+                return -1;
+            sign->nworkers++;
+        }
+    }
+    return 0;
+error:
+    security_error (ctx, NULL);
+    return -1;
+}
+
+/* Make worker context 'wctx' use 'cache', if its sign state exists.
+ */
+static void worker_set_cache (flux_security_t *wctx, struct sign_cache *cache)
+{
+    struct sign *wsign = flux_security_aux_get (wctx, auxname);
+
+    if (wsign) {
+        if (!wsign->cache_borrowed)
+            sign_cache_destroy (wsign->cache);
+        wsign->cache = cache;
+        wsign->cache_borrowed = true;
+    }
+}
+
+/* Replace the cache of 'sign' and its batch and asynchronous workers
+ * with 'cache'.
+ */
+static void set_cache (struct sign *sign, struct sign_cache *cache)
+{
+    if (!sign->cache_borrowed)
+        sign_cache_destroy (sign->cache);
+    sign->cache = cache;
+    sign->cache_borrowed = false;
+    for (int i = 0; i < sign->nworkers; i++)
+        worker_set_cache (sign->workers[i].ctx, cache);
+    if (sign->async) {
+        for (int i = 0; i < sign->async->nworkers; i++)
+            worker_set_cache (sign->async->workers[i].ctx, cache);
+    }
+}
+
+int flux_sign_cache_open (flux_security_t *ctx, const char *path, int size)
+{
+    struct sign *sign;
+    struct sign_cache *cache;
+
+    if (!ctx || !path || size <= 0) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    if (!(sign = sign_init (ctx)))
+        return -1;
+    if (!(cache = sign_cache_open (path, size))) {
+        security_error (ctx, "sign: %s: %s", path, strerror (errno));
+        return -1;
+    }
+    set_cache (sign, cache);
+    return 0;
+}
+
+/* Unwrap a batch of items on the worker pool.  If 'buf' is NULL, item
+ * results point into worker buffers, which are reused by the next batch.
+ * Otherwise they are copied to *buf, which the caller owns.
+ * Return the number of failed items, or -1 with errno and context error set.
+ */
+static int unwrap_batch (flux_security_t *ctx,
+                         struct flux_sign_unwrap_item *items, int count,
+                         int flags, void **buf, int *bufsz)
+{
+    struct sign *sign;
+    int nworkers;
+    int failed = 0;
+    int i;
+
+    if (!(sign = sign_init (ctx)))
+        return -1;
+    if (count == 0)
+        return 0;
+    /* sodium_init() is thread safe, but initialize before starting
+     * workers so that they never race to do it.
+     */
+    if (sodium_init () < 0) {
+        errno = EINVAL;
+        security_error (ctx, "sign-unwrap-batch: sodium_init failed");
+        return -1;
+    }
+    pthread_mutex_lock (&sign->lock);
+    nworkers = batch_workers (sign, count);
+    if (batch_prepare (ctx, sign, nworkers, count) < 0) {
+        pthread_mutex_unlock (&sign->lock);
+        return -1;
+    }
+    for (i = 0; i < nworkers; i++) {
+        struct sign_worker *w = &sign->workers[i];
+
+        w->items = items;
+        w->offsets = sign->offsets;
+        w->count = count;
+        w->first = i;
+        w->stride = nworkers;
+        w->flags = flags;
+        w->started = false;
+    }
+    /* The calling thread acts as worker 0.  If a thread cannot be
+     * started, its share of the batch is run here after worker 0.
+     */
+    for (i = 1; i < nworkers; i++) {
+        struct sign_worker *w = &sign->workers[i];
+        if (pthread_create (&w->thread, NULL, worker_run, w) == 0)
+            w->started = true;
+    }
+    worker_run (&sign->workers[0]);
+    for (i = 1; i < nworkers; i++) {
+        struct sign_worker *w = &sign->workers[i];
+        if (w->started)
+            (void)pthread_join (w->thread, NULL);
+        else
+            worker_run (w);
+    }
+    if (buf) {
+        if (batch_copy_results (sign, nworkers, buf, bufsz) < 0) {
+            pthread_mutex_unlock (&sign->lock);
+            security_error (ctx, NULL);
+            return -1;
+        }
+    }
+    else {
+        for (i = 0; i < nworkers; i++)
+            worker_resolve (&sign->workers[i], sign->workers[i].buf);
+    }
+    for (i = 0; i < nworkers; i++)
+        failed += sign->workers[i].failed;
+    pthread_mutex_unlock (&sign->lock);
+    return failed;
+}
+
+int flux_sign_unwrap_batch (flux_security_t *ctx,
+                            struct flux_sign_unwrap_item *items, int count,
+                            int flags)
+{
+    if (!ctx || count < 0 || (count > 0 && !items)
+        || !(flags == 0 || flags == FLUX_SIGN_NOVERIFY)) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    return unwrap_batch (ctx, items, count, flags, NULL, NULL);
+}
+
+int flux_sign_unwrap_batch_r (flux_security_t *ctx,
+                              struct flux_sign_unwrap_item *items, int count,
+                              void **buf, int *bufsz, int flags)
+{
+    if (!ctx || count < 0 || (count > 0 && !items)
+        || !buf || !bufsz || *bufsz < 0 || (*bufsz > 0 && !*buf)
+        || !(flags == 0 || flags == FLUX_SIGN_NOVERIFY)) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    return unwrap_batch (ctx, items, count, flags, buf, bufsz);
+}
+
+static void future_free (struct flux_sign_future *f)
+{
+    if (f) {
+        int saved_errno = errno;
+        free (f->mech_type);
+        free (f->input);
+        free (f->buf);
+        free (f->error);
+        free (f);
+        errno = saved_errno;
+    }
+}
+
+static void queue_push (struct future_queue *q, struct flux_sign_future *f)
+{
+    f->next = NULL;
+    if (q->tail)
+        q->tail->next = f;
+    else
+        q->head = f;
+    q->tail = f;
+}
+
+static struct flux_sign_future *queue_pop (struct future_queue *q)
+{
+    struct flux_sign_future *f = q->head;
+
+    if (f) {
+        if (!(q->head = f->next))
+            q->tail = NULL;
+        f->next = NULL;
+    }
+    return f;
+}
+
+static void queue_remove (struct future_queue *q, struct flux_sign_future *f)
+{
+    struct flux_sign_future **fp = &q->head;
+    struct flux_sign_future *prev = NULL;
+
+    while (*fp && *fp != f) {
+        prev = *fp;
+        fp = &(*fp)->next;
+    }
+    if (*fp) {
+        *fp = f->next;
+        if (q->tail == f)
+            q->tail = prev;
+        f->next = NULL;
+    }
+}
+
+/* Take one count from the eventfd for a future leaving the completed queue.
+ */
+static void async_fd_take (struct sign_async *async)
+{
+    uint64_t val;
+
+    while (read (async->fd, &val, sizeof (val)) < 0 && errno == EINTR)
+        ;
+}
+
+static void async_fd_give (struct sign_async *async)
+{
+    uint64_t val = 1;
+
+    while (write (async->fd, &val, sizeof (val)) < 0 && errno == EINTR)
+        ;
+}
+
+/* Run future 'f' on worker context 'wctx', storing the result in 'f'.
+ */
+static void future_run (flux_security_t *wctx, struct flux_sign_future *f)
+{
+    int rc;
+
+    if (f->unwrap) {
+        rc = sign_unwrap (wctx, f->input, f->inputsz,
+                          &f->buf, &f->bufsz, NULL, &f->outputsz,
+                          NULL, &f->userid, f->flags, true);
+    }
+    else {
+        rc = flux_sign_wrap_r (wctx, f->input, f->inputsz,
+                               f->mech_type, f->flags,
+                               (char **)&f->buf, &f->bufsz);
+        if (rc == 0)
+            f->outputsz = strlen (f->buf);
+    }
+    if (rc < 0) {
+        const char *s = flux_security_last_error (wctx);
+
+        f->errnum = flux_security_last_errnum (wctx);
+        if (f->errnum == 0)
+            f->errnum = EINVAL;
+        f->error = strdup (s ? s : strerror (f->errnum));
+    }
+    free (f->input);
+    f->input = NULL;
+}
+
+static void *async_run (void *arg)
+{
+    struct async_worker *w = arg;
+    struct sign_async *async = w->async;
+    struct flux_sign_future *f;
+
+    pthread_mutex_lock (&async->lock);
+    while (!async->shutdown) {
+        if (!(f = queue_pop (&async->pending))) {
+            pthread_cond_wait (&async->pending_cond, &async->lock);
+            continue;
+        }
+        f->state = FUTURE_RUNNING;
+        pthread_mutex_unlock (&async->lock);
+
+        future_run (w->ctx, f);
+
+        pthread_mutex_lock (&async->lock);
+        if (f->destroyed)
+            future_free (f);
+        else {
+            f->state = FUTURE_COMPLETE;
+            queue_push (&async->completed, f);
+            async_fd_give (async);
+            pthread_cond_broadcast (&async->complete_cond);
+        }
+    }
+    pthread_mutex_unlock (&async->lock);
+    return NULL;
+}
+
+/* Stop worker threads and free any futures left in the queues.
+ */
+static void async_destroy (struct sign_async *async)
+{
+    if (async) {
+        int saved_errno = errno;
+        struct flux_sign_future *f;
+
+        pthread_mutex_lock (&async->lock);
+        async->shutdown = true;
+        pthread_cond_broadcast (&async->pending_cond);
+        pthread_mutex_unlock (&async->lock);
+        for (int i = 0; i < async->nworkers; i++) {
+            (void)pthread_join (async->workers[i].thread, NULL);
+            flux_security_destroy (async->workers[i].ctx);
+        }
+        while ((f = queue_pop (&async->pending)))
+            future_free (f);
+        while ((f = queue_pop (&async->completed)))
+            future_free (f);
+        free (async->workers);
+        if (async->fd >= 0)
+            (void)close (async->fd);
+        pthread_cond_destroy (&async->complete_cond);
+        pthread_cond_destroy (&async->pending_cond);
+        pthread_mutex_destroy (&async->lock);
+        free (async);
+        errno = saved_errno;
+    }
+}
+
+/* Start up to 'n' worker threads for asynchronous operations.  The sign
+ * state of each worker context is created here, so that workers never
+ * create it concurrently with flux_sign_cache_open().
+ * Return 0 if at least one worker started, -1 on failure with errno and
+ * context error set.
+ */
+static int async_start (flux_security_t *ctx,
+                        struct sign *sign,
+                        struct sign_async *async,
+                        int n)
+{
+    while (async->nworkers < n) {
+        struct async_worker *w = &async->workers[async->nworkers];
+
+        w->async = async;
+        if (!(w->ctx = worker_ctx_create (ctx, sign)))
+            return -1;
+        if (!sign_init (w->ctx)) {
+            security_error (ctx, "%s", flux_security_last_error (w->ctx));
+            goto error;
+        }
+        if ((errno = pthread_create (&w->thread, NULL, async_run, w)) != 0) {
+            if (async->nworkers > 0) {
+                flux_security_destroy (w->ctx);
+                w->ctx = NULL;
+                break;
+            }
+            security_error (ctx, "sign-async: pthread_create: %s",
+                            strerror (errno));
+            goto error;
+        }
+        async->nworkers++;
+    }
+    return 0;
+error:
+    flux_security_destroy (async->workers[async->nworkers].ctx);
+    return -1;
+}
+
+/* Create worker threads for asynchronous operations, as many as the
+ * batch-workers setting.
+ * Return async state on success, or NULL on failure with errno and
+ * context error set.
+ */
+static struct sign_async *async_create (flux_security_t *ctx,
+                                        struct sign *sign)
+{
+    struct sign_async *async;
+    int n = batch_workers (sign, INT_MAX);
+
+    /* sodium_init() is thread safe, but initialize before starting
+     * workers so that they never race to do it.
+     */
+    if (sodium_init () < 0) {
+        errno = EINVAL;
+        security_error (ctx, "sign-async: sodium_init failed");
+        return NULL;
+    }
+    if (!(async = calloc (1, sizeof (*async)))) {
+        security_error (ctx, NULL);
+        return NULL;
+    }
+    pthread_mutex_init (&async->lock, NULL);
+    pthread_cond_init (&async->pending_cond, NULL);
+    pthread_cond_init (&async->complete_cond, NULL);
+    if ((async->fd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK
+                                 | EFD_SEMAPHORE)) < 0
+        || !(async->workers = calloc (n, sizeof (async->workers[0])))) {
+        security_error (ctx, NULL);
+        goto error;
+    }
+    if (async_start (ctx, sign, async, n) < 0)
+        goto error;
+    return async;
+error:
+    async_destroy (async);
+    return NULL;
+}
+
+/* Return the asynchronous worker state of 'ctx', creating it if needed.
+ * Return NULL on failure with errno and context error set.
+ */
+static struct sign_async *async_init (flux_security_t *ctx)
+{
+    struct sign *sign;
+    struct sign_async *async;
+
+    if (!(sign = sign_init (ctx)))
+        return NULL;
+    pthread_mutex_lock (&sign->lock);
+    if (!sign->async)
+        sign->async = async_create (ctx, sign);
+    async = sign->async;
+    pthread_mutex_unlock (&sign->lock);
+    return async;
+}
+
+/* Queue future 'f' with a copy of 'input' for a worker.
+ * Return 'f' on success, or NULL on failure with errno and context error set.
+ */
+static flux_sign_future_t *future_submit (flux_security_t *ctx,
+                                          struct flux_sign_future *f,
+                                          const void *input, int inputsz)
+{
+    struct sign_async *async;
+
+    if (!(async = async_init (ctx)))
+        goto error_nomsg;
+    if (!(f->input = malloc (inputsz > 0 ? inputsz : 1)))
+        goto error;
+    if (inputsz > 0)
+        memcpy (f->input, input, inputsz);
+    f->inputsz = inputsz;
+    f->ctx = ctx;
+    f->async = async;
+    pthread_mutex_lock (&async->lock);
+    f->state = FUTURE_PENDING;
+    queue_push (&async->pending, f);
+    pthread_cond_signal (&async->pending_cond);
+    pthread_mutex_unlock (&async->lock);
+    return f;
+error:
+    security_error (ctx, NULL);
+error_nomsg:
+    future_free (f);
+    return NULL;
+}
+
+flux_sign_future_t *flux_sign_wrap_async (flux_security_t *ctx,
+                                          const void *payload, int payloadsz,
+                                          const char *mech_type, int flags,
+                                          void *arg)
+{
+    struct flux_sign_future *f;
+
+    if (!ctx || payloadsz < 0 || (payloadsz > 0 && !payload) || flags != 0) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return NULL;
+    }
+    if (!(f = calloc (1, sizeof (*f)))
+        || (mech_type && !(f->mech_type = strdup (mech_type)))) {
+        security_error (ctx, NULL);
+        future_free (f);
+        return NULL;
+    }
+    f->flags = flags;
+    f->arg = arg;
+    return future_submit (ctx, f, payload, payloadsz);
+}
+
+flux_sign_future_t *flux_sign_unwrap_async (flux_security_t *ctx,
+                                            const void *input, int inputsz,
+                                            int flags, void *arg)
+{
+    struct flux_sign_future *f;
+
+    if (!ctx || !input || inputsz < 0
+        || !(flags == 0 || flags == FLUX_SIGN_NOVERIFY)) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return NULL;
+    }
+    if (!(f = calloc (1, sizeof (*f)))) {
+        security_error (ctx, NULL);
+        return NULL;
+    }
+    f->unwrap = true;
+    f->flags = flags;
+    f->arg = arg;
+    return future_submit (ctx, f, input, inputsz);
+}
+
+int flux_sign_async_fd (flux_security_t *ctx)
+{
+    struct sign_async *async;
+
+    if (!ctx) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    if (!(async = async_init (ctx)))
+        return -1;
+    return async->fd;
+}
+
+flux_sign_future_t *flux_sign_async_next (flux_security_t *ctx)
+{
+    struct sign_async *async;
+    struct flux_sign_future *f;
+
+    if (!ctx) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return NULL;
+    }
+    if (!(async = async_init (ctx)))
+        return NULL;
+    pthread_mutex_lock (&async->lock);
+    if ((f = queue_pop (&async->completed))) {
+        async_fd_take (async);
+        f->state = FUTURE_RETRIEVED;
+    }
+    pthread_mutex_unlock (&async->lock);
+    if (!f)
+        errno = EAGAIN;
+    return f;
+}
+
+int flux_sign_future_wait (flux_sign_future_t *f)
+{
+    struct sign_async *async;
+
+    if (!f) {
+        errno = EINVAL;
+        return -1;
+    }
+    async = f->async;
+    pthread_mutex_lock (&async->lock);
+    while (f->state == FUTURE_PENDING || f->state == FUTURE_RUNNING)
+        pthread_cond_wait (&async->complete_cond, &async->lock);
+    pthread_mutex_unlock (&async->lock);
+    return 0;
+}
+
+/* Check that 'f' is a complete operation of the expected type.  If it
+ * failed, set errno and context error from its result.
+ * Return 0 on success, -1 on failure.
+ */
+static int future_check (flux_sign_future_t *f, bool unwrap)
+{
+    bool done;
+
+    if (!f || f->unwrap != unwrap) {
+        errno = EINVAL;
+        return -1;
+    }
+    pthread_mutex_lock (&f->async->lock);
+    done = (f->state == FUTURE_COMPLETE || f->state == FUTURE_RETRIEVED);
+    pthread_mutex_unlock (&f->async->lock);
+    if (!done) {
+        errno = EAGAIN;
+        return -1;
+    }
+    if (f->errnum != 0) {
+        errno = f->errnum;
+        security_error (f->ctx, "%s", f->error ? f->error : strerror (errno));
+        return -1;
+    }
+    return 0;
+}
+
+int flux_sign_wrap_get (flux_sign_future_t *f, const char **output)
+{
+    if (future_check (f, false) < 0)
+        return -1;
+    if (output)
+        *output = f->buf;
+    return 0;
+}
+
+int flux_sign_unwrap_get (flux_sign_future_t *f,
+                          const void **payload, int *payloadsz,
+                          int64_t *userid)
+{
+    if (future_check (f, true) < 0)
+        return -1;
+    if (payload)
+        *payload = f->outputsz > 0 ? f->buf : NULL;
+    if (payloadsz)
+        *payloadsz = f->outputsz;
+    if (userid)
+        *userid = f->userid;
+    return 0;
+}
+
+void *flux_sign_future_arg (flux_sign_future_t *f)
+{
+    return f ? f->arg : NULL;
+}
+
+void flux_sign_future_destroy (flux_sign_future_t *f)
+{
+    if (f) {
+        struct sign_async *async = f->async;
+
+        pthread_mutex_lock (&async->lock);
+        switch (f->state) {
+            case FUTURE_PENDING:
+                queue_remove (&async->pending, f);
+                break;
+            case FUTURE_RUNNING:
+                f->destroyed = true;    // worker frees it when done
+                f = NULL;
+                break;
+            case FUTURE_COMPLETE:
+                queue_remove (&async->completed, f);
+                async_fd_take (async);
+                break;
+        }
+        pthread_mutex_unlock (&async->lock);
+        future_free (f);
+    }
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
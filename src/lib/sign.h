@@ -40,9 +40,31 @@ extern "C" {
  *   Mechanism dependent signature over HEADER.PAYLOAD, a string that
  *   must not contain "." (delimiter).
  *
+ * This is version 1 of the format.  Version 2 is a more compact binary
+ * frame in which the header, payload, and signature are each preceded
+ * by their length and are not base64 encoded.  flux_sign_wrap_bin()
+ * produces the binary frame.  If [sign] 'wrap-version' is set to 2, the
+ * other wrap functions produce an "armored" frame: the string "v2:"
+ * followed by the base64 encoded frame.  The unwrap functions accept
+ * either version.
+ *
  * The actual signing mechanism used is determined by configuration.
  */
 
+/* Concurrency:
+ * A context may only be used by one thread at a time, unless it has been
+ * configured and then shared with flux_security_share().  Threads may then
+ * concurrently call flux_sign_wrap_r(), flux_sign_unwrap_r(),
+ * flux_sign_unwrap_batch_r(), the asynchronous functions,
+ * flux_security_aux_get(), and flux_security_aux_set() on the shared
+ * context, although flux_security_aux_set() may then only add new keys.
+ * Error state set by these calls is private to the calling thread.  The
+ * functions that return pointers into context buffers (flux_sign_wrap(),
+ * flux_sign_wrap_as(), flux_sign_unwrap(), flux_sign_unwrap_anymech(),
+ * flux_sign_unwrap_batch()) must still be called by only one thread at a
+ * time.  The context must not be destroyed while other threads are using it.
+ */
+
 /* Required configuration:
  *
  * [sign]
@@ -78,6 +100,30 @@ const char *flux_sign_wrap_as (flux_security_t *ctx,
                                int flags);
 
 
+/* Same as flux_sign_wrap(), but store the result in *buf, a buffer of
+ * size *bufsz that is allocated or grown with realloc(3) as needed, in
+ * the manner of getline(3).  The caller must free *buf.
+ * On success, 0 is returned; on error, -1 is returned and context error
+ * state is updated.
+ */
+int flux_sign_wrap_r (flux_security_t *ctx,
+                      const void *payload, int payloadsz,
+                      const char *mech_type, int flags,
+                      char **buf, int *bufsz);
+
+/* Same as flux_sign_wrap(), but produce a version 2 binary frame, which
+ * may contain NUL bytes, regardless of the 'wrap-version' setting.  On
+ * success, *output and *outputsz are set to the frame and its size.
+ * The frame remains valid until the next call to flux_sign_wrap(),
+ * flux_sign_wrap_bin(), or 'ctx' is destroyed.
+ * On success, 0 is returned; on error, -1 is returned and context error
+ * state is updated.
+ */
+int flux_sign_wrap_bin (flux_security_t *ctx,
+                        const void *payload, int payloadsz,
+                        const char *mech_type, int flags,
+                        const void **output, int *outputsz);
+
 /* Given a NULL-terminated 'input' string generated by flux_sign_wrap(),
  * decode its contents and verify the signature.  If payload/payloadsz are
  * non-NULL, a pointer to the original payload and size is provided.
@@ -101,6 +147,189 @@ int flux_sign_unwrap_anymech (flux_security_t *ctx, const char *input,
                               const char **mech_type,
                               int64_t *userid, int flags);
 
+/* Same as flux_sign_unwrap(), but decode the payload to *buf, a buffer
+ * of size *bufsz that is allocated or grown with realloc(3) as needed,
+ * and set *payloadsz (if non-NULL) to the payload size.  The caller must
+ * free *buf.
+ */
+int flux_sign_unwrap_r (flux_security_t *ctx, const char *input,
+                        void **buf, int *bufsz, int *payloadsz,
+                        int64_t *userid, int flags);
+
+/* Same as flux_sign_unwrap(), but 'input' is a version 2 binary frame
+ * of size 'inputsz' generated by flux_sign_wrap_bin().
+ */
+int flux_sign_unwrap_bin (flux_security_t *ctx,
+                          const void *input, int inputsz,
+                          const void **payload, int *payloadsz,
+                          int64_t *userid, int flags);
+
+/* Same as flux_sign_unwrap(), but 'input' is of size 'inputsz' and need
+ * not be NULL terminated, so it may be unwrapped in place from a larger
+ * buffer, such as a network message or a mapped file.  It may be in any
+ * format accepted by flux_sign_unwrap() or flux_sign_unwrap_bin().
+ */
+int flux_sign_unwrap_buf (flux_security_t *ctx,
+                          const void *input, int inputsz,
+                          const void **payload, int *payloadsz,
+                          int64_t *userid, int flags);
+
+/* Input and results for one item of flux_sign_unwrap_batch().
+ */
+struct flux_sign_unwrap_item {
+    const char *input;      // in: output of flux_sign_wrap()
+    const void *payload;    // out: payload, or NULL if empty or on error
+    int payloadsz;          // out: payload size
+    int64_t userid;         // out: userid that signed 'input'
+    int errnum;             // out: 0 on success, or errno value on error
+    const char *error;      // out: error message, or NULL on success
+};
+
+/* Unwrap and verify 'count' items as flux_sign_unwrap() would, in
+ * parallel on a pool of worker threads.  The pool size is the [sign]
+ * 'batch-workers' setting, or the number of online CPUs if unset or 0.
+ * Results are stored in each item.  Payloads and error messages remain
+ * valid until the next call to flux_sign_unwrap_batch() or 'ctx' is
+ * destroyed.  'flags' is as for flux_sign_unwrap().
+ * Returns the number of items that failed, or -1 if the batch could not
+ * be processed, with context error state updated.
+ */
+int flux_sign_unwrap_batch (flux_security_t *ctx,
+                            struct flux_sign_unwrap_item *items, int count,
+                            int flags);
+
+/* Same as flux_sign_unwrap_batch(), but copy payloads and error messages
+ * to *buf, a buffer of size *bufsz that is allocated or grown with
+ * realloc(3) as needed.  Item results remain valid until *buf is reused
+ * or freed.  The caller must free *buf.
+ */
+int flux_sign_unwrap_batch_r (flux_security_t *ctx,
+                              struct flux_sign_unwrap_item *items, int count,
+                              void **buf, int *bufsz, int flags);
+
+/* Cache verified signatures in the file at 'path', shared with other
+ * processes that open the same file.  The file is created with room for
+ * 'size' signatures if it does not exist.  It must be owned by the
+ * effective uid and not be accessible by group or others.  This replaces
+ * any cache configured with the [sign] 'verify-cache-size' setting, and
+ * must not be called while other threads are using 'ctx'.
+ * On success, 0 is returned; on error, -1 is returned and context error
+ * state is updated.
+ */
+int flux_sign_cache_open (flux_security_t *ctx, const char *path, int size);
+
+/* Streaming wrap and unwrap, for payloads too large to hold in memory.
+ * Output is passed to 'write' in pieces as it is produced.  'write'
+ * should return 0 on success, or -1 with errno set to abort the stream.
+ * A stream must be destroyed before its context, and may be used by one
+ * thread at a time, including on a shared context.
+ */
+typedef struct flux_sign_stream flux_sign_stream_t;
+
+typedef int (*flux_sign_write_f)(const void *buf, int len, void *arg);
+
+/* Begin a stream that produces a HEADER.PAYLOAD.SIGNATURE string as
+ * flux_sign_wrap() would, except that the version 1 format is always
+ * used, and with the curve mechanism, the signature is made with the
+ * Ed25519ph variant so that the payload need not be held in memory.
+ * Call flux_sign_wrap_update() with successive pieces of the payload,
+ * then flux_sign_wrap_final() to write the signature.  The output is
+ * not \0 terminated.
+ * On success, the stream or 0 is returned; on error, NULL or -1 is
+ * returned and context error state is updated.
+ */
+flux_sign_stream_t *flux_sign_wrap_init (flux_security_t *ctx,
+                                         const char *mech_type, int flags,
+                                         flux_sign_write_f write, void *arg);
+
+int flux_sign_wrap_update (flux_sign_stream_t *st,
+                           const void *payload, int payloadsz);
+
+int flux_sign_wrap_final (flux_sign_stream_t *st);
+
+/* Begin a stream that unwraps a version 1 HEADER.PAYLOAD.SIGNATURE
+ * string as flux_sign_unwrap() would.  Call flux_sign_unwrap_update() with
+ * successive pieces of input, then flux_sign_unwrap_final() to verify the
+ * signature, and if 'userid' is non-NULL, obtain the userid that signed
+ * it.  The decoded payload is passed to 'write' as it becomes available,
+ * BEFORE the signature is verified, so it must not be trusted until
+ * flux_sign_unwrap_final() succeeds.
+ * On success, the stream or 0 is returned; on error, NULL or -1 is
+ * returned and context error state is updated.
+ */
+flux_sign_stream_t *flux_sign_unwrap_init (flux_security_t *ctx, int flags,
+                                           flux_sign_write_f write, void *arg);
+
+int flux_sign_unwrap_update (flux_sign_stream_t *st,
+                             const void *input, int inputsz);
+
+int flux_sign_unwrap_final (flux_sign_stream_t *st, int64_t *userid);
+
+void flux_sign_stream_destroy (flux_sign_stream_t *st);
+
+/* Asynchronous wrap and unwrap, for callers that run an event loop.
+ * Operations are queued to a pool of worker threads owned by 'ctx', with
+ * as many threads as the [sign] 'batch-workers' setting, or the number of
+ * online CPUs if unset or 0.  The pool is started on first use.
+ *
+ * flux_sign_async_fd() returns a file descriptor that is readable while
+ * completed operations are waiting to be retrieved with
+ * flux_sign_async_next(), which returns them in the order they completed,
+ * or NULL with errno set to EAGAIN if there are none.  The caller should
+ * not read from the file descriptor or close it.
+ *
+ * Results are obtained from a completed future with flux_sign_wrap_get()
+ * or flux_sign_unwrap_get(), which return -1 with errno set to EAGAIN if
+ * the operation has not completed, or fail as flux_sign_wrap_r() or
+ * flux_sign_unwrap_buf() would have.  Output remains valid until the
+ * future is destroyed.  flux_sign_future_wait() blocks until the future
+ * has completed.  A future may be destroyed at any time, which cancels
+ * the operation if it has not completed.  Destroying 'ctx' cancels
+ * outstanding operations and frees futures that have not been retrieved
+ * with flux_sign_async_next().  Retrieved futures must be destroyed
+ * before 'ctx'.
+ *
+ * These functions may be called on a shared context.  If the verified
+ * signature cache is replaced with flux_sign_cache_open(), no operations
+ * may be outstanding.
+ */
+typedef struct flux_sign_future flux_sign_future_t;
+
+/* Sign a copy of payload/payloadsz as flux_sign_wrap() would.  'arg' may
+ * be retrieved from the future with flux_sign_future_arg().
+ * On success, a future is returned; on error, NULL is returned and
+ * context error state is updated.
+ */
+flux_sign_future_t *flux_sign_wrap_async (flux_security_t *ctx,
+                                          const void *payload, int payloadsz,
+                                          const char *mech_type, int flags,
+                                          void *arg);
+
+/* Unwrap a copy of 'input' of size 'inputsz', in any format accepted by
+ * flux_sign_unwrap_buf().  'flags' is as for flux_sign_unwrap().
+ * On success, a future is returned; on error, NULL is returned and
+ * context error state is updated.
+ */
+flux_sign_future_t *flux_sign_unwrap_async (flux_security_t *ctx,
+                                            const void *input, int inputsz,
+                                            int flags, void *arg);
+
+int flux_sign_async_fd (flux_security_t *ctx);
+
+flux_sign_future_t *flux_sign_async_next (flux_security_t *ctx);
+
+int flux_sign_wrap_get (flux_sign_future_t *f, const char **output);
+
+int flux_sign_unwrap_get (flux_sign_future_t *f,
+                          const void **payload, int *payloadsz,
+                          int64_t *userid);
+
+int flux_sign_future_wait (flux_sign_future_t *f);
+
+void *flux_sign_future_arg (flux_sign_future_t *f);
+
+void flux_sign_future_destroy (flux_sign_future_t *f);
+
 #ifdef __cplusplus
 }
 #endif
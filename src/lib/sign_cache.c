@@ -0,0 +1,469 @@
+/************************************************************\
+ * Copyright 2026 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* sign_cache.c - LRU cache of verified signatures
+ *
+ * The cache is a single fixed-size region: a header, an array of entries,
+ * and a hash table.  Entries are found through a chained hash table indexed
+ * by the leading bytes of the key (already a SHA-256 hash), and kept in a
+ * doubly linked list in order of use, so that lookup, insertion, and
+ * eviction are all O(1).  Links are array indices, with -1 terminating a
+ * list, so the region is position independent.
+ *
+ * A private cache region is allocated on the heap.  A shared cache region
+ * is a file mapped MAP_SHARED by each process using it.  Processes serialize
+ * access with flock(2) on the file, and threads within a process with a
+ * mutex.  Since a process may die while holding the lock, the header 'busy'
+ * flag is set while the region is being modified.  Finding it set on lock
+ * means the region may be inconsistent, so it is reset.
+ */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "src/libutil/sha256.h"
+#include "src/libutil/macros.h"
+
+#include "sign_cache.h"
+
+#define CACHE_MAGIC     0x66736331  // "fsc1"
+#define CACHE_MECHSZ    16
+
+struct cache_entry {
+    uint8_t key[SIGN_CACHE_KEYSZ];
+    char mech[CACHE_MECHSZ];
+    int64_t expires;
+    int32_t hnext;      // next entry in hash chain
+    int32_t prev;       // previous (more recently used) entry
+    int32_t next;       // next (less recently used) entry, or free list
+    int32_t pad;
+};
+
+struct cache_header {
+    uint32_t magic;
+    int32_t size;
+    int32_t nbuckets;   // power of 2
+    int32_t count;
+    int32_t head;       // most recently used entry
+    int32_t tail;       // least recently used entry
+    int32_t free;       // free list
+    int32_t busy;       // region is being modified
+};
+
+struct sign_cache {
+    pthread_mutex_t lock;
+    int fd;             // shared cache file, or -1 if private
+    size_t length;
+    struct cache_header *hdr;
+    struct cache_entry *entries;
+    int32_t *buckets;
+};
+
+static int nbuckets_for_size (int size)
+{
+    int n = 1;
+    while (n < size)
+        n <<= 1;
+    return n;
+}
+
+static size_t region_length (int size, int nbuckets)
+{
+    return sizeof (struct cache_header)
+           + size * sizeof (struct cache_entry)
+           + nbuckets * sizeof (int32_t);
+}
+
+/* Set pointers into region 'hdr' for a cache of 'size' entries.
+ */
+static void region_map (struct sign_cache *cache,
+                        struct cache_header *hdr,
+                        int size,
+                        size_t length)
+{
+    cache->hdr = hdr;
+    cache->length = length;
+    cache->entries = (struct cache_entry *)(hdr + 1);
+    cache->buckets = (int32_t *)(cache->entries + size);
+}
+
+/* (Re-)initialize the region to an empty cache.
+ */
+static void region_init (struct sign_cache *cache, int size, int nbuckets)
+{
+    struct cache_header *hdr = cache->hdr;
+    int i;
+
+    hdr->magic = CACHE_MAGIC;
+    hdr->size = size;
+    hdr->nbuckets = nbuckets;
+    hdr->count = 0;
+    hdr->head = -1;
+    hdr->tail = -1;
+    hdr->free = 0;
+    for (i = 0; i < nbuckets; i++)
+        cache->buckets[i] = -1;
+    for (i = 0; i < size; i++)
+        cache->entries[i].next = i + 1 < size ? i + 1 : -1;
+    hdr->busy = 0;
+}
+
+/* Lock the cache against other threads and, if it is shared through a
+ * file, other processes.  Return 0 on success, or -1 with errno set if the
+ * file lock could not be acquired, in which case the cache must not be
+ * accessed.
+ */
+static int cache_lock (struct sign_cache *cache)
+{
+    pthread_mutex_lock (&cache->lock);
+    if (cache->fd >= 0) {
+        while (flock (cache->fd, LOCK_EX) < 0) {
+            if (errno != EINTR) {
+                ERRNO_SAFE_WRAP (pthread_mutex_unlock, &cache->lock);
+                return -1;
+            }
+        }
+        if (cache->hdr->busy)
+            region_init (cache, cache->hdr->size, cache->hdr->nbuckets);
+    }
+    return 0;
+}
+
+static void cache_unlock (struct sign_cache *cache)
+{
+    if (cache->fd >= 0)
+        (void)flock (cache->fd, LOCK_UN);
+    pthread_mutex_unlock (&cache->lock);
+}
+
+void sign_cache_destroy (struct sign_cache *cache)
+{
+    if (cache) {
+        int saved_errno = errno;
+        pthread_mutex_destroy (&cache->lock);
+        if (cache->fd >= 0) {
+            if (cache->hdr)
+                (void)munmap (cache->hdr, cache->length);
+            (void)close (cache->fd);
+        }
+        else
+            free (cache->hdr);
+        free (cache);
+        errno = saved_errno;
+    }
+}
+
+static struct sign_cache *cache_alloc (void)
+{
+    struct sign_cache *cache;
+
+    if (!(cache = calloc (1, sizeof (*cache))))
+        return NULL;
+    pthread_mutex_init (&cache->lock, NULL);
+    cache->fd = -1;
+    return cache;
+}
+
+struct sign_cache *sign_cache_create (int size)
+{
+    struct sign_cache *cache;
+    struct cache_header *hdr;
+    int nbuckets;
+    size_t length;
+
+    if (size <= 0 || size > SIGN_CACHE_MAXSIZE) {
+        errno = EINVAL;
+        return NULL;
+    }
+    nbuckets = nbuckets_for_size (size);
+    length = region_length (size, nbuckets);
+    if (!(cache = cache_alloc ()))
+        return NULL;
+    if (!(hdr = calloc (1, length))) {
+        sign_cache_destroy (cache);
+        errno = ENOMEM;
+        return NULL;
+    }
+    region_map (cache, hdr, size, length);
+    region_init (cache, size, nbuckets);
+    return cache;
+}
+
+/* Check that the header of an existing shared cache file of 'length'
+ * bytes describes a cache of that length.
+ */
+static bool header_valid (const struct cache_header *hdr, size_t length)
+{
+    return (hdr->magic == CACHE_MAGIC
+            && hdr->size > 0
+            && hdr->size <= SIGN_CACHE_MAXSIZE
+            && hdr->nbuckets == nbuckets_for_size (hdr->size)
+            && region_length (hdr->size, hdr->nbuckets) == length);
+}
+
+struct sign_cache *sign_cache_open (const char *path, int size)
+{
+    struct sign_cache *cache;
+    struct cache_header hdr;
+    struct stat sb;
+    void *region;
+    int nbuckets;
+    size_t length;
+    bool init = false;
+
+    if (!path || size <= 0 || size > SIGN_CACHE_MAXSIZE) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(cache = cache_alloc ()))
+        return NULL;
+    cache->fd = open (path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (cache->fd < 0)
+        goto error;
+    /* Hold the lock while checking and, if it was just created,
+     * initializing the file, so that a concurrent opener doesn't see
+     * a partially initialized header.
+     */
+    while (flock (cache->fd, LOCK_EX) < 0) {
+        if (errno != EINTR)
+            goto error;
+    }
+    if (fstat (cache->fd, &sb) < 0)
+        goto error_unlock;
+    if (!S_ISREG (sb.st_mode)
+        || sb.st_uid != geteuid ()
+        || (sb.st_mode & (S_IRWXG | S_IRWXO))) {
+        errno = EPERM;
+        goto error_unlock;
+    }
+    if (sb.st_size == 0) {
+        nbuckets = nbuckets_for_size (size);
+        length = region_length (size, nbuckets);
+        if (ftruncate (cache->fd, length) < 0)
+            goto error_unlock;
+        init = true;
+    }
+    else {
+        length = sb.st_size;
+        if (length < sizeof (hdr)
+            || pread (cache->fd, &hdr, sizeof (hdr), 0) != sizeof (hdr)
+            || !header_valid (&hdr, length)) {
+            errno = EINVAL;
+            goto error_unlock;
+        }
+        size = hdr.size;
+        nbuckets = hdr.nbuckets;
+    }
+    region = mmap (NULL,
+                   length,
+                   PROT_READ | PROT_WRITE,
+                   MAP_SHARED,
+                   cache->fd,
+                   0);
+    if (region == MAP_FAILED)
+        goto error_unlock;
+    region_map (cache, region, size, length);
+    if (init)
+        region_init (cache, size, nbuckets);
+    (void)flock (cache->fd, LOCK_UN);
+    return cache;
+error_unlock:
+    ERRNO_SAFE_WRAP (flock, cache->fd, LOCK_UN);
+error:
+    sign_cache_destroy (cache);
+    return NULL;
+}
+
+void sign_cache_key (const uint8_t *trust, int trustsz,
+                     const char *input, int inputsz,
+                     uint8_t key[SIGN_CACHE_KEYSZ])
+{
+    SHA256_CTX shx;
+
+    sha256_init (&shx);
+    if (trustsz > 0)
+        sha256_update (&shx, trust, trustsz);
+    sha256_update (&shx, (const BYTE *)input, inputsz);
+    sha256_final (&shx, key);
+}
+
+static int32_t *bucket (struct sign_cache *cache,
+                        const uint8_t key[SIGN_CACHE_KEYSZ])
+{
+    uint32_t h;
+
+    memcpy (&h, key, sizeof (h));
+    return &cache->buckets[h & (cache->hdr->nbuckets - 1)];
+}
+
+/* Return index of entry for 'key', or -1 if not found.
+ */
+static int find (struct sign_cache *cache,
+                 const uint8_t key[SIGN_CACHE_KEYSZ])
+{
+    int i = *bucket (cache, key);
+
+    while (i >= 0 && memcmp (cache->entries[i].key, key, SIGN_CACHE_KEYSZ))
+        i = cache->entries[i].hnext;
+    return i;
+}
+
+static void list_unlink (struct sign_cache *cache, int i)
+{
+    struct cache_entry *e = &cache->entries[i];
+
+    if (e->prev >= 0)
+        cache->entries[e->prev].next = e->next;
+    else
+        cache->hdr->head = e->next;
+    if (e->next >= 0)
+        cache->entries[e->next].prev = e->prev;
+    else
+        cache->hdr->tail = e->prev;
+}
+
+static void list_push (struct sign_cache *cache, int i)
+{
+    struct cache_entry *e = &cache->entries[i];
+
+    e->prev = -1;
+    e->next = cache->hdr->head;
+    if (cache->hdr->head >= 0)
+        cache->entries[cache->hdr->head].prev = i;
+    else
+        cache->hdr->tail = i;
+    cache->hdr->head = i;
+}
+
+/* Unlink entry 'i' from its hash chain and the use list,
+ * and return it to the free list.
+ */
+static void drop (struct sign_cache *cache, int i)
+{
+    int32_t *p = bucket (cache, cache->entries[i].key);
+
+    while (*p != i)
+        p = &cache->entries[*p].hnext;
+    *p = cache->entries[i].hnext;
+    list_unlink (cache, i);
+    cache->entries[i].next = cache->hdr->free;
+    cache->hdr->free = i;
+    cache->hdr->count--;
+}
+
+int sign_cache_lookup (struct sign_cache *cache,
+                       const uint8_t key[SIGN_CACHE_KEYSZ],
+                       const char *mech,
+                       time_t now)
+{
+    bool found = false;
+    int i;
+
+    if (cache_lock (cache) < 0)
+        return -1;
+    if ((i = find (cache, key)) >= 0) {
+        struct cache_entry *e = &cache->entries[i];
+
+        cache->hdr->busy = 1;
+        if (e->expires < now)
+            drop (cache, i);
+        else if (!strncmp (e->mech, mech, CACHE_MECHSZ)) {
+            list_unlink (cache, i);
+            list_push (cache, i);
+            found = true;
+        }
+        cache->hdr->busy = 0;
+    }
+    cache_unlock (cache);
+    if (!found) {
+        errno = ENOENT;
+        return -1;
+    }
+    return 0;
+}
+
+void sign_cache_insert (struct sign_cache *cache,
+                        const uint8_t key[SIGN_CACHE_KEYSZ],
+                        const char *mech,
+                        time_t expires)
+{
+    struct cache_entry *e;
+    int32_t *b;
+    int i;
+
+    if (cache_lock (cache) < 0)
+        return;
+    cache->hdr->busy = 1;
+    if ((i = find (cache, key)) >= 0)
+        list_unlink (cache, i);
+    else {
+        if (cache->hdr->free < 0)
+            drop (cache, cache->hdr->tail);
+        i = cache->hdr->free;
+        cache->hdr->free = cache->entries[i].next;
+        memcpy (cache->entries[i].key, key, SIGN_CACHE_KEYSZ);
+        b = bucket (cache, key);
+        cache->entries[i].hnext = *b;
+        *b = i;
+        cache->hdr->count++;
+    }
+    e = &cache->entries[i];
+    strncpy (e->mech, mech, CACHE_MECHSZ);
+    e->expires = expires;
+    list_push (cache, i);
+    cache->hdr->busy = 0;
+    cache_unlock (cache);
+}
+
+void sign_cache_remove (struct sign_cache *cache,
+                        const uint8_t key[SIGN_CACHE_KEYSZ])
+{
+    int i;
+
+    if (cache_lock (cache) < 0)
+        return;
+    if ((i = find (cache, key)) >= 0) {
+        cache->hdr->busy = 1;
+        drop (cache, i);
+        cache->hdr->busy = 0;
+    }
+    cache_unlock (cache);
+}
+
+int sign_cache_count (struct sign_cache *cache)
+{
+    int count;
+
+    if (cache_lock (cache) < 0)
+        return -1;
+    count = cache->hdr->count;
+    cache_unlock (cache);
+    return count;
+}
+
+int sign_cache_size (struct sign_cache *cache)
+{
+    return cache->hdr->size;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,94 @@
+/************************************************************\
+ * Copyright 2026 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _FLUX_SECURITY_SIGN_CACHE_H
+#define _FLUX_SECURITY_SIGN_CACHE_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "src/libutil/sha256.h"
+
+/* LRU cache of verified signatures.
+ *
+ * Entries are keyed by a SHA-256 hash of the full HEADER.PAYLOAD.SIGNATURE
+ * input, and record the mechanism that verified it and the time after which
+ * the verification result is no longer valid.  The cache is internally
+ * locked so it may be used by multiple threads, and a cache stored in a
+ * file may be used by multiple processes.
+ */
+
+#define SIGN_CACHE_KEYSZ SHA256_BLOCK_SIZE
+#define SIGN_CACHE_MAXSIZE (1024*1024)
+
+struct sign_cache;
+
+/* Create a cache private to this process that holds at most 'size'
+ * entries (0 < size <= SIGN_CACHE_MAXSIZE).
+ * Return cache on success, or NULL on failure with errno set.
+ */
+struct sign_cache *sign_cache_create (int size);
+
+/* Open a cache shared with other processes, stored in the file at 'path'.
+ * If the file does not exist or is empty, it is created with room for
+ * 'size' entries, otherwise its existing size is used.  The file must be
+ * a regular file owned by the effective uid, with no group or other
+ * permissions.
+ * Return cache on success, or NULL on failure with errno set.
+ */
+struct sign_cache *sign_cache_open (const char *path, int size);
+
+void sign_cache_destroy (struct sign_cache *cache);
+
+/* Compute the cache key of 'input', verified in the context identified
+ * by 'trust' of size 'trustsz'.  'trust' may be NULL if 'trustsz' is 0.
+ */
+void sign_cache_key (const uint8_t *trust, int trustsz,
+                     const char *input, int inputsz,
+                     uint8_t key[SIGN_CACHE_KEYSZ]);
+
+/* Look up 'key' verified by mechanism 'mech'.  If it is found and has not
+ * expired at 'now', mark it most recently used and return 0.  An expired
+ * entry is dropped.  Otherwise return -1 with errno set to ENOENT, or
+ * to another value if the cache file could not be locked.
+ */
+int sign_cache_lookup (struct sign_cache *cache,
+                       const uint8_t key[SIGN_CACHE_KEYSZ],
+                       const char *mech,
+                       time_t now);
+
+/* Add or update 'key', verified by mechanism 'mech' and valid until
+ * 'expires'.  If the cache is full, the least recently used entry is
+ * evicted.  Nothing is added if the cache file could not be locked.
+ */
+void sign_cache_insert (struct sign_cache *cache,
+                        const uint8_t key[SIGN_CACHE_KEYSZ],
+                        const char *mech,
+                        time_t expires);
+
+/* Drop 'key', if present.
+ */
+void sign_cache_remove (struct sign_cache *cache,
+                        const uint8_t key[SIGN_CACHE_KEYSZ]);
+
+/* Return the number of entries in the cache, or -1 with errno set
+ * if the cache file could not be locked.
+ */
+int sign_cache_count (struct sign_cache *cache);
+
+/* Return the maximum number of entries in the cache.
+ */
+int sign_cache_size (struct sign_cache *cache);
+
+#endif /* !_FLUX_SECURITY_SIGN_CACHE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -13,11 +13,16 @@
 #endif /* HAVE_CONFIG_H */
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <pwd.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <errno.h>
 #include <string.h>
+#include <limits.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "context.h"
 #include "context_private.h"
@@ -25,12 +30,38 @@
 #include "sign_mech.h"
 #include "src/libca/sigcert.h"
 #include "src/libca/ca.h"
+#include "src/libutil/macros.h"
+#include "src/libutil/sha256.h"
+
+/* Public certs loaded from user home directories, for require-ca = false,
+ * are cached by uid in a chained hash table.  An entry is used only if the
+ * file still has the same device, inode, size, and modification time as
+ * when it was read.  If the cache is full, it is emptied.
+ */
+#define UCERT_CACHE_MAXSIZE 1024
+#define UCERT_CACHE_BUCKETS 256
+
+struct ucert {
+    struct ucert *next;
+    int64_t userid;
+    char *path;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    struct sigcert *cert;
+};
 
 struct sign_curve {
+    pthread_mutex_t lock;   // protects cert, certkv, ca creation, and ucerts
     struct sigcert *cert;
+    struct kv *certkv;      // cert encoded with "curve.cert." key prefix
     int64_t max_ttl;
     const cf_t *curve_config;
     struct ca *ca;
+    uint8_t ca_digest[SHA256_BLOCK_SIZE]; // hash of CA cert, set with ca
+    struct ucert *ucerts[UCERT_CACHE_BUCKETS];
+    int ucert_count;
 };
 
 static const struct cf_option curve_opts[] = {
@@ -41,11 +72,16 @@ static const struct cf_option curve_opts[] = {
 
 static const char *auxname = "flux::sign_curve";
 
+static void ucert_clear (struct sign_curve *sc);
+
 static void sc_destroy (struct sign_curve *sc)
 {
     if (sc) {
+        ucert_clear (sc);
         ca_destroy (sc->ca);
+        kv_destroy (sc->certkv);
         sigcert_destroy (sc->cert);
+        pthread_mutex_destroy (&sc->lock);
         free (sc);
     }
 }
@@ -61,6 +97,7 @@ static int op_init (flux_security_t *ctx, const cf_t *cf)
         return 0;
     if (!(sc = calloc (1, sizeof (*sc))))
         goto error;
+    pthread_mutex_init (&sc->lock, NULL);
     sc->max_ttl = cf_int64 (cf_get_in (cf, "max-ttl"));
     if (!(sc->curve_config = cf_get_in (cf, "curve"))) {
         security_error (ctx, "sign-curve-init: [sign.curve] config missing");
@@ -93,7 +130,7 @@ static int header_put_cert (struct kv *header, const char *prefix,
 
     if (sigcert_encode (cert, &buf, &bufsz) < 0)
         return -1;
-    if (!(kv = kv_decode (buf, bufsz)))
+    if (!(kv = kv_view (buf, bufsz)))
         return -1;
     if (kv_join (header, kv, prefix) < 0)
         goto error;
@@ -111,73 +148,141 @@ static struct sigcert *header_get_cert (const struct kv *header,
                                         const char *prefix)
 {
     struct kv *kv;
-    const char *buf;
-    int len;
     struct sigcert *cert;
 
-    if (!(kv = kv_split (header, prefix)))
+    if (!(kv = kv_view_prefix (header, prefix)))
         return NULL;
-    if (kv_encode (kv, &buf, &len) < 0)
-        goto error;
-    if (!(cert = sigcert_decode (buf, len)))
-        goto error;
+    cert = sigcert_decode_kv (kv);
     kv_destroy (kv);
     return cert;
-error:
-    kv_destroy (kv);
-    return NULL;
+}
+
+/* Upper bound on the getpwuid_r(3) buffer, which is grown on ERANGE.
+ */
+#define PWBUF_MAXSIZE (1024*1024)
+
+/* Build the path of the curve cert in the home directory of 'uid',
+ * followed by 'suffix', in 'buf'.  getpwuid_r(3) is used since this may
+ * run on worker threads.  Its buffer is sized from sysconf(3) and grown
+ * as needed for large entries, e.g. from LDAP.
+ * Return 0 on success, -1 on failure with errno set (ENOENT if the user
+ * does not exist).
+ */
+static int home_cert_path (uid_t uid, const char *suffix,
+                           char *buf, int bufsz)
+{
+    long size = sysconf (_SC_GETPW_R_SIZE_MAX);
+    char *pwbuf = NULL;
+    struct passwd pwd;
+    struct passwd *pw = NULL;
+    int rc;
+
+    if (size <= 0)
+        size = 1024;
+    for (;;) {
+        char *newbuf;
+        if (!(newbuf = realloc (pwbuf, size))) {
+            free (pwbuf);
+            return -1;
+        }
+        pwbuf = newbuf;
+        if ((rc = getpwuid_r (uid, &pwd, pwbuf, size, &pw)) != ERANGE)
+            break;
+        if (size >= PWBUF_MAXSIZE)
+            break;
+        size *= 2;
+    }
+    if (rc != 0 || !pw) {
+        free (pwbuf);
+        errno = rc != 0 ? rc : ENOENT;
+        return -1;
+    }
+    if (snprintf (buf, bufsz, "%s/.flux/curve/sig%s",
+                  pw->pw_dir, suffix) >= bufsz) {
+        free (pwbuf);
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    free (pwbuf);
+    return 0;
+}
+
+/* Load signing cert and encode it as header entries, on first use.
+ * Return 0 on success, -1 on error with errno and context error set.
+ */
+static int load_cert (flux_security_t *ctx, struct sign_curve *sc)
+{
+    char buf[PATH_MAX + 1];
+    int bufsz = sizeof (buf);
+    const char *certpath;
+    struct sigcert *cert;
+    struct kv *certkv;
+    const cf_t *entry;
+
+    if ((entry = cf_get_in (sc->curve_config, "cert-path"))) // test
+        certpath = cf_string (entry);
+    else {
+        if (home_cert_path (getuid (), "", buf, bufsz) < 0) {
+            security_error (ctx, "sign-curve-prep: cert path for uid %ju: %s",
+                            (uintmax_t)getuid (), strerror (errno));
+            return -1;
+        }
+        certpath = buf;
+    }
+    if (!(cert = sigcert_load (certpath, true))) {
+        security_error (ctx, "sign-curve-prep: load %s: %s",
+                        certpath, strerror (errno));
+        return -1;
+    }
+    if (!(certkv = kv_create ())
+            || header_put_cert (certkv, "curve.cert.", cert) < 0) {
+        security_error (ctx, NULL);
+        kv_destroy (certkv);
+        sigcert_destroy (cert);
+        return -1;
+    }
+    sigcert_destroy (sc->cert);
+    sc->cert = cert;
+    sc->certkv = certkv;
+    return 0;
 }
 
 /* prep - add to security header
  *   curve.cert    signer's public certificate
  *   curve.ctime   signature creation time
  *   curve.xtime   signature expiration time
+ *   curve.prehash true if signed with Ed25519ph (streaming only)
+ * The cert entries are encoded once, then copied into each header.
  */
 static int op_prep (flux_security_t *ctx, struct kv *header, int flags)
 {
     struct sign_curve *sc = flux_security_aux_get (ctx, auxname);
     time_t ctime;
     time_t xtime;
+    int rc;
 
     assert (sc != NULL);
 
-    if (!sc->cert) { // load signing cert on first use
-        char buf[PATH_MAX + 1];
-        int bufsz = sizeof (buf);
-        const char *certpath;
-        struct sigcert *cert;
-        const cf_t *entry;
-        if ((entry = cf_get_in (sc->curve_config, "cert-path"))) // test
-            certpath = cf_string (entry);
-        else {
-            uid_t real_uid = getuid ();
-            struct passwd *pw = getpwuid (real_uid);
-            if (!pw || snprintf (buf, bufsz, "%s/.flux/curve/sig",
-                                                    pw->pw_dir) >= bufsz) {
-                errno = EINVAL;
-                goto error;
-            }
-            certpath = buf;
-        }
-        if (!(cert = sigcert_load (certpath, true))) {
-            security_error (ctx, "sign-curve-prep: load %s: %s",
-                            certpath, strerror (errno));
-            goto error_nomsg;
-        }
-        sigcert_destroy (sc->cert);
-        sc->cert = cert;
-    }
+    pthread_mutex_lock (&sc->lock);
+    rc = sc->certkv ? 0 : load_cert (ctx, sc);
+    pthread_mutex_unlock (&sc->lock);
+    if (rc < 0)
+        return -1;
+    /* N.B. certkv is not modified once set, so it may be read unlocked.
+     */
     if ((ctime = time (NULL)) == (time_t)-1)
         goto error;
     xtime = ctime + sc->max_ttl;
-    if (header_put_cert (header, "curve.cert.", sc->cert) < 0
+    if (kv_join (header, sc->certkv, NULL) < 0
             || kv_put (header, "curve.ctime", KV_TIMESTAMP, ctime) < 0
             || kv_put (header, "curve.xtime", KV_TIMESTAMP, xtime) < 0)
         goto error;
+    if ((flags & SIGN_MECH_STREAM)
+            && kv_put (header, "curve.prehash", KV_BOOL, true) < 0)
+        goto error;
     return 0;
 error:
     security_error (ctx, NULL);
-error_nomsg:
     return -1;
 }
 
@@ -198,61 +303,249 @@ static char *op_sign (flux_security_t *ctx,
     return sign;
 }
 
+static void ucert_destroy (struct ucert *uc)
+{
+    if (uc) {
+        int saved_errno = errno;
+        sigcert_destroy (uc->cert);
+        free (uc->path);
+        free (uc);
+        errno = saved_errno;
+    }
+}
+
+static struct ucert **ucert_bucket (struct sign_curve *sc, int64_t userid)
+{
+    return &sc->ucerts[(uint64_t)userid % UCERT_CACHE_BUCKETS];
+}
+
+static void ucert_clear (struct sign_curve *sc)
+{
+    for (int i = 0; i < UCERT_CACHE_BUCKETS; i++) {
+        while (sc->ucerts[i]) {
+            struct ucert *uc = sc->ucerts[i];
+            sc->ucerts[i] = uc->next;
+            ucert_destroy (uc);
+        }
+    }
+    sc->ucert_count = 0;
+}
+
+static struct ucert *ucert_find (struct sign_curve *sc, int64_t userid)
+{
+    struct ucert *uc = *ucert_bucket (sc, userid);
+
+    while (uc && uc->userid != userid)
+        uc = uc->next;
+    return uc;
+}
+
+/* Unlink the entry for 'userid', if any, and return it.
+ */
+static struct ucert *ucert_remove (struct sign_curve *sc, int64_t userid)
+{
+    struct ucert **ucp = ucert_bucket (sc, userid);
+    struct ucert *uc;
+
+    while (*ucp && (*ucp)->userid != userid)
+        ucp = &(*ucp)->next;
+    if ((uc = *ucp)) {
+        *ucp = uc->next;
+        sc->ucert_count--;
+    }
+    return uc;
+}
+
+static bool ucert_match (const struct ucert *uc,
+                         const char *path,
+                         const struct stat *sb)
+{
+    return (uc->dev == sb->st_dev
+            && uc->ino == sb->st_ino
+            && uc->size == sb->st_size
+            && uc->mtime.tv_sec == sb->st_mtim.tv_sec
+            && uc->mtime.tv_nsec == sb->st_mtim.tv_nsec
+            && !strcmp (uc->path, path));
+}
+
+/* Read the public cert 'path', and set 'sb' to the status of the file read.
+ * Return cert on success, NULL on failure with errno set.
+ */
+static struct sigcert *ucert_load (const char *path, struct stat *sb)
+{
+    FILE *fp;
+    struct sigcert *cert = NULL;
+    int saved_errno;
+
+    if (!(fp = fopen (path, "r")))
+        return NULL;
+    if (fstat (fileno (fp), sb) < 0 || !(cert = sigcert_fread_public (fp)))
+        goto error;
+    (void)fclose (fp);
+    return cert;
+error:
+    saved_errno = errno;
+    (void)fclose (fp);
+    errno = saved_errno;
+    return NULL;
+}
+
+/* Cache 'cert', read from 'path' with status 'sb', for 'userid'.
+ * Failure to cache is not an error.  The cache takes ownership of 'cert'.
+ */
+static void ucert_insert (struct sign_curve *sc,
+                          int64_t userid,
+                          const char *path,
+                          const struct stat *sb,
+                          struct sigcert *cert)
+{
+    struct ucert *uc;
+
+    if (!(uc = calloc (1, sizeof (*uc))) || !(uc->path = strdup (path))) {
+        free (uc);
+        sigcert_destroy (cert);
+        return;
+    }
+    uc->userid = userid;
+    uc->dev = sb->st_dev;
+    uc->ino = sb->st_ino;
+    uc->size = sb->st_size;
+    uc->mtime = sb->st_mtim;
+    uc->cert = cert;
+
+    pthread_mutex_lock (&sc->lock);
+    ucert_destroy (ucert_remove (sc, userid));
+    if (sc->ucert_count >= UCERT_CACHE_MAXSIZE)
+        ucert_clear (sc);
+    uc->next = *ucert_bucket (sc, userid);
+    *ucert_bucket (sc, userid) = uc;
+    sc->ucert_count++;
+    pthread_mutex_unlock (&sc->lock);
+}
+
+/* Look up the cached cert for 'userid', and if it was read from 'path'
+ * and the file is unchanged, set *equal to whether it matches 'cert'.
+ * Return 0 on a cache hit, -1 on a miss.
+ */
+static int ucert_lookup (struct sign_curve *sc,
+                         int64_t userid,
+                         const char *path,
+                         const struct sigcert *cert,
+                         bool *equal)
+{
+    struct stat sb;
+    struct ucert *uc;
+    int rc = -1;
+
+    if (stat (path, &sb) < 0)
+        return -1;
+    pthread_mutex_lock (&sc->lock);
+    if ((uc = ucert_find (sc, userid)) && ucert_match (uc, path, &sb)) {
+        *equal = sigcert_equal (uc->cert, cert);
+        rc = 0;
+    }
+    pthread_mutex_unlock (&sc->lock);
+    return rc;
+}
+
 /* Verify that cert authenticates userid, because it exists in that user's
- * home directory.
+ * home directory.  The cert in the home directory is cached, and is read
+ * again only if the file has changed.
  */
 static int verify_cert_home (flux_security_t *ctx, struct sign_curve *sc,
                              const struct sigcert *cert, int64_t userid)
 {
-    char buf[PATH_MAX + 1] = "unknown user";
-    int bufsz = sizeof (buf);
-    struct passwd *pw = getpwuid (userid);
+    char pubpath[PATH_MAX + 1];
     struct sigcert *ucert = NULL;
+    struct stat sb;
+    bool equal;
 
-    if (!pw || snprintf (buf, bufsz, "%s/.flux/curve/sig", pw->pw_dir) >= bufsz
-                                || (!(ucert = sigcert_load (buf, false)))) {
-        errno = EINVAL;
-        security_error (ctx, "sign-curve-verify: error loading cert from %s",
-                        buf);
+    if (home_cert_path (userid, ".pub", pubpath, sizeof (pubpath)) < 0) {
+        security_error (ctx, "sign-curve-verify: cert path for uid %jd: %s",
+                        (intmax_t)userid, strerror (errno));
         return -1;
     }
-    if (!sigcert_equal (ucert, cert)) {
+    if (ucert_lookup (sc, userid, pubpath, cert, &equal) < 0) {
+        if (!(ucert = ucert_load (pubpath, &sb)))
+            goto error;
+        equal = sigcert_equal (ucert, cert);
+        ucert_insert (sc, userid, pubpath, &sb, ucert);
+    }
+    if (!equal) {
         errno = EINVAL;
         security_error (ctx, "sign-curve-verify: cert verification failed");
-        sigcert_destroy (ucert);
         return -1;
     }
-    sigcert_destroy (ucert);
     return 0;
+error:
+    errno = EINVAL;
+    security_error (ctx, "sign-curve-verify: error loading cert from %s",
+                    pubpath);
+    return -1;
+}
+
+/* Load CA context on first use, and hash its cert into sc->ca_digest.
+ * Return 0 on success, -1 on error with errno and context error set.
+ */
+static int load_ca (flux_security_t *ctx, struct sign_curve *sc)
+{
+    const cf_t *ca_config;
+    const struct sigcert *ca_cert;
+    struct ca *ca = NULL;
+    const char *buf;
+    int bufsz;
+    SHA256_CTX shx;
+    ca_error_t e;
+
+    pthread_mutex_lock (&sc->lock);
+    if (sc->ca) {
+        pthread_mutex_unlock (&sc->lock);
+        return 0;
+    }
+    if (!(ca_config = security_get_config (ctx, "ca"))) {
+        errno = EINVAL;
+        security_error (ctx, "sign-curve-verify: [ca] config missing");
+        goto error;
+    }
+    if (!(ca = ca_create (ca_config, e))
+            || ca_load (ca, false, e) < 0
+            || !(ca_cert = ca_get_cert (ca, e))) {
+        security_error (ctx, "sign-curve-verify: ca: %s", e);
+        goto error;
+    }
+    if (sigcert_encode (ca_cert, &buf, &bufsz) < 0) {
+        security_error (ctx, "sign-curve-verify: ca: %s", strerror (errno));
+        goto error;
+    }
+    sha256_init (&shx);
+    sha256_update (&shx, (const BYTE *)buf, bufsz);
+    sha256_final (&shx, sc->ca_digest);
+    sc->ca = ca;
+    pthread_mutex_unlock (&sc->lock);
+    return 0;
+error:
+    ERRNO_SAFE_WRAP (ca_destroy, ca);
+    pthread_mutex_unlock (&sc->lock);
+    return -1;
 }
 
 /* Verify that cert authenticates userid, because it was signed by the CA,
- * and the cert contains the same userid.
+ * and the cert contains the same userid.  If 'cached' is true, the cert
+ * signature was previously verified, so only the cert expiration and
+ * revocation status are checked again.
  */
 static int verify_cert_ca (flux_security_t *ctx, struct sign_curve *sc,
                            const struct sigcert *cert, int64_t userid,
-                           time_t now, time_t ctime)
+                           time_t now, time_t ctime, bool cached)
 {
     int64_t cert_max_sign_ttl;
     int64_t cert_userid;
     ca_error_t e;
 
-    if (!sc->ca) { // load CA context on first use
-        const cf_t *ca_config;
-        struct ca *ca;
-
-        if (!(ca_config = security_get_config (ctx, "ca"))) {
-            security_error (ctx, "sign-curve-verify: [ca] config missing");
-            return -1;
-        }
-        if (!(ca = ca_create (ca_config, e)) || ca_load (ca, false, e)) {
-            security_error (ctx, "sign-curve-verify: ca: %s", e);
-            ca_destroy (ca);
-            return -1;
-        }
-        sc->ca = ca;
-    }
-    if (ca_verify (sc->ca, cert, &cert_userid, &cert_max_sign_ttl, e) < 0) {
+    if (load_ca (ctx, sc) < 0)
+        return -1;
+    if ((cached ? ca_recheck : ca_verify) (sc->ca, cert, &cert_userid,
+                                           &cert_max_sign_ttl, e) < 0) {
         security_error (ctx, "sign-curve-verify: ca: %s", e);
         return -1;
     }
@@ -267,18 +560,35 @@ static int verify_cert_ca (flux_security_t *ctx, struct sign_curve *sc,
     return 0;
 }
 
+/* Return true if the header indicates an Ed25519ph signature.
+ */
+static bool header_prehash (const struct kv *header)
+{
+    bool prehash = false;
+
+    (void)kv_get (header, "curve.prehash", KV_BOOL, &prehash);
+    return prehash;
+}
+
 /* verify - verify HEADER.PAYLOAD.SIGNATURE, e.g.
  * - enclosed cert created SIGNATURE over HEADER.PAYLOAD
  * - enclosed cert authenticates header userid (two methods)
  * - xtime has not passed
  * - ctime plus configured max-ttl has not passed
+ * If 'ph' is non-NULL, it holds the Ed25519ph state of HEADER.PAYLOAD,
+ * otherwise 'input' is HEADER.PAYLOAD.  If 'signature' is NULL, the
+ * signature was previously verified and only the remaining checks are
+ * repeated.
  */
-static int op_verify (flux_security_t *ctx, const struct kv *header,
-                      const char *input, int inputsz,
-                      const char *signature, int flags)
+static int curve_verify (flux_security_t *ctx, const struct kv *header,
+                         const char *input, int inputsz,
+                         struct sigcert_stream *ph,
+                         const char *signature, time_t *expires)
 {
     struct sign_curve *sc = flux_security_aux_get (ctx, auxname);
     struct sigcert *cert = NULL;
+    bool cached = (signature == NULL);
+    int rc;
     time_t now;
     time_t ctime;
     time_t xtime;
@@ -296,13 +606,19 @@ static int op_verify (flux_security_t *ctx, const struct kv *header,
         security_error (ctx, "sign-curve-verify: incomplete header");
         goto error_nomsg;
     }
-    if (sigcert_verify_detached (cert, signature,
-                                 (uint8_t *)input, inputsz) < 0) {
-        security_error (ctx, "sign-curve-verify: verification failure");
-        goto error_nomsg;
+    if (!cached) {
+        if (ph)
+            rc = sigcert_verify_stream (cert, signature, ph);
+        else
+            rc = sigcert_verify_detached (cert, signature,
+                                          (uint8_t *)input, inputsz);
+        if (rc < 0) {
+            security_error (ctx, "sign-curve-verify: verification failure");
+            goto error_nomsg;
+        }
     }
     if (cf_bool (cf_get_in (sc->curve_config, "require-ca"))) {
-        if (verify_cert_ca (ctx, sc, cert, userid, now, ctime) < 0)
+        if (verify_cert_ca (ctx, sc, cert, userid, now, ctime, cached) < 0)
             goto error_nomsg;
     }
     else {          // require-ca = false
@@ -319,6 +635,8 @@ static int op_verify (flux_security_t *ctx, const struct kv *header,
         security_error (ctx, "sign-curve-verify: ctime is in the future");
         goto error_nomsg;
     }
+    if (expires)
+        *expires = xtime < ctime + sc->max_ttl ? xtime : ctime + sc->max_ttl;
     sigcert_destroy (cert);
     return 0;
 error:
@@ -328,12 +646,178 @@ error_nomsg:
     return -1;
 }
 
+static int op_verify (flux_security_t *ctx, const struct kv *header,
+                      const char *input, int inputsz,
+                      const char *signature, int flags,
+                      time_t *expires)
+{
+    struct sigcert_stream *ph;
+    int rc;
+
+    if (!header_prehash (header))
+        return curve_verify (ctx, header, input, inputsz, NULL,
+                             signature, expires);
+    if (!(ph = sigcert_stream_create ())
+            || sigcert_stream_update (ph, (uint8_t *)input, inputsz) < 0) {
+        security_error (ctx, NULL);
+        sigcert_stream_destroy (ph);
+        return -1;
+    }
+    rc = curve_verify (ctx, header, NULL, 0, ph, signature, expires);
+    sigcert_stream_destroy (ph);
+    return rc;
+}
+
+/* recheck - repeat the checks of verify, other than signature
+ * verification, on a cached result.  This catches cert revocation.
+ */
+static int op_recheck (flux_security_t *ctx, const struct kv *header,
+                       int flags)
+{
+    return curve_verify (ctx, header, NULL, 0, NULL, NULL, NULL);
+}
+
+/* trust - hash require-ca and, if set, the CA cert.  A cached result is
+ * rechecked without its cert signature, so it must not be reused after the
+ * CA changes.  Home directory certs are compared again by recheck.
+ */
+static int op_trust (flux_security_t *ctx, const struct kv *header,
+                     uint8_t digest[SIGN_MECH_TRUSTSZ])
+{
+    struct sign_curve *sc = flux_security_aux_get (ctx, auxname);
+    uint8_t require_ca;
+    SHA256_CTX shx;
+
+    assert (sc != NULL);
+
+    require_ca = cf_bool (cf_get_in (sc->curve_config, "require-ca"));
+    if (require_ca && load_ca (ctx, sc) < 0)
+        return -1;
+    sha256_init (&shx);
+    sha256_update (&shx, (const BYTE *)"curve", 5);
+    sha256_update (&shx, &require_ca, 1);
+    if (require_ca)
+        sha256_update (&shx, sc->ca_digest, sizeof (sc->ca_digest));
+    sha256_final (&shx, digest);
+    return 0;
+}
+
+/* Streams are signed with Ed25519ph, which hashes the input incrementally.
+ * A stream signed with plain Ed25519 by flux_sign_wrap() can still be
+ * verified, but its input must be accumulated in memory.
+ */
+struct curve_stream {
+    struct sigcert_stream *ph;
+    char *buf;
+    int len;
+    int size;
+};
+
+static void op_stream_destroy (void *state)
+{
+    struct curve_stream *cs = state;
+
+    if (cs) {
+        int saved_errno = errno;
+        sigcert_stream_destroy (cs->ph);
+        free (cs->buf);
+        free (cs);
+        errno = saved_errno;
+    }
+}
+
+static int op_stream_create (flux_security_t *ctx, const struct kv *header,
+                             int flags, void **state)
+{
+    struct curve_stream *cs;
+
+    if (!(cs = calloc (1, sizeof (*cs))))
+        goto error;
+    if (header_prehash (header) && !(cs->ph = sigcert_stream_create ()))
+        goto error;
+    *state = cs;
+    return 0;
+error:
+    security_error (ctx, NULL);
+    op_stream_destroy (cs);
+    return -1;
+}
+
+static int op_stream_update (flux_security_t *ctx, void *state,
+                             const char *input, int inputsz)
+{
+    struct curve_stream *cs = state;
+
+    if (cs->ph) {
+        if (sigcert_stream_update (cs->ph, (uint8_t *)input, inputsz) < 0)
+            goto error;
+        return 0;
+    }
+    if (inputsz > INT_MAX - cs->len) {
+        errno = EOVERFLOW;
+        goto error;
+    }
+    if (cs->len + inputsz > cs->size) {
+        int newsize = cs->size > 0 ? cs->size : 4096;
+        char *new;
+        while (newsize < cs->len + inputsz)
+            newsize = newsize > INT_MAX / 2 ? INT_MAX : newsize * 2;
+        if (!(new = realloc (cs->buf, newsize)))
+            goto error;
+        cs->buf = new;
+        cs->size = newsize;
+    }
+    memcpy (cs->buf + cs->len, input, inputsz);
+    cs->len += inputsz;
+    return 0;
+error:
+    security_error (ctx, NULL);
+    return -1;
+}
+
+static char *op_stream_sign (flux_security_t *ctx, void *state, int flags)
+{
+    struct sign_curve *sc = flux_security_aux_get (ctx, auxname);
+    struct curve_stream *cs = state;
+    char *sign;
+
+    assert (sc != NULL);
+
+    if (!cs->ph) {
+        errno = EINVAL;
+        security_error (ctx, "sign-curve: stream was not prepared for signing");
+        return NULL;
+    }
+    if (!(sign = sigcert_sign_stream (sc->cert, cs->ph))) {
+        security_error (ctx, "sign-curve: %s", strerror (errno));
+        return NULL;
+    }
+    return sign;
+}
+
+static int op_stream_verify (flux_security_t *ctx, const struct kv *header,
+                             void *state, const char *signature, int flags,
+                             time_t *expires)
+{
+    struct curve_stream *cs = state;
+
+    return curve_verify (ctx, header, cs->buf, cs->len, cs->ph,
+                         signature, expires);
+}
+
 const struct sign_mech sign_mech_curve = {
     .name = "curve",
     .init = op_init,
     .prep = op_prep,
     .sign = op_sign,
     .verify = op_verify,
+    .recheck = op_recheck,
+    .trust = op_trust,
+    .stream_create = op_stream_create,
+    .stream_update = op_stream_update,
+    .stream_sign = op_stream_sign,
+    .stream_verify = op_stream_verify,
+    .stream_destroy = op_stream_destroy,
 };
 
 /*
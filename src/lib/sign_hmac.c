@@ -0,0 +1,564 @@
+/************************************************************\
+ * Copyright 2026 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* sign_hmac.c - symmetric key signing mechanism
+ *
+ * HEADER.PAYLOAD is authenticated with HMAC-SHA256 using a key shared by
+ * all hosts in the cluster.  Since anyone who can read the key can sign as
+ * any userid, the key file must be restricted to trusted processes, and
+ * the header userid is believed only because the MAC is valid.
+ *
+ * The key file contains one key per line, as a key ID followed by the
+ * base64-encoded key, separated by white space.  Blank lines and lines
+ * beginning with '#' are ignored.  The first key is used for signing, and
+ * any listed key is accepted for verification, so keys may be rotated by
+ * adding a new key to the end of the file everywhere, moving it to the
+ * top, and finally removing the old one.
+ */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sodium.h>
+
+#include "src/libutil/base64.h"
+#include "src/libutil/macros.h"
+
+#include "context.h"
+#include "context_private.h"
+#include "sign.h"
+#include "sign_mech.h"
+
+#define HMAC_KEY_MIN    32
+#define HMAC_KEY_MAX    64
+#define HMAC_KEYID_MAX  64
+#define HMAC_MAX_KEYS   16
+
+struct hmac_key {
+    char id[HMAC_KEYID_MAX + 1];
+    uint8_t key[HMAC_KEY_MAX];
+    size_t keylen;
+};
+
+struct sign_hmac {
+    pthread_mutex_t lock;   // protects key loading
+    struct hmac_key keys[HMAC_MAX_KEYS];
+    int count;              // keys[0] signs, all verify
+    int64_t max_ttl;
+    const char *key_path;
+};
+
+static const struct cf_option hmac_opts[] = {
+    {"key-path",                CF_STRING,      true},
+    CF_OPTIONS_TABLE_END,
+};
+
+static const char *auxname = "flux::sign_hmac";
+
+static void sh_destroy (struct sign_hmac *sh)
+{
+    if (sh) {
+        int saved_errno = errno;
+        sodium_memzero (sh->keys, sizeof (sh->keys));
+        pthread_mutex_destroy (&sh->lock);
+        free (sh);
+        errno = saved_errno;
+    }
+}
+
+/* init - one time mechanism initialization
+ * The key file is not read until first use, so that a context may list
+ * hmac in allowed-types without being able to read it.
+ */
+static int op_init (flux_security_t *ctx, const cf_t *cf)
+{
+    struct sign_hmac *sh = flux_security_aux_get (ctx, auxname);
+    const cf_t *hmac_config;
+    struct cf_error cfe;
+
+    if (sh != NULL)
+        return 0;
+    if (sodium_init () < 0) {
+        security_error (ctx, "sign-hmac-init: sodium_init failed");
+        return -1;
+    }
+    if (!(sh = calloc (1, sizeof (*sh))))
+        goto error;
+    pthread_mutex_init (&sh->lock, NULL);
+    sh->max_ttl = cf_int64 (cf_get_in (cf, "max-ttl"));
+    if (!(hmac_config = cf_get_in (cf, "hmac"))) {
+        security_error (ctx, "sign-hmac-init: [sign.hmac] config missing");
+        goto error_nomsg;
+    }
+    if (cf_check (hmac_config, hmac_opts, CF_STRICT, &cfe) < 0) {
+        security_error (ctx, "sign-hmac-init: [hmac] config: %s", cfe.errbuf);
+        goto error_nomsg;
+    }
+    sh->key_path = cf_string (cf_get_in (hmac_config, "key-path"));
+    if (flux_security_aux_set (ctx, auxname, sh,
+                               (flux_security_free_f)sh_destroy) < 0)
+        goto error;
+    return 0;
+error:
+    security_error (ctx, NULL);
+error_nomsg:
+    sh_destroy (sh);
+    return -1;
+}
+
+static bool valid_keyid (const char *id)
+{
+    int len = strlen (id);
+
+    if (len == 0 || len > HMAC_KEYID_MAX)
+        return false;
+    for (int i = 0; i < len; i++) {
+        if (!isalnum ((unsigned char)id[i]) && !strchr ("-_.", id[i]))
+            return false;
+    }
+    return true;
+}
+
+static const struct hmac_key *lookup_key (struct sign_hmac *sh,
+                                          const char *id)
+{
+    for (int i = 0; i < sh->count; i++) {
+        if (!strcmp (sh->keys[i].id, id))
+            return &sh->keys[i];
+    }
+    return NULL;
+}
+
+/* Parse key file line 'buf' into sh->keys[sh->count].
+ * The key is decoded with libsodium, whose base64 codec is constant-time.
+ * Return 1 if a key was added, 0 if the line is blank or a comment,
+ * or -1 with errno set if the line is invalid.
+ */
+static int parse_key (struct sign_hmac *sh, char *buf)
+{
+    struct hmac_key *k;
+    char *saveptr;
+    char *id;
+    char *key;
+
+    if (!(id = strtok_r (buf, " \t\r\n", &saveptr)) || id[0] == '#')
+        return 0;
+    if (sh->count == HMAC_MAX_KEYS) {
+        errno = E2BIG;
+        return -1;
+    }
+    k = &sh->keys[sh->count];
+    if (!(key = strtok_r (NULL, " \t\r\n", &saveptr))
+        || strtok_r (NULL, " \t\r\n", &saveptr)
+        || !valid_keyid (id)
+        || lookup_key (sh, id)
+        || sodium_base642bin (k->key, sizeof (k->key), key, strlen (key),
+                              NULL, &k->keylen, NULL,
+                              sodium_base64_VARIANT_ORIGINAL) < 0
+        || k->keylen < HMAC_KEY_MIN) {
+        errno = EINVAL;
+        return -1;
+    }
+    strcpy (k->id, id);
+    sh->count++;
+    return 1;
+}
+
+/* Read keys from the configured key file, which must be a regular file
+ * owned by root or the effective user, and not writable by group or
+ * accessible by others.
+ * Return 0 on success, -1 on error with errno and context error set.
+ */
+static int load_keys (flux_security_t *ctx, struct sign_hmac *sh)
+{
+    char buf[256];
+    struct stat sb;
+    FILE *f = NULL;
+    int fd;
+    int lineno = 0;
+    int rc;
+
+    if ((fd = open (sh->key_path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC)) < 0
+        || fstat (fd, &sb) < 0) {
+        security_error (ctx, "sign-hmac: open %s: %s",
+                        sh->key_path, strerror (errno));
+        goto error;
+    }
+    if (!S_ISREG (sb.st_mode)) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac: %s is not a regular file",
+                        sh->key_path);
+        goto error;
+    }
+    if ((sb.st_uid != 0 && sb.st_uid != geteuid ())
+        || (sb.st_mode & (S_IWGRP | S_IRWXO))) {
+        errno = EPERM;
+        security_error (ctx, "sign-hmac: %s has insecure owner or mode",
+                        sh->key_path);
+        goto error;
+    }
+    if (!(f = fdopen (fd, "r"))) {
+        security_error (ctx, NULL);
+        goto error;
+    }
+    fd = -1;
+    while (fgets (buf, sizeof (buf), f)) {
+        lineno++;
+        if (!strchr (buf, '\n') && !feof (f)) {
+            errno = EINVAL;
+            rc = -1;
+        }
+        else
+            rc = parse_key (sh, buf);
+        sodium_memzero (buf, sizeof (buf));
+        if (rc < 0) {
+            security_error (ctx, "sign-hmac: %s:%d: %s", sh->key_path, lineno,
+                            errno == E2BIG ? "too many keys" : "invalid key");
+            goto error;
+        }
+    }
+    if (ferror (f)) {
+        security_error (ctx, "sign-hmac: read %s: %s",
+                        sh->key_path, strerror (errno));
+        goto error;
+    }
+    if (sh->count == 0) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac: %s: no keys found", sh->key_path);
+        goto error;
+    }
+    fclose (f);
+    return 0;
+error:
+    ERRNO_SAFE_WRAP (sodium_memzero, sh->keys, sizeof (sh->keys));
+    sh->count = 0;
+    if (f)
+        ERRNO_SAFE_WRAP (fclose, f);
+    if (fd >= 0)
+        ERRNO_SAFE_WRAP (close, fd);
+    return -1;
+}
+
+/* Load keys on first use.  Once loaded, they are not modified, so they may
+ * be read without holding the lock.
+ * Return 0 on success, -1 on error with errno and context error set.
+ */
+static int get_keys (flux_security_t *ctx, struct sign_hmac *sh)
+{
+    int rc;
+
+    pthread_mutex_lock (&sh->lock);
+    rc = sh->count > 0 ? 0 : load_keys (ctx, sh);
+    pthread_mutex_unlock (&sh->lock);
+    return rc;
+}
+
+/* Look up the key named in the security header.
+ * Return key on success, NULL on error with errno and context error set.
+ */
+static const struct hmac_key *header_key (flux_security_t *ctx,
+                                          struct sign_hmac *sh,
+                                          const struct kv *header)
+{
+    const struct hmac_key *k;
+    const char *id;
+
+    if (get_keys (ctx, sh) < 0)
+        return NULL;
+    if (kv_get (header, "hmac.keyid", KV_STRING, &id) < 0) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac-verify: incomplete header");
+        return NULL;
+    }
+    if (!(k = lookup_key (sh, id))) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac-verify: unknown key id %s", id);
+        return NULL;
+    }
+    return k;
+}
+
+/* prep - add to security header
+ *   hmac.keyid     ID of signing key
+ *   hmac.ctime     signature creation time
+ *   hmac.xtime     signature expiration time
+ */
+static int op_prep (flux_security_t *ctx, struct kv *header, int flags)
+{
+    struct sign_hmac *sh = flux_security_aux_get (ctx, auxname);
+    time_t ctime;
+    time_t xtime;
+
+    assert (sh != NULL);
+
+    if (get_keys (ctx, sh) < 0)
+        return -1;
+    if ((ctime = time (NULL)) == (time_t)-1)
+        goto error;
+    xtime = ctime + sh->max_ttl;
+    if (kv_put (header, "hmac.keyid", KV_STRING, sh->keys[0].id) < 0
+        || kv_put (header, "hmac.ctime", KV_TIMESTAMP, ctime) < 0
+        || kv_put (header, "hmac.xtime", KV_TIMESTAMP, xtime) < 0)
+        goto error;
+    return 0;
+error:
+    security_error (ctx, NULL);
+    return -1;
+}
+
+/* Finish MAC 'st' and return it base64-encoded, or NULL on error with
+ * errno and context error set.
+ */
+static char *hmac_sign (flux_security_t *ctx, crypto_auth_hmacsha256_state *st)
+{
+    uint8_t mac[crypto_auth_hmacsha256_BYTES];
+    size_t sigsz = base64_encode_length (sizeof (mac));
+    char *sig;
+
+    crypto_auth_hmacsha256_final (st, mac);
+    if (!(sig = malloc (sigsz))
+        || base64_encode (sig, sigsz, mac, sizeof (mac)) < 0) {
+        security_error (ctx, NULL);
+        free (sig);
+        return NULL;
+    }
+    return sig;
+}
+
+/* Finish MAC 'st' and compare it with 'signature' in constant time.
+ * Return 0 on match, -1 with errno and context error set otherwise.
+ */
+static int hmac_check (flux_security_t *ctx,
+                       crypto_auth_hmacsha256_state *st,
+                       const char *signature)
+{
+    uint8_t mac[crypto_auth_hmacsha256_BYTES];
+    uint8_t inmac[crypto_auth_hmacsha256_BYTES];
+    size_t inlen;
+
+    crypto_auth_hmacsha256_final (st, mac);
+    if (base64_decode (inmac, sizeof (inmac), signature, strlen (signature),
+                       &inlen) < 0
+        || inlen != sizeof (inmac)
+        || sodium_memcmp (mac, inmac, sizeof (mac)) != 0) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac-verify: verification failure");
+        return -1;
+    }
+    return 0;
+}
+
+/* Check that xtime has not passed, ctime plus configured max-ttl has not
+ * passed, and ctime is not in the future.
+ * Return 0 on success, -1 with errno and context error set otherwise.
+ */
+static int check_times (flux_security_t *ctx, struct sign_hmac *sh,
+                        const struct kv *header, time_t *expires)
+{
+    time_t now;
+    time_t ctime;
+    time_t xtime;
+
+    if (kv_get (header, "hmac.xtime", KV_TIMESTAMP, &xtime) < 0
+        || kv_get (header, "hmac.ctime", KV_TIMESTAMP, &ctime) < 0) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac-verify: incomplete header");
+        return -1;
+    }
+    if ((now = time (NULL)) == (time_t)-1) {
+        security_error (ctx, NULL);
+        return -1;
+    }
+    if (xtime < now || ctime + sh->max_ttl < now) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac-verify: xtime or max-ttl exceeded");
+        return -1;
+    }
+    if (ctime > now) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac-verify: ctime is in the future");
+        return -1;
+    }
+    if (expires)
+        *expires = xtime < ctime + sh->max_ttl ? xtime : ctime + sh->max_ttl;
+    return 0;
+}
+
+/* sign - MAC HEADER.PAYLOAD with the first key, which prep put in header.
+ */
+static char *op_sign (flux_security_t *ctx,
+                      const char *input, int inputsz, int flags)
+{
+    struct sign_hmac *sh = flux_security_aux_get (ctx, auxname);
+    crypto_auth_hmacsha256_state st;
+    char *sig;
+
+    assert (sh != NULL && sh->count > 0);
+
+    crypto_auth_hmacsha256_init (&st, sh->keys[0].key, sh->keys[0].keylen);
+    crypto_auth_hmacsha256_update (&st, (const uint8_t *)input, inputsz);
+    sig = hmac_sign (ctx, &st);
+    sodium_memzero (&st, sizeof (st));
+    return sig;
+}
+
+/* verify - verify HEADER.PAYLOAD.SIGNATURE, e.g.
+ * - the key named in header created SIGNATURE over HEADER.PAYLOAD
+ * - xtime has not passed
+ * - ctime plus configured max-ttl has not passed
+ */
+static int op_verify (flux_security_t *ctx, const struct kv *header,
+                      const char *input, int inputsz,
+                      const char *signature, int flags,
+                      time_t *expires)
+{
+    struct sign_hmac *sh = flux_security_aux_get (ctx, auxname);
+    crypto_auth_hmacsha256_state st;
+    const struct hmac_key *k;
+    int rc;
+
+    assert (sh != NULL);
+
+    if (!(k = header_key (ctx, sh, header)))
+        return -1;
+    crypto_auth_hmacsha256_init (&st, k->key, k->keylen);
+    crypto_auth_hmacsha256_update (&st, (const uint8_t *)input, inputsz);
+    rc = hmac_check (ctx, &st, signature);
+    sodium_memzero (&st, sizeof (st));
+    if (rc < 0)
+        return -1;
+    return check_times (ctx, sh, header, expires);
+}
+
+/* recheck - repeat the checks of verify, other than the MAC, on a cached
+ * result.  The key must still be listed, so that removing a key from the
+ * key file revokes signatures in a shared cache.
+ */
+static int op_recheck (flux_security_t *ctx, const struct kv *header,
+                       int flags)
+{
+    struct sign_hmac *sh = flux_security_aux_get (ctx, auxname);
+
+    assert (sh != NULL);
+
+    if (!header_key (ctx, sh, header))
+        return -1;
+    return check_times (ctx, sh, header, NULL);
+}
+
+/* trust - hash the id and bytes of the key named in the header, so that
+ * a cached result is not reused after a key is replaced under the same id.
+ */
+static int op_trust (flux_security_t *ctx, const struct kv *header,
+                     uint8_t digest[SIGN_MECH_TRUSTSZ])
+{
+    struct sign_hmac *sh = flux_security_aux_get (ctx, auxname);
+    const struct hmac_key *k;
+    crypto_hash_sha256_state st;
+
+    assert (sh != NULL);
+
+    if (!(k = header_key (ctx, sh, header)))
+        return -1;
+    crypto_hash_sha256_init (&st);
+    crypto_hash_sha256_update (&st, (const uint8_t *)"hmac", 4);
+    crypto_hash_sha256_update (&st, (const uint8_t *)k->id, strlen (k->id) + 1);
+    crypto_hash_sha256_update (&st, k->key, k->keylen);
+    crypto_hash_sha256_final (&st, digest);
+    sodium_memzero (&st, sizeof (st));
+    return 0;
+}
+
+/* The MAC is computed incrementally, keyed by the key named in the header,
+ * which for signing is the one added by prep.
+ */
+static void op_stream_destroy (void *state)
+{
+    if (state) {
+        sodium_memzero (state, sizeof (crypto_auth_hmacsha256_state));
+        free (state);
+    }
+}
+
+static int op_stream_create (flux_security_t *ctx, const struct kv *header,
+                             int flags, void **state)
+{
+    struct sign_hmac *sh = flux_security_aux_get (ctx, auxname);
+    crypto_auth_hmacsha256_state *st;
+    const struct hmac_key *k;
+
+    assert (sh != NULL);
+
+    if (!(k = header_key (ctx, sh, header)))
+        return -1;
+    if (!(st = malloc (sizeof (*st)))) {
+        security_error (ctx, NULL);
+        return -1;
+    }
+    crypto_auth_hmacsha256_init (st, k->key, k->keylen);
+    *state = st;
+    return 0;
+}
+
+static int op_stream_update (flux_security_t *ctx, void *state,
+                             const char *input, int inputsz)
+{
+    crypto_auth_hmacsha256_update (state, (const uint8_t *)input, inputsz);
+    return 0;
+}
+
+static char *op_stream_sign (flux_security_t *ctx, void *state, int flags)
+{
+    return hmac_sign (ctx, state);
+}
+
+static int op_stream_verify (flux_security_t *ctx, const struct kv *header,
+                             void *state, const char *signature, int flags,
+                             time_t *expires)
+{
+    struct sign_hmac *sh = flux_security_aux_get (ctx, auxname);
+
+    assert (sh != NULL);
+
+    if (hmac_check (ctx, state, signature) < 0)
+        return -1;
+    return check_times (ctx, sh, header, expires);
+}
+
+const struct sign_mech sign_mech_hmac = {
+    .name = "hmac",
+    .init = op_init,
+    .prep = op_prep,
+    .sign = op_sign,
+    .verify = op_verify,
+    .recheck = op_recheck,
+    .trust = op_trust,
+    .stream_create = op_stream_create,
+    .stream_update = op_stream_update,
+    .stream_sign = op_stream_sign,
+    .stream_verify = op_stream_verify,
+    .stream_destroy = op_stream_destroy,
+};
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
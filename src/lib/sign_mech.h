@@ -11,6 +11,9 @@
 #ifndef _FLUX_SECURITY_SIGN_MECH_H
 #define _FLUX_SECURITY_SIGN_MECH_H
 
+#include <time.h>
+#include <stdint.h>
+
 #include "sign.h"
 
 #include "src/libutil/cf.h"
@@ -32,10 +35,16 @@
  */
 typedef int (*sign_mech_init_f)(flux_security_t *ctx, const cf_t *cf);
 
+/* Set in 'flags' passed to prep when the input will be signed with the
+ * stream callbacks below, rather than sign.
+ */
+#define SIGN_MECH_STREAM 0x100
+
 /* prep (optional)
  * Called before signing, if defined.  Populate 'struct kv' header with
  * mechanism specific data before HEADER is serialized for signing.
- * 'flags' is identical to 'flags' param of flux_sign_wrap().
+ * 'flags' is identical to 'flags' param of flux_sign_wrap(), plus
+ * SIGN_MECH_STREAM if applicable.
  * Return 0 on success, or -1 on error with errno and context error set.
  */
 typedef int (*sign_mech_prep_f)(flux_security_t *ctx, struct kv *header,
@@ -55,12 +64,73 @@ typedef char *(*sign_mech_sign_f)(flux_security_t *ctx,
  * input/inputsz (input != NULL, inputsz > 0).
  * Parsed security 'header' is provided for access to mechanism specific
  * data, if any, as well as claimed 'userid' value for verification.
+ * On success, the mechanism may set 'expires' to the time after which the
+ * result is no longer valid, allowing it to be cached.  It is initially 0,
+ * which disables caching.
  * Return 0 on success, or -1 on error with errno and context error set.
  */
 typedef int (*sign_mech_verify_f)(flux_security_t *ctx,
                                   const struct kv *header,
 				  const char *input, int inputsz,
-				  const char *signature, int flags);
+				  const char *signature, int flags,
+				  time_t *expires);
+
+/* recheck (optional)
+ * Called in place of verify when the input is found unexpired in the
+ * verified signature cache.  Re-check any conditions that may have changed
+ * since verify succeeded, such as cert revocation, without repeating
+ * signature verification.
+ * Return 0 on success, or -1 on error with errno and context error set.
+ */
+typedef int (*sign_mech_recheck_f)(flux_security_t *ctx,
+                                   const struct kv *header, int flags);
+
+/* Size of the digest set by trust.
+ */
+#define SIGN_MECH_TRUSTSZ 32
+
+/* trust (optional)
+ * Set 'digest' to a hash of the configuration and keys that verification
+ * of a signature with security 'header' depends on, such as the CA cert.
+ * It is mixed into the verified signature cache key, so that a cached
+ * result is not reused after that trust context changes.  Without it,
+ * recheck must be able to detect any such change by itself.
+ * Return 0 on success, or -1 on error with errno and context error set.
+ */
+typedef int (*sign_mech_trust_f)(flux_security_t *ctx,
+                                 const struct kv *header,
+                                 uint8_t digest[SIGN_MECH_TRUSTSZ]);
+
+/* stream_create, stream_update, stream_sign, stream_verify, stream_destroy
+ * (optional, all or none)
+ * Sign or verify input presented in pieces, so that it need not be held
+ * in memory all at once.  stream_create is called with the complete
+ * 'header' (after prep when signing) and sets 'state'.  stream_update is
+ * called with successive pieces of input.  Then stream_sign returns the
+ * signature over all input as for sign, or stream_verify verifies it as
+ * for verify.  stream_destroy frees 'state'.
+ * Functions that return int return 0 on success, or -1 on error with errno
+ * and context error set.
+ */
+typedef int (*sign_mech_stream_create_f)(flux_security_t *ctx,
+                                         const struct kv *header,
+                                         int flags,
+                                         void **state);
+
+typedef int (*sign_mech_stream_update_f)(flux_security_t *ctx,
+                                         void *state,
+                                         const char *input, int inputsz);
+
+typedef char *(*sign_mech_stream_sign_f)(flux_security_t *ctx,
+                                         void *state, int flags);
+
+typedef int (*sign_mech_stream_verify_f)(flux_security_t *ctx,
+                                         const struct kv *header,
+                                         void *state,
+                                         const char *signature, int flags,
+                                         time_t *expires);
+
+typedef void (*sign_mech_stream_destroy_f)(void *state);
 
 struct sign_mech {
     const char *name;
@@ -68,10 +138,18 @@ struct sign_mech {
     sign_mech_prep_f prep;
     sign_mech_sign_f sign;
     sign_mech_verify_f verify;
+    sign_mech_recheck_f recheck;
+    sign_mech_trust_f trust;
+    sign_mech_stream_create_f stream_create;
+    sign_mech_stream_update_f stream_update;
+    sign_mech_stream_sign_f stream_sign;
+    sign_mech_stream_verify_f stream_verify;
+    sign_mech_stream_destroy_f stream_destroy;
 };
 
 extern const struct sign_mech sign_mech_none;
 extern const struct sign_mech sign_mech_munge;
 extern const struct sign_mech sign_mech_curve;
+extern const struct sign_mech sign_mech_hmac;
 
 #endif /* !_FLUX_SECURITY_SIGN_MECH_H */
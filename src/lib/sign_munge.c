@@ -16,6 +16,7 @@
 #include <string.h>
 #include <munge.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "src/libutil/sha256.h"
 
@@ -24,9 +25,25 @@
 #include "sign.h"
 #include "sign_mech.h"
 
+/* Decoded credentials are cached in a set associative table of
+ * 'nsets' * DECODE_CACHE_WAYS entries, keyed by a hash of the credential.
+ */
+#define DECODE_CACHE_WAYS       4
+#define DECODE_CACHE_MAXSIZE    (1024*1024)
+
+struct decode_entry {
+    uint8_t key[SHA256_BLOCK_SIZE];
+    time_t encode_time;     // zero if entry is unused
+    uid_t uid;
+    uint8_t digest[SHA256_BLOCK_SIZE + 1];
+};
+
 struct sign_munge {
     munge_ctx_t munge;
     int64_t max_ttl;
+    pthread_mutex_t lock;   // protects cache
+    struct decode_entry *cache;
+    int nsets;
 };
 
 /* Single byte codes to indicate hash type used.
@@ -41,6 +58,7 @@ enum {
  */
 static const struct cf_option munge_opts[] = {
     {"socket-path",     CF_STRING,      false},
+    {"decode-cache-size", CF_INT64,     false},
     CF_OPTIONS_TABLE_END,
 };
 
@@ -52,6 +70,8 @@ static void sm_destroy (struct sign_munge *sm)
         int saved_errno = errno;
         if (sm->munge)
             munge_ctx_destroy (sm->munge);
+        pthread_mutex_destroy (&sm->lock);
+        free (sm->cache);
         free (sm);
         errno = saved_errno;
     }
@@ -62,16 +82,15 @@ static int op_init (flux_security_t *ctx, const cf_t *cf)
     struct sign_munge *sm = flux_security_aux_get (ctx, auxname);
     const cf_t *munge_config;
     const char *socket_path = NULL;
+    int64_t cache_size = 0;
 
     if (sm != NULL)
         return 0;
     if (!(sm = calloc (1, sizeof (*sm))))
         goto error;
+    pthread_mutex_init (&sm->lock, NULL);
     if (!(sm->munge = munge_ctx_create ()))
         goto error;
-    if (flux_security_aux_set (ctx, auxname, sm,
-                               (flux_security_free_f)sm_destroy) < 0)
-        goto error;
     sm->max_ttl = cf_int64 (cf_get_in (cf, "max-ttl"));
     if ((munge_config = cf_get_in (cf, "munge"))) {
         struct cf_error cfe;
@@ -82,6 +101,18 @@ static int op_init (flux_security_t *ctx, const cf_t *cf)
         }
         if ((entry = cf_get_in (munge_config, "socket-path")))
             socket_path = cf_string (entry);
+        cache_size = cf_int64 (cf_get_in (munge_config, "decode-cache-size"));
+    }
+    if (cache_size < 0 || cache_size > DECODE_CACHE_MAXSIZE) {
+        errno = EINVAL;
+        security_error (ctx, "sign-munge-init: decode-cache-size is out of range");
+        goto error_nomsg;
+    }
+    if (cache_size > 0) {
+        sm->nsets = (cache_size + DECODE_CACHE_WAYS - 1) / DECODE_CACHE_WAYS;
+        if (!(sm->cache = calloc (sm->nsets * DECODE_CACHE_WAYS,
+                                  sizeof (sm->cache[0]))))
+            goto error;
     }
     if (socket_path) {
         munge_err_t e;
@@ -92,6 +123,9 @@ static int op_init (flux_security_t *ctx, const cf_t *cf)
             goto error_nomsg;
         }
     }
+    if (flux_security_aux_set (ctx, auxname, sm,
+                               (flux_security_free_f)sm_destroy) < 0)
+        goto error;
     return 0;
 error:
     security_error (ctx, NULL);
@@ -100,57 +134,157 @@ error_nomsg:
     return -1;
 }
 
-/* Compute hash over HEADER.PAYLOAD (input), then "sign" the hash,
+/* Finish hash 'shx' over HEADER.PAYLOAD, then "sign" the hash,
  * producing a munge credential.
  * Reserve first byte of munge payload to indicate which hash algorithm.
  */
-static char *op_sign (flux_security_t *ctx,
-                      const char *input, int inputsz, int flags)
+static char *munge_sign (flux_security_t *ctx, SHA256_CTX *shx)
 {
     struct sign_munge *sm = flux_security_aux_get (ctx, auxname);
     BYTE digest[SHA256_BLOCK_SIZE + 1] = { HASH_TYPE_SHA256 };
-    SHA256_CTX shx;
+    munge_ctx_t munge;
     char *cred;
     munge_err_t e;
 
     assert (sm != NULL);
-    sha256_init (&shx);
-    sha256_update (&shx, (const BYTE *)input, inputsz);
-    sha256_final (&shx, digest + 1);
-    e = munge_encode (&cred, sm->munge, digest, sizeof (digest));
+    if (!(munge = munge_ctx_copy (sm->munge))) {
+        errno = ENOMEM;
+        security_error (ctx, NULL);
+        return NULL;
+    }
+    sha256_final (shx, digest + 1);
+    e = munge_encode (&cred, munge, digest, sizeof (digest));
     if (e != EMUNGE_SUCCESS) {
         errno = EINVAL;
         security_error (ctx, "sign-munge-sign: %s",
-                        munge_ctx_strerror (sm->munge));
+                        munge_ctx_strerror (munge));
+        munge_ctx_destroy (munge);
         return NULL;
     }
+    munge_ctx_destroy (munge);
     return cred;
 }
 
-/* Recompute hash over HEADER.PAYLOAD portion of input, then munge_decode
- * the SIGNATURE portion of input as a munge cred, and check:
- * - munge cred's payload matches the computed hash
- * - security header userid matches munge cred uid
- * - munge encode time plus configured max-ttl is not past.
+static char *op_sign (flux_security_t *ctx,
+                      const char *input, int inputsz, int flags)
+{
+    SHA256_CTX shx;
+
+    sha256_init (&shx);
+    sha256_update (&shx, (const BYTE *)input, inputsz);
+    return munge_sign (ctx, &shx);
+}
+
+/* Return the first entry of the cache set for credential 'key'.
  */
-static int op_verify (flux_security_t *ctx, const struct kv *header,
-                      const char *input, int inputsz,
-                      const char *signature, int flags)
+static struct decode_entry *decode_cache_set (struct sign_munge *sm,
+                                              const uint8_t *key)
 {
-    struct sign_munge *sm = flux_security_aux_get (ctx, auxname);
+    uint32_t h;
+
+    memcpy (&h, key, sizeof (h));
+    return &sm->cache[(h % sm->nsets) * DECODE_CACHE_WAYS];
+}
+
+/* Look up credential 'key' in the decode cache.  If found and the
+ * credential has not exceeded max-ttl at 'now', copy the decoded uid,
+ * encode time, and payload digest and return 0.  Otherwise return -1.
+ */
+static int decode_cache_lookup (struct sign_munge *sm,
+                                const uint8_t *key,
+                                time_t now,
+                                uid_t *uid,
+                                time_t *encode_time,
+                                uint8_t *digest)
+{
+    struct decode_entry *set;
+    int rc = -1;
+
+    if (!sm->cache)
+        return -1;
+    pthread_mutex_lock (&sm->lock);
+    set = decode_cache_set (sm, key);
+    for (int i = 0; i < DECODE_CACHE_WAYS; i++) {
+        struct decode_entry *e = &set[i];
+
+        if (e->encode_time != 0
+            && memcmp (e->key, key, sizeof (e->key)) == 0) {
+            if (e->encode_time + sm->max_ttl < now)
+                e->encode_time = 0;
+            else {
+                *uid = e->uid;
+                *encode_time = e->encode_time;
+                memcpy (digest, e->digest, sizeof (e->digest));
+                rc = 0;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock (&sm->lock);
+    return rc;
+}
+
+/* Add decoded credential 'key' to the decode cache, replacing an unused
+ * entry or, failing that, the entry that expires first.
+ */
+static void decode_cache_insert (struct sign_munge *sm,
+                                 const uint8_t *key,
+                                 uid_t uid,
+                                 time_t encode_time,
+                                 const uint8_t *digest)
+{
+    struct decode_entry *set;
+    struct decode_entry *e;
+
+    if (!sm->cache || encode_time == 0)
+        return;
+    pthread_mutex_lock (&sm->lock);
+    set = decode_cache_set (sm, key);
+    e = &set[0];
+    for (int i = 0; i < DECODE_CACHE_WAYS; i++) {
+        if (set[i].encode_time == 0
+            || memcmp (set[i].key, key, sizeof (set[i].key)) == 0) {
+            e = &set[i];
+            break;
+        }
+        if (set[i].encode_time < e->encode_time)
+            e = &set[i];
+    }
+    memcpy (e->key, key, sizeof (e->key));
+    e->uid = uid;
+    e->encode_time = encode_time;
+    memcpy (e->digest, digest, sizeof (e->digest));
+    pthread_mutex_unlock (&sm->lock);
+}
+
+/* munge_decode 'signature', and set the originating 'uid', 'encode_time',
+ * and payload 'digest', which must be a hash type byte followed by a
+ * SHA256 hash.  Return 0 on success, -1 on failure with errno and context
+ * error set.
+ */
+static int munge_decode_digest (flux_security_t *ctx,
+                                struct sign_munge *sm,
+                                const char *signature,
+                                uid_t *uid,
+                                time_t *encode_time,
+                                uint8_t *digest)
+{
+    munge_ctx_t munge;
     munge_err_t e;
     char *indigest = NULL;
     int indigestsz = 0;
-    uid_t uid;
-    uint64_t userid;
-    time_t now;
-    time_t encode_time;
     int saved_errno;
 
-    assert (sm != NULL);
-
-    e = munge_decode (signature, sm->munge, (void **)&indigest,
-                                                     &indigestsz, &uid, NULL);
+    /* munge_decode() leaves per-call state such as the encode time in the
+     * munge context, so use a private copy in case 'ctx' is shared.
+     */
+    if (!(munge = munge_ctx_copy (sm->munge))) {
+        errno = ENOMEM;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    e = munge_decode (signature, munge, (void **)&indigest,
+                                                     &indigestsz, uid, NULL);
     /*  EMUNGE_CRED_REPLAYED is intentionally accepted: credentials may be
      *  legitimately reused more than once per node (e.g. in testing when
      *  running multiple brokers per node).  TTL checking below provides
@@ -162,67 +296,170 @@ static int op_verify (flux_security_t *ctx, const struct kv *header,
                             && e != EMUNGE_CRED_EXPIRED) {
         errno = EINVAL;
         security_error (ctx, "sign-munge-verify: munge_decode: %s",
-                        munge_ctx_strerror (sm->munge));
+                        munge_ctx_strerror (munge));
         goto error;
     }
-
     switch (indigestsz > 0 ? indigest[0] : HASH_TYPE_INVALID) {
-        case HASH_TYPE_SHA256: {
-            BYTE refdigest[SHA256_BLOCK_SIZE + 1] = { HASH_TYPE_SHA256 };
-            SHA256_CTX shx;
-
-            sha256_init (&shx);
-            sha256_update (&shx, (const BYTE *)input, inputsz);
-            sha256_final (&shx, refdigest + 1);
-
-            if (indigestsz != sizeof (refdigest)
-                        || memcmp (refdigest, indigest, indigestsz) != 0) {
+        case HASH_TYPE_SHA256:
+            if (indigestsz != SHA256_BLOCK_SIZE + 1) {
                 errno = EINVAL;
                 security_error (ctx, "sign-munge-verify: SHA256 hash mismatch");
                 goto error;
             }
+            memcpy (digest, indigest, indigestsz);
             break;
-        }
         default:
             errno = EINVAL;
             security_error (ctx, "sign-munge-verify: unknown hash type");
             goto error;
     }
-
-    if (kv_get (header, "userid", KV_INT64, &userid) < 0 || userid != uid) {
-        errno = EINVAL;
-        security_error (ctx, "sign-munge-verify: uid mismatch");
-        goto error;
-    }
-    e = munge_ctx_get (sm->munge, MUNGE_OPT_ENCODE_TIME, &encode_time);
+    e = munge_ctx_get (munge, MUNGE_OPT_ENCODE_TIME, encode_time);
     if (e != EMUNGE_SUCCESS) {
         errno = EINVAL;
         security_error (ctx, "sign-munge-verify: munge_ctx_get ENCODE_TIME: %s",
-                        munge_ctx_strerror (sm->munge));
-        goto error;
-    }
-    if ((now = time (NULL)) == (time_t)-1)
-        goto error;
-    if (encode_time + sm->max_ttl < now) {
-        errno = EINVAL;
-        security_error (ctx, "sign-munge-verify: max-ttl exceeded");
+                        munge_ctx_strerror (munge));
         goto error;
     }
     free (indigest);
+    munge_ctx_destroy (munge);
     return 0;
 error:
     saved_errno = errno;
     free (indigest);
+    munge_ctx_destroy (munge);
     errno = saved_errno;
     return -1;
 }
 
+/* Finish hash 'shx' over HEADER.PAYLOAD portion of input, then
+ * munge_decode the SIGNATURE portion of input as a munge cred, and check:
+ * - munge cred's payload matches the computed hash
+ * - security header userid matches munge cred uid
+ * - munge encode time plus configured max-ttl is not past.
+ * If the decode cache is enabled and holds the cred, munge_decode is
+ * skipped, but the checks are still made.
+ */
+static int munge_verify (flux_security_t *ctx, const struct kv *header,
+                         SHA256_CTX *shx, const char *signature,
+                         time_t *expires)
+{
+    struct sign_munge *sm = flux_security_aux_get (ctx, auxname);
+    uint8_t key[SHA256_BLOCK_SIZE];
+    BYTE indigest[SHA256_BLOCK_SIZE + 1];
+    BYTE refdigest[SHA256_BLOCK_SIZE + 1] = { HASH_TYPE_SHA256 };
+    uid_t uid;
+    uint64_t userid;
+    time_t now;
+    time_t encode_time;
+    bool cached = false;
+
+    assert (sm != NULL);
+
+    if ((now = time (NULL)) == (time_t)-1) {
+        security_error (ctx, NULL);
+        return -1;
+    }
+    if (sm->cache) {
+        SHA256_CTX kshx;
+
+        sha256_init (&kshx);
+        sha256_update (&kshx, (const BYTE *)signature, strlen (signature));
+        sha256_final (&kshx, key);
+        if (decode_cache_lookup (sm, key, now, &uid, &encode_time,
+                                 indigest) == 0)
+            cached = true;
+    }
+    if (!cached && munge_decode_digest (ctx, sm, signature, &uid,
+                                        &encode_time, indigest) < 0)
+        return -1;
+
+    sha256_final (shx, refdigest + 1);
+    if (memcmp (refdigest, indigest, sizeof (refdigest)) != 0) {
+        errno = EINVAL;
+        security_error (ctx, "sign-munge-verify: SHA256 hash mismatch");
+        return -1;
+    }
+    if (kv_get (header, "userid", KV_INT64, &userid) < 0 || userid != uid) {
+        errno = EINVAL;
+        security_error (ctx, "sign-munge-verify: uid mismatch");
+        return -1;
+    }
+    if (encode_time + sm->max_ttl < now) {
+        errno = EINVAL;
+        security_error (ctx, "sign-munge-verify: max-ttl exceeded");
+        return -1;
+    }
+    if (!cached)
+        decode_cache_insert (sm, key, uid, encode_time, indigest);
+    *expires = encode_time + sm->max_ttl;
+    return 0;
+}
+
+static int op_verify (flux_security_t *ctx, const struct kv *header,
+                      const char *input, int inputsz,
+                      const char *signature, int flags,
+                      time_t *expires)
+{
+    SHA256_CTX shx;
+
+    sha256_init (&shx);
+    sha256_update (&shx, (const BYTE *)input, inputsz);
+    return munge_verify (ctx, header, &shx, signature, expires);
+}
+
+/* The munge payload is a hash of the input, so streaming only requires
+ * the hash to be computed incrementally.
+ */
+static int op_stream_create (flux_security_t *ctx, const struct kv *header,
+                             int flags, void **state)
+{
+    SHA256_CTX *shx;
+
+    if (!(shx = malloc (sizeof (*shx)))) {
+        security_error (ctx, NULL);
+        return -1;
+    }
+    sha256_init (shx);
+    *state = shx;
+    return 0;
+}
+
+static int op_stream_update (flux_security_t *ctx, void *state,
+                             const char *input, int inputsz)
+{
+    sha256_update (state, (const BYTE *)input, inputsz);
+    return 0;
+}
+
+static char *op_stream_sign (flux_security_t *ctx, void *state, int flags)
+{
+    return munge_sign (ctx, state);
+}
+
+static int op_stream_verify (flux_security_t *ctx, const struct kv *header,
+                             void *state, const char *signature, int flags,
+                             time_t *expires)
+{
+    return munge_verify (ctx, header, state, signature, expires);
+}
+
+static void op_stream_destroy (void *state)
+{
+    free (state);
+}
+
 const struct sign_mech sign_mech_munge = {
     .name = "munge",
     .init = op_init,
     .prep = NULL,
     .sign = op_sign,
     .verify = op_verify,
+    .recheck = NULL,
+    .stream_create = op_stream_create,
+    .stream_update = op_stream_update,
+    .stream_sign = op_stream_sign,
+    .stream_verify = op_stream_verify,
+    .stream_destroy = op_stream_destroy,
 };
 
 /*
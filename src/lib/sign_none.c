@@ -36,7 +36,8 @@ static char *op_sign (flux_security_t *ctx,
 
 static int op_verify (flux_security_t *ctx, const struct kv *header,
                       const char *input, int inputsz,
-                      const char *signature, int flags)
+                      const char *signature, int flags,
+                      time_t *expires)
 {
     int64_t userid;
     int64_t real_userid = getuid ();
@@ -56,12 +57,49 @@ static int op_verify (flux_security_t *ctx, const struct kv *header,
     return 0;
 }
 
+/* The signature does not depend on the input, so no stream state is needed.
+ */
+static int op_stream_create (flux_security_t *ctx, const struct kv *header,
+                             int flags, void **state)
+{
+    *state = NULL;
+    return 0;
+}
+
+static int op_stream_update (flux_security_t *ctx, void *state,
+                             const char *input, int inputsz)
+{
+    return 0;
+}
+
+static char *op_stream_sign (flux_security_t *ctx, void *state, int flags)
+{
+    return op_sign (ctx, NULL, 0, flags);
+}
+
+static int op_stream_verify (flux_security_t *ctx, const struct kv *header,
+                             void *state, const char *signature, int flags,
+                             time_t *expires)
+{
+    return op_verify (ctx, header, NULL, 0, signature, flags, expires);
+}
+
+static void op_stream_destroy (void *state)
+{
+}
+
 const struct sign_mech sign_mech_none = {
     .name = "none",
     .init = NULL,
     .prep = NULL,
     .sign = op_sign,
     .verify = op_verify,
+    .recheck = NULL,
+    .stream_create = op_stream_create,
+    .stream_update = op_stream_update,
+    .stream_sign = op_stream_sign,
+    .stream_verify = op_stream_verify,
+    .stream_destroy = op_stream_destroy,
 };
 
 /*
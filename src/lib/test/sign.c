@@ -12,7 +12,12 @@
 #include "config.h"
 #endif
 #include <errno.h>
+#include <stdint.h>
 #include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
 #include <sys/param.h>
 #include <sodium.h>
 
@@ -69,6 +74,49 @@ const char *badconf_nonstring_allowed_types = \
 "default-type = \"none\"\n" \
 "allowed-types = [ 1 ]\n";
 
+const char *conf_batch = \
+"[sign]\n" \
+"max-ttl = 30\n" \
+"default-type = \"none\"\n" \
+"allowed-types = [ \"none\" ]\n" \
+"batch-workers = 4\n";
+
+const char *badconf_neg_batch_workers = \
+"[sign]\n" \
+"max-ttl = 30\n" \
+"default-type = \"none\"\n" \
+"allowed-types = [ \"none\" ]\n" \
+"batch-workers = -1\n";
+
+const char *conf_cache = \
+"[sign]\n" \
+"max-ttl = 30\n" \
+"default-type = \"none\"\n" \
+"allowed-types = [ \"none\" ]\n" \
+"batch-workers = 4\n" \
+"verify-cache-size = 16\n";
+
+const char *badconf_neg_verify_cache_size = \
+"[sign]\n" \
+"max-ttl = 30\n" \
+"default-type = \"none\"\n" \
+"allowed-types = [ \"none\" ]\n" \
+"verify-cache-size = -1\n";
+
+const char *conf_v2 = \
+"[sign]\n" \
+"max-ttl = 30\n" \
+"default-type = \"none\"\n" \
+"allowed-types = [ \"none\" ]\n" \
+"wrap-version = 2\n";
+
+const char *badconf_wrap_version = \
+"[sign]\n" \
+"max-ttl = 30\n" \
+"default-type = \"none\"\n" \
+"allowed-types = [ \"none\" ]\n" \
+"wrap-version = 3\n";
+
 
 static char tmpdir[PATH_MAX + 1];
 static char cfpath[PATH_MAX + 1];
@@ -188,6 +236,30 @@ void test_config (void)
         "flux_sign_wrap with nonstring allowed-types config fails with EINVAL");
     diag ("%s", flux_security_last_error (ctx));
     flux_security_destroy (ctx);
+
+    if (!(ctx = context_init (badconf_neg_batch_workers)))
+        BAIL_OUT ("failed to set up test config");
+    errno = 0;
+    ok (flux_sign_wrap (ctx, "foo", 3, NULL, 0) == NULL && errno == EINVAL,
+        "flux_sign_wrap with negative batch-workers config fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+    flux_security_destroy (ctx);
+
+    if (!(ctx = context_init (badconf_neg_verify_cache_size)))
+        BAIL_OUT ("failed to set up test config");
+    errno = 0;
+    ok (flux_sign_wrap (ctx, "foo", 3, NULL, 0) == NULL && errno == EINVAL,
+        "flux_sign_wrap with negative verify-cache-size fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+    flux_security_destroy (ctx);
+
+    if (!(ctx = context_init (badconf_wrap_version)))
+        BAIL_OUT ("failed to set up test config");
+    errno = 0;
+    ok (flux_sign_wrap (ctx, "foo", 3, NULL, 0) == NULL && errno == EINVAL,
+        "flux_sign_wrap with wrap-version = 3 fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+    flux_security_destroy (ctx);
 }
 
 void test_basic (flux_security_t *ctx)
@@ -559,9 +631,1231 @@ void test_corner (flux_security_t *ctx)
     free (cpy);
 }
 
+/* Unwrap a batch of 'count' items, with every 7th item signed as a
+ * different user so that it fails verification.
+ */
+void test_batch (flux_security_t *ctx, int count)
+{
+    struct flux_sign_unwrap_item *items;
+    char payload[64];
+    bool good = true;
+    int failed;
+    int i;
+
+    if (!(items = calloc (count, sizeof (items[0]))))
+        BAIL_OUT ("out of memory");
+    for (i = 0; i < count; i++) {
+        const char *s;
+        snprintf (payload, sizeof (payload), "payload-%d", i);
+        if (i % 7 == 3)
+            s = flux_sign_wrap_as (ctx, getuid () + 1,
+                                   payload, strlen (payload), NULL, 0);
+        else
+            s = flux_sign_wrap (ctx, payload, strlen (payload), NULL, 0);
+        if (!s || !(items[i].input = strdup (s)))
+            BAIL_OUT ("flux_sign_wrap: %s", flux_security_last_error (ctx));
+    }
+    failed = flux_sign_unwrap_batch (ctx, items, count, 0);
+    ok (failed == (count + 3) / 7,
+        "flux_sign_unwrap_batch count=%d reports %d failures",
+        count, failed);
+    for (i = 0; i < count; i++) {
+        snprintf (payload, sizeof (payload), "payload-%d", i);
+        if (i % 7 == 3) {
+            if (items[i].errnum != EINVAL
+                || items[i].error == NULL
+                || items[i].payload != NULL)
+                good = false;
+        }
+        else {
+            if (items[i].errnum != 0
+                || items[i].error != NULL
+                || items[i].userid != getuid ()
+                || items[i].payloadsz != (int)strlen (payload)
+                || memcmp (items[i].payload, payload, items[i].payloadsz) != 0)
+                good = false;
+        }
+    }
+    ok (good,
+        "flux_sign_unwrap_batch returned expected per-item results");
+    if (count > 3)
+        diag ("%s", items[3].error);
+
+    failed = flux_sign_unwrap_batch (ctx, items, count, FLUX_SIGN_NOVERIFY);
+    ok (failed == 0,
+        "flux_sign_unwrap_batch NOVERIFY reports no failures");
+    good = true;
+    for (i = 0; i < count; i++) {
+        snprintf (payload, sizeof (payload), "payload-%d", i);
+        if (items[i].errnum != 0
+            || items[i].userid != getuid () + (i % 7 == 3 ? 1 : 0)
+            || items[i].payloadsz != (int)strlen (payload)
+            || memcmp (items[i].payload, payload, items[i].payloadsz) != 0)
+            good = false;
+    }
+    ok (good,
+        "flux_sign_unwrap_batch NOVERIFY returned expected per-item results");
+
+    for (i = 0; i < count; i++)
+        free ((char *)items[i].input);
+    free (items);
+}
+
+void test_batch_corner (flux_security_t *ctx)
+{
+    struct flux_sign_unwrap_item items[3];
+    const char *s;
+    void *buf = NULL;
+    int bufsz = 0;
+
+    if (!(s = flux_sign_wrap (ctx, NULL, 0, NULL, 0)))
+        BAIL_OUT ("flux_sign_wrap: %s", flux_security_last_error (ctx));
+    memset (items, 0, sizeof (items));
+    items[0].input = s;
+    items[1].input = NULL;
+    items[2].input = "foo";
+
+    ok (flux_sign_unwrap_batch (ctx, items, 3, 0) == 2,
+        "flux_sign_unwrap_batch with invalid items reports 2 failures");
+    ok (items[0].errnum == 0 && items[0].payload == NULL
+        && items[0].payloadsz == 0,
+        "empty payload was unwrapped");
+    ok (items[1].errnum == EINVAL && items[1].error != NULL,
+        "input=NULL failed with EINVAL");
+    ok (items[2].errnum == EINVAL && items[2].error != NULL,
+        "input=foo failed with EINVAL");
+    ok (flux_sign_unwrap_batch (ctx, NULL, 0, 0) == 0,
+        "flux_sign_unwrap_batch count=0 works");
+
+    errno = 0;
+    ok (flux_sign_unwrap_batch (NULL, items, 3, 0) < 0 && errno == EINVAL,
+        "flux_sign_unwrap_batch ctx=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_batch (ctx, NULL, 3, 0) < 0 && errno == EINVAL,
+        "flux_sign_unwrap_batch items=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_batch (ctx, items, -1, 0) < 0 && errno == EINVAL,
+        "flux_sign_unwrap_batch count=-1 fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_batch (ctx, items, 3, 0xff) < 0 && errno == EINVAL,
+        "flux_sign_unwrap_batch flags=0xff fails with EINVAL");
+
+    ok (flux_sign_unwrap_batch_r (ctx, items, 3, &buf, &bufsz, 0) == 2,
+        "flux_sign_unwrap_batch_r with invalid items reports 2 failures");
+    ok (items[0].errnum == 0 && items[0].payload == NULL
+        && items[2].errnum == EINVAL
+        && items[2].error >= (char *)buf
+        && items[2].error < (char *)buf + bufsz,
+        "flux_sign_unwrap_batch_r stored results in caller buffer");
+    errno = 0;
+    ok (flux_sign_unwrap_batch_r (ctx, items, 3, NULL, &bufsz, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_batch_r buf=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_batch_r (ctx, items, 3, &buf, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_batch_r bufsz=NULL fails with EINVAL");
+    free (buf);
+}
+
+/* Wait for completions on the async fd and retrieve them until 'count'
+ * futures have been stored in 'futures', indexed by their arg.
+ */
+static void async_collect (flux_security_t *ctx,
+                           flux_sign_future_t **futures,
+                           int count)
+{
+    struct pollfd pfd = { .events = POLLIN };
+    flux_sign_future_t *f;
+    int n = 0;
+
+    if ((pfd.fd = flux_sign_async_fd (ctx)) < 0)
+        BAIL_OUT ("flux_sign_async_fd: %s", flux_security_last_error (ctx));
+    while (n < count) {
+        if (poll (&pfd, 1, 10000) != 1)
+            BAIL_OUT ("timed out waiting for async completion");
+        while ((f = flux_sign_async_next (ctx))) {
+            futures[(intptr_t)flux_sign_future_arg (f)] = f;
+            n++;
+        }
+        if (errno != EAGAIN)
+            BAIL_OUT ("flux_sign_async_next: %s", strerror (errno));
+    }
+}
+
+/* Wrap 'count' payloads asynchronously, then unwrap the results, with
+ * every 7th signed as a different user so that it fails verification.
+ */
+void test_async (flux_security_t *ctx, int count)
+{
+    flux_sign_future_t **futures;
+    char **inputs;
+    char payload[64];
+    struct pollfd pfd = { .events = POLLIN };
+    bool good = true;
+    int i;
+
+    if (!(futures = calloc (count, sizeof (futures[0])))
+        || !(inputs = calloc (count, sizeof (inputs[0]))))
+        BAIL_OUT ("out of memory");
+    for (i = 0; i < count; i++) {
+        snprintf (payload, sizeof (payload), "payload-%d", i);
+        if (!flux_sign_wrap_async (ctx, payload, strlen (payload), NULL, 0,
+                                   (void *)(intptr_t)i))
+            BAIL_OUT ("flux_sign_wrap_async: %s",
+                      flux_security_last_error (ctx));
+    }
+    async_collect (ctx, futures, count);
+    for (i = 0; i < count; i++) {
+        const char *s;
+        if (flux_sign_wrap_get (futures[i], &s) < 0)
+            BAIL_OUT ("flux_sign_wrap_get: %s", flux_security_last_error (ctx));
+        if (i % 7 == 3) {
+            snprintf (payload, sizeof (payload), "payload-%d", i);
+            s = flux_sign_wrap_as (ctx, getuid () + 1,
+                                   payload, strlen (payload), NULL, 0);
+        }
+        if (!s || !(inputs[i] = strdup (s)))
+            BAIL_OUT ("out of memory");
+        flux_sign_future_destroy (futures[i]);
+    }
+    ok (true,
+        "flux_sign_wrap_async count=%d works", count);
+
+    for (i = 0; i < count; i++) {
+        if (!flux_sign_unwrap_async (ctx, inputs[i], strlen (inputs[i]), 0,
+                                     (void *)(intptr_t)i))
+            BAIL_OUT ("flux_sign_unwrap_async: %s",
+                      flux_security_last_error (ctx));
+    }
+    async_collect (ctx, futures, count);
+    for (i = 0; i < count; i++) {
+        const void *pay;
+        int paysz;
+        int64_t userid;
+        int rc;
+
+        snprintf (payload, sizeof (payload), "payload-%d", i);
+        errno = 0;
+        rc = flux_sign_unwrap_get (futures[i], &pay, &paysz, &userid);
+        if (i % 7 == 3) {
+            if (rc == 0 || errno != EINVAL
+                || !flux_security_last_error (ctx))
+                good = false;
+        }
+        else {
+            if (rc < 0
+                || userid != getuid ()
+                || paysz != (int)strlen (payload)
+                || memcmp (pay, payload, paysz) != 0)
+                good = false;
+        }
+        flux_sign_future_destroy (futures[i]);
+        free (inputs[i]);
+    }
+    ok (good,
+        "flux_sign_unwrap_async count=%d returned expected results", count);
+
+    errno = 0;
+    ok (flux_sign_async_next (ctx) == NULL && errno == EAGAIN,
+        "flux_sign_async_next fails with EAGAIN when queue is empty");
+    pfd.fd = flux_sign_async_fd (ctx);
+    ok (poll (&pfd, 1, 0) == 0,
+        "async fd is not readable when queue is empty");
+
+    free (inputs);
+    free (futures);
+}
+
+void test_async_corner (flux_security_t *ctx)
+{
+    flux_sign_future_t *f;
+    flux_sign_future_t *fs[100];
+    struct pollfd pfd = { .events = POLLIN };
+    const char *s;
+    const void *pay;
+    int paysz;
+    int64_t userid;
+    int i;
+
+    ok ((pfd.fd = flux_sign_async_fd (ctx)) >= 0,
+        "flux_sign_async_fd works");
+
+    ok ((f = flux_sign_wrap_async (ctx, NULL, 0, NULL, 0, NULL)) != NULL,
+        "flux_sign_wrap_async with empty payload works");
+    ok (flux_sign_future_wait (f) == 0,
+        "flux_sign_future_wait works");
+    ok (poll (&pfd, 1, 0) == 1,
+        "async fd is readable after completion");
+    ok (flux_sign_wrap_get (f, &s) == 0 && s != NULL,
+        "flux_sign_wrap_get works before flux_sign_async_next");
+    errno = 0;
+    ok (flux_sign_unwrap_get (f, &pay, &paysz, &userid) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_get on wrap future fails with EINVAL");
+    flux_sign_future_destroy (f);
+    ok (poll (&pfd, 1, 0) == 0,
+        "async fd is not readable after completed future is destroyed");
+
+    ok ((f = flux_sign_unwrap_async (ctx, "foo", 3, 0, &pfd)) != NULL,
+        "flux_sign_unwrap_async input=foo works");
+    ok (flux_sign_future_arg (f) == &pfd,
+        "flux_sign_future_arg returns arg");
+    flux_sign_future_wait (f);
+    errno = 0;
+    ok (flux_sign_unwrap_get (f, &pay, &paysz, &userid) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_get input=foo fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+    ok (flux_sign_async_next (ctx) == f,
+        "flux_sign_async_next returns failed future");
+    flux_sign_future_destroy (f);
+
+    for (i = 0; i < 100; i++) {
+        if (!(fs[i] = flux_sign_wrap_async (ctx, "x", 1, NULL, 0, NULL)))
+            BAIL_OUT ("flux_sign_wrap_async: %s",
+                      flux_security_last_error (ctx));
+    }
+    for (i = 0; i < 100; i++)
+        flux_sign_future_destroy (fs[i]);
+    if (!(f = flux_sign_wrap_async (ctx, "x", 1, NULL, 0, NULL)))
+        BAIL_OUT ("flux_sign_wrap_async: %s", flux_security_last_error (ctx));
+    flux_sign_future_wait (f);
+    ok (flux_sign_async_next (ctx) == f && flux_sign_async_next (ctx) == NULL,
+        "destroyed futures are not returned by flux_sign_async_next");
+    flux_sign_future_destroy (f);
+
+    errno = 0;
+    ok (flux_sign_wrap_async (NULL, "x", 1, NULL, 0, NULL) == NULL
+        && errno == EINVAL,
+        "flux_sign_wrap_async ctx=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_wrap_async (ctx, NULL, 1, NULL, 0, NULL) == NULL
+        && errno == EINVAL,
+        "flux_sign_wrap_async payload=NULL payloadsz=1 fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_wrap_async (ctx, "x", 1, NULL, 1, NULL) == NULL
+        && errno == EINVAL,
+        "flux_sign_wrap_async flags=1 fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_async (ctx, NULL, 0, 0, NULL) == NULL
+        && errno == EINVAL,
+        "flux_sign_unwrap_async input=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_async (ctx, "x", 1, 0xff, NULL) == NULL
+        && errno == EINVAL,
+        "flux_sign_unwrap_async flags=0xff fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_wrap_get (NULL, &s) < 0 && errno == EINVAL,
+        "flux_sign_wrap_get f=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_async_fd (NULL) < 0 && errno == EINVAL,
+        "flux_sign_async_fd ctx=NULL fails with EINVAL");
+    lives_ok ({flux_sign_future_destroy (NULL);},
+        "flux_sign_future_destroy f=NULL doesn't crash");
+}
+
+void test_reentrant (flux_security_t *ctx)
+{
+    char *wbuf = NULL;
+    int wbufsz = 0;
+    void *ubuf = NULL;
+    int ubufsz = 0;
+    int payloadsz;
+    int64_t userid;
+    char *p;
+
+    ok (flux_sign_wrap_r (ctx, "foo", 3, NULL, 0, &wbuf, &wbufsz) == 0
+        && wbuf != NULL && wbufsz > (int)strlen (wbuf),
+        "flux_sign_wrap_r allocates buffer");
+    p = wbuf;
+    ok (flux_sign_wrap_r (ctx, "bar", 3, NULL, 0, &wbuf, &wbufsz) == 0
+        && wbuf == p,
+        "flux_sign_wrap_r reuses buffer");
+    ok (flux_sign_unwrap_r (ctx, wbuf, &ubuf, &ubufsz, &payloadsz,
+                            &userid, 0) == 0
+        && ubuf != NULL
+        && payloadsz == 3
+        && memcmp (ubuf, "bar", 3) == 0
+        && userid == getuid (),
+        "flux_sign_unwrap_r works");
+    ok (flux_sign_unwrap_r (ctx, wbuf, &ubuf, &ubufsz, NULL, NULL, 0) == 0,
+        "flux_sign_unwrap_r payloadsz=NULL userid=NULL works");
+
+    errno = 0;
+    ok (flux_sign_wrap_r (NULL, "foo", 3, NULL, 0, &wbuf, &wbufsz) < 0
+        && errno == EINVAL,
+        "flux_sign_wrap_r ctx=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_wrap_r (ctx, "foo", 3, NULL, 0, NULL, &wbufsz) < 0
+        && errno == EINVAL,
+        "flux_sign_wrap_r buf=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_wrap_r (ctx, "foo", 3, NULL, 0, &wbuf, NULL) < 0
+        && errno == EINVAL,
+        "flux_sign_wrap_r bufsz=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_r (NULL, wbuf, &ubuf, &ubufsz, NULL, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_r ctx=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_r (ctx, NULL, &ubuf, &ubufsz, NULL, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_r input=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_r (ctx, wbuf, NULL, &ubufsz, NULL, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_r buf=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_r (ctx, "foo", &ubuf, &ubufsz, NULL, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_r input=foo fails with EINVAL");
+
+    free (wbuf);
+    free (ubuf);
+}
+
+/* Wrap with userids of varying length, so that the start of each header
+ * matches the previous one to a varying extent, and check the result
+ * against a wrap by a context that has not wrapped anything before.
+ */
+void test_header_reuse (flux_security_t *ctx)
+{
+    int64_t uids[] = { 1, 123456789, 12, 0, 4294967295, 123456, 7 };
+    int nuids = sizeof (uids) / sizeof (uids[0]);
+    const char *inmsg = "reuse";
+    int inmsgsz = strlen (inmsg);
+    bool good = true;
+
+    for (int i = 0; i < nuids; i++) {
+        flux_security_t *ctx2 = context_init (conf);
+        const char *s;
+        const char *s2;
+        const void *outmsg;
+        int outmsgsz;
+        int64_t userid;
+
+        s = flux_sign_wrap_as (ctx, uids[i], inmsg, inmsgsz, "none", 0);
+        s2 = flux_sign_wrap_as (ctx2, uids[i], inmsg, inmsgsz, "none", 0);
+        if (!s || !s2 || strcmp (s, s2) != 0)
+            good = false;
+        else if (flux_sign_unwrap (ctx, s, &outmsg, &outmsgsz, &userid,
+                                   FLUX_SIGN_NOVERIFY) < 0
+                 || userid != uids[i]
+                 || outmsgsz != inmsgsz
+                 || memcmp (outmsg, inmsg, outmsgsz) != 0)
+            good = false;
+        if (!good)
+            diag ("userid=%jd: %s", (intmax_t)uids[i], s ? s : "NULL");
+        flux_security_destroy (ctx2);
+    }
+    ok (good,
+        "successive headers are encoded correctly");
+}
+
+/* Wrap with the [sign] wrap-version = 2 context 'ctx2', and check
+ * that the armored result, and version 1 input, can be unwrapped.
+ */
+void test_armored (flux_security_t *ctx, flux_security_t *ctx2)
+{
+    const char *inmsg = "hello world";
+    int inmsgsz = strlen (inmsg);
+    const void *outmsg;
+    int outmsgsz;
+    int64_t userid;
+    const char *s;
+    char *v1;
+    char *header;
+    char input[2048];
+
+    s = flux_sign_wrap (ctx2, inmsg, inmsgsz, NULL, 0);
+    ok (s != NULL && strncmp (s, "v2:", 3) == 0,
+        "flux_sign_wrap with wrap-version = 2 produces armored frame");
+    diag ("%s", s ? s : "NULL");
+    ok (flux_sign_unwrap (ctx, s, &outmsg, &outmsgsz, &userid, 0) == 0
+        && outmsgsz == inmsgsz
+        && memcmp (outmsg, inmsg, inmsgsz) == 0
+        && userid == getuid (),
+        "flux_sign_unwrap works on armored frame");
+    ok (flux_sign_unwrap (ctx, s, &outmsg, &outmsgsz, NULL,
+                          FLUX_SIGN_NOVERIFY) == 0
+        && outmsgsz == inmsgsz,
+        "flux_sign_unwrap NOVERIFY works on armored frame");
+
+    s = flux_sign_wrap (ctx2, NULL, 0, NULL, 0);
+    ok (s != NULL
+        && flux_sign_unwrap (ctx, s, &outmsg, &outmsgsz, NULL, 0) == 0
+        && outmsg == NULL
+        && outmsgsz == 0,
+        "armored frame with empty payload works");
+
+    s = flux_sign_wrap_as (ctx2, 42, inmsg, inmsgsz, NULL, 0);
+    ok (s != NULL
+        && flux_sign_unwrap (ctx, s, NULL, NULL, &userid,
+                             FLUX_SIGN_NOVERIFY) == 0
+        && userid == 42,
+        "flux_sign_wrap_as works with wrap-version = 2");
+
+    if (!(v1 = strdup (flux_sign_wrap (ctx, inmsg, inmsgsz, NULL, 0))))
+        BAIL_OUT ("flux_sign_wrap failed");
+    ok (strncmp (v1, "v2:", 3) != 0
+        && flux_sign_unwrap (ctx2, v1, &outmsg, &outmsgsz, NULL, 0) == 0
+        && outmsgsz == inmsgsz,
+        "context with wrap-version = 2 unwraps version 1 input");
+    free (v1);
+
+    errno = 0;
+    ok (flux_sign_unwrap (ctx, "v2:", NULL, NULL, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap of empty armored frame fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+    errno = 0;
+    ok (flux_sign_unwrap (ctx, "v2:AAAA!", NULL, NULL, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap of bad base64 armored frame fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+
+    header = make_header (2, "none", getuid ());
+    snprintf (input, sizeof (input), "%s.aGkK.none", header);
+    errno = 0;
+    ok (flux_sign_unwrap (ctx, input, NULL, NULL, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap of version 1 input with version=2 fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+    free (header);
+}
+
+/* Unwrap a modified copy of 'frame' of size 'framesz', in which 'len'
+ * bytes at 'offset' are replaced by 'data', and return the result.
+ */
+static int unwrap_modified (flux_security_t *ctx,
+                            const void *frame, int framesz,
+                            int offset, const void *data, int len)
+{
+    char *cpy;
+    int rc;
+
+    if (!(cpy = malloc (framesz)))
+        BAIL_OUT ("out of memory");
+    memcpy (cpy, frame, framesz);
+    memcpy (cpy + offset, data, len);
+    rc = flux_sign_unwrap_bin (ctx, cpy, framesz, NULL, NULL, NULL, 0);
+    diag ("%s", flux_security_last_error (ctx));
+    free (cpy);
+    return rc;
+}
+
+void test_bin (flux_security_t *ctx)
+{
+    const char *inmsg = "hello\0world";
+    int inmsgsz = 11;
+    const void *frame;
+    int framesz;
+    const void *outmsg;
+    int outmsgsz;
+    int64_t userid;
+    char *cpy;
+    const char *s;
+
+    ok (flux_sign_wrap_bin (ctx, inmsg, inmsgsz, NULL, 0,
+                            &frame, &framesz) == 0,
+        "flux_sign_wrap_bin works");
+    ok (framesz > 16 && memcmp (frame, "\0FS2", 4) == 0,
+        "frame starts with magic");
+    ok (flux_sign_unwrap_bin (ctx, frame, framesz,
+                              &outmsg, &outmsgsz, &userid, 0) == 0
+        && outmsgsz == inmsgsz
+        && memcmp (outmsg, inmsg, inmsgsz) == 0
+        && userid == getuid (),
+        "flux_sign_unwrap_bin works");
+    ok (flux_sign_unwrap_bin (ctx, frame, framesz,
+                              &outmsg, &outmsgsz, &userid,
+                              FLUX_SIGN_NOVERIFY) == 0
+        && outmsgsz == inmsgsz
+        && memcmp (outmsg, inmsg, inmsgsz) == 0,
+        "flux_sign_unwrap_bin NOVERIFY works");
+
+    /* The frame buffer is reused, so keep a copy for the tests below.
+     */
+    if (!(cpy = malloc (framesz)))
+        BAIL_OUT ("out of memory");
+    memcpy (cpy, frame, framesz);
+
+    ok (flux_sign_wrap_bin (ctx, NULL, 0, NULL, 0, &frame, &framesz) == 0
+        && flux_sign_unwrap_bin (ctx, frame, framesz,
+                                 &outmsg, &outmsgsz, NULL, 0) == 0
+        && outmsg == NULL
+        && outmsgsz == 0,
+        "binary frame with empty payload works");
+
+    errno = 0;
+    ok (unwrap_modified (ctx, cpy, framesz - 1, 0, "", 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_bin of truncated frame fails with EINVAL");
+    errno = 0;
+    ok (unwrap_modified (ctx, cpy, 15, 0, "", 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_bin of frame shorter than minimum fails with EINVAL");
+    errno = 0;
+    ok (unwrap_modified (ctx, cpy, framesz, 1, "X", 1) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_bin with bad magic fails with EINVAL");
+    errno = 0;
+    ok (unwrap_modified (ctx, cpy, framesz, 4, "\xff\xff\xff\xff", 4) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_bin with bad header length fails with EINVAL");
+    errno = 0;
+    ok (unwrap_modified (ctx, cpy, framesz, 4, "\0\0\0\0", 4) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_bin with zero header length fails with EINVAL");
+    errno = 0;
+    ok (unwrap_modified (ctx, cpy, framesz, framesz - 1, "", 1) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_bin with NUL in signature fails with EINVAL");
+    errno = 0;
+    ok (unwrap_modified (ctx, cpy, framesz, framesz - 1, "X", 1) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_bin with bad signature fails with EINVAL");
+    free (cpy);
+
+    s = flux_sign_wrap (ctx, inmsg, inmsgsz, NULL, 0);
+    errno = 0;
+    ok (s != NULL
+        && flux_sign_unwrap_bin (ctx, s, strlen (s), NULL, NULL, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_bin of version 1 input fails with EINVAL");
+
+    errno = 0;
+    ok (flux_sign_wrap_bin (NULL, inmsg, inmsgsz, NULL, 0,
+                            &frame, &framesz) < 0 && errno == EINVAL,
+        "flux_sign_wrap_bin ctx=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_wrap_bin (ctx, inmsg, inmsgsz, NULL, 0,
+                            NULL, &framesz) < 0 && errno == EINVAL,
+        "flux_sign_wrap_bin output=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_bin (ctx, NULL, 16, NULL, NULL, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_bin input=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_bin (ctx, inmsg, -1, NULL, NULL, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_bin inputsz=-1 fails with EINVAL");
+}
+
+/* Return a copy of 'input' of size 'inputsz' without a \0 terminator,
+ * so reading past the end is caught by memory checkers.
+ */
+static void *copy_exact (const void *input, int inputsz)
+{
+    void *cpy;
+
+    if (!(cpy = malloc (inputsz)))
+        BAIL_OUT ("out of memory");
+    memcpy (cpy, input, inputsz);
+    return cpy;
+}
+
+/* Unwrap a copy of 'input' of size 'inputsz' with flux_sign_unwrap_buf(),
+ * and check that the result matches 'inmsg'.
+ */
+static bool unwrap_buf_check (flux_security_t *ctx,
+                              const void *input, int inputsz,
+                              const char *inmsg, int flags)
+{
+    void *cpy = copy_exact (input, inputsz);
+    const void *outmsg;
+    int outmsgsz;
+    int64_t userid;
+    int inmsgsz = strlen (inmsg);
+    bool good;
+
+    good = flux_sign_unwrap_buf (ctx, cpy, inputsz,
+                                 &outmsg, &outmsgsz, &userid, flags) == 0
+        && outmsgsz == inmsgsz
+        && (inmsgsz == 0 || memcmp (outmsg, inmsg, inmsgsz) == 0)
+        && userid == getuid ();
+    if (!good)
+        diag ("%s", flux_security_last_error (ctx));
+    free (cpy);
+    return good;
+}
+
+void test_buf (flux_security_t *ctx, flux_security_t *ctx2)
+{
+    const char *inmsg = "hello world";
+    int inmsgsz = strlen (inmsg);
+    const void *frame;
+    int framesz;
+    char msg[256];
+    char *v1;
+    const char *s;
+    int len;
+    int n;
+
+    if (!(v1 = strdup (flux_sign_wrap (ctx, inmsg, inmsgsz, NULL, 0))))
+        BAIL_OUT ("flux_sign_wrap failed");
+    len = strlen (v1);
+    ok (unwrap_buf_check (ctx, v1, len, inmsg, 0),
+        "flux_sign_unwrap_buf works on version 1 input");
+    ok (unwrap_buf_check (ctx, v1, len, inmsg, FLUX_SIGN_NOVERIFY),
+        "flux_sign_unwrap_buf NOVERIFY works on version 1 input");
+
+    /* Unwrap from the middle of a larger message.
+     */
+    n = sizeof (msg);
+    if (snprintf (msg, n, "{\"J\":\"%s\"}", v1) >= n)
+        BAIL_OUT ("msg buffer overflow");
+    ok (unwrap_buf_check (ctx, msg + 6, len, inmsg, 0),
+        "flux_sign_unwrap_buf works on input within a larger buffer");
+
+    s = flux_sign_wrap (ctx2, inmsg, inmsgsz, NULL, 0);
+    ok (s != NULL && unwrap_buf_check (ctx, s, strlen (s), inmsg, 0),
+        "flux_sign_unwrap_buf works on armored input");
+
+    ok (flux_sign_wrap_bin (ctx, inmsg, inmsgsz, NULL, 0,
+                            &frame, &framesz) == 0
+        && unwrap_buf_check (ctx, frame, framesz, inmsg, 0),
+        "flux_sign_unwrap_buf works on binary input");
+
+    s = flux_sign_wrap (ctx, NULL, 0, NULL, 0);
+    ok (s != NULL && unwrap_buf_check (ctx, s, strlen (s), "", 0),
+        "flux_sign_unwrap_buf works on empty payload");
+
+    /* Errors
+     */
+    errno = 0;
+    ok (!unwrap_buf_check (ctx, v1, len - 1, inmsg, 0) && errno == EINVAL,
+        "flux_sign_unwrap_buf of truncated signature fails with EINVAL");
+    errno = 0;
+    ok (!unwrap_buf_check (ctx, v1, strrchr (v1, '.') - v1, inmsg,
+                           FLUX_SIGN_NOVERIFY)
+        && errno == EINVAL,
+        "flux_sign_unwrap_buf without SIGNATURE delim fails with EINVAL");
+    errno = 0;
+    ok (!unwrap_buf_check (ctx, v1, strchr (v1, '.') - v1, inmsg,
+                           FLUX_SIGN_NOVERIFY)
+        && errno == EINVAL,
+        "flux_sign_unwrap_buf without PAYLOAD delim fails with EINVAL");
+    v1[len - 1] = '\0';
+    errno = 0;
+    ok (!unwrap_buf_check (ctx, v1, len, inmsg, 0) && errno == EINVAL,
+        "flux_sign_unwrap_buf with NUL in signature fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_buf (ctx, v1, 0, NULL, NULL, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_buf inputsz=0 fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_buf (ctx, v1, -1, NULL, NULL, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_buf inputsz=-1 fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_buf (ctx, NULL, 1, NULL, NULL, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_buf input=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_buf (NULL, v1, len, NULL, NULL, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_sign_unwrap_buf ctx=NULL fails with EINVAL");
+    free (v1);
+}
+
+/* Growable output buffer for stream tests.
+ */
+struct sbuf {
+    char *data;
+    int len;
+    int size;
+    int fail_after;     // fail writes after this many bytes, if > 0
+};
+
+static int sbuf_write (const void *buf, int len, void *arg)
+{
+    struct sbuf *sb = arg;
+
+    if (sb->fail_after > 0 && sb->len + len > sb->fail_after) {
+        errno = ENOSPC;
+        return -1;
+    }
+    if (sb->len + len + 1 > sb->size) {
+        while (sb->len + len + 1 > sb->size)
+            sb->size = sb->size ? sb->size * 2 : 256;
+        if (!(sb->data = realloc (sb->data, sb->size)))
+            BAIL_OUT ("out of memory");
+    }
+    memcpy (sb->data + sb->len, buf, len);
+    sb->len += len;
+    sb->data[sb->len] = '\0';
+    return 0;
+}
+
+static void sbuf_fini (struct sbuf *sb)
+{
+    free (sb->data);
+    memset (sb, 0, sizeof (*sb));
+}
+
+/* Wrap 'len' bytes of 'payload' with a stream, in pieces of 'chunk' bytes.
+ */
+static int wrap_stream (flux_security_t *ctx, const void *payload, int len,
+                        int chunk, struct sbuf *out)
+{
+    flux_sign_stream_t *st;
+    int rc = -1;
+
+    if (!(st = flux_sign_wrap_init (ctx, NULL, 0, sbuf_write, out)))
+        return -1;
+    for (int i = 0; i < len; i += chunk) {
+        if (flux_sign_wrap_update (st, (char *)payload + i,
+                                   MIN (chunk, len - i)) < 0)
+            goto done;
+    }
+    rc = flux_sign_wrap_final (st);
+done:
+    flux_sign_stream_destroy (st);
+    return rc;
+}
+
+/* Unwrap 'input' with a stream, in pieces of 'chunk' bytes.
+ */
+static int unwrap_stream (flux_security_t *ctx, const char *input,
+                          int chunk, int flags, struct sbuf *out,
+                          int64_t *userid)
+{
+    flux_sign_stream_t *st;
+    int len = strlen (input);
+    int rc = -1;
+
+    if (!(st = flux_sign_unwrap_init (ctx, flags, sbuf_write, out)))
+        return -1;
+    for (int i = 0; i < len; i += chunk) {
+        if (flux_sign_unwrap_update (st, input + i,
+                                     MIN (chunk, len - i)) < 0)
+            goto done;
+    }
+    rc = flux_sign_unwrap_final (st, userid);
+done:
+    flux_sign_stream_destroy (st);
+    return rc;
+}
+
+void test_stream (flux_security_t *ctx)
+{
+    int chunks[] = { 1, 2, 3, 4, 5, 7, 64, 100000 };
+    int nchunks = sizeof (chunks) / sizeof (chunks[0]);
+    int lens[] = { 0, 1, 2, 3, 4, 5, 6, 100, 49151, 49152, 49153, 200000 };
+    int nlens = sizeof (lens) / sizeof (lens[0]);
+    int maxlen = lens[nlens - 1];
+    char *payload;
+    struct sbuf out = { 0 };
+    struct sbuf dec = { 0 };
+    flux_sign_stream_t *st;
+    int64_t userid;
+    char *header;
+    char *input;
+    bool good;
+
+    if (!(payload = malloc (maxlen)))
+        BAIL_OUT ("out of memory");
+    for (int i = 0; i < maxlen; i++)
+        payload[i] = random ();
+
+    /* The 'none' header has no timestamps, so a stream wrap should
+     * produce exactly the same result as flux_sign_wrap().
+     */
+    good = true;
+    for (int i = 0; i < nlens && good; i++) {
+        for (int j = 0; j < nchunks && good; j++) {
+            const char *s = flux_sign_wrap (ctx, payload, lens[i], NULL, 0);
+            if (!s
+                || wrap_stream (ctx, payload, lens[i], chunks[j], &out) < 0
+                || strcmp (s, out.data) != 0) {
+                diag ("len=%d chunk=%d: %s", lens[i], chunks[j],
+                      flux_security_last_error (ctx));
+                good = false;
+            }
+            sbuf_fini (&out);
+        }
+    }
+    ok (good,
+        "flux_sign_wrap_init/update/final matches flux_sign_wrap");
+
+    good = true;
+    for (int i = 0; i < nlens && good; i++) {
+        for (int j = 0; j < nchunks && good; j++) {
+            const char *s = flux_sign_wrap (ctx, payload, lens[i], NULL, 0);
+            userid = -1;
+            if (!s
+                || unwrap_stream (ctx, s, chunks[j], 0, &dec, &userid) < 0
+                || dec.len != lens[i]
+                || (lens[i] > 0 && memcmp (dec.data, payload, lens[i]) != 0)
+                || userid != getuid ()) {
+                diag ("len=%d chunk=%d: %s", lens[i], chunks[j],
+                      flux_security_last_error (ctx));
+                good = false;
+            }
+            sbuf_fini (&dec);
+        }
+    }
+    ok (good,
+        "flux_sign_unwrap_init/update/final works");
+
+    ok (flux_sign_unwrap (ctx, flux_sign_wrap (ctx, "x", 1, NULL, 0),
+                          NULL, NULL, NULL, 0) == 0
+        && unwrap_stream (ctx, flux_sign_wrap (ctx, "x", 1, NULL, 0), 3,
+                          FLUX_SIGN_NOVERIFY, &dec, NULL) == 0
+        && dec.len == 1,
+        "flux_sign_unwrap stream NOVERIFY works");
+    sbuf_fini (&dec);
+
+    /* Errors
+     */
+    header = make_header (1, "none", getuid ());
+    if (asprintf (&input, "%s.Zg==.nonX", header) < 0)
+        BAIL_OUT ("asprintf failed");
+    errno = 0;
+    ok (unwrap_stream (ctx, input, 2, 0, &dec, NULL) < 0 && errno == EINVAL,
+        "flux_sign_unwrap stream with bad signature fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+    sbuf_fini (&dec);
+    ok (unwrap_stream (ctx, input, 2, FLUX_SIGN_NOVERIFY, &dec, NULL) == 0
+        && dec.len == 1,
+        "flux_sign_unwrap stream NOVERIFY with bad signature works");
+    sbuf_fini (&dec);
+    free (input);
+
+    if (asprintf (&input, "%s.Zg==Zg==.none", header) < 0)
+        BAIL_OUT ("asprintf failed");
+    errno = 0;
+    ok (unwrap_stream (ctx, input, 1, 0, &dec, NULL) < 0 && errno == EINVAL,
+        "flux_sign_unwrap stream with padding before end fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+    sbuf_fini (&dec);
+    free (input);
+
+    if (asprintf (&input, "%s.Zm9.none", header) < 0)
+        BAIL_OUT ("asprintf failed");
+    errno = 0;
+    ok (unwrap_stream (ctx, input, 5, 0, &dec, NULL) < 0 && errno == EINVAL,
+        "flux_sign_unwrap stream with partial group fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+    sbuf_fini (&dec);
+    free (input);
+
+    if (asprintf (&input, "%s.Zm9v!AAA.none", header) < 0)
+        BAIL_OUT ("asprintf failed");
+    errno = 0;
+    ok (unwrap_stream (ctx, input, 64, 0, &dec, NULL) < 0 && errno == EINVAL,
+        "flux_sign_unwrap stream with bad base64 fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+    sbuf_fini (&dec);
+    free (input);
+
+    if (asprintf (&input, "%s.Zm9v", header) < 0)
+        BAIL_OUT ("asprintf failed");
+    errno = 0;
+    ok (unwrap_stream (ctx, input, 64, 0, &dec, NULL) < 0 && errno == EINVAL,
+        "flux_sign_unwrap stream of truncated input fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+    sbuf_fini (&dec);
+    free (input);
+    free (header);
+
+    header = make_header (1, "munge", getuid ());
+    if (asprintf (&input, "%s.Zm9v.xyz", header) < 0)
+        BAIL_OUT ("asprintf failed");
+    errno = 0;
+    ok (unwrap_stream (ctx, input, 64, 0, &dec, NULL) < 0 && errno == EINVAL,
+        "flux_sign_unwrap stream with disallowed mechanism fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+    sbuf_fini (&dec);
+    free (input);
+    free (header);
+
+    if (!(st = flux_sign_unwrap_init (ctx, 0, sbuf_write, &dec)))
+        BAIL_OUT ("flux_sign_unwrap_init failed");
+    good = true;
+    for (int i = 0; i < 1024*1024 / maxlen + 1; i++) {
+        memset (payload, 'A', maxlen);
+        if (flux_sign_unwrap_update (st, payload, maxlen) < 0)
+            good = false;
+    }
+    ok (!good && errno == EINVAL,
+        "flux_sign_unwrap stream with very long header fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+    errno = 0;
+    ok (flux_sign_unwrap_update (st, ".", 1) < 0 && errno == EINVAL,
+        "flux_sign_unwrap_update after failure fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+    flux_sign_stream_destroy (st);
+    sbuf_fini (&dec);
+
+    out.fail_after = 100;
+    errno = 0;
+    ok (wrap_stream (ctx, payload, maxlen, 1000, &out) < 0 && errno == ENOSPC,
+        "flux_sign_wrap stream fails with write callback errno");
+    diag ("%s", flux_security_last_error (ctx));
+    sbuf_fini (&out);
+
+    if (!(st = flux_sign_wrap_init (ctx, NULL, 0, sbuf_write, &out)))
+        BAIL_OUT ("flux_sign_wrap_init failed");
+    ok (flux_sign_wrap_final (st) == 0,
+        "flux_sign_wrap_final works");
+    errno = 0;
+    ok (flux_sign_wrap_update (st, "x", 1) < 0 && errno == EINVAL,
+        "flux_sign_wrap_update after final fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_wrap_final (st) < 0 && errno == EINVAL,
+        "flux_sign_wrap_final after final fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_update (st, "x", 1) < 0 && errno == EINVAL,
+        "flux_sign_unwrap_update on wrap stream fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_wrap_update (st, NULL, 1) < 0 && errno == EINVAL,
+        "flux_sign_wrap_update payload=NULL fails with EINVAL");
+    flux_sign_stream_destroy (st);
+    sbuf_fini (&out);
+
+    errno = 0;
+    ok (flux_sign_wrap_init (ctx, NULL, 0, NULL, NULL) == NULL
+        && errno == EINVAL,
+        "flux_sign_wrap_init write=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_wrap_init (ctx, NULL, 1, sbuf_write, &out) == NULL
+        && errno == EINVAL,
+        "flux_sign_wrap_init flags=1 fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_wrap_init (ctx, "foo", 0, sbuf_write, &out) == NULL
+        && errno == EINVAL,
+        "flux_sign_wrap_init mech_type=foo fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_init (NULL, 0, sbuf_write, &out) == NULL
+        && errno == EINVAL,
+        "flux_sign_unwrap_init ctx=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_init (ctx, 42, sbuf_write, &out) == NULL
+        && errno == EINVAL,
+        "flux_sign_unwrap_init flags=42 fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_final (NULL, NULL) < 0 && errno == EINVAL,
+        "flux_sign_unwrap_final st=NULL fails with EINVAL");
+    lives_ok ({flux_sign_stream_destroy (NULL);},
+        "flux_sign_stream_destroy NULL doesn't crash");
+
+    free (payload);
+}
+
+void test_cache_open (flux_security_t *ctx)
+{
+    char path[PATH_MAX + 1];
+    const char *s;
+    int n;
+
+    n = sizeof (path);
+    if (snprintf (path, n, "%s/verify.cache", tmpdir) >= n)
+        BAIL_OUT ("path buffer overflow");
+
+    ok (flux_sign_cache_open (ctx, path, 16) == 0,
+        "flux_sign_cache_open works");
+    ok (flux_sign_cache_open (ctx, path, 16) == 0,
+        "flux_sign_cache_open works a second time");
+    ok ((s = flux_sign_wrap (ctx, "foo", 3, NULL, 0)) != NULL
+        && flux_sign_unwrap (ctx, s, NULL, NULL, NULL, 0) == 0,
+        "flux_sign_unwrap works with shared cache");
+
+    errno = 0;
+    ok (flux_sign_cache_open (NULL, path, 16) < 0 && errno == EINVAL,
+        "flux_sign_cache_open ctx=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_cache_open (ctx, NULL, 16) < 0 && errno == EINVAL,
+        "flux_sign_cache_open path=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_cache_open (ctx, path, 0) < 0 && errno == EINVAL,
+        "flux_sign_cache_open size=0 fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_cache_open (ctx, "/nonexistent/verify.cache", 16) < 0
+        && errno == ENOENT,
+        "flux_sign_cache_open with bad path fails with ENOENT");
+    diag ("%s", flux_security_last_error (ctx));
+
+    (void)unlink (path);
+}
+
+struct share_arg {
+    flux_security_t *ctx;
+    int id;
+    bool good;
+};
+
+static void *share_thread (void *arg)
+{
+    struct share_arg *a = arg;
+    char payload[64];
+    char *wbuf = NULL;
+    int wbufsz = 0;
+    void *ubuf = NULL;
+    int ubufsz = 0;
+    int payloadsz;
+    int64_t userid;
+    char *input;
+    int i;
+
+    a->good = true;
+    for (i = 0; i < 200; i++) {
+        int len = snprintf (payload, sizeof (payload), "%d-%d", a->id, i);
+        if (flux_sign_wrap_r (a->ctx, payload, len, NULL, 0,
+                              &wbuf, &wbufsz) < 0
+            || flux_sign_unwrap_r (a->ctx, wbuf, &ubuf, &ubufsz,
+                                   &payloadsz, &userid, 0) < 0
+            || payloadsz != len
+            || memcmp (ubuf, payload, len) != 0
+            || userid != getuid ())
+            a->good = false;
+    }
+    /* An error in this thread must not be visible in the others.
+     */
+    input = a->id % 2 ? "foo" : "bar";
+    if (flux_sign_unwrap_r (a->ctx, input, &ubuf, &ubufsz,
+                            NULL, NULL, 0) == 0
+        || flux_security_last_errnum (a->ctx) != EINVAL)
+        a->good = false;
+    free (wbuf);
+    free (ubuf);
+    return NULL;
+}
+
+#define SHARE_BATCH_COUNT 64
+
+struct share_batch_arg {
+    flux_security_t *ctx;
+    int id;
+    struct flux_sign_unwrap_item items[SHARE_BATCH_COUNT];
+    void *buf;
+    int bufsz;
+    int failed;
+};
+
+/* Unwrap a batch repeatedly, leaving the results of the last one in 'a'
+ * to be checked after all threads have finished.
+ */
+static void *share_batch_thread (void *arg)
+{
+    struct share_batch_arg *a = arg;
+    char payload[64];
+    char *wbuf = NULL;
+    int wbufsz = 0;
+    int i;
+
+    for (i = 0; i < SHARE_BATCH_COUNT; i++) {
+        int len = snprintf (payload, sizeof (payload), "batch%d-%d", a->id, i);
+        if (flux_sign_wrap_r (a->ctx, payload, len, NULL, 0,
+                              &wbuf, &wbufsz) < 0
+            || !(a->items[i].input = strdup (wbuf)))
+            BAIL_OUT ("flux_sign_wrap_r failed");
+    }
+    for (i = 0; i < 20; i++) {
+        a->failed = flux_sign_unwrap_batch_r (a->ctx, a->items,
+                                              SHARE_BATCH_COUNT,
+                                              &a->buf, &a->bufsz, 0);
+    }
+    free (wbuf);
+    return NULL;
+}
+
+static bool share_batch_check (struct share_batch_arg *a)
+{
+    char payload[64];
+    bool good = (a->failed == 0);
+
+    for (int i = 0; i < SHARE_BATCH_COUNT; i++) {
+        int len = snprintf (payload, sizeof (payload), "batch%d-%d", a->id, i);
+        if (a->items[i].errnum != 0
+            || a->items[i].payloadsz != len
+            || memcmp (a->items[i].payload, payload, len) != 0)
+            good = false;
+        free ((char *)a->items[i].input);
+    }
+    free (a->buf);
+    return good;
+}
+
+void test_share (flux_security_t *ctx)
+{
+    struct share_arg args[4];
+    struct share_batch_arg bargs[2];
+    pthread_t t[4];
+    char pattern[PATH_MAX + 1];
+    bool good = true;
+    char *s;
+    int i;
+
+    ok (flux_security_share (ctx) == 0,
+        "flux_security_share works");
+    ok (flux_security_share (ctx) == 0,
+        "flux_security_share works a second time");
+    errno = 0;
+    ok (flux_security_share (NULL) < 0 && errno == EINVAL,
+        "flux_security_share ctx=NULL fails with EINVAL");
+
+    snprintf (pattern, sizeof (pattern), "%s/*.toml", tmpdir);
+    errno = 0;
+    ok (flux_security_configure (ctx, pattern) < 0 && errno == EBUSY,
+        "flux_security_configure on shared context fails with EBUSY");
+
+    for (i = 0; i < 4; i++) {
+        args[i].ctx = ctx;
+        args[i].id = i;
+        if (pthread_create (&t[i], NULL, share_thread, &args[i]) != 0)
+            BAIL_OUT ("pthread_create failed");
+    }
+    for (i = 0; i < 4; i++) {
+        if (pthread_join (t[i], NULL) != 0)
+            BAIL_OUT ("pthread_join failed");
+        if (!args[i].good)
+            good = false;
+    }
+    ok (good,
+        "4 threads wrapped and unwrapped concurrently on shared context");
+
+    memset (bargs, 0, sizeof (bargs));
+    for (i = 0; i < 2; i++) {
+        bargs[i].ctx = ctx;
+        bargs[i].id = i;
+        if (pthread_create (&t[i], NULL, share_batch_thread, &bargs[i]) != 0)
+            BAIL_OUT ("pthread_create failed");
+    }
+    for (i = 0; i < 2; i++) {
+        if (pthread_join (t[i], NULL) != 0)
+            BAIL_OUT ("pthread_join failed");
+    }
+    good = true;
+    for (i = 0; i < 2; i++) {
+        if (!share_batch_check (&bargs[i]))
+            good = false;
+    }
+    ok (good,
+        "2 threads ran batches concurrently and kept their own results");
+
+    if (!(s = strdup ("hello")))
+        BAIL_OUT ("strdup failed");
+    ok (flux_security_aux_set (ctx, "share-test", s, free) == 0,
+        "flux_security_aux_set on shared context adds a new key");
+    errno = 0;
+    ok (flux_security_aux_set (ctx, "share-test", ctx, NULL) < 0
+        && errno == EEXIST,
+        "flux_security_aux_set on shared context cannot replace a key");
+    errno = 0;
+    ok (flux_security_aux_set (ctx, "share-test", NULL, NULL) < 0
+        && errno == EEXIST,
+        "flux_security_aux_set on shared context cannot remove a key");
+    ok (flux_security_aux_get (ctx, "share-test") == s,
+        "original value is still set");
+}
+
 int main (int argc, char *argv[])
 {
     flux_security_t *ctx;
+    flux_security_t *ctx2;
 
     plan (NO_PLAN);
 
@@ -576,6 +1870,52 @@ int main (int argc, char *argv[])
     test_badpayload (ctx);
     test_badsignature (ctx);
     test_corner (ctx);
+    test_reentrant (ctx);
+    test_header_reuse (ctx);
+    test_bin (ctx);
+    ctx2 = context_init (conf_v2);
+    test_armored (ctx, ctx2);
+    test_buf (ctx, ctx2);
+    test_stream (ctx);
+    test_basic (ctx2);
+    test_badsignature (ctx2);
+    flux_security_destroy (ctx2);
+    flux_security_destroy (ctx);
+
+    ctx = context_init (conf_batch);
+    test_batch (ctx, 1);
+    test_batch (ctx, 3);
+    test_batch (ctx, 1000);
+    test_batch_corner (ctx);
+    test_async (ctx, 1);
+    test_async (ctx, 1000);
+    test_async_corner (ctx);
+    flux_security_destroy (ctx);
+
+    ctx = context_init (conf_cache);
+    test_basic (ctx);
+    test_badsignature (ctx);
+    test_batch (ctx, 100);
+    test_async (ctx, 100);
+    test_cache_open (ctx);
+    test_batch (ctx, 100);
+    test_async (ctx, 100);
+    test_bin (ctx);
+    ctx2 = context_init (conf_v2);
+    test_buf (ctx, ctx2);
+    flux_security_destroy (ctx2);
+    flux_security_destroy (ctx);
+
+    ctx = context_init (conf);
+    test_share (ctx);
+    test_async (ctx, 100);
+    flux_security_destroy (ctx);
+
+    /* destroy context with operations outstanding
+     */
+    ctx = context_init (conf_batch);
+    for (int i = 0; i < 100; i++)
+        flux_sign_wrap_async (ctx, "x", 1, NULL, 0, NULL);
     flux_security_destroy (ctx);
 
     cfpath_fini ();
@@ -0,0 +1,339 @@
+/************************************************************\
+ * Copyright 2026 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "src/libtap/tap.h"
+#include "src/lib/sign_cache.h"
+
+static void make_key (int n, uint8_t key[SIGN_CACHE_KEYSZ])
+{
+    char buf[32];
+
+    snprintf (buf, sizeof (buf), "input-%d", n);
+    sign_cache_key (NULL, 0, buf, strlen (buf), key);
+}
+
+void test_basic (void)
+{
+    struct sign_cache *cache;
+    uint8_t key[SIGN_CACHE_KEYSZ];
+    uint8_t key2[SIGN_CACHE_KEYSZ];
+    uint8_t key3[SIGN_CACHE_KEYSZ];
+    const uint8_t trust1[4] = { 1, 2, 3, 4 };
+    const uint8_t trust2[4] = { 1, 2, 3, 5 };
+
+    ok ((cache = sign_cache_create (4)) != NULL,
+        "sign_cache_create size=4 works");
+    if (!cache)
+        BAIL_OUT ("sign_cache_create failed");
+
+    make_key (1, key);
+    make_key (1, key2);
+    ok (memcmp (key, key2, sizeof (key)) == 0,
+        "sign_cache_key is deterministic");
+    make_key (2, key2);
+    ok (memcmp (key, key2, sizeof (key)) != 0,
+        "sign_cache_key differs for different input");
+    sign_cache_key (trust1, sizeof (trust1), "input-1", 7, key2);
+    sign_cache_key (trust2, sizeof (trust2), "input-1", 7, key3);
+    ok (memcmp (key, key2, sizeof (key)) != 0
+        && memcmp (key2, key3, sizeof (key)) != 0,
+        "sign_cache_key differs for different trust context");
+
+    errno = 0;
+    ok (sign_cache_lookup (cache, key, "curve", 100) < 0 && errno == ENOENT,
+        "sign_cache_lookup on empty cache fails with ENOENT");
+
+    sign_cache_insert (cache, key, "curve", 200);
+    ok (sign_cache_count (cache) == 1,
+        "sign_cache_insert added an entry");
+    ok (sign_cache_lookup (cache, key, "curve", 100) == 0,
+        "sign_cache_lookup finds entry");
+    ok (sign_cache_lookup (cache, key, "curve", 200) == 0,
+        "sign_cache_lookup finds entry at expiration time");
+    errno = 0;
+    ok (sign_cache_lookup (cache, key, "munge", 100) < 0 && errno == ENOENT,
+        "sign_cache_lookup with different mech fails with ENOENT");
+    ok (sign_cache_count (cache) == 1,
+        "entry was kept");
+
+    sign_cache_insert (cache, key, "curve", 300);
+    ok (sign_cache_count (cache) == 1,
+        "sign_cache_insert of existing key did not add an entry");
+    ok (sign_cache_lookup (cache, key, "curve", 250) == 0,
+        "sign_cache_lookup finds entry with updated expiration");
+
+    errno = 0;
+    ok (sign_cache_lookup (cache, key, "curve", 301) < 0 && errno == ENOENT,
+        "sign_cache_lookup after expiration fails with ENOENT");
+    ok (sign_cache_count (cache) == 0,
+        "expired entry was dropped");
+
+    sign_cache_insert (cache, key, "curve", 200);
+    sign_cache_remove (cache, key);
+    errno = 0;
+    ok (sign_cache_count (cache) == 0
+        && sign_cache_lookup (cache, key, "curve", 100) < 0 && errno == ENOENT,
+        "sign_cache_remove works");
+    sign_cache_remove (cache, key);
+    ok (sign_cache_count (cache) == 0,
+        "sign_cache_remove of missing key does nothing");
+
+    sign_cache_destroy (cache);
+}
+
+void test_lru (void)
+{
+    struct sign_cache *cache;
+    uint8_t key[SIGN_CACHE_KEYSZ];
+    bool good;
+    int i;
+
+    if (!(cache = sign_cache_create (3)))
+        BAIL_OUT ("sign_cache_create failed");
+
+    for (i = 0; i < 3; i++) {
+        make_key (i, key);
+        sign_cache_insert (cache, key, "curve", 100);
+    }
+    ok (sign_cache_count (cache) == 3,
+        "filled cache with 3 entries");
+
+    /* Touch entry 0 so that entry 1 becomes least recently used.
+     */
+    make_key (0, key);
+    ok (sign_cache_lookup (cache, key, "curve", 0) == 0,
+        "looked up entry 0");
+    make_key (3, key);
+    sign_cache_insert (cache, key, "curve", 100);
+    ok (sign_cache_count (cache) == 3,
+        "inserting into full cache keeps 3 entries");
+    make_key (1, key);
+    ok (sign_cache_lookup (cache, key, "curve", 0) < 0,
+        "least recently used entry 1 was evicted");
+    make_key (0, key);
+    ok (sign_cache_lookup (cache, key, "curve", 0) == 0,
+        "entry 0 was kept");
+    make_key (2, key);
+    ok (sign_cache_lookup (cache, key, "curve", 0) == 0,
+        "entry 2 was kept");
+
+    /* Churn through many more keys than the cache holds.
+     */
+    good = true;
+    for (i = 0; i < 1000; i++) {
+        make_key (i, key);
+        sign_cache_insert (cache, key, "curve", 100);
+        if (sign_cache_lookup (cache, key, "curve", 0) < 0)
+            good = false;
+    }
+    ok (good && sign_cache_count (cache) == 3,
+        "1000 inserts into cache of size 3 works");
+    for (i = 997; i < 1000; i++) {
+        make_key (i, key);
+        if (sign_cache_lookup (cache, key, "curve", 0) < 0)
+            good = false;
+    }
+    ok (good,
+        "last 3 entries are present");
+
+    sign_cache_destroy (cache);
+}
+
+/* Return the descriptor of this process open on 'path', or -1.
+ */
+static int cache_fd (const char *path)
+{
+    struct stat sb;
+    struct stat fsb;
+
+    if (stat (path, &sb) < 0)
+        return -1;
+    for (int fd = 3; fd < 1024; fd++) {
+        if (fstat (fd, &fsb) == 0
+            && fsb.st_dev == sb.st_dev
+            && fsb.st_ino == sb.st_ino)
+            return fd;
+    }
+    return -1;
+}
+
+void test_shared (void)
+{
+    char tmpdir[PATH_MAX + 1];
+    char path[PATH_MAX + 1];
+    struct sign_cache *cache;
+    struct sign_cache *cache2;
+    uint8_t key[SIGN_CACHE_KEYSZ];
+    struct stat sb;
+    pid_t pid;
+    int status;
+    int fd;
+
+    const char *t = getenv ("TMPDIR");
+    int n;
+
+    n = sizeof (tmpdir);
+    if (snprintf (tmpdir, n, "%s/sign_cache-XXXXXX", t ? t : "/tmp") >= n)
+        BAIL_OUT ("tmpdir buffer overflow");
+    if (!mkdtemp (tmpdir))
+        BAIL_OUT ("mkdtemp: %s", strerror (errno));
+    n = sizeof (path);
+    if (snprintf (path, n, "%s/cache", tmpdir) >= n)
+        BAIL_OUT ("path buffer overflow");
+
+    ok ((cache = sign_cache_open (path, 4)) != NULL,
+        "sign_cache_open creates shared cache");
+    if (!cache)
+        BAIL_OUT ("sign_cache_open: %s", strerror (errno));
+    ok (stat (path, &sb) == 0 && (sb.st_mode & 0777) == 0600,
+        "cache file has mode 0600");
+    make_key (1, key);
+    sign_cache_insert (cache, key, "curve", 100);
+
+    ok ((cache2 = sign_cache_open (path, 64)) != NULL,
+        "sign_cache_open opens existing shared cache");
+    if (!cache2)
+        BAIL_OUT ("sign_cache_open: %s", strerror (errno));
+    ok (sign_cache_size (cache2) == 4,
+        "existing cache size is used");
+    ok (sign_cache_lookup (cache2, key, "curve", 0) == 0,
+        "entry inserted through first handle is found through second");
+
+    /* Insert from another process.
+     */
+    if ((pid = fork ()) < 0)
+        BAIL_OUT ("fork: %s", strerror (errno));
+    if (pid == 0) {
+        struct sign_cache *c = sign_cache_open (path, 4);
+        make_key (2, key);
+        if (!c)
+            _exit (1);
+        sign_cache_insert (c, key, "munge", 100);
+        sign_cache_destroy (c);
+        _exit (0);
+    }
+    if (waitpid (pid, &status, 0) < 0)
+        BAIL_OUT ("waitpid: %s", strerror (errno));
+    make_key (2, key);
+    ok (WIFEXITED (status) && WEXITSTATUS (status) == 0
+        && sign_cache_lookup (cache, key, "munge", 0) == 0,
+        "entry inserted by another process is found");
+    ok (sign_cache_count (cache) == 2,
+        "cache has 2 entries");
+    sign_cache_destroy (cache2);
+    sign_cache_destroy (cache);
+
+    /* Close the cache file descriptor behind the cache's back, so that
+     * flock(2) fails with EBADF.  The mapping remains valid, but must not
+     * be used without the lock.
+     */
+    if (!(cache = sign_cache_open (path, 4)))
+        BAIL_OUT ("sign_cache_open: %s", strerror (errno));
+    if ((fd = cache_fd (path)) < 0)
+        BAIL_OUT ("could not find cache file descriptor");
+    close (fd);
+    make_key (3, key);
+    sign_cache_insert (cache, key, "curve", 100);
+    errno = 0;
+    ok (sign_cache_lookup (cache, key, "curve", 0) < 0 && errno == EBADF,
+        "sign_cache_lookup fails if the cache file cannot be locked");
+    errno = 0;
+    ok (sign_cache_count (cache) < 0 && errno == EBADF,
+        "sign_cache_count fails if the cache file cannot be locked");
+    sign_cache_destroy (cache);
+    if (!(cache = sign_cache_open (path, 4)))
+        BAIL_OUT ("sign_cache_open: %s", strerror (errno));
+    ok (sign_cache_count (cache) == 2
+        && sign_cache_lookup (cache, key, "curve", 0) < 0 && errno == ENOENT,
+        "sign_cache_insert did not modify the cache without the lock");
+    sign_cache_destroy (cache);
+
+    /* Simulate a process that died while modifying the cache
+     * by setting the busy flag, the last word of the header.
+     */
+    if ((fd = open (path, O_RDWR)) < 0)
+        BAIL_OUT ("open %s: %s", path, strerror (errno));
+    if (pwrite (fd, &(int32_t){1}, sizeof (int32_t), 28) != sizeof (int32_t))
+        BAIL_OUT ("pwrite: %s", strerror (errno));
+    close (fd);
+    if (!(cache = sign_cache_open (path, 4)))
+        BAIL_OUT ("sign_cache_open: %s", strerror (errno));
+    ok (sign_cache_count (cache) == 0,
+        "cache left busy by a dead process is reset");
+    sign_cache_destroy (cache);
+
+    if (chmod (path, 0644) < 0)
+        BAIL_OUT ("chmod: %s", strerror (errno));
+    errno = 0;
+    ok (sign_cache_open (path, 4) == NULL && errno == EPERM,
+        "sign_cache_open fails with EPERM on file accessible by others");
+    if (chmod (path, 0600) < 0 || truncate (path, 100) < 0)
+        BAIL_OUT ("chmod/truncate: %s", strerror (errno));
+    errno = 0;
+    ok (sign_cache_open (path, 4) == NULL && errno == EINVAL,
+        "sign_cache_open fails with EINVAL on corrupt file");
+    if (unlink (path) < 0)
+        BAIL_OUT ("unlink: %s", strerror (errno));
+    if (symlink ("/dev/null", path) < 0)
+        BAIL_OUT ("symlink: %s", strerror (errno));
+    errno = 0;
+    ok (sign_cache_open (path, 4) == NULL && errno == ELOOP,
+        "sign_cache_open fails with ELOOP on symlink");
+    errno = 0;
+    ok (sign_cache_open (NULL, 4) == NULL && errno == EINVAL,
+        "sign_cache_open path=NULL fails with EINVAL");
+    errno = 0;
+    ok (sign_cache_open (path, 0) == NULL && errno == EINVAL,
+        "sign_cache_open size=0 fails with EINVAL");
+
+    if (unlink (path) < 0 || rmdir (tmpdir) < 0)
+        BAIL_OUT ("cleanup: %s", strerror (errno));
+}
+
+void test_corner (void)
+{
+    errno = 0;
+    ok (sign_cache_create (0) == NULL && errno == EINVAL,
+        "sign_cache_create size=0 fails with EINVAL");
+    errno = 0;
+    ok (sign_cache_create (-1) == NULL && errno == EINVAL,
+        "sign_cache_create size=-1 fails with EINVAL");
+    lives_ok ({sign_cache_destroy (NULL);},
+        "sign_cache_destroy NULL doesn't crash");
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    test_basic ();
+    test_lru ();
+    test_shared ();
+    test_corner ();
+
+    done_testing ();
+}
+
+/*
+ * vi: ts=4 sw=4 expandtab
+ */
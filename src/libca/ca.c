@@ -20,6 +20,8 @@
 #include <errno.h>
 #include <string.h>
 #include <stdarg.h>
+#include <dirent.h>
+#include <pthread.h>
 #include <uuid.h>
 #include <assert.h>
 
@@ -29,9 +31,36 @@
 
 #define UUID_STRING_SIZE    37  // see uuid_unparse(3)
 
+#define REVOKE_INDEX_MAGIC  "flux-security-revoke-index"
+#define REVOKE_INDEX_VERSION 1
+
+/* The revocation sources are checked for changes at most once
+ * per this many seconds.
+ */
+#define REVOKE_CHECK_INTERVAL 1
+
+/* In-memory copy of the revocation list, so that checking a cert does not
+ * require a filesystem lookup.  The set is reloaded when the mtime of
+ * 'revoke-dir' changes.  If 'racy' is set, the directory changed within
+ * a second of being loaded, so an unchanged mtime cannot be trusted.
+ * N.B. ca_verify() may be called from multiple threads on one ca object.
+ */
+struct revoke_set {
+    pthread_mutex_t lock;
+    bool valid;
+    bool racy;
+    time_t checked;             // wallclock time of last check
+    dev_t dev;                  // revoke-dir device, inode, and mtime
+    ino_t ino;
+    struct timespec mtime;
+    char **uuids;               // sorted
+    size_t count;
+};
+
 struct ca {
     cf_t *cf;                   // config table is cached
     struct sigcert *ca_cert;    // the CA certificate
+    struct revoke_set *revoked;
 };
 
 static const struct cf_option ca_opts[] = {
@@ -40,6 +69,7 @@ static const struct cf_option ca_opts[] = {
     {"cert-path",       CF_STRING,   true},
     {"revoke-dir",      CF_STRING,   true},
     {"revoke-allow",    CF_BOOL,     true},
+    {"revoke-index",    CF_STRING,   false},
     {"domain",          CF_STRING,   true},
     CF_OPTIONS_TABLE_END,
 };
@@ -64,13 +94,45 @@ static void ca_error (ca_error_t e, const char *fmt, ...)
     }
 }
 
+static void uuids_destroy (char **uuids, size_t count)
+{
+    if (uuids) {
+        int saved_errno = errno;
+        for (size_t i = 0; i < count; i++)
+            free (uuids[i]);
+        free (uuids);
+        errno = saved_errno;
+    }
+}
+
+static void revoke_set_destroy (struct revoke_set *rs)
+{
+    if (rs) {
+        int saved_errno = errno;
+        uuids_destroy (rs->uuids, rs->count);
+        pthread_mutex_destroy (&rs->lock);
+        free (rs);
+        errno = saved_errno;
+    }
+}
+
+static struct revoke_set *revoke_set_create (void)
+{
+    struct revoke_set *rs;
+
+    if (!(rs = calloc (1, sizeof (*rs))))
+        return NULL;
+    pthread_mutex_init (&rs->lock, NULL);
+    return rs;
+}
+
 static struct ca *ca_alloc (const cf_t *cf)
 {
     struct ca *ca;
 
     if (!(ca = calloc (1, sizeof (*ca))))
         return NULL;
-    if (!(ca->cf = cf_copy (cf))) {
+    if (!(ca->cf = cf_copy (cf)) || !(ca->revoked = revoke_set_create ())) {
         ca_destroy (ca);
         return NULL;
     }
@@ -110,6 +172,7 @@ void ca_destroy (struct ca *ca)
         int saved_errno = errno;
         sigcert_destroy (ca->ca_cert);
         cf_destroy (ca->cf);
+        revoke_set_destroy (ca->revoked);
         free (ca);
         errno = saved_errno;
     }
@@ -231,32 +294,366 @@ int ca_revoke (const struct ca *ca, const char *uuid, ca_error_t e)
         ca_error (e, "%s: %s", path, strerror (errno));
         return -1;
     }
+    /* Don't wait for the mtime check to notice our own revocation.
+     */
+    pthread_mutex_lock (&ca->revoked->lock);
+    ca->revoked->valid = false;
+    pthread_mutex_unlock (&ca->revoked->lock);
     return 0;
 error:
     ca_error (e, NULL);
     return -1;
 }
 
-static int check_revocation (const struct ca *ca, const char *uuid,
-                             ca_error_t e)
+static int uuid_cmp (const void *a, const void *b)
 {
-    char path[PATH_MAX + 1];
+    return strcmp (*(char * const *)a, *(char * const *)b);
+}
+
+/* Append a copy of 'uuid' to 'uuids', which holds 'count' entries
+ * and has room for 'size'.
+ */
+static int uuids_append (char ***uuids, size_t *count, size_t *size,
+                         const char *uuid)
+{
+    if (*count == *size) {
+        size_t new_size = *size > 0 ? *size * 2 : 64;
+        char **new_uuids;
+
+        if (!(new_uuids = realloc (*uuids, new_size * sizeof (*new_uuids))))
+            return -1;
+        *uuids = new_uuids;
+        *size = new_size;
+    }
+    if (!((*uuids)[*count] = strdup (uuid)))
+        return -1;
+    (*count)++;
+    return 0;
+}
+
+static bool stat_same (const struct stat *a, const struct stat *b)
+{
+    return (a->st_dev == b->st_dev
+            && a->st_ino == b->st_ino
+            && a->st_mtim.tv_sec == b->st_mtim.tv_sec
+            && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec);
+}
+
+/* Read the names in revocation directory 'dir' into a sorted array.
+ * Names beginning with '.' or containing a newline cannot be a uuid
+ * and are skipped.  A missing directory is an empty list.
+ */
+static int revoke_read_dir (const char *dir, char ***uuidsp, size_t *countp,
+                            ca_error_t e)
+{
+    DIR *dirp;
+    struct dirent *ent;
+    char **uuids = NULL;
+    size_t count = 0;
+    size_t size = 0;
+
+    if (!(dirp = opendir (dir))) {
+        if (errno == ENOENT) {
+            *uuidsp = NULL;
+            *countp = 0;
+            return 0;
+        }
+        ca_error (e, "%s: %s", dir, strerror (errno));
+        return -1;
+    }
+    for (;;) {
+        errno = 0;
+        if (!(ent = readdir (dirp))) {
+            if (errno != 0)
+                goto error;
+            break;
+        }
+        if (ent->d_name[0] == '.' || strchr (ent->d_name, '\n'))
+            continue;
+        if (uuids_append (&uuids, &count, &size, ent->d_name) < 0)
+            goto error;
+    }
+    (void)closedir (dirp);
+    if (count > 0)
+        qsort (uuids, count, sizeof (uuids[0]), uuid_cmp);
+    *uuidsp = uuids;
+    *countp = count;
+    return 0;
+error:
+    ca_error (e, "%s: %s", dir, strerror (errno));
+    (void)closedir (dirp);
+    uuids_destroy (uuids, count);
+    return -1;
+}
+
+/* Read the revocation index at 'path', written by ca_revoke_compile().
+ * Return 1 if the index was read, or 0 if it is missing or does not match
+ * the current state of the revocation directory described by 'sb'.
+ * A malformed index is an error, rather than an empty list.
+ */
+static int revoke_read_index (const char *path, const struct stat *sb,
+                              char ***uuidsp, size_t *countp, ca_error_t e)
+{
+    FILE *f;
+    struct stat isb;
+    char *line = NULL;
+    size_t linesz = 0;
+    ssize_t n;
+    char magic[32];
+    int version;
+    long long sec;
+    long nsec;
+    size_t expected;
+    char **uuids = NULL;
+    size_t count = 0;
+    size_t size = 0;
+    int rc = -1;
+
+    if (!(f = fopen (path, "r"))) {
+        if (errno == ENOENT)
+            return 0;
+        ca_error (e, "%s: %s", path, strerror (errno));
+        return -1;
+    }
+    if (fstat (fileno (f), &isb) < 0) {
+        ca_error (e, "%s: %s", path, strerror (errno));
+        goto done;
+    }
+    if ((n = getline (&line, &linesz, f)) < 0
+        || sscanf (line, "%31s %d %lld %ld %zu",
+                   magic, &version, &sec, &nsec, &expected) != 5
+        || strcmp (magic, REVOKE_INDEX_MAGIC) != 0
+        || version != REVOKE_INDEX_VERSION)
+        goto malformed;
+    /* The index is current only if it was compiled from the directory as
+     * it is now, and it was written after the last change to the directory.
+     * The second test rejects an index compiled within one mtime tick of a
+     * change that it may have missed.
+     */
+    if (sec != sb->st_mtim.tv_sec
+        || nsec != sb->st_mtim.tv_nsec
+        || isb.st_mtim.tv_sec < sec
+        || (isb.st_mtim.tv_sec == sec && isb.st_mtim.tv_nsec <= nsec)) {
+        rc = 0;
+        goto done;
+    }
+    while ((n = getline (&line, &linesz, f)) > 0) {
+        if (line[n - 1] != '\n' || n == 1)
+            goto malformed;
+        line[n - 1] = '\0';
+        if (count > 0 && strcmp (uuids[count - 1], line) >= 0)
+            goto malformed; // must be sorted for bsearch(3)
+        if (uuids_append (&uuids, &count, &size, line) < 0) {
+            ca_error (e, NULL);
+            goto done;
+        }
+    }
+    if (ferror (f)) {
+        ca_error (e, "%s: %s", path, strerror (errno));
+        goto done;
+    }
+    if (count != expected)
+        goto malformed;
+    *uuidsp = uuids;
+    *countp = count;
+    uuids = NULL;
+    rc = 1;
+    goto done;
+malformed:
+    errno = EINVAL;
+    ca_error (e, "%s: malformed revocation index", path);
+done:
+    uuids_destroy (uuids, count);
+    free (line);
+    (void)fclose (f);
+    return rc;
+}
+
+/* Bring the revocation set up to date, unless it was checked less than
+ * REVOKE_CHECK_INTERVAL seconds ago.  A missing 'revoke-dir' means that
+ * no certs have been revoked.  Call with the set locked.
+ */
+static int revoke_set_refresh (const struct ca *ca, time_t now, ca_error_t e)
+{
+    struct revoke_set *rs = ca->revoked;
     const char *dir = cf_string (cf_get_in (ca->cf, "revoke-dir"));
-    if (snprintf (path, sizeof (path), "%s/%s", dir, uuid) >= sizeof (path)) {
+    const cf_t *index = cf_get_in (ca->cf, "revoke-index");
+    struct stat sb;
+    char **uuids = NULL;
+    size_t count = 0;
+    int rc = 0;
+
+    if (rs->valid
+        && now >= rs->checked
+        && now - rs->checked < REVOKE_CHECK_INTERVAL)
+        return 0;
+    memset (&sb, 0, sizeof (sb));
+    if (stat (dir, &sb) < 0 && errno != ENOENT) {
+        ca_error (e, "%s: %s", dir, strerror (errno));
+        return -1;
+    }
+    if (rs->valid
+        && !rs->racy
+        && rs->dev == sb.st_dev
+        && rs->ino == sb.st_ino
+        && rs->mtime.tv_sec == sb.st_mtim.tv_sec
+        && rs->mtime.tv_nsec == sb.st_mtim.tv_nsec) {
+        rs->checked = now;
+        return 0;
+    }
+    if (sb.st_ino != 0) {
+        if (index)
+            rc = revoke_read_index (cf_string (index), &sb, &uuids, &count, e);
+        if (rc < 0)
+            return -1;
+        if (rc == 0 && revoke_read_dir (dir, &uuids, &count, e) < 0)
+            return -1;
+    }
+    uuids_destroy (rs->uuids, rs->count);
+    rs->uuids = uuids;
+    rs->count = count;
+    rs->dev = sb.st_dev;
+    rs->ino = sb.st_ino;
+    rs->mtime = sb.st_mtim;
+    rs->checked = now;
+    rs->valid = true;
+    /* With coarse timestamps, a change later in the same second as the one
+     * just read would not alter the mtime, so force a reload next time.
+     */
+    rs->racy = (sb.st_mtim.tv_sec >= now - 1);
+    return 0;
+}
+
+static int check_revocation (const struct ca *ca, const char *uuid,
+                             time_t now, ca_error_t e)
+{
+    struct revoke_set *rs = ca->revoked;
+    bool revoked;
+
+    pthread_mutex_lock (&rs->lock);
+    if (revoke_set_refresh (ca, now, e) < 0) {
+        pthread_mutex_unlock (&rs->lock);
+        return -1;
+    }
+    revoked = (rs->count > 0 && bsearch (&uuid,
+                                         rs->uuids,
+                                         rs->count,
+                                         sizeof (rs->uuids[0]),
+                                         uuid_cmp));
+    pthread_mutex_unlock (&rs->lock);
+    if (revoked) {
+        errno = EINVAL;
+        ca_error (e, "cert has been revoked");
+        return -1;
+    }
+    return 0;
+}
+
+int ca_revoke_compile (const struct ca *ca, ca_error_t e)
+{
+    const cf_t *index;
+    const char *dir;
+    const char *path;
+    struct stat sb;
+    struct stat sb2;
+    char **uuids = NULL;
+    size_t count = 0;
+    char tmp[PATH_MAX + 1];
+    int fd;
+    FILE *f;
+    int tries = 0;
+
+    if (!ca) {
         errno = EINVAL;
         ca_error (e, NULL);
         return -1;
     }
-    if (access (path, F_OK) == 0) {
+    if (!(index = cf_get_in (ca->cf, "revoke-index"))) {
         errno = EINVAL;
-        ca_error (e, "cert has been revoked");
+        ca_error (e, "revoke-index is not configured");
         return -1;
     }
+    path = cf_string (index);
+    dir = cf_string (cf_get_in (ca->cf, "revoke-dir"));
+
+    /* Read the directory again if it changed while it was being read,
+     * since the index records the mtime of the directory it was built from.
+     */
+    for (;;) {
+        if (stat (dir, &sb) < 0) {
+            ca_error (e, "%s: %s", dir, strerror (errno));
+            return -1;
+        }
+        if (revoke_read_dir (dir, &uuids, &count, e) < 0)
+            return -1;
+        if (stat (dir, &sb2) < 0) {
+            ca_error (e, "%s: %s", dir, strerror (errno));
+            goto error;
+        }
+        if (stat_same (&sb, &sb2))
+            break;
+        uuids_destroy (uuids, count);
+        uuids = NULL;
+        count = 0;
+        if (++tries == 3) {
+            errno = EAGAIN;
+            ca_error (e, "%s: changed while it was being read", dir);
+            return -1;
+        }
+    }
+
+    /* Write to a temporary file and rename it over the index, so that
+     * readers see either the old or the new index in full.
+     */
+    if (snprintf (tmp, sizeof (tmp), "%s.XXXXXX", path) >= sizeof (tmp)) {
+        errno = EINVAL;
+        ca_error (e, NULL);
+        goto error;
+    }
+    if ((fd = mkostemp (tmp, O_CLOEXEC)) < 0) {
+        ca_error (e, "%s: %s", tmp, strerror (errno));
+        goto error;
+    }
+    if (fchmod (fd, 0644) < 0 || !(f = fdopen (fd, "w"))) {
+        ca_error (e, "%s: %s", tmp, strerror (errno));
+        (void)close (fd);
+        goto error_unlink;
+    }
+    fprintf (f, "%s %d %lld %ld %zu\n",
+             REVOKE_INDEX_MAGIC,
+             REVOKE_INDEX_VERSION,
+             (long long)sb.st_mtim.tv_sec,
+             (long)sb.st_mtim.tv_nsec,
+             count);
+    for (size_t i = 0; i < count; i++)
+        fprintf (f, "%s\n", uuids[i]);
+    if (fflush (f) != 0 || fsync (fileno (f)) < 0) {
+        ca_error (e, "%s: %s", tmp, strerror (errno));
+        (void)fclose (f);
+        goto error_unlink;
+    }
+    if (fclose (f) != 0) {
+        ca_error (e, "%s: %s", tmp, strerror (errno));
+        goto error_unlink;
+    }
+    if (rename (tmp, path) < 0) {
+        ca_error (e, "%s: %s", path, strerror (errno));
+        goto error_unlink;
+    }
+    uuids_destroy (uuids, count);
     return 0;
+error_unlink:
+    (void)unlink (tmp);
+error:
+    uuids_destroy (uuids, count);
+    return -1;
 }
 
-int ca_verify (const struct ca *ca, const struct sigcert *cert,
-               int64_t *useridp, int64_t *max_sign_ttlp, ca_error_t e)
+/* Verify cert, skipping its signature check if 'check_sig' is false.
+ */
+static int verify_cert (const struct ca *ca, const struct sigcert *cert,
+                        bool check_sig, int64_t *useridp,
+                        int64_t *max_sign_ttlp, ca_error_t e)
 {
     int64_t max_sign_ttl;
     int64_t userid;
@@ -284,7 +681,7 @@ int ca_verify (const struct ca *ca, const struct sigcert *cert,
     }
     if (time (&now) == (time_t)-1)
         goto error;
-    if (sigcert_verify_cert (ca->ca_cert, cert) < 0) {
+    if (check_sig && sigcert_verify_cert (ca->ca_cert, cert) < 0) {
         ca_error (e, "signature verification failed");
         errno = EINVAL;
         return -1;
@@ -312,7 +709,7 @@ int ca_verify (const struct ca *ca, const struct sigcert *cert,
         errno = EINVAL;
         return -1;
     }
-    if (check_revocation (ca, uuid, e) < 0)
+    if (check_revocation (ca, uuid, now, e) < 0)
         return -1;
     if (useridp)
         *useridp = userid;
@@ -328,6 +725,18 @@ error:
     return -1;
 }
 
+int ca_verify (const struct ca *ca, const struct sigcert *cert,
+               int64_t *useridp, int64_t *max_sign_ttlp, ca_error_t e)
+{
+    return verify_cert (ca, cert, true, useridp, max_sign_ttlp, e);
+}
+
+int ca_recheck (const struct ca *ca, const struct sigcert *cert,
+                int64_t *useridp, int64_t *max_sign_ttlp, ca_error_t e)
+{
+    return verify_cert (ca, cert, false, useridp, max_sign_ttlp, e);
+}
+
 int ca_keygen (struct ca *ca, time_t not_valid_before_time,
                int64_t ttl, ca_error_t e)
 {
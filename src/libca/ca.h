@@ -33,7 +33,11 @@
  * environments that will authenticate messages.
  *
  * Cert revocation consists of placing the uuid of a cert in a directory
- * that is propagated along with the CA public key.
+ * that is propagated along with the CA public key.  The CA object keeps
+ * the contents of the directory in memory, and reloads them when the
+ * directory mtime changes, which is checked at most once per second.
+ * Optionally, the directory may be compiled into an index file that is
+ * faster to load, see ca_revoke_compile().
  */
 
 typedef char ca_error_t[200];
@@ -66,6 +70,15 @@ int ca_sign (const struct ca *ca, struct sigcert *cert,
  */
 int ca_revoke (const struct ca *ca, const char *uuid, ca_error_t error);
 
+/* Write the contents of 'revoke-dir' to the file named by 'revoke-index'.
+ * The index records the mtime of the directory, and is used in place of
+ * the directory by ca_verify() only while the directory is unchanged,
+ * so it should not be located in 'revoke-dir'.
+ * Return 0 on success, -1 on failure with errno set.
+ * On failure, if 'error' is non-NULL, it will contain a textual error message.
+ */
+int ca_revoke_compile (const struct ca *ca, ca_error_t error);
+
 /* Verify that cert was signed by CA and has not expired or been revoked.
  * This function fails if the CA public key has not been loaded with ca_load
  * or ca_keygen.  Return the userid in 'userid' if non-NULL.
@@ -76,6 +89,13 @@ int ca_revoke (const struct ca *ca, const char *uuid, ca_error_t error);
 int ca_verify (const struct ca *ca, const struct sigcert *cert,
                int64_t *userid, int64_t *max_sign_ttl, ca_error_t error);
 
+/* Same as ca_verify(), but skip verification of the cert signature.
+ * This re-checks expiration and revocation of a cert that was previously
+ * verified with ca_verify(), and must not be used on an untrusted cert.
+ */
+int ca_recheck (const struct ca *ca, const struct sigcert *cert,
+                int64_t *userid, int64_t *max_sign_ttl, ca_error_t error);
+
 /* Generate new CA cert in memory, replacing any cached cert with the new one.
  * Return 0 on success, -1 on failure with errno set.
  * On failure, if 'error' is non-NULL, it will contain a textual error message.
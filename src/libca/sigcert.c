@@ -29,6 +29,7 @@
 #include "src/libutil/tomltk.h"
 #include "src/libutil/kv.h"
 #include "src/libutil/macros.h"
+#include "src/libutil/base64.h"
 
 #include "sigcert.h"
 
@@ -233,9 +234,11 @@ int sigcert_meta_get (const struct sigcert *cert, const char *key,
 
 /* Decode a base64 string string to 'dst', a buffer of size 'dstsz'.
  * The decoded size must exactly match 'dstsz'.
+ * If 'secret' is true, use libsodium's constant-time decoder.
  * Return 0 on success, -1 on error.
  */
-static int decode_base64_exact (const char *src, uint8_t *dst, size_t dstsz)
+static int decode_base64_exact (const char *src, uint8_t *dst, size_t dstsz,
+                                bool secret)
 {
     int rc = -1;
     size_t srclen;
@@ -244,10 +247,16 @@ static int decode_base64_exact (const char *src, uint8_t *dst, size_t dstsz)
     if (!src)
         goto done;
     srclen = strlen (src);
-    if (sodium_base642bin (dst, dstsz, src, srclen,
-                           NULL, &dstlen, NULL,
-                           sodium_base64_VARIANT_ORIGINAL) < 0)
-        goto done;
+    if (secret) {
+        if (sodium_base642bin (dst, dstsz, src, srclen,
+                               NULL, &dstlen, NULL,
+                               sodium_base64_VARIANT_ORIGINAL) < 0)
+            goto done;
+    }
+    else {
+        if (base64_decode (dst, dstsz, src, srclen, &dstlen) < 0)
+            goto done;
+    }
     if (dstlen != dstsz)
         goto done;
     rc = 0;
@@ -280,6 +289,8 @@ static int sigcert_fwrite_secret (const struct sigcert *cert, FILE *fp)
     // [curve]
     if (fprintf (fp, "[curve]\n") < 0)
         return -1;
+    /* N.B. libsodium's encoder is constant-time, unlike base64_encode().
+     */
     sodium_bin2base64 (seckey, sizeof (seckey),
                        cert->secret_key, sizeof (cert->secret_key),
                        sodium_base64_VARIANT_ORIGINAL);
@@ -333,17 +344,17 @@ int sigcert_fwrite_public (const struct sigcert *cert, FILE *fp)
         goto error;
 
     char pubkey[PUBLICKEY_BASE64_SIZE];
-    sodium_bin2base64 (pubkey, sizeof (pubkey),
-                       cert->public_key, sizeof (cert->public_key),
-                       sodium_base64_VARIANT_ORIGINAL);
+    if (base64_encode (pubkey, sizeof (pubkey),
+                       cert->public_key, sizeof (cert->public_key)) < 0)
+        goto error;
     if (fprintf (fp, "    public-key = \"%s\"\n", pubkey) < 0)
         goto error;
 
     if (cert->signature_valid) {
         char sign[SIGN_BASE64_SIZE];
-        sodium_bin2base64 (sign, sizeof (sign),
-                           cert->signature, sizeof (cert->signature),
-                           sodium_base64_VARIANT_ORIGINAL);
+        if (base64_encode (sign, sizeof (sign),
+                           cert->signature, sizeof (cert->signature)) < 0)
+            goto error;
         if (fprintf (fp, "    signature = \"%s\"\n", sign) < 0)
             goto error;
     }
@@ -395,14 +406,15 @@ error:
  * The decoded size must exactly match 'dstsz'.
  * Return 0 on success, -1 on error with errno set.
  */
-static int parse_toml_base64_exact (const char *raw, uint8_t *dst, size_t dstsz)
+static int parse_toml_base64_exact (const char *raw, uint8_t *dst, size_t dstsz,
+                                    bool secret)
 {
     char *s = NULL;
     int rc = -1;
 
     if (toml_rtos (raw, &s) < 0)
         goto done;
-    if (decode_base64_exact (s, dst, dstsz) < 0) {
+    if (decode_base64_exact (s, dst, dstsz, secret) < 0) {
         errno = EINVAL;
         goto done;
     }
@@ -513,7 +525,7 @@ static int sigcert_fread_secret (struct sigcert *cert, FILE *fp)
     if (!(raw = toml_raw_in (curve_table, "secret-key")))
         goto inval;
     if (parse_toml_base64_exact (raw, cert->secret_key,
-                                 sizeof (cert->secret_key)) < 0)
+                                 sizeof (cert->secret_key), true) < 0)
         goto inval;
     cert->secret_valid = true;
     free (conf);
@@ -565,11 +577,11 @@ struct sigcert *sigcert_fread_public (FILE *fp)
     if (!(raw = toml_raw_in (curve_table, "public-key")))
         goto inval;
     if (parse_toml_base64_exact (raw, cert->public_key,
-                                 sizeof (cert->public_key)) < 0)
+                                 sizeof (cert->public_key), false) < 0)
         goto inval;
     if ((raw = toml_raw_in (curve_table, "signature"))) { // optional
         if (parse_toml_base64_exact (raw, cert->signature,
-                                     sizeof (cert->signature)) < 0)
+                                     sizeof (cert->signature), false) < 0)
             goto inval;
         cert->signature_valid = true;
     }
@@ -633,32 +645,29 @@ error:
  * The decoded size must exactly match 'dstsz'.
  * Return 0 on success, -1 on error with errno set.
  */
-static int get_base64_exact (struct kv *kv, const char *key,
+static int get_base64_exact (const struct kv *kv, const char *key,
                              uint8_t *dst, size_t dstsz)
 {
     const char *src;
     if (kv_get (kv, key, KV_STRING, &src) < 0)
         return -1;
-    if (decode_base64_exact (src, dst, dstsz) < 0) {
+    if (decode_base64_exact (src, dst, dstsz, false) < 0) {
         errno = EINVAL;
         return -1;
     }
     return 0;
 }
 
-struct sigcert *sigcert_decode (const char *s, int len)
+struct sigcert *sigcert_decode_kv (const struct kv *kv)
 {
-    struct kv *kv;
     struct sigcert *cert;
 
-    if (!s || len == 0) {
+    if (!kv) {
         errno = EINVAL;
         return NULL;
     }
-    if (!(kv = kv_decode (s, len)))
-        return NULL;
     if (!(cert = sigcert_alloc ()))
-        goto error;
+        return NULL;
 
     kv_destroy (cert->meta);
     if (!(cert->meta = kv_split (kv, "meta.")))
@@ -671,14 +680,28 @@ struct sigcert *sigcert_decode (const char *s, int len)
         cert->signature_valid = true;
     else if (errno != ENOENT)
         goto error;
-    kv_destroy (kv);
     return cert;
 error:
-    kv_destroy (kv);
     sigcert_destroy (cert);
     return NULL;
 }
 
+struct sigcert *sigcert_decode (const char *s, int len)
+{
+    struct kv *kv;
+    struct sigcert *cert;
+
+    if (!s || len == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(kv = kv_view (s, len)))
+        return NULL;
+    cert = sigcert_decode_kv (kv);
+    kv_destroy (kv);
+    return cert;
+}
+
 int sigcert_encode (const struct sigcert *cert, const char **buf, int *len)
 {
     char pubkey[PUBLICKEY_BASE64_SIZE];
@@ -692,16 +715,16 @@ int sigcert_encode (const struct sigcert *cert, const char **buf, int *len)
         return -1;
     if (kv_join (cert->enc, cert->meta, "meta.") < 0)
         return -1;
-    sodium_bin2base64 (pubkey, sizeof (pubkey),
-                       cert->public_key, sizeof (cert->public_key),
-                       sodium_base64_VARIANT_ORIGINAL);
+    if (base64_encode (pubkey, sizeof (pubkey),
+                       cert->public_key, sizeof (cert->public_key)) < 0)
+        return -1;
     if (kv_put (cert->enc, "curve.public-key", KV_STRING, pubkey) < 0)
         return -1;
     if (cert->signature_valid) {
         char sign[SIGN_BASE64_SIZE];
-        sodium_bin2base64 (sign, sizeof (sign),
-                           cert->signature, sizeof (cert->signature),
-                           sodium_base64_VARIANT_ORIGINAL);
+        if (base64_encode (sign, sizeof (sign),
+                           cert->signature, sizeof (cert->signature)) < 0)
+            return -1;
         if (kv_put (cert->enc, "curve.signature", KV_STRING, sign) < 0)
             return -1;
     }
@@ -744,9 +767,10 @@ char *sigcert_sign_detached (const struct sigcert *cert,
     }
     if (!(sig_base64 = calloc (1, SIGN_BASE64_SIZE)))
         return NULL;
-    sodium_bin2base64 (sig_base64, SIGN_BASE64_SIZE,
-                       sig, sizeof (sig),
-                       sodium_base64_VARIANT_ORIGINAL);
+    if (base64_encode (sig_base64, SIGN_BASE64_SIZE, sig, sizeof (sig)) < 0) {
+        ERRNO_SAFE_WRAP (free, sig_base64);
+        return NULL;
+    }
     return sig_base64;
 }
 
@@ -760,7 +784,7 @@ int sigcert_verify_detached (const struct sigcert *cert,
         errno = EINVAL;
         return -1;
     }
-    if (decode_base64_exact (signature, sig, sizeof (sig)) < 0) {
+    if (decode_base64_exact (signature, sig, sizeof (sig), false) < 0) {
         errno = EINVAL;
         return -1;
     }
@@ -771,6 +795,93 @@ int sigcert_verify_detached (const struct sigcert *cert,
     return 0;
 }
 
+struct sigcert_stream {
+    crypto_sign_state state;
+};
+
+struct sigcert_stream *sigcert_stream_create (void)
+{
+    struct sigcert_stream *st;
+
+    if (!(st = calloc (1, sizeof (*st))))
+        return NULL;
+    if (crypto_sign_init (&st->state) < 0) {
+        free (st);
+        errno = EINVAL;
+        return NULL;
+    }
+    return st;
+}
+
+void sigcert_stream_destroy (struct sigcert_stream *st)
+{
+    if (st) {
+        int saved_errno = errno;
+        sodium_memzero (st, sizeof (*st));
+        free (st);
+        errno = saved_errno;
+    }
+}
+
+int sigcert_stream_update (struct sigcert_stream *st,
+                           const uint8_t *buf, int len)
+{
+    if (!st || len < 0 || (len > 0 && buf == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (crypto_sign_update (&st->state, buf, len) < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+char *sigcert_sign_stream (const struct sigcert *cert,
+                           struct sigcert_stream *st)
+{
+    uint8_t sig[crypto_sign_BYTES];
+    char *sig_base64;
+
+    if (!cert || !cert->secret_valid || !st) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (crypto_sign_final_create (&st->state, sig, NULL,
+                                  cert->secret_key) < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(sig_base64 = calloc (1, SIGN_BASE64_SIZE)))
+        return NULL;
+    if (base64_encode (sig_base64, SIGN_BASE64_SIZE, sig, sizeof (sig)) < 0) {
+        ERRNO_SAFE_WRAP (free, sig_base64);
+        return NULL;
+    }
+    return sig_base64;
+}
+
+int sigcert_verify_stream (const struct sigcert *cert,
+                           const char *signature,
+                           struct sigcert_stream *st)
+{
+    uint8_t sig[crypto_sign_BYTES];
+
+    if (!cert || !signature || !st) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (decode_base64_exact (signature, sig, sizeof (sig), false) < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (crypto_sign_final_verify (&st->state, sig, cert->public_key) < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
 /* Serialize cert2, excluding secret + signature, sign with cert1.
  * Add 'signature' attribute to [curve] stanza.
  */
@@ -789,9 +900,9 @@ int sigcert_sign_cert (const struct sigcert *cert1,
     }
     if (!(kv = kv_create()))
         return -1;
-    sodium_bin2base64 (pubkey, sizeof (pubkey),
-                       cert2->public_key, sizeof (cert2->public_key),
-                       sodium_base64_VARIANT_ORIGINAL);
+    if (base64_encode (pubkey, sizeof (pubkey),
+                       cert2->public_key, sizeof (cert2->public_key)) < 0)
+        goto done;
     if (kv_put (kv, "curve.public_key", KV_STRING, pubkey) < 0)
         goto done;
     if (kv_join (kv, cert2->meta, "meta.") < 0)
@@ -826,9 +937,9 @@ int sigcert_verify_cert (const struct sigcert *cert1,
     }
     if (!(kv = kv_create()))
         return -1;
-    sodium_bin2base64 (pubkey, sizeof (pubkey),
-                       cert2->public_key, sizeof (cert2->public_key),
-                       sodium_base64_VARIANT_ORIGINAL);
+    if (base64_encode (pubkey, sizeof (pubkey),
+                       cert2->public_key, sizeof (cert2->public_key)) < 0)
+        goto done;
     if (kv_put (kv, "curve.public_key", KV_STRING, pubkey) < 0)
         goto done;
     if (kv_join (kv, cert2->meta, "meta.") < 0)
@@ -29,6 +29,7 @@ extern "C" {
 #endif
 
 struct sigcert;
+struct kv;
 
 /* Destroy cert.
  */
@@ -71,6 +72,10 @@ struct sigcert *sigcert_fread_public (FILE *fp);
  */
 struct sigcert *sigcert_decode (const char *s, int len);
 
+/* Decode cert from kv object, e.g. a kv_view_prefix() of a larger kv.
+ */
+struct sigcert *sigcert_decode_kv (const struct kv *kv);
+
 /* Encode cert to kv buffer.
  */
 int sigcert_encode (const struct sigcert *cert, const char **bp, int *len);
@@ -93,6 +98,29 @@ int sigcert_verify_detached (const struct sigcert *cert,
                              const char *signature,
                              const uint8_t *buf, int len);
 
+/* Incrementally sign or verify input that is too large to hold in memory
+ * at once, using the hash-then-sign Ed25519ph variant.  A signature made
+ * this way is not interchangeable with a detached one over the same input.
+ * Add input with sigcert_stream_update(), then call sigcert_sign_stream()
+ * or sigcert_verify_stream() once, with the same conventions as the
+ * detached functions above.
+ */
+struct sigcert_stream;
+
+struct sigcert_stream *sigcert_stream_create (void);
+
+void sigcert_stream_destroy (struct sigcert_stream *st);
+
+int sigcert_stream_update (struct sigcert_stream *st,
+                           const uint8_t *buf, int len);
+
+char *sigcert_sign_stream (const struct sigcert *cert,
+                           struct sigcert_stream *st);
+
+int sigcert_verify_stream (const struct sigcert *cert,
+                           const char *signature,
+                           struct sigcert_stream *st);
+
 /* Use cert1 to sign cert2.
  * The signature covers public key and all metadata.
  * It does not cover secret key or existing signature, if any.
@@ -17,6 +17,7 @@
 #include <string.h>
 #include <limits.h>
 #include <errno.h>
+#include <stdio.h>
 
 #include "src/libtap/tap.h"
 #include "src/libutil/cf.h"
@@ -184,6 +185,12 @@ void test_basic (void)
         "ca_verify fails with EINVAL");
     diag ("%s", e);
 
+    ok (ca_recheck (ca, cert, &userid, &ttl, e) == 0
+        && userid == getuid () && ttl == 30,
+        "ca_recheck works");
+    ok (ca_recheck (ca, badcert, NULL, NULL, e) == 0,
+        "ca_recheck does not check cert signature");
+
     /* Revoke cert
      */
     if (sigcert_meta_get (cert, "uuid", SM_STRING, &uuid) < 0)
@@ -191,6 +198,10 @@ void test_basic (void)
     ok (ca_revoke (ca, uuid, e) == 0,
         "sigcert revoke works");
     errno = 0;
+    ok (ca_recheck (ca, cert, NULL, NULL, e) < 0 && errno == EINVAL,
+        "ca_recheck fails with EINVAL after revocation");
+    diag ("%s", e);
+    errno = 0;
     ok (ca_verify (ca, badcert, NULL, NULL, e) < 0 && errno == EINVAL,
         "ca_verify fails with EINVAL");
     diag ("%s", e);
@@ -449,6 +460,15 @@ void test_corner (void)
     ok (ca_revoke (ca, "", e) < 0 && errno == EINVAL && *e,
         "ca_revoke uuid=(empty) fails with EINVAL and updates e");
 
+    errno = 0;
+    *e = '\0';
+    ok (ca_revoke_compile (NULL, e) < 0 && errno == EINVAL && *e,
+        "ca_revoke_compile ca=NULL fails with EINVAL and updates e");
+    errno = 0;
+    *e = '\0';
+    ok (ca_revoke_compile (ca, e) < 0 && errno == EINVAL && *e,
+        "ca_revoke_compile fails with EINVAL if revoke-index is not set");
+
     errno = 0;
     *e = '\0';
     ok (ca_get_cert (NULL, e) == NULL && errno == EINVAL && *e,
@@ -470,6 +490,183 @@ void test_corner (void)
     ca_destroy (canokey);
 }
 
+/* Create a ca object from 'conf' that shares the CA cert of 'ca',
+ * but not its in-memory revocation list.
+ */
+static struct ca *ca_dup (const cf_t *conf, struct ca *ca)
+{
+    struct ca *ca2;
+    const struct sigcert *cert;
+    ca_error_t e;
+
+    if (!(ca2 = ca_create (conf, e))
+        || !(cert = ca_get_cert (ca, e))
+        || ca_set_cert (ca2, cert, e) < 0)
+        BAIL_OUT ("ca_dup: %s", e);
+    return ca2;
+}
+
+static struct sigcert *sign_cert (struct ca *ca, const char **uuid)
+{
+    struct sigcert *cert;
+    ca_error_t e;
+
+    if (!(cert = sigcert_create ()))
+        BAIL_OUT ("sigcert_create failed");
+    if (ca_sign (ca, cert, 0, 0, getuid (), e) < 0)
+        BAIL_OUT ("ca_sign: %s", e);
+    if (sigcert_meta_get (cert, "uuid", SM_STRING, uuid) < 0)
+        BAIL_OUT ("failed to read cert uuid: %s", strerror (errno));
+    return cert;
+}
+
+/* Replace the uuids in the index at 'path' with 'line1' and 'line2',
+ * keeping the directory mtime recorded in its header.
+ */
+static void rewrite_index (const char *path, const char *line1,
+                           const char *line2)
+{
+    FILE *f;
+    char header[256];
+    char *count;
+
+    if (!(f = fopen (path, "r")) || !fgets (header, sizeof (header), f))
+        BAIL_OUT ("%s: %s", path, strerror (errno));
+    fclose (f);
+    if (!(count = strrchr (header, ' ')))
+        BAIL_OUT ("%s: malformed header", path);
+    *count = '\0';
+    if (!(f = fopen (path, "w")))
+        BAIL_OUT ("%s: %s", path, strerror (errno));
+    fprintf (f, "%s 2\n%s\n%s\n", header, line1, line2);
+    if (fclose (f) != 0)
+        BAIL_OUT ("%s: %s", path, strerror (errno));
+}
+
+void test_revoke_index (void)
+{
+    struct cf_error error;
+    cf_t *icf;
+    char conf[PATH_MAX*2 + 1];
+    char index[PATH_MAX + 32];
+    char path[PATH_MAX*2 + 1];
+    ca_error_t e;
+    struct ca *ca;
+    struct ca *ca2;
+    struct sigcert *cert1, *cert2;
+    const char *uuid1, *uuid2;
+    FILE *f;
+    char buf[256];
+
+    (void)snprintf (index, sizeof (index), "%s/ca-revoke.index", tmpdir);
+    (void)snprintf (conf, sizeof (conf), "revoke-index = \"%s\"\n", index);
+    if (!(icf = cf_copy (cf))
+        || cf_update (icf, conf, strlen (conf), &error) < 0)
+        BAIL_OUT ("cf_update: %s", error.errbuf);
+
+    if (!(ca = ca_create (icf, e)) || ca_keygen (ca, 0, 0, e) < 0)
+        BAIL_OUT ("ca: %s", e);
+    cert1 = sign_cert (ca, &uuid1);
+    cert2 = sign_cert (ca, &uuid2);
+
+    errno = 0;
+    ok (ca_revoke_compile (ca, e) < 0 && errno == ENOENT,
+        "ca_revoke_compile fails with ENOENT if revoke-dir is missing");
+    diag ("%s", e);
+
+    ok (ca_verify (ca, cert1, NULL, NULL, e) == 0
+        && ca_verify (ca, cert2, NULL, NULL, e) == 0,
+        "ca_verify works before revocation");
+    ok (ca_revoke (ca, uuid1, e) == 0,
+        "ca_revoke works");
+    errno = 0;
+    ok (ca_verify (ca, cert1, NULL, NULL, e) < 0 && errno == EINVAL,
+        "ca_verify immediately notices revocation on the same ca object");
+    diag ("%s", e);
+
+    ok (ca_revoke_compile (ca, e) == 0,
+        "ca_revoke_compile works");
+    ok ((f = fopen (index, "r")) != NULL
+        && fgets (buf, sizeof (buf), f) != NULL
+        && strstr (buf, "flux-security-revoke-index 1 ") == buf
+        && fgets (buf, sizeof (buf), f) != NULL
+        && !strncmp (buf, uuid1, strlen (uuid1))
+        && fgets (buf, sizeof (buf), f) == NULL,
+        "index contains header and revoked uuid");
+    if (f)
+        fclose (f);
+
+    ca2 = ca_dup (icf, ca);
+    errno = 0;
+    ok (ca_verify (ca2, cert1, NULL, NULL, e) < 0 && errno == EINVAL,
+        "ca_verify fails on revoked cert using index");
+    diag ("%s", e);
+    ok (ca_verify (ca2, cert2, NULL, NULL, e) == 0,
+        "ca_verify works on unrevoked cert using index");
+    ca_destroy (ca2);
+
+    /* An index that matches revoke-dir is used in place of it.
+     * Add uuid2 to the index only, and confirm that it is revoked.
+     */
+    if (strcmp (uuid1, uuid2) < 0)
+        rewrite_index (index, uuid1, uuid2);
+    else
+        rewrite_index (index, uuid2, uuid1);
+    ca2 = ca_dup (icf, ca);
+    errno = 0;
+    ok (ca_verify (ca2, cert2, NULL, NULL, e) < 0 && errno == EINVAL
+        && strstr (e, "revoked") != NULL,
+        "ca_verify reads revocations from the index");
+    diag ("%s", e);
+    ca_destroy (ca2);
+
+    /* Unsorted entries are rejected.
+     */
+    if (strcmp (uuid1, uuid2) < 0)
+        rewrite_index (index, uuid2, uuid1);
+    else
+        rewrite_index (index, uuid1, uuid2);
+    ca2 = ca_dup (icf, ca);
+    *e = '\0';
+    errno = 0;
+    ok (ca_verify (ca2, cert2, NULL, NULL, e) < 0 && errno == EINVAL
+        && strstr (e, "malformed") != NULL,
+        "ca_verify fails on a malformed index");
+    diag ("%s", e);
+    ca_destroy (ca2);
+
+    /* An index that is older than revoke-dir is ignored.
+     */
+    ok (ca_revoke_compile (ca, e) == 0,
+        "ca_revoke_compile works");
+    ok (ca_revoke (ca, uuid2, e) == 0,
+        "ca_revoke works");
+    ca2 = ca_dup (icf, ca);
+    errno = 0;
+    ok (ca_verify (ca2, cert2, NULL, NULL, e) < 0 && errno == EINVAL,
+        "ca_verify ignores a stale index");
+    diag ("%s", e);
+    ca_destroy (ca2);
+
+    /* clean up revocation dir and index */
+    snprintf (path, sizeof (path), "%s/ca-revoke/%s", tmpdir, uuid1);
+    if (unlink (path) < 0)
+        BAIL_OUT ("%s: %s", path, strerror (errno));
+    snprintf (path, sizeof (path), "%s/ca-revoke/%s", tmpdir, uuid2);
+    if (unlink (path) < 0)
+        BAIL_OUT ("%s: %s", path, strerror (errno));
+    snprintf (path, sizeof (path), "%s/ca-revoke", tmpdir);
+    if (rmdir (path) < 0)
+        BAIL_OUT ("%s: %s", path, strerror (errno));
+    if (unlink (index) < 0)
+        BAIL_OUT ("%s: %s", index, strerror (errno));
+
+    sigcert_destroy (cert1);
+    sigcert_destroy (cert2);
+    ca_destroy (ca);
+    cf_destroy (icf);
+}
+
 int main (int argc, char *argv[])
 {
     plan (NO_PLAN);
@@ -480,6 +677,7 @@ int main (int argc, char *argv[])
     test_ca_meta ();
     test_ca_capability ();
     test_expiration ();
+    test_revoke_index ();
     test_corner ();
 
     cf_fini ();
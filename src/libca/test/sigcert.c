@@ -13,12 +13,14 @@
 #endif
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/param.h>
 #include <unistd.h>
 #include <string.h>
 #include <limits.h>
 #include <errno.h>
 
 #include "src/libtap/tap.h"
+#include "src/libutil/kv.h"
 #include "sigcert.h"
 
 static char scratch[PATH_MAX + 1];
@@ -311,11 +313,115 @@ void test_sign_verify_detached (void)
     sigcert_destroy (cert2);
 }
 
+/* Sign 'len' bytes of 'buf' in pieces of 'chunk' bytes.
+ */
+static char *sign_stream (struct sigcert *cert, const uint8_t *buf, int len,
+                          int chunk)
+{
+    struct sigcert_stream *st;
+    char *sig = NULL;
+
+    if (!(st = sigcert_stream_create ()))
+        BAIL_OUT ("sigcert_stream_create: %s", strerror (errno));
+    for (int i = 0; i < len; i += chunk) {
+        if (sigcert_stream_update (st, buf + i, MIN (chunk, len - i)) < 0)
+            goto done;
+    }
+    sig = sigcert_sign_stream (cert, st);
+done:
+    sigcert_stream_destroy (st);
+    return sig;
+}
+
+/* Verify 'len' bytes of 'buf' against 'sig' in pieces of 'chunk' bytes.
+ */
+static int verify_stream (struct sigcert *cert, const char *sig,
+                          const uint8_t *buf, int len, int chunk)
+{
+    struct sigcert_stream *st;
+    int rc = -1;
+
+    if (!(st = sigcert_stream_create ()))
+        BAIL_OUT ("sigcert_stream_create: %s", strerror (errno));
+    for (int i = 0; i < len; i += chunk) {
+        if (sigcert_stream_update (st, buf + i, MIN (chunk, len - i)) < 0)
+            goto done;
+    }
+    rc = sigcert_verify_stream (cert, sig, st);
+done:
+    sigcert_stream_destroy (st);
+    return rc;
+}
+
+void test_sign_verify_stream (void)
+{
+    struct sigcert *cert1;
+    struct sigcert *cert2;
+    uint8_t message[] = "foo-bar-baz";
+    uint8_t tampered[] = "foo-KITTENS-baz";
+    char *sig;
+    char *sig2;
+
+    if (!(cert1 = sigcert_create ()))
+        BAIL_OUT ("sigcert_create: %s", strerror (errno));
+    if (!(cert2 = sigcert_create ()))
+        BAIL_OUT ("sigcert_create: %s", strerror (errno));
+
+    sig = sign_stream (cert1, message, sizeof (message), 1);
+    ok (sig != NULL,
+        "sigcert_sign_stream works");
+    ok (verify_stream (cert1, sig, message, sizeof (message), 5) == 0,
+        "sigcert_verify_stream works with different pieces");
+    errno = 0;
+    ok (verify_stream (cert2, sig, message, sizeof (message), 5) < 0
+        && errno == EINVAL,
+        "sigcert_verify_stream cert=bad fails with EINVAL");
+    errno = 0;
+    ok (verify_stream (cert1, sig, tampered, sizeof (tampered), 5) < 0
+        && errno == EINVAL,
+        "sigcert_verify_stream tampered fails with EINVAL");
+    errno = 0;
+    ok (sigcert_verify_detached (cert1, sig, message, sizeof (message)) < 0
+        && errno == EINVAL,
+        "sigcert_verify_detached fails on stream signature");
+
+    sig2 = sigcert_sign_detached (cert1, message, sizeof (message));
+    errno = 0;
+    ok (sig2 != NULL
+        && verify_stream (cert1, sig2, message, sizeof (message), 5) < 0
+        && errno == EINVAL,
+        "sigcert_verify_stream fails on detached signature");
+    free (sig2);
+
+    sig2 = sign_stream (cert1, NULL, 0, 1);
+    ok (sig2 != NULL && verify_stream (cert1, sig2, NULL, 0, 1) == 0,
+        "sigcert_sign_stream/verify_stream work on zero-length message");
+    free (sig2);
+
+    errno = 0;
+    ok (sigcert_stream_update (NULL, message, 1) < 0 && errno == EINVAL,
+        "sigcert_stream_update st=NULL fails with EINVAL");
+    errno = 0;
+    ok (sigcert_sign_stream (cert1, NULL) == NULL && errno == EINVAL,
+        "sigcert_sign_stream st=NULL fails with EINVAL");
+    errno = 0;
+    ok (sigcert_verify_stream (cert1, sig, NULL) < 0 && errno == EINVAL,
+        "sigcert_verify_stream st=NULL fails with EINVAL");
+    lives_ok ({sigcert_stream_destroy (NULL);},
+        "sigcert_stream_destroy NULL doesn't crash");
+
+    free (sig);
+    sigcert_destroy (cert1);
+    sigcert_destroy (cert2);
+}
+
 void test_codec (void)
 {
     struct sigcert *cert;
     struct sigcert *cert_pub;
     struct sigcert *cert2;
+    struct sigcert *cert3;
+    struct kv *kv, *kv2;
     const char *s;
     int len;
 
@@ -356,6 +462,24 @@ void test_codec (void)
     ok (sigcert_equal (cert2, cert_pub) == true,
         "the two certs are equal");
 
+    /* Embed encoded cert_pub in a larger kv under a prefix, then decode
+     * from a view of that prefix.
+     */
+    if (!(kv = kv_create ())
+        || kv_put (kv, "other", KV_STRING, "foo") < 0
+        || !(kv2 = kv_view (s, len))
+        || kv_join (kv, kv2, "cert.") < 0)
+        BAIL_OUT ("failed to create kv with embedded cert");
+    kv_destroy (kv2);
+    ok ((kv2 = kv_view_prefix (kv, "cert.")) != NULL,
+        "kv_view_prefix works on embedded cert");
+    cert3 = sigcert_decode_kv (kv2);
+    ok (cert3 != NULL && sigcert_equal (cert3, cert_pub) == true,
+        "sigcert_decode_kv works on prefix view");
+    sigcert_destroy (cert3);
+    kv_destroy (kv2);
+    kv_destroy (kv);
+
     sigcert_destroy (cert);
     sigcert_destroy (cert_pub);
     sigcert_destroy (cert2);
@@ -445,6 +569,9 @@ void test_corner (void)
     errno = 0;
     ok (sigcert_decode ("", 1) == NULL && errno == EINVAL,
         "sigcert_decode s=empty fails with EINVAL");
+    errno = 0;
+    ok (sigcert_decode_kv (NULL) == NULL && errno == EINVAL,
+        "sigcert_decode_kv kv=NULL fails with EINVAL");
 
     /* General meta get/set corner cases
      */
@@ -805,6 +932,7 @@ int main (int argc, char *argv[])
     test_meta ();
     test_load_store ();
     test_sign_verify_detached ();
+    test_sign_verify_stream ();
     test_codec ();
     test_corner ();
     test_sign_cert ();
@@ -0,0 +1,487 @@
+/************************************************************\
+ * Copyright 2026 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* Vector kernels are based on the algorithms described in
+ *   W. Mula, D. Lemire, "Faster Base64 Encoding and Decoding Using AVX2
+ *   Instructions", ACM Transactions on the Web 12(3), 2018.
+ */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+#include "base64.h"
+#include "macros.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+/* An implementation converts a bulk prefix of its input, and the
+ * scalar code handles the remainder and any error reporting.
+ * encode - encode a multiple of 3 bytes of 'src' to 4/3 as many characters
+ *   in 'dst', returning the number of bytes encoded.
+ * decode - decode a multiple of 4 characters of 'src', which contains
+ *   only complete, unpadded groups of 4, to 3/4 as many bytes in 'dst'.
+ *   Stop early if an invalid character is found.  Return the number of
+ *   characters decoded.  At least 'srclen' * 3 / 4 + 16 bytes of 'dst'
+ *   are writable.
+ */
+struct base64_impl {
+    const char *name;
+    bool (*supported)(void);
+    size_t (*encode)(char *dst, const uint8_t *src, size_t srclen);
+    size_t (*decode)(uint8_t *dst, const char *src, size_t srclen);
+};
+
+static const char enctab[64] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Character to 6-bit value, or 0xff if invalid.
+ */
+static const uint8_t dectab[256] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b,
+    0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+    0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+    0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20,
+    0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
+    0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+static bool scalar_supported (void)
+{
+    return true;
+}
+
+static size_t scalar_encode (char *dst, const uint8_t *src, size_t srclen)
+{
+    size_t n = srclen - srclen % 3;
+
+    for (size_t i = 0; i < n; i += 3) {
+        uint32_t v = (uint32_t)src[i] << 16 | src[i + 1] << 8 | src[i + 2];
+        *dst++ = enctab[v >> 18];
+        *dst++ = enctab[(v >> 12) & 0x3f];
+        *dst++ = enctab[(v >> 6) & 0x3f];
+        *dst++ = enctab[v & 0x3f];
+    }
+    return n;
+}
+
+static size_t scalar_decode (uint8_t *dst, const char *src, size_t srclen)
+{
+    size_t i;
+
+    for (i = 0; i + 4 <= srclen; i += 4) {
+        unsigned int a = dectab[(uint8_t)src[i]];
+        unsigned int b = dectab[(uint8_t)src[i + 1]];
+        unsigned int c = dectab[(uint8_t)src[i + 2]];
+        unsigned int d = dectab[(uint8_t)src[i + 3]];
+        uint32_t v;
+
+        if ((a | b | c | d) & 0xc0)
+            break;
+        v = a << 18 | b << 12 | c << 6 | d;
+        *dst++ = v >> 16;
+        *dst++ = (v >> 8) & 0xff;
+        *dst++ = v & 0xff;
+    }
+    return i;
+}
+
+#if HAVE_X86_KERNELS
+/* Spread 12 input bytes in the low 12 bytes of each 128-bit lane to
+ * 16 6-bit values, one per byte.
+ */
+#define ENC_SHUFFLE \
+    1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10
+
+/* Each output sextet falls into one of 5 ranges, each mapped to ASCII
+ * by adding a constant: 0-25 'A', 26-51 'a', 52-61 '0', 62 '+', 63 '/'.
+ */
+#define ENC_OFFSETS \
+    65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0
+
+/* Decoding validates characters by the intersection of flags looked up
+ * by their low and high nibbles, then maps them to 6-bit values by
+ * adding a constant looked up by high nibble ('/' is a special case).
+ */
+#define DEC_LUT_LO \
+    0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, \
+    0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a
+#define DEC_LUT_HI \
+    0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, \
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+#define DEC_LUT_ROLL \
+    0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+
+/* Pack 4 6-bit values per 32 bits to 3 bytes, in the low 12 bytes of
+ * each 128-bit lane.
+ */
+#define DEC_SHUFFLE \
+    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+
+static bool ssse3_supported (void)
+{
+    return __builtin_cpu_supports ("ssse3");
+}
+
+__attribute__((target ("ssse3")))
+static inline __m128i ssse3_enc (__m128i in)
+{
+    __m128i t0, t1, t2, t3, idx;
+
+    in = _mm_shuffle_epi8 (in, _mm_setr_epi8 (ENC_SHUFFLE));
+    t0 = _mm_and_si128 (in, _mm_set1_epi32 (0x0fc0fc00));
+    t1 = _mm_mulhi_epu16 (t0, _mm_set1_epi32 (0x04000040));
+    t2 = _mm_and_si128 (in, _mm_set1_epi32 (0x003f03f0));
+    t3 = _mm_mullo_epi16 (t2, _mm_set1_epi32 (0x01000010));
+    in = _mm_or_si128 (t1, t3);
+
+    idx = _mm_subs_epu8 (in, _mm_set1_epi8 (51));
+    idx = _mm_sub_epi8 (idx, _mm_cmpgt_epi8 (in, _mm_set1_epi8 (25)));
+    return _mm_add_epi8 (in, _mm_shuffle_epi8 (_mm_setr_epi8 (ENC_OFFSETS),
+                                               idx));
+}
+
+__attribute__((target ("ssse3")))
+static size_t ssse3_encode (char *dst, const uint8_t *src, size_t srclen)
+{
+    size_t i;
+
+    /* Load 16 bytes, use 12.
+     */
+    for (i = 0; i + 16 <= srclen; i += 12) {
+        __m128i in = _mm_loadu_si128 ((const __m128i *)(src + i));
+        _mm_storeu_si128 ((__m128i *)dst, ssse3_enc (in));
+        dst += 16;
+    }
+    return i;
+}
+
+/* Translate 16 characters to 6-bit values.
+ * Return false if any are invalid.
+ */
+__attribute__((target ("ssse3")))
+static inline bool ssse3_dec (__m128i *in)
+{
+    const __m128i mask_2f = _mm_set1_epi8 (0x2f);
+    __m128i hi_nibbles = _mm_and_si128 (_mm_srli_epi32 (*in, 4), mask_2f);
+    __m128i lo_nibbles = _mm_and_si128 (*in, mask_2f);
+    __m128i hi = _mm_shuffle_epi8 (_mm_setr_epi8 (DEC_LUT_HI), hi_nibbles);
+    __m128i lo = _mm_shuffle_epi8 (_mm_setr_epi8 (DEC_LUT_LO), lo_nibbles);
+    __m128i roll;
+
+    if (_mm_movemask_epi8 (_mm_cmpgt_epi8 (_mm_and_si128 (lo, hi),
+                                           _mm_setzero_si128 ())) != 0)
+        return false;
+    roll = _mm_add_epi8 (_mm_cmpeq_epi8 (*in, mask_2f), hi_nibbles);
+    roll = _mm_shuffle_epi8 (_mm_setr_epi8 (DEC_LUT_ROLL), roll);
+    *in = _mm_add_epi8 (*in, roll);
+    return true;
+}
+
+__attribute__((target ("ssse3")))
+static size_t ssse3_decode (uint8_t *dst, const char *src, size_t srclen)
+{
+    size_t i;
+
+    /* Decode 16 characters to 12 bytes, store 16.
+     */
+    for (i = 0; i + 16 <= srclen; i += 16) {
+        __m128i in = _mm_loadu_si128 ((const __m128i *)(src + i));
+        if (!ssse3_dec (&in))
+            break;
+        in = _mm_maddubs_epi16 (in, _mm_set1_epi32 (0x01400140));
+        in = _mm_madd_epi16 (in, _mm_set1_epi32 (0x00011000));
+        in = _mm_shuffle_epi8 (in, _mm_setr_epi8 (DEC_SHUFFLE));
+        _mm_storeu_si128 ((__m128i *)dst, in);
+        dst += 12;
+    }
+    return i;
+}
+
+static bool avx2_supported (void)
+{
+    return __builtin_cpu_supports ("avx2");
+}
+
+__attribute__((target ("avx2")))
+static inline __m256i avx2_bcast (__m128i v)
+{
+    return _mm256_broadcastsi128_si256 (v);
+}
+
+__attribute__((target ("avx2")))
+static size_t avx2_encode (char *dst, const uint8_t *src, size_t srclen)
+{
+    const __m256i shuffle = avx2_bcast (_mm_setr_epi8 (ENC_SHUFFLE));
+    const __m256i offsets = avx2_bcast (_mm_setr_epi8 (ENC_OFFSETS));
+    size_t i;
+
+    /* Load 12 bytes into each lane (reading 28), encode to 32 characters.
+     */
+    for (i = 0; i + 28 <= srclen; i += 24) {
+        __m256i in, t0, t1, t2, t3, idx;
+
+        in = _mm256_castsi128_si256 (
+                _mm_loadu_si128 ((const __m128i *)(src + i)));
+        in = _mm256_inserti128_si256 (in,
+                _mm_loadu_si128 ((const __m128i *)(src + i + 12)), 1);
+        in = _mm256_shuffle_epi8 (in, shuffle);
+        t0 = _mm256_and_si256 (in, _mm256_set1_epi32 (0x0fc0fc00));
+        t1 = _mm256_mulhi_epu16 (t0, _mm256_set1_epi32 (0x04000040));
+        t2 = _mm256_and_si256 (in, _mm256_set1_epi32 (0x003f03f0));
+        t3 = _mm256_mullo_epi16 (t2, _mm256_set1_epi32 (0x01000010));
+        in = _mm256_or_si256 (t1, t3);
+
+        idx = _mm256_subs_epu8 (in, _mm256_set1_epi8 (51));
+        idx = _mm256_sub_epi8 (idx,
+                               _mm256_cmpgt_epi8 (in, _mm256_set1_epi8 (25)));
+        in = _mm256_add_epi8 (in, _mm256_shuffle_epi8 (offsets, idx));
+        _mm256_storeu_si256 ((__m256i *)dst, in);
+        dst += 32;
+    }
+    return i;
+}
+
+__attribute__((target ("avx2")))
+static size_t avx2_decode (uint8_t *dst, const char *src, size_t srclen)
+{
+    const __m256i mask_2f = _mm256_set1_epi8 (0x2f);
+    const __m256i lut_lo = avx2_bcast (_mm_setr_epi8 (DEC_LUT_LO));
+    const __m256i lut_hi = avx2_bcast (_mm_setr_epi8 (DEC_LUT_HI));
+    const __m256i lut_roll = avx2_bcast (_mm_setr_epi8 (DEC_LUT_ROLL));
+    const __m256i shuffle = avx2_bcast (_mm_setr_epi8 (DEC_SHUFFLE));
+    const __m256i pack = _mm256_setr_epi32 (0, 1, 2, 4, 5, 6, -1, -1);
+    size_t i;
+
+    /* Decode 32 characters to 24 bytes, store 32.
+     */
+    for (i = 0; i + 32 <= srclen; i += 32) {
+        __m256i in = _mm256_loadu_si256 ((const __m256i *)(src + i));
+        __m256i hi_nibbles = _mm256_and_si256 (_mm256_srli_epi32 (in, 4),
+                                               mask_2f);
+        __m256i lo_nibbles = _mm256_and_si256 (in, mask_2f);
+        __m256i hi = _mm256_shuffle_epi8 (lut_hi, hi_nibbles);
+        __m256i lo = _mm256_shuffle_epi8 (lut_lo, lo_nibbles);
+        __m256i roll;
+
+        if (!_mm256_testz_si256 (lo, hi))
+            break;
+        roll = _mm256_add_epi8 (_mm256_cmpeq_epi8 (in, mask_2f), hi_nibbles);
+        in = _mm256_add_epi8 (in, _mm256_shuffle_epi8 (lut_roll, roll));
+        in = _mm256_maddubs_epi16 (in, _mm256_set1_epi32 (0x01400140));
+        in = _mm256_madd_epi16 (in, _mm256_set1_epi32 (0x00011000));
+        in = _mm256_shuffle_epi8 (in, shuffle);
+        in = _mm256_permutevar8x32_epi32 (in, pack);
+        _mm256_storeu_si256 ((__m256i *)dst, in);
+        dst += 24;
+    }
+    /* Let the SSSE3 kernel finish any remaining 16 character block.
+     */
+    return i + ssse3_decode (dst, src + i, srclen - i);
+}
+#endif /* HAVE_X86_KERNELS */
+
+/* In order of preference.
+ */
+static const struct base64_impl impls[] = {
+#if HAVE_X86_KERNELS
+    { "avx2", avx2_supported, avx2_encode, avx2_decode },
+    { "ssse3", ssse3_supported, ssse3_encode, ssse3_decode },
+#endif
+    { "scalar", scalar_supported, scalar_encode, scalar_decode },
+};
+
+static const struct base64_impl *current_impl;
+
+static const struct base64_impl *best_impl (void)
+{
+    const struct base64_impl *impl;
+
+    for (impl = &impls[0]; !impl->supported (); impl++)
+        ;
+    return impl;
+}
+
+static const struct base64_impl *get_impl (void)
+{
+    const struct base64_impl *impl;
+
+    if (!(impl = __atomic_load_n (&current_impl, __ATOMIC_ACQUIRE))) {
+        impl = best_impl ();
+        __atomic_store_n (&current_impl, impl, __ATOMIC_RELEASE);
+    }
+    return impl;
+}
+
+int base64_select (const char *name)
+{
+    const struct base64_impl *impl = NULL;
+
+    if (!name)
+        impl = best_impl ();
+    else {
+        for (size_t i = 0; i < ARRAY_SIZE (impls); i++) {
+            if (streq (impls[i].name, name))
+                impl = &impls[i];
+        }
+        if (!impl) {
+            /* Vector kernels are not built for this architecture.
+             */
+            if (streq (name, "avx2") || streq (name, "ssse3"))
+                errno = ENOTSUP;
+            else
+                errno = ENOENT;
+            return -1;
+        }
+        if (!impl->supported ()) {
+            errno = ENOTSUP;
+            return -1;
+        }
+    }
+    __atomic_store_n (&current_impl, impl, __ATOMIC_RELEASE);
+    return 0;
+}
+
+size_t base64_encode_length (size_t srclen)
+{
+    return (srclen + 2) / 3 * 4 + 1;
+}
+
+size_t base64_decode_length (size_t srclen)
+{
+    return (srclen + 3) / 4 * 3;
+}
+
+int base64_encode (char *dst, size_t dstsz, const void *src, size_t srclen)
+{
+    const uint8_t *in = src;
+    size_t n;
+
+    if (!dst || (!src && srclen > 0)
+        || srclen > (SIZE_MAX - 1) / 4 * 3
+        || dstsz < base64_encode_length (srclen)) {
+        errno = EINVAL;
+        return -1;
+    }
+    n = get_impl ()->encode (dst, in, srclen);
+    n += scalar_encode (dst + n / 3 * 4, in + n, srclen - n);
+    dst += n / 3 * 4;
+    if (srclen - n == 1) {
+        *dst++ = enctab[in[n] >> 2];
+        *dst++ = enctab[(in[n] & 0x03) << 4];
+        *dst++ = '=';
+        *dst++ = '=';
+    }
+    else if (srclen - n == 2) {
+        *dst++ = enctab[in[n] >> 2];
+        *dst++ = enctab[(in[n] & 0x03) << 4 | in[n + 1] >> 4];
+        *dst++ = enctab[(in[n + 1] & 0x0f) << 2];
+        *dst++ = '=';
+    }
+    *dst = '\0';
+    return 0;
+}
+
+int base64_decode (void *dst, size_t dstsz, const char *src, size_t srclen,
+                   size_t *dstlen)
+{
+    uint8_t *out = dst;
+    size_t pad = 0;
+    size_t body;
+    size_t outlen;
+    size_t n;
+
+    if ((!dst && dstsz > 0) || (!src && srclen > 0) || srclen % 4 != 0)
+        goto inval;
+    if (srclen > 0 && src[srclen - 1] == '=') {
+        pad++;
+        if (src[srclen - 2] == '=')
+            pad++;
+    }
+    outlen = srclen / 4 * 3 - pad;
+    if (outlen > dstsz) {
+        errno = ERANGE;
+        return -1;
+    }
+    /* Decode complete groups, leaving any padded group for below.
+     * Vector kernels may write up to 16 bytes beyond the decoded output,
+     * so they are only used on the part of 'src' where that will land
+     * within 'dst'.
+     */
+    body = pad ? srclen - 4 : srclen;
+    n = 0;
+    if (body >= 96) {
+        size_t safe = (dstsz - 16) / 3 * 4;
+        n = get_impl ()->decode (out, src, body < safe ? body : safe);
+    }
+    n += scalar_decode (out + n / 4 * 3, src + n, body - n);
+    if (n < body)
+        goto inval;
+    out += n / 4 * 3;
+    if (pad) {
+        unsigned int a = dectab[(uint8_t)src[n]];
+        unsigned int b = dectab[(uint8_t)src[n + 1]];
+        unsigned int c = pad == 1 ? dectab[(uint8_t)src[n + 2]] : 0;
+
+        if ((a | b | c) & 0xc0)
+            goto inval;
+        *out++ = a << 2 | b >> 4;
+        if (pad == 1) {
+            if ((c & 0x03))
+                goto inval;
+            *out++ = (b & 0x0f) << 4 | c >> 2;
+        }
+        else if ((b & 0x0f))
+            goto inval;
+    }
+    if (dstlen)
+        *dstlen = outlen;
+    return 0;
+inval:
+    errno = EINVAL;
+    return -1;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
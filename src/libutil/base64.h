@@ -0,0 +1,65 @@
+/************************************************************\
+ * Copyright 2026 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_BASE64_H
+#define _UTIL_BASE64_H
+
+/* Standard (RFC 4648 section 4) base64 with padding.
+ *
+ * Output and the set of accepted input are identical to libsodium's
+ * sodium_bin2base64() and sodium_base642bin() with
+ * sodium_base64_VARIANT_ORIGINAL and no ignored characters, but vector
+ * instructions are used when the CPU supports them.  Unlike libsodium,
+ * these functions are not constant-time, so they should not be used to
+ * encode or decode secret keys.
+ */
+
+#include <stddef.h>
+
+/* Return the size of the buffer needed to encode 'srclen' bytes,
+ * including the \0 string terminator.
+ */
+size_t base64_encode_length (size_t srclen);
+
+/* Return the maximum number of bytes decoded from 'srclen' characters.
+ */
+size_t base64_decode_length (size_t srclen);
+
+/* Encode 'srclen' bytes of 'src' to 'dst', a buffer of size 'dstsz',
+ * which must be at least base64_encode_length (srclen).
+ * The result is \0 terminated.
+ * Return 0 on success, -1 on failure with errno set.
+ */
+int base64_encode (char *dst, size_t dstsz, const void *src, size_t srclen);
+
+/* Decode 'srclen' characters of 'src' to 'dst', a buffer of size 'dstsz'.
+ * All of 'src' must be valid base64, including padding.  If 'dstlen' is
+ * non-NULL, it is set to the number of bytes decoded.
+ * Return 0 on success, -1 on failure with errno set:
+ *   EINVAL - 'src' is not valid base64
+ *   ERANGE - the decoded result does not fit in 'dstsz' bytes
+ */
+int base64_decode (void *dst, size_t dstsz, const char *src, size_t srclen,
+                   size_t *dstlen);
+
+/* Use the named implementation ("scalar", "ssse3", or "avx2"), or if
+ * 'name' is NULL, the fastest one supported by the CPU (the default).
+ * This is intended for testing.
+ * Return 0 on success, -1 on failure with errno set:
+ *   ENOENT - unknown implementation
+ *   ENOTSUP - implementation is not supported by this CPU or build
+ */
+int base64_select (const char *name);
+
+#endif /* !_UTIL_BASE64_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -21,6 +21,7 @@
 #include <time.h>
 #include <stdarg.h>
 #include <assert.h>
+#include <limits.h>
 
 #include "timestamp.h"
 #include "kv.h"
@@ -28,17 +29,55 @@
 
 #define KV_CHUNK 4096
 
+/* Build an index once a lookup has to scan this many entries.
+ */
+#define KV_INDEX_MIN 16
+
+/* Open addressing (linear probing) hash of key to entry offset.
+ */
+struct kv_index {
+    int size;               /* power of 2 */
+    int count;
+    int slot[];             /* entry offset in kv buf, or -1 if empty */
+};
+
 struct kv {
     char *buf;
     int bufsz;
     int len;
+
+    /* Optional index, built lazily by kv_find() and then maintained by
+     * kv_put() and kv_delete().  The index is a cache only and does not
+     * affect the encoded form.  Since kv_find() may build it for a const
+     * kv, it is published with an atomic compare-and-swap, so concurrent
+     * lookups in an unchanging kv are safe.
+     */
+    struct kv_index *index;
+    bool index_disabled;    /* buffer contains duplicate keys */
+
+    /* A view refers to a borrowed 'buf' and is read-only.  If 'prefix'
+     * is set, only entries whose keys begin with it are visible, and
+     * kv_next() returns keys with the prefix skipped.
+     */
+    bool view;
+    char *prefix;
+    int prefixlen;
 };
 
+static void kv_index_drop (struct kv *kv)
+{
+    free (kv->index);
+    kv->index = NULL;
+}
+
 void kv_destroy (struct kv *kv)
 {
     if (kv) {
         int saved_errno = errno;
-        free (kv->buf);
+        kv_index_drop (kv);
+        if (!kv->view)
+            free (kv->buf);
+        free (kv->prefix);
         free (kv);
         errno = saved_errno;
     }
@@ -74,19 +113,61 @@ struct kv *kv_create (void)
     return kv_create_from (NULL, 0);
 }
 
+struct kv *kv_create_sized (int size)
+{
+    struct kv *kv;
+
+    if (size < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(kv = kv_create_from (NULL, 0)))
+        return NULL;
+    if (kv_reserve (kv, size) < 0) {
+        kv_destroy (kv);
+        return NULL;
+    }
+    return kv;
+}
+
 struct kv *kv_copy (const struct kv *kv)
 {
     if (!kv) {
         errno = EINVAL;
         return NULL;
     }
+    if (kv->prefix)
+        return kv_split (kv, NULL);
     return kv_create_from (kv->buf, kv->len);
 }
 
+/* Compare kv1 and kv2 entry by entry, for use when either is a
+ * prefix view and the encoded buffers cannot be compared directly.
+ */
+static bool kv_equal_entries (const struct kv *kv1, const struct kv *kv2)
+{
+    const char *key1 = NULL;
+    const char *key2 = NULL;
+
+    for (;;) {
+        key1 = kv_next (kv1, key1);
+        key2 = kv_next (kv2, key2);
+        if (!key1 || !key2)
+            break;
+        if (strcmp (key1, key2) != 0
+            || kv_typeof (key1) != kv_typeof (key2)
+            || strcmp (kv_val_string (key1), kv_val_string (key2)) != 0)
+            return false;
+    }
+    return key1 == key2;
+}
+
 bool kv_equal (const struct kv *kv1, const struct kv *kv2)
 {
     if (!kv1 || !kv2)
         return false;
+    if (kv1->prefix || kv2->prefix)
+        return kv_equal_entries (kv1, kv2);
     if (kv1->len != kv2->len)
         return false;
     if (memcmp (kv1->buf, kv2->buf, kv1->len) != 0)
@@ -94,18 +175,54 @@ bool kv_equal (const struct kv *kv1, const struct kv *kv2)
     return true;
 }
 
-/* Grow kv buffer until it can accommodate 'needsz' new characters.
+/* Grow kv buffer so it can accommodate 'needsz' new characters.
+ * The buffer at least doubles in size (starting from KV_CHUNK) so that
+ * repeated appends cost amortized O(1) reallocations.
  * Returns 0 on success, -1 on failure with errno set.
  */
 static int kv_expand (struct kv *kv, int needsz)
 {
     char *new;
-    while (kv->bufsz - kv->len < needsz) {
-        if (!(new = realloc (kv->buf, kv->bufsz + KV_CHUNK)))
-            return -1;
-        kv->buf = new;
-        kv->bufsz += KV_CHUNK;
+    int size;
+
+    if (kv->bufsz - kv->len >= needsz)
+        return 0;
+    if (needsz > INT_MAX - kv->len) {
+        errno = ENOMEM;
+        return -1;
     }
+    size = kv->bufsz < KV_CHUNK ? KV_CHUNK : kv->bufsz;
+    while (size - kv->len < needsz)
+        size = size > INT_MAX / 2 ? INT_MAX : size * 2;
+    if (!(new = realloc (kv->buf, size)))
+        return -1;
+    kv->buf = new;
+    kv->bufsz = size;
+    return 0;
+}
+
+int kv_reserve (struct kv *kv, int size)
+{
+    char *new;
+
+    if (!kv || size < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (kv->view) {
+        errno = EROFS;
+        return -1;
+    }
+    if (kv->bufsz - kv->len >= size)
+        return 0;
+    if (size > INT_MAX - kv->len) {
+        errno = ENOMEM;
+        return -1;
+    }
+    if (!(new = realloc (kv->buf, kv->len + size)))
+        return -1;
+    kv->buf = new;
+    kv->bufsz = kv->len + size;
     return 0;
 }
 
@@ -116,25 +233,190 @@ static bool valid_key (const char *key)
     return true;
 }
 
+/* FNV-1a hash of NUL-terminated key
+ */
+static unsigned int kv_hash (const char *key)
+{
+    unsigned int h = 2166136261U;
+    while (*key) {
+        h ^= (unsigned char) *key++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+/* Return index slot holding 'key', or the empty slot where it would go.
+ */
+static int kv_index_slot (const struct kv *kv, const struct kv_index *index,
+                          const char *key)
+{
+    int mask = index->size - 1;
+    int i = kv_hash (key) & mask;
+
+    while (index->slot[i] >= 0 && strcmp (kv->buf + index->slot[i], key) != 0)
+        i = (i + 1) & mask;
+    return i;
+}
+
+/* Create an index of 'size' slots containing the entries of 'old', if any.
+ * Returns index on success, NULL on failure.
+ */
+static struct kv_index *kv_index_create (const struct kv *kv,
+                                         const struct kv_index *old,
+                                         int size)
+{
+    struct kv_index *index;
+
+    if (!(index = malloc (sizeof (*index) + size * sizeof (index->slot[0]))))
+        return NULL;
+    memset (index->slot, 0xff, size * sizeof (index->slot[0]));
+    index->size = size;
+    index->count = 0;
+    if (old) {
+        for (int i = 0; i < old->size; i++) {
+            int offset = old->slot[i];
+            if (offset >= 0)
+                index->slot[kv_index_slot (kv, index, kv->buf + offset)] =
+                    offset;
+        }
+        index->count = old->count;
+    }
+    return index;
+}
+
+/* Add entry at 'offset' to *indexp, keeping load factor <= 1/2.
+ * If the key is already indexed, the existing (first) entry is kept
+ * and 1 is returned.  Returns 0 if added, or -1 on failure.
+ */
+static int kv_index_insert (const struct kv *kv, struct kv_index **indexp,
+                            int offset)
+{
+    struct kv_index *index = *indexp;
+    int slot;
+
+    if ((index->count + 1) * 2 > index->size) {
+        if (!(index = kv_index_create (kv, index, index->size * 2)))
+            return -1;
+        free (*indexp);
+        *indexp = index;
+    }
+    slot = kv_index_slot (kv, index, kv->buf + offset);
+    if (index->slot[slot] >= 0)
+        return 1;
+    index->slot[slot] = offset;
+    index->count++;
+    return 0;
+}
+
+/* Remove entry at 'offset' of length 'entry_len' from the index, then
+ * account for the following entries moving down by 'entry_len'.
+ */
+static void kv_index_remove (struct kv *kv, int offset, int entry_len)
+{
+    struct kv_index *index = kv->index;
+    int mask = index->size - 1;
+    int i = kv_index_slot (kv, index, kv->buf + offset);
+    int j = i;
+
+    /* Backward shift deletion keeps probe sequences intact
+     */
+    index->slot[i] = -1;
+    index->count--;
+    for (;;) {
+        int k;
+
+        j = (j + 1) & mask;
+        if (index->slot[j] < 0)
+            break;
+        k = kv_hash (kv->buf + index->slot[j]) & mask;
+        if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+            index->slot[i] = index->slot[j];
+            index->slot[j] = -1;
+            i = j;
+        }
+    }
+    for (i = 0; i < index->size; i++) {
+        if (index->slot[i] > offset)
+            index->slot[i] -= entry_len;
+    }
+}
+
+/* Index all entries of kv and publish the result in kv->index, unless
+ * another thread got there first.  The index is not built if the buffer
+ * (from kv_decode()) contains duplicate keys, since kv_find() must return
+ * the first match and kv_delete() only removes that one.
+ */
+static void kv_index_build (const struct kv *kv)
+{
+    struct kv *kv_mutable = (struct kv *)kv;
+    struct kv_index *index;
+    struct kv_index *expected = NULL;
+    const char *entry = NULL;
+    int size = 64;
+    int n = 0;
+
+    while ((entry = kv_next (kv, entry)))
+        n++;
+    while (size < n * 2)
+        size *= 2;
+    if (!(index = kv_index_create (kv, NULL, size)))
+        return;
+    while ((entry = kv_next (kv, entry))) {
+        int rc = kv_index_insert (kv, &index, entry - kv->buf);
+        if (rc != 0) {
+            if (rc > 0)
+                __atomic_store_n (&kv_mutable->index_disabled,
+                                  true,
+                                  __ATOMIC_RELAXED);
+            free (index);
+            return;
+        }
+    }
+    if (!__atomic_compare_exchange_n (&kv_mutable->index,
+                                      &expected,
+                                      index,
+                                      false,
+                                      __ATOMIC_RELEASE,
+                                      __ATOMIC_RELAXED))
+        free (index);
+}
+
 /* Look up entry by key (and type if type != KV_UNKNOWN).
  * Returns entry on success, NULL on failure with errno set.
  */
 static const char *kv_find (const struct kv *kv, const char *key,
                             enum kv_type type)
 {
+    const struct kv_index *index;
     const char *entry = NULL;
+    int count = 0;
 
     if (!kv || !valid_key (key)) {
         errno = EINVAL;
         return NULL;
     }
-    while ((entry = kv_next (kv, entry))) {
-        if (!strcmp (key, entry)) {
+    if ((index = __atomic_load_n (&kv->index, __ATOMIC_ACQUIRE))) {
+        int slot = kv_index_slot (kv, index, key);
+        if (index->slot[slot] >= 0) {
+            entry = kv->buf + index->slot[slot];
             if (type == KV_UNKNOWN || kv_typeof (entry) == type)
                 return entry;
-            break;
         }
+        errno = ENOENT;
+        return NULL;
+    }
+    while ((entry = kv_next (kv, entry))) {
+        count++;
+        if (!strcmp (key, entry))
+            break;
     }
+    /* The index is a cache, so it may be built for a const kv.
+     */
+    if (count >= KV_INDEX_MIN
+        && !__atomic_load_n (&kv->index_disabled, __ATOMIC_RELAXED))
+        kv_index_build (kv);
+    if (entry && (type == KV_UNKNOWN || kv_typeof (entry) == type))
+        return entry;
     errno = ENOENT;
     return NULL;
 }
@@ -164,6 +446,10 @@ int kv_delete (struct kv *kv, const char *key)
     int entry_offset;
     int entry_len;
 
+    if (kv && kv->view) {
+        errno = EROFS;
+        return -1;
+    }
     if (!(entry = kv_find (kv, key, KV_UNKNOWN)))
         return -1;
     entry_offset = entry - kv->buf;
@@ -172,6 +458,8 @@ int kv_delete (struct kv *kv, const char *key)
         errno = EINVAL;
         return -1;
     }
+    if (kv->index)
+        kv_index_remove (kv, entry_offset, entry_len);
     memmove (kv->buf + entry_offset,
              kv->buf + entry_offset + entry_len,
              kv->len - entry_offset - entry_len);
@@ -189,12 +477,17 @@ static int kv_put_raw (struct kv *kv, const char *key, enum kv_type type,
         errno = EINVAL;
         return -1;
     }
+    if (kv->view) {
+        errno = EROFS;
+        return -1;
+    }
     if (kv_delete (kv, key) < 0) {
         if (errno != ENOENT)
             return -1;
     }
     int keylen = strlen (key);
     int vallen = strlen (val);
+    int offset = kv->len;
     if (kv_expand (kv, keylen + vallen + 3) < 0) // key\0Tval\0
         return -1;
     assert (kv->buf != NULL);
@@ -203,6 +496,8 @@ static int kv_put_raw (struct kv *kv, const char *key, enum kv_type type,
     kv->buf[kv->len++] = type;
     strlcpy (&kv->buf[kv->len], val, vallen + 1);
     kv->len += vallen + 1;
+    if (kv->index && kv_index_insert (kv, &kv->index, offset) < 0)
+        kv_index_drop (kv);
     return 0;
 }
 
@@ -261,22 +556,42 @@ int kv_put (struct kv *kv, const char *key, enum kv_type type, ...)
     return rc;
 }
 
-const char *kv_next (const struct kv *kv, const char *key)
+/* Return the entry following 'entry' in the encoded buffer, or the
+ * first entry if 'entry' is NULL, ignoring any view prefix.
+ */
+static const char *kv_next_entry (const struct kv *kv, const char *entry)
 {
     int entry_len;
     int entry_offset;
 
-    if (!kv || kv->len == 0)
+    if (kv->len == 0)
         return NULL;
-    if (!key)
+    if (!entry)
         return kv->buf;
-    if (key < kv->buf || key > kv->buf + kv->len)
+    if (entry < kv->buf || entry > kv->buf + kv->len)
         return NULL;
-    entry_offset = key - kv->buf;
-    entry_len = entry_length (key, kv->len - entry_offset);
+    entry_offset = entry - kv->buf;
+    entry_len = entry_length (entry, kv->len - entry_offset);
     if (entry_len < 0 || entry_offset + entry_len == kv->len)
         return NULL;
-    return key + entry_len;
+    return entry + entry_len;
+}
+
+const char *kv_next (const struct kv *kv, const char *key)
+{
+    const char *entry;
+
+    if (!kv)
+        return NULL;
+    if (!kv->prefix)
+        return kv_next_entry (kv, key);
+    entry = key ? key - kv->prefixlen : NULL;
+    while ((entry = kv_next_entry (kv, entry))) {
+        if (strlen (entry) > kv->prefixlen
+            && !strncmp (entry, kv->prefix, kv->prefixlen))
+            return entry + kv->prefixlen;
+    }
+    return NULL;
 }
 
 const char *kv_val_string (const char *key)
@@ -455,7 +770,7 @@ inval:
 
 int kv_encode (const struct kv *kv, const char **buf, int *len)
 {
-    if (!kv || !buf || !len) {
+    if (!kv || !buf || !len || kv->prefix) {
         errno = EINVAL;
         return -1;
     }
@@ -477,6 +792,57 @@ struct kv *kv_decode (const char *buf, int len)
     return kv;
 }
 
+struct kv *kv_view (const char *buf, int len)
+{
+    struct kv *kv;
+
+    if (len < 0 || (len > 0 && !buf)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(kv = calloc (1, sizeof (*kv))))
+        return NULL;
+    kv->buf = (char *) buf;
+    kv->bufsz = kv->len = len;
+    kv->view = true;
+    if (kv_check_integrity (kv) < 0) {
+        kv_destroy (kv);
+        return NULL;
+    }
+    return kv;
+}
+
+struct kv *kv_view_prefix (const struct kv *kv, const char *prefix)
+{
+    struct kv *view;
+
+    if (!kv) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(view = calloc (1, sizeof (*view))))
+        return NULL;
+    view->buf = kv->buf;
+    view->bufsz = view->len = kv->len;
+    view->view = true;
+
+    /* A view of a prefix view is a view of the underlying buffer with
+     * the prefixes concatenated.
+     */
+    if (kv->prefix || (prefix && *prefix != '\0')) {
+        if (asprintf (&view->prefix,
+                      "%s%s",
+                      kv->prefix ? kv->prefix : "",
+                      prefix ? prefix : "") < 0) {
+            view->prefix = NULL;
+            kv_destroy (view);
+            return NULL;
+        }
+        view->prefixlen = strlen (view->prefix);
+    }
+    return view;
+}
+
 /* Wrapper for kv_put_raw() which adds 'prefix' to key, if non-NULL.
  * Returns 0 on success, -1 on failure with errno set (ENOMEM).
  */
@@ -504,6 +870,21 @@ int kv_join (struct kv *kv1, const struct kv *kv2, const char *prefix)
 {
     const char *key = NULL;
 
+    /* Presize kv1 for all of kv2 (plus prefixes) so the join needs at
+     * most one reallocation. Existing keys replaced by the join only
+     * make this an overestimate.
+     */
+    if (kv1 && kv2) {
+        int needsz = kv2->len;
+        if (prefix) {
+            int prefixlen = strlen (prefix);
+            while ((key = kv_next (kv2, key)))
+                needsz += prefixlen;
+        }
+        if (kv_reserve (kv1, needsz) < 0)
+            return -1;
+    }
+
     while ((key = kv_next (kv2, key))) {
         if (kv_put_prefix (kv1, prefix, key, kv_typeof (key),
                                              kv_val_string (key)) < 0)
@@ -521,7 +902,7 @@ struct kv *kv_split (const struct kv *kv1, const char *prefix)
     if (!(kv2 = kv_create ()))
         return NULL;
     while ((key = kv_next (kv1, key))) {
-        if (strlen (key) > n && !strncmp (key, prefix, n)) {
+        if (strlen (key) > n && (n == 0 || !strncmp (key, prefix, n))) {
             if (kv_put_raw (kv2, key + n, kv_typeof (key),
                                           kv_val_string (key)) < 0) {
                 kv_destroy (kv2);
@@ -612,11 +993,22 @@ error:
 struct kv *kv_encode_argv (const char **argv)
 {
     struct kv * kv;
+    int size = 0;
     if (!argv) {
         errno = EINVAL;
         return NULL;
     }
-    if (!(kv = kv_create ()))
+    /* key\0Tval\0 with key at most 20 digits
+     */
+    for (int i = 0; argv[i] != NULL; i++) {
+        int len = strlen (argv[i]);
+        if (len > INT_MAX - size - 23) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        size += len + 23;
+    }
+    if (!(kv = kv_create_sized (size)))
         return NULL;
     for (int i = 0; argv[i] != NULL; i++) {
         char key [21];
@@ -38,6 +38,31 @@ struct kv *kv_create (void);
 void kv_destroy (struct kv *kv);
 struct kv *kv_copy (const struct kv *kv);
 
+/* Create kv object with room for 'size' bytes of encoded entries.
+ */
+struct kv *kv_create_sized (int size);
+
+/* Ensure kv can grow by 'size' bytes of encoded entries without
+ * reallocation.  An entry needs strlen (key) + strlen (val) + 3 bytes.
+ */
+int kv_reserve (struct kv *kv, int size);
+
+/* Create a read-only kv object that refers to 'buf' without copying it.
+ * The buffer is validated as in kv_decode(), and must remain valid and
+ * unchanged for the life of the view.  kv_put() and kv_delete() on a
+ * view fail with EROFS.
+ * Return kv object on success, NULL on failure with errno set.
+ */
+struct kv *kv_view (const char *buf, int len);
+
+/* Create a read-only kv object that refers to entries in kv with matching
+ * key prefix, with the prefix removed, like kv_split() but without copying.
+ * kv must not be modified or destroyed while the view exists.
+ * kv_encode() is not supported on a view created with a non-empty prefix.
+ * Return kv object on success, NULL on failure with errno set.
+ */
+struct kv *kv_view_prefix (const struct kv *kv, const char *prefix);
+
 /* Add kv2 entries to kv1, prepending 'prefix' to its keys (if non-NULL).
  * When there are key conflicts, values from kv2 override kv1.
  * Return 0 on success, -1 on failure with errno set.
@@ -10,12 +10,42 @@
               Algorithm specification can be found here:
                * http://csrc.nist.gov/publications/fips/fips180-2/fips180-2withchangenotice.pdf
               This implementation uses little endian byte order.
+
+              The block function may be replaced at runtime by one using
+              the x86 SHA extensions (SHA-NI) or the ARMv8 cryptography
+              extensions, when the CPU supports them.
 *********************************************************************/
 
 /*************************** HEADER FILES ***************************/
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
 #include <stdlib.h>
-#include <memory.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
 #include "sha256.h"
+#include "macros.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_SHANI_KERNEL 1
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
+
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__linux__) \
+	&& (defined(__ARM_FEATURE_SHA2) || !defined(__clang__))
+#define HAVE_ARMV8_KERNEL 1
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#if defined(__ARM_FEATURE_SHA2)
+#define ARMV8_TARGET
+#else
+#define ARMV8_TARGET __attribute__((target("+crypto")))
+#endif
+#endif
 
 /****************************** MACROS ******************************/
 #define ROTLEFT(a,b) (((a) << (b)) | ((a) >> (32-(b))))
@@ -28,6 +58,14 @@
 #define SIG0(x) (ROTRIGHT(x,7) ^ ROTRIGHT(x,18) ^ ((x) >> 3))
 #define SIG1(x) (ROTRIGHT(x,17) ^ ROTRIGHT(x,19) ^ ((x) >> 10))
 
+/**************************** DATA TYPES ****************************/
+// Process 'nblocks' consecutive 64 byte blocks of 'data' into 'state'.
+struct sha256_impl {
+	const char *name;
+	bool (*supported)(void);
+	void (*blocks)(WORD state[8], const BYTE data[], size_t nblocks);
+};
+
 /**************************** VARIABLES *****************************/
 static const WORD k[64] = {
 	0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
@@ -41,45 +79,214 @@ static const WORD k[64] = {
 };
 
 /*********************** FUNCTION DEFINITIONS ***********************/
-void sha256_transform(SHA256_CTX *ctx, const BYTE data[])
+static bool generic_supported(void)
+{
+	return true;
+}
+
+static void generic_blocks(WORD state[8], const BYTE data[], size_t nblocks)
 {
 	WORD a, b, c, d, e, f, g, h, i, j, t1, t2, m[64];
 
-	for (i = 0, j = 0; i < 16; ++i, j += 4)
-		m[i] = (data[j] << 24) | (data[j + 1] << 16) | (data[j + 2] << 8) | (data[j + 3]);
-	for ( ; i < 64; ++i)
-		m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
-
-	a = ctx->state[0];
-	b = ctx->state[1];
-	c = ctx->state[2];
-	d = ctx->state[3];
-	e = ctx->state[4];
-	f = ctx->state[5];
-	g = ctx->state[6];
-	h = ctx->state[7];
-
-	for (i = 0; i < 64; ++i) {
-		t1 = h + EP1(e) + CH(e,f,g) + k[i] + m[i];
-		t2 = EP0(a) + MAJ(a,b,c);
-		h = g;
-		g = f;
-		f = e;
-		e = d + t1;
-		d = c;
-		c = b;
-		b = a;
-		a = t1 + t2;
+	for ( ; nblocks > 0; nblocks--, data += 64) {
+		for (i = 0, j = 0; i < 16; ++i, j += 4)
+			m[i] = ((WORD)data[j] << 24) | ((WORD)data[j + 1] << 16) | ((WORD)data[j + 2] << 8) | ((WORD)data[j + 3]);
+		for ( ; i < 64; ++i)
+			m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
+
+		a = state[0];
+		b = state[1];
+		c = state[2];
+		d = state[3];
+		e = state[4];
+		f = state[5];
+		g = state[6];
+		h = state[7];
+
+		for (i = 0; i < 64; ++i) {
+			t1 = h + EP1(e) + CH(e,f,g) + k[i] + m[i];
+			t2 = EP0(a) + MAJ(a,b,c);
+			h = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+		state[5] += f;
+		state[6] += g;
+		state[7] += h;
+	}
+}
+
+#if HAVE_SHANI_KERNEL
+static bool shani_supported(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)
+	    || !(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1))
+		return false;
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return false;
+	return (ebx & bit_SHA) != 0;
+}
+
+// Each sha256rnds2 performs two rounds, with the state split into ABEF and
+// CDGH halves.  Message words for rounds 16-63 are computed four at a time
+// from the previous 16 with sha256msg1 and sha256msg2, kept in m[], which
+// holds words 4g-16 to 4g-1 at the start of group g.
+__attribute__((target("sha,sse4.1,ssse3")))
+static void shani_blocks(WORD state[8], const BYTE data[], size_t nblocks)
+{
+	const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i state0, state1, abef, cdgh, tmp, m[4];
+	int g;
+
+	tmp = _mm_loadu_si128((const __m128i *)&state[0]);     // ABCD
+	state1 = _mm_loadu_si128((const __m128i *)&state[4]);  // EFGH
+	tmp = _mm_shuffle_epi32(tmp, 0xB1);                     // CDAB
+	state1 = _mm_shuffle_epi32(state1, 0x1B);               // EFGH
+	state0 = _mm_alignr_epi8(tmp, state1, 8);               // ABEF
+	state1 = _mm_blend_epi16(state1, tmp, 0xF0);            // CDGH
+
+	for ( ; nblocks > 0; nblocks--, data += 64) {
+		abef = state0;
+		cdgh = state1;
+		for (g = 0; g < 4; g++)
+			m[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + g * 16)), bswap);
+		for (g = 0; g < 16; g++) {
+			if (g >= 4) {
+				tmp = _mm_sha256msg1_epu32(m[g & 3], m[(g + 1) & 3]);
+				tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(m[(g + 3) & 3], m[(g + 2) & 3], 4));
+				m[g & 3] = _mm_sha256msg2_epu32(tmp, m[(g + 3) & 3]);
+			}
+			tmp = _mm_add_epi32(m[g & 3], _mm_loadu_si128((const __m128i *)&k[g * 4]));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, tmp);
+			tmp = _mm_shuffle_epi32(tmp, 0x0E);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, tmp);
+		}
+		state0 = _mm_add_epi32(state0, abef);
+		state1 = _mm_add_epi32(state1, cdgh);
 	}
 
-	ctx->state[0] += a;
-	ctx->state[1] += b;
-	ctx->state[2] += c;
-	ctx->state[3] += d;
-	ctx->state[4] += e;
-	ctx->state[5] += f;
-	ctx->state[6] += g;
-	ctx->state[7] += h;
+	tmp = _mm_shuffle_epi32(state0, 0x1B);                  // FEBA
+	state1 = _mm_shuffle_epi32(state1, 0xB1);               // DCHG
+	state0 = _mm_blend_epi16(tmp, state1, 0xF0);            // DCBA
+	state1 = _mm_alignr_epi8(state1, tmp, 8);               // ABEF
+	_mm_storeu_si128((__m128i *)&state[0], state0);
+	_mm_storeu_si128((__m128i *)&state[4], state1);
+}
+#endif
+
+#if HAVE_ARMV8_KERNEL
+static bool armv8_supported(void)
+{
+	return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+}
+
+// Each sha256h/sha256h2 pair performs four rounds.  Message words are
+// scheduled as for shani_blocks(), with sha256su0 and sha256su1.
+ARMV8_TARGET
+static void armv8_blocks(WORD state[8], const BYTE data[], size_t nblocks)
+{
+	uint32x4_t state0, state1, save0, save1, prev, tmp, m[4];
+	int g;
+
+	state0 = vld1q_u32(&state[0]);
+	state1 = vld1q_u32(&state[4]);
+
+	for ( ; nblocks > 0; nblocks--, data += 64) {
+		save0 = state0;
+		save1 = state1;
+		for (g = 0; g < 4; g++)
+			m[g] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + g * 16)));
+		for (g = 0; g < 16; g++) {
+			if (g >= 4) {
+				tmp = vsha256su0q_u32(m[g & 3], m[(g + 1) & 3]);
+				m[g & 3] = vsha256su1q_u32(tmp, m[(g + 2) & 3], m[(g + 3) & 3]);
+			}
+			tmp = vaddq_u32(m[g & 3], vld1q_u32(&k[g * 4]));
+			prev = state0;
+			state0 = vsha256hq_u32(state0, state1, tmp);
+			state1 = vsha256h2q_u32(state1, prev, tmp);
+		}
+		state0 = vaddq_u32(state0, save0);
+		state1 = vaddq_u32(state1, save1);
+	}
+
+	vst1q_u32(&state[0], state0);
+	vst1q_u32(&state[4], state1);
+}
+#endif
+
+// In order of preference.
+static const struct sha256_impl impls[] = {
+#if HAVE_SHANI_KERNEL
+	{ "shani", shani_supported, shani_blocks },
+#endif
+#if HAVE_ARMV8_KERNEL
+	{ "armv8", armv8_supported, armv8_blocks },
+#endif
+	{ "generic", generic_supported, generic_blocks },
+};
+
+static const struct sha256_impl *current_impl;
+
+static const struct sha256_impl *best_impl(void)
+{
+	const struct sha256_impl *impl;
+
+	for (impl = &impls[0]; !impl->supported(); impl++)
+		;
+	return impl;
+}
+
+static const struct sha256_impl *get_impl(void)
+{
+	const struct sha256_impl *impl;
+
+	if (!(impl = __atomic_load_n(&current_impl, __ATOMIC_ACQUIRE))) {
+		impl = best_impl();
+		__atomic_store_n(&current_impl, impl, __ATOMIC_RELEASE);
+	}
+	return impl;
+}
+
+int sha256_select(const char *name)
+{
+	const struct sha256_impl *impl = NULL;
+
+	if (!name)
+		impl = best_impl();
+	else {
+		for (size_t i = 0; i < ARRAY_SIZE(impls); i++) {
+			if (streq(impls[i].name, name))
+				impl = &impls[i];
+		}
+		if (!impl) {
+			// Kernel is not built for this architecture.
+			if (streq(name, "shani") || streq(name, "armv8"))
+				errno = ENOTSUP;
+			else
+				errno = ENOENT;
+			return -1;
+		}
+		if (!impl->supported()) {
+			errno = ENOTSUP;
+			return -1;
+		}
+	}
+	__atomic_store_n(&current_impl, impl, __ATOMIC_RELEASE);
+	return 0;
 }
 
 void sha256_init(SHA256_CTX *ctx)
@@ -98,21 +305,40 @@ void sha256_init(SHA256_CTX *ctx)
 
 void sha256_update(SHA256_CTX *ctx, const BYTE data[], size_t len)
 {
-	WORD i;
+	const struct sha256_impl *impl = get_impl();
+	size_t n;
 
-	for (i = 0; i < len; ++i) {
-		ctx->data[ctx->datalen] = data[i];
-		ctx->datalen++;
-		if (ctx->datalen == 64) {
-			sha256_transform(ctx, ctx->data);
-			ctx->bitlen += 512;
-			ctx->datalen = 0;
-		}
+	// Complete a partial block left by a previous update.
+	if (ctx->datalen > 0 && len > 0) {
+		n = 64 - ctx->datalen;
+		if (n > len)
+			n = len;
+		memcpy(ctx->data + ctx->datalen, data, n);
+		ctx->datalen += n;
+		data += n;
+		len -= n;
+		if (ctx->datalen < 64)
+			return;
+		impl->blocks(ctx->state, ctx->data, 1);
+		ctx->bitlen += 512;
+		ctx->datalen = 0;
+	}
+	// Hash whole blocks in place, and save the remainder.
+	if ((n = len / 64) > 0) {
+		impl->blocks(ctx->state, data, n);
+		ctx->bitlen += (unsigned long long)n * 512;
+		data += n * 64;
+		len -= n * 64;
+	}
+	if (len > 0) {
+		memcpy(ctx->data, data, len);
+		ctx->datalen = len;
 	}
 }
 
 void sha256_final(SHA256_CTX *ctx, BYTE hash[])
 {
+	const struct sha256_impl *impl = get_impl();
 	WORD i;
 
 	i = ctx->datalen;
@@ -127,7 +353,7 @@ void sha256_final(SHA256_CTX *ctx, BYTE hash[])
 		ctx->data[i++] = 0x80;
 		while (i < 64)
 			ctx->data[i++] = 0x00;
-		sha256_transform(ctx, ctx->data);
+		impl->blocks(ctx->state, ctx->data, 1);
 		memset(ctx->data, 0, 56);
 	}
 
@@ -141,7 +367,7 @@ void sha256_final(SHA256_CTX *ctx, BYTE hash[])
 	ctx->data[58] = ctx->bitlen >> 40;
 	ctx->data[57] = ctx->bitlen >> 48;
 	ctx->data[56] = ctx->bitlen >> 56;
-	sha256_transform(ctx, ctx->data);
+	impl->blocks(ctx->state, ctx->data, 1);
 
 	// Since this implementation uses little endian byte ordering and SHA uses big endian,
 	// reverse all the bytes when copying the final state to the output hash.
@@ -31,4 +31,12 @@ void sha256_init(SHA256_CTX *ctx);
 void sha256_update(SHA256_CTX *ctx, const BYTE data[], size_t len);
 void sha256_final(SHA256_CTX *ctx, BYTE hash[]);
 
+// Use the named implementation ("generic", "shani", or "armv8"), or if
+// 'name' is NULL, the fastest one supported by the CPU (the default).
+// This is intended for testing and benchmarking.
+// Returns 0 on success, -1 on failure with errno set:
+//   ENOENT - unknown implementation
+//   ENOTSUP - implementation is not supported by this CPU or build
+int sha256_select(const char *name);
+
 #endif   // SHA256_H
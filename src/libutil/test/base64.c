@@ -0,0 +1,301 @@
+/************************************************************\
+ * Copyright 2026 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "src/libtap/tap.h"
+#include "src/libutil/base64.h"
+
+static const char *impls[] = { "scalar", "ssse3", "avx2" };
+
+/* RFC 4648 section 10 test vectors
+ */
+static const struct {
+    const char *dec;
+    const char *enc;
+} vectors[] = {
+    { "", "" },
+    { "f", "Zg==" },
+    { "fo", "Zm8=" },
+    { "foo", "Zm9v" },
+    { "foob", "Zm9vYg==" },
+    { "fooba", "Zm9vYmE=" },
+    { "foobar", "Zm9vYmFy" },
+};
+
+static const int nvectors = sizeof (vectors) / sizeof (vectors[0]);
+
+#define MAXLEN 1024
+
+static uint8_t data[MAXLEN];
+
+/* Encoding of data[0:len] by the scalar implementation,
+ * used as the reference for the others.
+ */
+static char *ref[MAXLEN + 1];
+
+static void make_ref (void)
+{
+    if (base64_select ("scalar") < 0)
+        BAIL_OUT ("base64_select scalar failed");
+    for (int i = 0; i < MAXLEN; i++)
+        data[i] = random ();
+    for (int len = 0; len <= MAXLEN; len++) {
+        size_t sz = base64_encode_length (len);
+        if (!(ref[len] = malloc (sz))
+            || base64_encode (ref[len], sz, data, len) < 0)
+            BAIL_OUT ("failed to encode reference data");
+    }
+}
+
+static void free_ref (void)
+{
+    for (int len = 0; len <= MAXLEN; len++)
+        free (ref[len]);
+}
+
+void test_vectors (const char *name)
+{
+    char enc[16];
+    char dec[16];
+    size_t declen;
+    bool good = true;
+
+    for (int i = 0; i < nvectors; i++) {
+        size_t len = strlen (vectors[i].dec);
+        if (base64_encode (enc, sizeof (enc), vectors[i].dec, len) < 0
+            || strcmp (enc, vectors[i].enc) != 0) {
+            diag ("encode %s: got %s", vectors[i].dec, enc);
+            good = false;
+        }
+        if (base64_decode (dec, sizeof (dec), vectors[i].enc,
+                           strlen (vectors[i].enc), &declen) < 0
+            || declen != len
+            || memcmp (dec, vectors[i].dec, len) != 0) {
+            diag ("decode %s failed", vectors[i].enc);
+            good = false;
+        }
+    }
+    ok (good,
+        "%s: RFC 4648 test vectors work", name);
+}
+
+/* Encode and decode every length up to MAXLEN, with output buffers
+ * that are exactly the required size, and compare with the reference.
+ */
+void test_roundtrip (const char *name)
+{
+    bool good = true;
+
+    for (int len = 0; len <= MAXLEN && good; len++) {
+        size_t encsz = base64_encode_length (len);
+        size_t reflen = strlen (ref[len]);
+        char *enc = malloc (encsz);
+        uint8_t *dec = malloc (len + 1);
+        size_t declen;
+
+        if (!enc || !dec)
+            BAIL_OUT ("out of memory");
+        if (base64_encode (enc, encsz, data, len) < 0
+            || strcmp (enc, ref[len]) != 0) {
+            diag ("encode len=%d differs from reference", len);
+            good = false;
+        }
+        else if (base64_decode (dec, len, enc, reflen, &declen) < 0
+                 || declen != len
+                 || memcmp (dec, data, len) != 0) {
+            diag ("decode len=%d failed", len);
+            good = false;
+        }
+        free (enc);
+        free (dec);
+    }
+    ok (good,
+        "%s: encode matches reference and decodes for length 0-%d",
+        name, MAXLEN);
+}
+
+/* Replace each character of a long encoding in turn with every byte
+ * value, and check that decoding fails unless the byte is in the base64
+ * alphabet, and that otherwise the result matches the scalar decoder.
+ */
+void test_invalid_chars (const char *name)
+{
+    const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                           "abcdefghijklmnopqrstuvwxyz0123456789+/";
+    const int len = 288;
+    size_t enclen = strlen (ref[len]);
+    char *enc = strdup (ref[len]);
+    uint8_t dec[len];
+    uint8_t expect[len];
+    size_t declen;
+    bool good = true;
+
+    if (!enc)
+        BAIL_OUT ("out of memory");
+    for (int pos = 0; pos < enclen && good; pos++) {
+        for (int c = 0; c < 256 && good; c++) {
+            bool valid = c != 0 && strchr (alphabet, c) != NULL;
+            int rc;
+
+            enc[pos] = c;
+            errno = 0;
+            rc = base64_decode (dec, len, enc, enclen, &declen);
+            if (!valid && (rc == 0 || errno != EINVAL)) {
+                diag ("pos=%d char=0x%x was accepted", pos, c);
+                good = false;
+            }
+            else if (valid) {
+                if (base64_select ("scalar") < 0
+                    || base64_decode (expect, len, enc, enclen, NULL) < 0
+                    || base64_select (name) < 0)
+                    BAIL_OUT ("scalar decode failed");
+                if (rc < 0 || declen != len || memcmp (dec, expect, len)) {
+                    diag ("pos=%d char=%c decoded incorrectly", pos, c);
+                    good = false;
+                }
+            }
+        }
+        enc[pos] = ref[len][pos];
+    }
+    free (enc);
+    ok (good,
+        "%s: every invalid character is detected at every position", name);
+}
+
+void test_padding (const char *name)
+{
+    uint8_t dec[16];
+    size_t declen;
+
+    /* Padding
+     */
+    errno = 0;
+    ok (base64_decode (dec, sizeof (dec), "Zg", 2, &declen) < 0
+        && errno == EINVAL,
+        "%s: missing padding fails with EINVAL", name);
+    errno = 0;
+    ok (base64_decode (dec, sizeof (dec), "Zg=", 3, &declen) < 0
+        && errno == EINVAL,
+        "%s: short padding fails with EINVAL", name);
+    errno = 0;
+    ok (base64_decode (dec, sizeof (dec), "Zm9v=", 5, &declen) < 0
+        && errno == EINVAL,
+        "%s: extra padding fails with EINVAL", name);
+    errno = 0;
+    ok (base64_decode (dec, sizeof (dec), "Zg==Zg==", 8, &declen) < 0
+        && errno == EINVAL,
+        "%s: padding before end fails with EINVAL", name);
+    errno = 0;
+    ok (base64_decode (dec, sizeof (dec), "Z===", 4, &declen) < 0
+        && errno == EINVAL,
+        "%s: three padding characters fails with EINVAL", name);
+    errno = 0;
+    ok (base64_decode (dec, sizeof (dec), "====", 4, &declen) < 0
+        && errno == EINVAL,
+        "%s: only padding fails with EINVAL", name);
+    errno = 0;
+    ok (base64_decode (dec, sizeof (dec), "Zm=v", 4, &declen) < 0
+        && errno == EINVAL,
+        "%s: padding within group fails with EINVAL", name);
+
+    /* Non-zero unused bits
+     */
+    errno = 0;
+    ok (base64_decode (dec, sizeof (dec), "Zh==", 4, &declen) < 0
+        && errno == EINVAL,
+        "%s: non-zero trailing bits with 2 padding fails with EINVAL", name);
+    errno = 0;
+    ok (base64_decode (dec, sizeof (dec), "Zm9=", 4, &declen) < 0
+        && errno == EINVAL,
+        "%s: non-zero trailing bits with 1 padding fails with EINVAL", name);
+}
+
+void test_corner (void)
+{
+    char enc[16];
+    uint8_t dec[16];
+    size_t declen;
+
+    errno = 0;
+    ok (base64_select ("foo") < 0 && errno == ENOENT,
+        "base64_select name=foo fails with ENOENT");
+    ok (base64_select (NULL) == 0,
+        "base64_select name=NULL works");
+
+    ok (base64_encode_length (0) == 1
+        && base64_encode_length (1) == 5
+        && base64_encode_length (3) == 5
+        && base64_encode_length (4) == 9,
+        "base64_encode_length works");
+    ok (base64_decode_length (0) == 0
+        && base64_decode_length (4) == 3
+        && base64_decode_length (5) == 6,
+        "base64_decode_length works");
+
+    errno = 0;
+    ok (base64_encode (enc, 4, "f", 1) < 0 && errno == EINVAL,
+        "base64_encode fails with EINVAL when dst is too small");
+    errno = 0;
+    ok (base64_encode (NULL, sizeof (enc), "f", 1) < 0 && errno == EINVAL,
+        "base64_encode dst=NULL fails with EINVAL");
+    errno = 0;
+    ok (base64_encode (enc, sizeof (enc), NULL, 1) < 0 && errno == EINVAL,
+        "base64_encode src=NULL fails with EINVAL");
+    ok (base64_encode (enc, sizeof (enc), NULL, 0) == 0 && enc[0] == '\0',
+        "base64_encode src=NULL srclen=0 works");
+
+    errno = 0;
+    ok (base64_decode (dec, 2, "Zm9v", 4, &declen) < 0 && errno == ERANGE,
+        "base64_decode fails with ERANGE when dst is too small");
+    ok (base64_decode (dec, 3, "Zm9v", 4, NULL) == 0,
+        "base64_decode dstlen=NULL works");
+    ok (base64_decode (NULL, 0, NULL, 0, &declen) == 0 && declen == 0,
+        "base64_decode of empty input works");
+    errno = 0;
+    ok (base64_decode (dec, sizeof (dec), NULL, 4, &declen) < 0
+        && errno == EINVAL,
+        "base64_decode src=NULL fails with EINVAL");
+    errno = 0;
+    ok (base64_decode (NULL, 3, "Zm9v", 4, &declen) < 0 && errno == EINVAL,
+        "base64_decode dst=NULL fails with EINVAL");
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    make_ref ();
+    for (int i = 0; i < sizeof (impls) / sizeof (impls[0]); i++) {
+        if (base64_select (impls[i]) < 0) {
+            diag ("%s: %s", impls[i], strerror (errno));
+            continue;
+        }
+        test_vectors (impls[i]);
+        test_roundtrip (impls[i]);
+        test_invalid_chars (impls[i]);
+        test_padding (impls[i]);
+    }
+    test_corner ();
+    free_ref ();
+
+    done_testing ();
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -17,6 +17,7 @@
 #include <string.h>
 #include <limits.h>
 #include <errno.h>
+#include <pthread.h>
 #include <float.h>
 #include <math.h>
 
@@ -451,6 +452,369 @@ static void check_expansion (void)
     kv_destroy (kv);
 }
 
+/* Apply random puts, updates and deletes to a kv large enough to be
+ * indexed, checking lookups and the encoded buffer against a simple
+ * model that keeps entries in encoding order.
+ */
+#define MODEL_KEYS 200
+static void indexed_ops (void)
+{
+    struct kv *kv;
+    int order[MODEL_KEYS];  // key numbers in encoding order
+    int vals[MODEL_KEYS];   // current value per key number, -1 if absent
+    int count = 0;
+    int errors = 0;
+    char key[32];
+    char expected[MODEL_KEYS * 32];
+    const char *buf;
+    int len;
+    int explen;
+    int64_t val;
+
+    if (!(kv = kv_create ()))
+        BAIL_OUT ("kv_create failed");
+    for (int i = 0; i < MODEL_KEYS; i++)
+        vals[i] = -1;
+
+    srand (1);
+    for (int iter = 0; iter < 5000; iter++) {
+        int k = rand () % MODEL_KEYS;
+        int op = rand () % 3;
+
+        snprintf (key, sizeof (key), "k%d", k);
+        if (op < 2) {
+            if (kv_put (kv, key, KV_INT64, (int64_t) iter) < 0)
+                errors++;
+            if (vals[k] >= 0) {
+                int j = 0;
+                while (order[j] != k)
+                    j++;
+                memmove (&order[j], &order[j + 1], (count - j - 1) * sizeof (int));
+                count--;
+            }
+            order[count++] = k;
+            vals[k] = iter;
+        }
+        else {
+            int rc = kv_delete (kv, key);
+            if (vals[k] >= 0) {
+                int j = 0;
+                if (rc < 0)
+                    errors++;
+                while (order[j] != k)
+                    j++;
+                memmove (&order[j], &order[j + 1], (count - j - 1) * sizeof (int));
+                count--;
+                vals[k] = -1;
+            }
+            else if (rc == 0 || errno != ENOENT)
+                errors++;
+        }
+        k = rand () % MODEL_KEYS;
+        snprintf (key, sizeof (key), "k%d", k);
+        if (vals[k] >= 0) {
+            if (kv_get (kv, key, KV_INT64, &val) < 0 || val != vals[k])
+                errors++;
+            if (kv_get (kv, key, KV_STRING, NULL) == 0)
+                errors++;
+        }
+        else if (kv_get (kv, key, KV_INT64, &val) == 0 || errno != ENOENT)
+            errors++;
+    }
+    ok (errors == 0,
+        "kv_put/kv_get/kv_delete agree with model");
+
+    explen = 0;
+    for (int i = 0; i < count; i++) {
+        explen += sprintf (&expected[explen], "k%d", order[i]) + 1;
+        expected[explen++] = KV_INT64;
+        explen += sprintf (&expected[explen], "%d", vals[order[i]]) + 1;
+    }
+    ok (kv_encode (kv, &buf, &len) == 0
+        && len == explen
+        && memcmp (buf, expected, len) == 0,
+        "encoded buffer matches unindexed format");
+    kv_destroy (kv);
+}
+
+static void reserve (void)
+{
+    struct kv *kv1, *kv2;
+    char key[32];
+    bool same = true;
+
+    errno = 0;
+    ok (kv_create_sized (-1) == NULL && errno == EINVAL,
+        "kv_create_sized size=-1 fails with EINVAL");
+    errno = 0;
+    ok (kv_reserve (NULL, 1) < 0 && errno == EINVAL,
+        "kv_reserve kv=NULL fails with EINVAL");
+
+    if (!(kv1 = kv_create ()))
+        BAIL_OUT ("kv_create failed");
+    ok ((kv2 = kv_create_sized (100000)) != NULL,
+        "kv_create_sized 100000 works");
+    errno = 0;
+    ok (kv_reserve (kv2, -1) < 0 && errno == EINVAL,
+        "kv_reserve size=-1 fails with EINVAL");
+    ok (kv_reserve (kv2, 0) == 0,
+        "kv_reserve size=0 works");
+    for (int i = 0; i < 10000; i++) {
+        snprintf (key, sizeof (key), "key%d", i);
+        if (kv_put (kv1, key, KV_INT64, (int64_t)i) < 0
+            || kv_put (kv2, key, KV_INT64, (int64_t)i) < 0)
+            same = false;
+        if (i == 5000 && kv_reserve (kv1, 1000000) < 0)
+            same = false;
+    }
+    ok (same && kv_equal (kv1, kv2),
+        "kv built from kv_create_sized/kv_reserve equals kv_create");
+    kv_destroy (kv1);
+    kv_destroy (kv2);
+}
+
+static void views (void)
+{
+    struct kv *kv, *kv2, *view, *view2;
+    const char *buf;
+    const char *key;
+    const char *s;
+    int len;
+    int64_t i;
+    char k[32];
+
+    if (!(kv = kv_create ())
+        || kv_put (kv, "a", KV_STRING, "foo") < 0
+        || kv_put (kv, "cert.x", KV_INT64, (int64_t)42) < 0
+        || kv_put (kv, "b", KV_BOOL, true) < 0
+        || kv_put (kv, "cert.meta.y", KV_STRING, "bar") < 0
+        || kv_put (kv, "cert.", KV_STRING, "notme") < 0)
+        BAIL_OUT ("failed to create kv");
+    if (kv_encode (kv, &buf, &len) < 0)
+        BAIL_OUT ("kv_encode failed");
+
+    /* buffer view
+     */
+    ok ((view = kv_view (buf, len)) != NULL,
+        "kv_view works");
+    ok (kv_equal (view, kv),
+        "view is equal to original");
+    ok (kv_encode (view, &s, &len) == 0 && s == buf,
+        "kv_encode on view returns the borrowed buffer");
+    ok (kv_get (view, "a", KV_STRING, &s) == 0 && s > buf
+        && !strcmp (s, "foo"),
+        "kv_get on view returns value in borrowed buffer");
+    errno = 0;
+    ok (kv_put (view, "c", KV_STRING, "x") < 0 && errno == EROFS,
+        "kv_put on view fails with EROFS");
+    errno = 0;
+    ok (kv_delete (view, "a") < 0 && errno == EROFS,
+        "kv_delete on view fails with EROFS");
+    errno = 0;
+    ok (kv_join (view, kv, NULL) < 0 && errno == EROFS,
+        "kv_join into view fails with EROFS");
+    ok ((kv2 = kv_copy (view)) != NULL && kv_equal (kv2, kv),
+        "kv_copy of view works");
+    ok (kv_put (kv2, "c", KV_STRING, "x") == 0,
+        "and copy is writable");
+    kv_destroy (kv2);
+    kv_destroy (view);
+
+    errno = 0;
+    ok (kv_view ("a\0sfoo", 6) == NULL && errno == EINVAL,
+        "kv_view fails with EINVAL on invalid buffer");
+    errno = 0;
+    ok (kv_view (NULL, 1) == NULL && errno == EINVAL,
+        "kv_view buf=NULL fails with EINVAL");
+    ok ((view = kv_view (NULL, 0)) != NULL && kv_next (view, NULL) == NULL,
+        "kv_view buf=NULL len=0 is an empty view");
+    kv_destroy (view);
+
+    /* prefix view
+     */
+    errno = 0;
+    ok (kv_view_prefix (NULL, "cert.") == NULL && errno == EINVAL,
+        "kv_view_prefix kv=NULL fails with EINVAL");
+    ok ((view = kv_view_prefix (kv, "cert.")) != NULL,
+        "kv_view_prefix works");
+    if (!(kv2 = kv_split (kv, "cert.")))
+        BAIL_OUT ("kv_split failed");
+    ok (kv_equal (view, kv2) && kv_equal (kv2, view),
+        "prefix view is equal to kv_split result");
+    key = kv_next (view, NULL);
+    ok (key != NULL && !strcmp (key, "x")
+        && (key = kv_next (view, key)) != NULL && !strcmp (key, "meta.y")
+        && kv_next (view, key) == NULL,
+        "kv_next iterates over prefixed keys with prefix removed");
+    ok (kv_get (view, "x", KV_INT64, &i) == 0 && i == 42,
+        "kv_get x works on prefix view");
+    errno = 0;
+    ok (kv_get (view, "a", KV_STRING, NULL) < 0 && errno == ENOENT,
+        "kv_get of key outside prefix fails with ENOENT");
+    errno = 0;
+    ok (kv_encode (view, &s, &len) < 0 && errno == EINVAL,
+        "kv_encode on prefix view fails with EINVAL");
+    kv_destroy (kv2);
+    ok ((kv2 = kv_copy (view)) != NULL
+        && kv_encode (kv2, &s, &len) == 0
+        && len == 18 && !memcmp (s, "x\0i42\0meta.y\0sbar\0", len),
+        "kv_copy of prefix view is encoded like kv_split");
+    kv_destroy (kv2);
+
+    ok ((view2 = kv_view_prefix (view, "meta.")) != NULL
+        && kv_get (view2, "y", KV_STRING, &s) == 0 && !strcmp (s, "bar")
+        && (key = kv_next (view2, NULL)) != NULL && !strcmp (key, "y")
+        && kv_next (view2, key) == NULL,
+        "kv_view_prefix of prefix view works");
+    kv_destroy (view2);
+    kv_destroy (view);
+    kv_destroy (kv);
+
+    /* lookups on a large prefix view use the index
+     */
+    if (!(kv = kv_create ()))
+        BAIL_OUT ("kv_create failed");
+    for (int n = 0; n < 100; n++) {
+        snprintf (k, sizeof (k), "p.%d", n);
+        if (kv_put (kv, k, KV_INT64, (int64_t)n) < 0
+            || kv_put (kv, k + 2, KV_INT64, (int64_t)-n) < 0)
+            BAIL_OUT ("kv_put failed");
+    }
+    if (!(view = kv_view_prefix (kv, "p.")))
+        BAIL_OUT ("kv_view_prefix failed");
+    bool good = true;
+    for (int n = 99; n >= 0; n--) {
+        snprintf (k, sizeof (k), "%d", n);
+        if (kv_get (view, k, KV_INT64, &i) < 0 || i != n)
+            good = false;
+    }
+    ok (good,
+        "kv_get works for all keys in large prefix view");
+    kv_destroy (view);
+    kv_destroy (kv);
+}
+
+struct lookup_arg {
+    const struct kv *kv;
+    pthread_barrier_t *barrier;
+};
+
+static void *lookup_thread (void *arg)
+{
+    struct lookup_arg *la = arg;
+    char key[32];
+    int64_t val;
+
+    (void)pthread_barrier_wait (la->barrier);
+    for (int i = 99; i >= 0; i--) {
+        snprintf (key, sizeof (key), "key%d", i);
+        if (kv_get (la->kv, key, KV_INT64, &val) < 0 || val != i)
+            return (void *)-1;
+    }
+    return NULL;
+}
+
+/* Run lookups on 'kv' from 4 threads that start together, so that
+ * their first kv_get() calls race to build the index.
+ */
+static bool lookup_race (const struct kv *kv)
+{
+    pthread_t t[4];
+    pthread_barrier_t barrier;
+    struct lookup_arg la = { .kv = kv, .barrier = &barrier };
+    bool good = true;
+
+    if (pthread_barrier_init (&barrier, NULL, 4) != 0)
+        BAIL_OUT ("pthread_barrier_init failed");
+    for (int i = 0; i < 4; i++) {
+        if (pthread_create (&t[i], NULL, lookup_thread, &la) != 0)
+            BAIL_OUT ("pthread_create failed");
+    }
+    for (int i = 0; i < 4; i++) {
+        void *result;
+        if (pthread_join (t[i], &result) != 0 || result != NULL)
+            good = false;
+    }
+    pthread_barrier_destroy (&barrier);
+    return good;
+}
+
+/* Concurrent lookups in a const kv may race to build the index.
+ * kv_put() builds the index as it goes, so start from kv_decode()
+ * and kv_view() objects, whose index is built by the first lookup.
+ */
+static void concurrent_lookup (void)
+{
+    struct kv *kv;
+    struct kv *kv2;
+    const char *buf;
+    int len;
+    char key[32];
+    bool good_decode = true;
+    bool good_view = true;
+
+    if (!(kv = kv_create ()))
+        BAIL_OUT ("kv_create failed");
+    for (int i = 0; i < 100; i++) {
+        snprintf (key, sizeof (key), "key%d", i);
+        if (kv_put (kv, key, KV_INT64, (int64_t)i) < 0)
+            BAIL_OUT ("kv_put failed");
+    }
+    if (kv_encode (kv, &buf, &len) < 0)
+        BAIL_OUT ("kv_encode failed");
+    for (int n = 0; n < 20; n++) {
+        if (!(kv2 = kv_decode (buf, len)))
+            BAIL_OUT ("kv_decode failed");
+        if (!lookup_race (kv2))
+            good_decode = false;
+        kv_destroy (kv2);
+
+        if (!(kv2 = kv_view (buf, len)))
+            BAIL_OUT ("kv_view failed");
+        if (!lookup_race (kv2))
+            good_view = false;
+        kv_destroy (kv2);
+    }
+    ok (good_decode,
+        "concurrent first kv_get on decoded kv from multiple threads works");
+    ok (good_view,
+        "concurrent first kv_get on kv view from multiple threads works");
+    kv_destroy (kv);
+}
+
+static void decoded_duplicates (void)
+{
+    struct kv *kv;
+    char buf[1024];
+    int len = 0;
+    const char *s;
+
+    /* kv_decode() accepts duplicate keys. The first must be returned.
+     */
+    len += sprintf (&buf[len], "dup") + 1;
+    len += sprintf (&buf[len], "sfirst") + 1;
+    for (int i = 0; i < 32; i++) {
+        len += sprintf (&buf[len], "key%d", i) + 1;
+        len += sprintf (&buf[len], "s%d", i) + 1;
+    }
+    len += sprintf (&buf[len], "dup") + 1;
+    len += sprintf (&buf[len], "ssecond") + 1;
+
+    if (!(kv = kv_decode (buf, len)))
+        BAIL_OUT ("kv_decode failed");
+    ok (kv_get (kv, "nokey", KV_STRING, &s) < 0 && errno == ENOENT,
+        "kv_get of missing key in large decoded kv fails with ENOENT");
+    ok (kv_get (kv, "key31", KV_STRING, &s) == 0 && !strcmp (s, "31"),
+        "kv_get key31 works");
+    ok (kv_get (kv, "dup", KV_STRING, &s) == 0 && !strcmp (s, "first"),
+        "kv_get of duplicate key returns first entry");
+    ok (kv_delete (kv, "dup") == 0
+        && kv_get (kv, "dup", KV_STRING, &s) == 0
+        && !strcmp (s, "second"),
+        "kv_get after kv_delete of duplicate key returns second entry");
+    kv_destroy (kv);
+}
+
 static void bad_parameters (void)
 {
     struct kv *kv;
@@ -849,6 +1213,11 @@ int main (int argc, char *argv[])
     simple_test ();
     empty_object ();
     check_expansion ();
+    indexed_ops ();
+    decoded_duplicates ();
+    reserve ();
+    views ();
+    concurrent_lookup ();
     bad_parameters ();
     key_deletion ();
     key_update ();
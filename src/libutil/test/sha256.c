@@ -16,49 +16,134 @@
 #include <stdio.h>
 #include <memory.h>
 #include <string.h>
+#include <stdlib.h>
+#include <errno.h>
 #include "src/libtap/tap.h"
 #include "src/libutil/sha256.h"
 
+static const char *impls[] = { "generic", "shani", "armv8" };
+
 /*********************** FUNCTION DEFINITIONS ***********************/
-void sha256_test()
+void sha256_test(const char *name)
 {
+	BYTE text0[] = {""};
 	BYTE text1[] = {"abc"};
 	BYTE text2[] = {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"};
 	BYTE text3[] = {"aaaaaaaaaa"};
+	BYTE text4[] = {"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+	                "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu"};
+	BYTE hash0[SHA256_BLOCK_SIZE] = {0xe3,0xb0,0xc4,0x42,0x98,0xfc,0x1c,0x14,0x9a,0xfb,0xf4,0xc8,0x99,0x6f,0xb9,0x24,
+	                                 0x27,0xae,0x41,0xe4,0x64,0x9b,0x93,0x4c,0xa4,0x95,0x99,0x1b,0x78,0x52,0xb8,0x55};
 	BYTE hash1[SHA256_BLOCK_SIZE] = {0xba,0x78,0x16,0xbf,0x8f,0x01,0xcf,0xea,0x41,0x41,0x40,0xde,0x5d,0xae,0x22,0x23,
 	                                 0xb0,0x03,0x61,0xa3,0x96,0x17,0x7a,0x9c,0xb4,0x10,0xff,0x61,0xf2,0x00,0x15,0xad};
 	BYTE hash2[SHA256_BLOCK_SIZE] = {0x24,0x8d,0x6a,0x61,0xd2,0x06,0x38,0xb8,0xe5,0xc0,0x26,0x93,0x0c,0x3e,0x60,0x39,
 	                                 0xa3,0x3c,0xe4,0x59,0x64,0xff,0x21,0x67,0xf6,0xec,0xed,0xd4,0x19,0xdb,0x06,0xc1};
 	BYTE hash3[SHA256_BLOCK_SIZE] = {0xcd,0xc7,0x6e,0x5c,0x99,0x14,0xfb,0x92,0x81,0xa1,0xc7,0xe2,0x84,0xd7,0x3e,0x67,
 	                                 0xf1,0x80,0x9a,0x48,0xa4,0x97,0x20,0x0e,0x04,0x6d,0x39,0xcc,0xc7,0x11,0x2c,0xd0};
+	BYTE hash4[SHA256_BLOCK_SIZE] = {0xcf,0x5b,0x16,0xa7,0x78,0xaf,0x83,0x80,0x03,0x6c,0xe5,0x9e,0x7b,0x04,0x92,0x37,
+	                                 0x0b,0x24,0x9b,0x11,0xe8,0xf0,0x7a,0x51,0xaf,0xac,0x45,0x03,0x7a,0xfe,0xe9,0xd1};
 	BYTE buf[SHA256_BLOCK_SIZE];
 	SHA256_CTX ctx;
 	int idx;
 
+	sha256_init(&ctx);
+	sha256_update(&ctx, text0, strlen((char *)text0));
+	sha256_final(&ctx, buf);
+	ok (!memcmp(hash0, buf, SHA256_BLOCK_SIZE),
+	    "%s: text0 OK", name);
+
 	sha256_init(&ctx);
 	sha256_update(&ctx, text1, strlen((char *)text1));
 	sha256_final(&ctx, buf);
 	ok (!memcmp(hash1, buf, SHA256_BLOCK_SIZE),
-	    "text1 OK");
+	    "%s: text1 OK", name);
 
 	sha256_init(&ctx);
 	sha256_update(&ctx, text2, strlen((char *)text2));
 	sha256_final(&ctx, buf);
 	ok (!memcmp(hash2, buf, SHA256_BLOCK_SIZE),
-	    "text2 OK");
+	    "%s: text2 OK", name);
 
 	sha256_init(&ctx);
 	for (idx = 0; idx < 100000; ++idx)
 	   sha256_update(&ctx, text3, strlen((char *)text3));
 	sha256_final(&ctx, buf);
 	ok (!memcmp(hash3, buf, SHA256_BLOCK_SIZE),
-	    "text3 OK");
+	    "%s: text3 OK", name);
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, text4, strlen((char *)text4));
+	sha256_final(&ctx, buf);
+	ok (!memcmp(hash4, buf, SHA256_BLOCK_SIZE),
+	    "%s: text4 OK", name);
+}
+
+/* Hash every length up to 1024 bytes of random data, in one update and
+ * split at a random point, and compare with the generic implementation.
+ */
+void sha256_compare(const char *name)
+{
+	static BYTE data[1024];
+	BYTE ref[SHA256_BLOCK_SIZE];
+	BYTE buf[SHA256_BLOCK_SIZE];
+	SHA256_CTX ctx;
+	int len, split;
+	int good = 1;
+
+	for (len = 0; len < (int)sizeof(data); len++)
+		data[len] = random();
+	for (len = 0; len <= (int)sizeof(data) && good; len++) {
+		split = len > 0 ? random() % len : 0;
+
+		if (sha256_select("generic") < 0)
+			BAIL_OUT("sha256_select generic failed");
+		sha256_init(&ctx);
+		sha256_update(&ctx, data, len);
+		sha256_final(&ctx, ref);
+		if (sha256_select(name) < 0)
+			BAIL_OUT("sha256_select %s failed", name);
+
+		sha256_init(&ctx);
+		sha256_update(&ctx, data, len);
+		sha256_final(&ctx, buf);
+		if (memcmp(ref, buf, SHA256_BLOCK_SIZE) != 0) {
+			diag("len=%d differs from generic", len);
+			good = 0;
+		}
+		sha256_init(&ctx);
+		sha256_update(&ctx, data, split);
+		sha256_update(&ctx, data + split, len - split);
+		sha256_final(&ctx, buf);
+		if (memcmp(ref, buf, SHA256_BLOCK_SIZE) != 0) {
+			diag("len=%d split=%d differs from generic", len, split);
+			good = 0;
+		}
+	}
+	ok (good,
+	    "%s: matches generic for length 0-%d", name, (int)sizeof(data));
+}
+
+void sha256_corner()
+{
+	errno = 0;
+	ok (sha256_select("foo") < 0 && errno == ENOENT,
+	    "sha256_select name=foo fails with ENOENT");
+	ok (sha256_select(NULL) == 0,
+	    "sha256_select name=NULL works");
 }
 
 int main()
 {
 	plan (NO_PLAN);
-	sha256_test ();
+	for (int i = 0; i < (int)(sizeof(impls) / sizeof(impls[0])); i++) {
+		if (sha256_select(impls[i]) < 0) {
+			diag ("%s: %s", impls[i], strerror(errno));
+			continue;
+		}
+		sha256_test (impls[i]);
+		sha256_compare (impls[i]);
+	}
+	sha256_corner ();
 	done_testing ();
 	return(0);
 }
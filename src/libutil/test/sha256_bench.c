@@ -0,0 +1,102 @@
+/************************************************************\
+ * Copyright 2026 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* sha256_bench - measure SHA-256 throughput of each implementation
+ *
+ * Usage: sha256_bench [SIZE [ITERATIONS]]
+ *
+ * Hash a SIZE byte buffer (default 4096) ITERATIONS times (default 10000)
+ * with each SHA-256 implementation supported on this CPU and report
+ * the throughput.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "sha256.h"
+
+static const char *impls[] = { "generic", "shani", "armv8" };
+
+static double now (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void die (const char *msg)
+{
+    fprintf (stderr, "sha256_bench: %s: %s\n", msg, strerror (errno));
+    exit (1);
+}
+
+/* Hash 'buf' 'iterations' times and print the throughput.
+ */
+static void bench (const char *name,
+                   const BYTE *buf,
+                   size_t size,
+                   int iterations)
+{
+    SHA256_CTX ctx;
+    BYTE hash[SHA256_BLOCK_SIZE];
+    double t;
+    double t0 = now ();
+
+    for (int i = 0; i < iterations; i++) {
+        sha256_init (&ctx);
+        sha256_update (&ctx, buf, size);
+        sha256_final (&ctx, hash);
+    }
+    t = now () - t0;
+    printf ("%-8s %02x%02x%02x%02x %10.1f MB/s %8.1f ns/hash\n",
+            name,
+            hash[0], hash[1], hash[2], hash[3],
+            (double)size * iterations / t / 1e6,
+            t * 1e9 / iterations);
+}
+
+int main (int argc, char *argv[])
+{
+    int size = argc > 1 ? atoi (argv[1]) : 4096;
+    int iterations = argc > 2 ? atoi (argv[2]) : 10000;
+    BYTE *buf;
+
+    if (size < 0 || iterations < 1) {
+        fprintf (stderr, "Usage: sha256_bench [SIZE [ITERATIONS]]\n");
+        exit (1);
+    }
+    if (!(buf = malloc (size > 0 ? size : 1)))
+        die ("malloc");
+    for (int i = 0; i < size; i++)
+        buf[i] = i;
+
+    printf ("%d bytes x %d iterations\n", size, iterations);
+    for (int i = 0; i < (int)(sizeof (impls) / sizeof (impls[0])); i++) {
+        if (sha256_select (impls[i]) < 0) {
+            printf ("%-8s %s\n", impls[i], strerror (errno));
+            continue;
+        }
+        bench (impls[i], buf, size, iterations);
+    }
+
+    free (buf);
+    return 0;
+}
+
+/*
+ * vi: ts=4 sw=4 expandtab
+ */
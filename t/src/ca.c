@@ -45,6 +45,7 @@ static void usage (void)
     fprintf (stderr,
 "Usage: ca keygen\n"
 "   or: ca revoke uuid\n"
+"   or: ca revoke-compile\n"
 "   or: ca verify path\n");
 }
 
@@ -85,6 +86,19 @@ static void revoke (const char *uuid)
     ca_destroy (ca);
 }
 
+/* Write the CA revocation directory to the configured index file.
+ */
+static void revoke_compile (void)
+{
+    struct ca *ca = init_ca ();
+    ca_error_t error;
+
+    if (ca_revoke_compile (ca, error) < 0)
+        die ("ca_revoke_compile: %s", error);
+
+    ca_destroy (ca);
+}
+
 /* Generate new CA cert, writing to the configured path.
  */
 static void keygen (void)
@@ -128,6 +142,8 @@ int main (int argc, char **argv)
         keygen ();
     else if (argc == 3 && !strcmp (argv[1], "revoke"))
         revoke (argv[2]);
+    else if (argc == 2 && !strcmp (argv[1], "revoke-compile"))
+        revoke_compile ();
     else if (argc == 3 && !strcmp (argv[1], "verify"))
         verify (argv[2]);
     else
@@ -8,7 +8,8 @@
  * SPDX-License-Identifier: LGPL-3.0
 \************************************************************/
 
-/* getpwuid.c - LD_PRELOAD version of getpwuid() that uses TEST_PASSWD_FILE
+/* getpwuid.c - LD_PRELOAD version of getpwuid() and getpwuid_r() that
+ * use TEST_PASSWD_FILE
  */
 
 #if HAVE_CONFIG_H
@@ -44,5 +45,28 @@ struct passwd *getpwuid (uid_t uid)
     return pwp;
 }
 
+int getpwuid_r (uid_t uid, struct passwd *pwd,
+                char *buf, size_t buflen, struct passwd **result)
+{
+    const char *filename;
+    FILE *f;
+    int rc = 0;
+
+    if (!(filename = getenv ("TEST_PASSWD_FILE")))
+        filename = "/etc/passwd";
+
+    *result = NULL;
+    if ((f = fopen (filename, "r"))) {
+        while ((rc = fgetpwent_r (f, pwd, buf, buflen, result)) == 0) {
+            if ((*result)->pw_uid == uid)
+                break;
+        }
+        (void)fclose (f);
+    }
+    if (rc == ENOENT)
+        rc = 0;
+    return rc;
+}
+
 /* vi: ts=4 sw=4 expandtab
  */
@@ -10,7 +10,11 @@
 
 /* verify.c - verify signed content on stdin
  *
- * Usage: verify <input >output
+ * Usage: verify [count] <input >output
+ *
+ * If count is specified, the input is unwrapped count times.
+ * If VERIFY_CACHE is set in the environment, it names a verified signature
+ * cache file to share with other invocations.
  */
 
 #if HAVE_CONFIG_H
@@ -63,23 +67,32 @@ int main (int argc, char **argv)
     int64_t userid;
     const char *payload;
     int payloadsz;
+    int count = 1;
+    const char *cache_path;
 
-    if (argc != 1)
-        die ("Usage: verify <input >output");
+    if (argc > 2)
+        die ("Usage: verify [count] <input >output");
+    if (argc == 2 && (count = strtol (argv[1], NULL, 10)) < 1)
+        die ("count must be greater than zero");
 
     if (!(ctx = flux_security_create (0)))
         die ("flux_security_create");
     if (flux_security_configure (ctx, getenv ("FLUX_IMP_CONFIG_PATTERN")) < 0)
         die ("flux_security_configure: %s", flux_security_last_error (ctx));
+    if ((cache_path = getenv ("VERIFY_CACHE"))
+        && flux_sign_cache_open (ctx, cache_path, 16) < 0)
+        die ("flux_sign_cache_open: %s", flux_security_last_error (ctx));
 
     buflen = read_all (buf, sizeof (buf) - 1);
     buf[buflen] = '\0';
     while (buflen > 0 && isspace (buf[buflen - 1]))
         buf[--buflen] = '\0';
 
-    if (flux_sign_unwrap (ctx, buf, (const void **)&payload, &payloadsz,
-                          &userid, 0) < 0)
-        die ("flux_sign_unwrap: %s", flux_security_last_error (ctx));
+    while (count-- > 0) {
+        if (flux_sign_unwrap (ctx, buf, (const void **)&payload, &payloadsz,
+                              &userid, 0) < 0)
+            die ("flux_sign_unwrap: %s", flux_security_last_error (ctx));
+    }
 
     if (payload)
         fwrite (payload, payloadsz, 1, stdout);
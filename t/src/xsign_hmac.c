@@ -0,0 +1,212 @@
+/************************************************************\
+ * Copyright 2026 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* xsign_hmac.c - create invalid signatures for hmac mechanism
+ *
+ * Usage: xsign_hmac keyid key testname <input >output
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <unistd.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <sodium.h>
+
+#include "src/libutil/kv.h"
+
+const char *prog = "xsign_hmac";
+
+static void die (const char *fmt, ...)
+{
+    va_list ap;
+    char buf[256];
+
+    va_start (ap, fmt);
+    (void)vsnprintf (buf, sizeof (buf), fmt, ap);
+    va_end (ap);
+    fprintf (stderr, "%s: %s\n", prog, buf);
+    exit (1);
+}
+
+static int read_all (void *buf, int bufsz)
+{
+    int n;
+    int count = 0;
+    do {
+        if ((n = read (STDIN_FILENO, (char *)buf + count, bufsz - count)) < 0)
+            die ("read stdin: %s", strerror (errno));
+        count += n;
+    } while (n > 0 && count < bufsz);
+    if (n > 0)
+        die ("input buffer exceeded");
+    return count;
+}
+
+static char *encode (const void *src, int srclen)
+{
+    char *dst;
+    int dstlen;
+
+    dstlen = sodium_base64_encoded_len (srclen,
+                                        sodium_base64_VARIANT_ORIGINAL);
+    if (!(dst = malloc (dstlen)))
+        die ("malloc: %s", strerror (errno));
+    sodium_bin2base64 (dst, dstlen, src, srclen,
+                       sodium_base64_VARIANT_ORIGINAL);
+    return dst;
+}
+
+static char *make_header (int64_t userid, const char *keyid,
+                          time_t ctime, time_t xtime, bool bad_header)
+{
+    struct kv *header;
+    const char *src;
+    int srclen;
+    char *dst;
+
+    if (!(header = kv_create ()))
+        die ("kv_create: %s", strerror (errno));
+    if (kv_put (header, "version", KV_INT64, 1LL) < 0
+        || kv_put (header, "mechanism", KV_STRING, "hmac") < 0
+        || kv_put (header, "userid", KV_INT64, userid) < 0
+        || kv_put (header, "hmac.keyid", KV_STRING, keyid) < 0
+        || kv_put (header, "hmac.ctime", KV_TIMESTAMP, ctime) < 0
+        || kv_put (header, "hmac.xtime", KV_TIMESTAMP, xtime) < 0)
+        die ("kv_put: %s", strerror (errno));
+    if (bad_header) {
+        if (kv_delete (header, "hmac.xtime") < 0)
+            die ("kv_delete: %s", strerror (errno));
+    }
+    if (kv_encode (header, &src, &srclen) < 0)
+        die ("kv_encode: %s", strerror (errno));
+    dst = encode (src, srclen);
+    kv_destroy (header);
+
+    return dst;
+}
+
+static char *make_signature (const uint8_t *key, size_t keylen,
+                             const char *headerpayload, bool change_mac)
+{
+    crypto_auth_hmacsha256_state st;
+    uint8_t mac[crypto_auth_hmacsha256_BYTES];
+
+    crypto_auth_hmacsha256_init (&st, key, keylen);
+    crypto_auth_hmacsha256_update (&st, (const uint8_t *)headerpayload,
+                                   strlen (headerpayload));
+    crypto_auth_hmacsha256_final (&st, mac);
+    if (change_mac)
+        mac[0]++;
+    return encode (mac, sizeof (mac));
+}
+
+static char *test_sign_wrap (const void *pay, int paysz,
+                             const char *keyid,
+                             const uint8_t *key, size_t keylen,
+                             int64_t userid, time_t ctime, time_t xtime,
+                             bool change_payload, bool change_mac,
+                             bool bad_header)
+{
+    char *header;
+    char *payload;
+    char *signature;
+    char *headerpayload;
+    char *msg;
+
+    header = make_header (userid, keyid, ctime, xtime, bad_header);
+    payload = encode (pay, paysz);
+
+    if (asprintf (&headerpayload, "%s.%s", header, payload) < 0)
+        die ("asprintf: %s", strerror (errno));
+
+    signature = make_signature (key, keylen, headerpayload, change_mac);
+
+    if (change_payload) {
+        free (payload);
+        payload = encode ("bogus", 5);
+    }
+    if (asprintf (&msg, "%s.%s.%s", header, payload, signature) < 0)
+        die ("asprintf: %s", strerror (errno));
+
+    free (header);
+    free (payload);
+    free (headerpayload);
+    free (signature);
+
+    return msg;
+}
+
+int main (int argc, char **argv)
+{
+    char buf[1024];
+    int buflen;
+    char *msg = NULL;
+    const char *keyid;
+    uint8_t key[64];
+    size_t keylen;
+    time_t now;
+
+    if (argc != 4)
+        die ("Usage: %s keyid key {good|xuser|xpaychg|xmacchg|xkeyid|xctime|xxtime|xheader} <input >output", prog);
+
+    if (sodium_init () < 0)
+        die ("sodium_init failed");
+    if ((now = time (NULL)) == (time_t)-1)
+        die ("time: %s", strerror (errno));
+    keyid = argv[1];
+    if (sodium_base642bin (key, sizeof (key), argv[2], strlen (argv[2]),
+                           NULL, &keylen, NULL,
+                           sodium_base64_VARIANT_ORIGINAL) < 0)
+        die ("could not decode key");
+    buflen = read_all (buf, sizeof (buf));
+
+    if (!strcmp (argv[3], "good"))
+        msg = test_sign_wrap (buf, buflen, keyid, key, keylen, getuid (),
+                              now, now + 1, false, false, false);
+    else if (!strcmp (argv[3], "xuser"))
+        msg = test_sign_wrap (buf, buflen, keyid, key, keylen, getuid () + 1,
+                              now, now + 1, false, false, false);
+    else if (!strcmp (argv[3], "xpaychg"))
+        msg = test_sign_wrap (buf, buflen, keyid, key, keylen, getuid (),
+                              now, now + 1, true, false, false);
+    else if (!strcmp (argv[3], "xmacchg"))
+        msg = test_sign_wrap (buf, buflen, keyid, key, keylen, getuid (),
+                              now, now + 1, false, true, false);
+    else if (!strcmp (argv[3], "xkeyid"))
+        msg = test_sign_wrap (buf, buflen, "bogus", key, keylen, getuid (),
+                              now, now + 1, false, false, false);
+    else if (!strcmp (argv[3], "xctime"))
+        msg = test_sign_wrap (buf, buflen, keyid, key, keylen, getuid (),
+                              now + 2, now + 3, false, false, false);
+    else if (!strcmp (argv[3], "xxtime"))
+        msg = test_sign_wrap (buf, buflen, keyid, key, keylen, getuid (),
+                              now, now - 1, false, false, false);
+    else if (!strcmp (argv[3], "xheader"))
+        msg = test_sign_wrap (buf, buflen, keyid, key, keylen, getuid (),
+                              now, now + 1, false, false, true);
+    else
+        die ("unknown test: %s", argv[3]);
+
+    assert (msg != NULL);
+    printf ("%s\n", msg);
+    free (msg);
+    sodium_memzero (key, sizeof (key));
+
+    return 0;
+}
+
+/* vi: ts=4 sw=4 expandtab
+ */
@@ -33,6 +33,7 @@ new_ca_config() {
 	cert-path = "${SHARNESS_TRASH_DIRECTORY}/ca"
 	revoke-dir = "${SHARNESS_TRASH_DIRECTORY}/revoke.d"
 	revoke-allow = true
+	revoke-index = "${SHARNESS_TRASH_DIRECTORY}/revoke.index"
 	domain = "EXAMPLE.TEST"
 	EOT
 }
@@ -110,6 +111,15 @@ test_expect_success 'CA cannot verify revoked cert' '
 	test_must_fail $ca verify u
 '
 
+test_expect_success 'CA compiles revocation index' '
+	$ca revoke-compile &&
+	grep $uuid revoke.index
+'
+
+test_expect_success 'CA cannot verify revoked cert using index' '
+	test_must_fail $ca verify u
+'
+
 test_expect_success NO_ASAN 'imp casign fails on /dev/zero input' '
 	test_must_fail $flux_imp casign </dev/zero
 '
@@ -108,6 +108,50 @@ test_expect_success 'message with altered munge cred fails verify' '
 	grep -q "munge_decode" xcredchg.err
 '
 
+test_expect_success 'create sign.toml with decode-cache-size=16' '
+	cat >sign.toml <<-EOT
+	[sign]
+	max-ttl = 60
+	default-type = "munge"
+	allowed-types = [ "munge" ]
+	[sign.munge]
+	socket-path = "${MUNGE_SOCKET}"
+	decode-cache-size = 16
+	EOT
+'
+
+test_expect_success 'message verifies repeatedly with decode cache' '
+	${verify} 3 <sign.out >verify_cache.out &&
+	test_cmp sign.in verify_cache.out
+'
+
+test_expect_success 'message with altered payload fails verify with decode cache' '
+	test_must_fail ${verify} <xpaychg.out 2>xpaychg_cache.err &&
+	grep -q "hash mismatch" xpaychg_cache.err
+'
+
+test_expect_success 'message with wrong userid fails verify with decode cache' '
+	test_must_fail ${verify} <xuser.out 2>xuser_cache.err &&
+	grep -q "uid mismatch" xuser_cache.err
+'
+
+test_expect_success 'create sign.toml with decode-cache-size=-1' '
+	cat >sign.toml <<-EOT
+	[sign]
+	max-ttl = 60
+	default-type = "munge"
+	allowed-types = [ "munge" ]
+	[sign.munge]
+	socket-path = "${MUNGE_SOCKET}"
+	decode-cache-size = -1
+	EOT
+'
+
+test_expect_success 'init fails with out of range decode-cache-size' '
+	test_must_fail ${sign} </dev/null 2>badcache.err &&
+	grep -q "decode-cache-size is out of range" badcache.err
+'
+
 # N.B. max-ttl = (exactly) -100 is allowed for testing
 test_expect_success 'create sign.toml with max-ttl=-100' '
 	cat >sign.toml <<-EOT
@@ -99,6 +99,53 @@ test_expect_success 'sign/verify a short message' '
 	test_cmp sign.in verify.out
 '
 
+test_expect_success 'enable verify cache' '
+	config_sign >conf.d/sign.toml &&
+	echo "verify-cache-size = 8" >>conf.d/sign.toml &&
+	config_sign_curve_ca >>conf.d/sign.toml
+'
+
+test_expect_success 'sign/verify repeatedly with verify cache' '
+	${sign} <sign.in >sign.out &&
+	${verify} 3 <sign.out >verify.out &&
+	test_cmp sign.in verify.out
+'
+
+test_expect_success 'altered payload fails verify with verify cache' '
+	${xsign} u xpaychg </dev/null >xpaychg.out &&
+	test_must_fail ${verify} 2 <xpaychg.out 2>xpaychg.err &&
+	grep -q "verification failure" xpaychg.err
+'
+
+test_expect_success 'message verifies with shared verify cache' '
+	VERIFY_CACHE=$(pwd)/verify.cache ${verify} <sign.out >verify.out &&
+	test_cmp sign.in verify.out
+'
+
+test_expect_success 'replace CA cert' '
+	mv ca ca.orig &&
+	mv ca.pub ca.pub.orig &&
+	${ca} keygen
+'
+
+test_expect_success 'cached message fails verify after CA is replaced' '
+	test_must_fail env VERIFY_CACHE=$(pwd)/verify.cache \
+		${verify} <sign.out 2>xcarotate.err &&
+	grep -q "ca: signature verification" xcarotate.err
+'
+
+test_expect_success 'restore CA cert' '
+	mv ca.orig ca &&
+	mv ca.pub.orig ca.pub &&
+	VERIFY_CACHE=$(pwd)/verify.cache ${verify} <sign.out >verify.out &&
+	test_cmp sign.in verify.out
+'
+
+test_expect_success 'disable verify cache' '
+	config_sign >conf.d/sign.toml &&
+	config_sign_curve_ca >>conf.d/sign.toml
+'
+
 test_expect_success 'switch to un-CA-signed cert' '
 	mv u.pub u.pub.signed &&
 	mv u.pub.unsigned u.pub
@@ -243,6 +290,11 @@ test_expect_success 'sign/verify zero length payload using unsigned cert' '
 		LD_PRELOAD=${prelib} ${verify} <znoca.out
 '
 
+test_expect_success 'verify repeatedly using cached home cert' '
+	TEST_PASSWD_FILE=${SHARNESS_TRASH_DIRECTORY}/passwd \
+		LD_PRELOAD=${prelib} ${verify} 3 <znoca.out
+'
+
 test_expect_success 'verify fails after home cert is changed' '
 	${keygen} testuser/.flux/curve/sig &&
 	! TEST_PASSWD_FILE=${SHARNESS_TRASH_DIRECTORY}/passwd \
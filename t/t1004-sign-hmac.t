@@ -0,0 +1,207 @@
+#!/bin/sh
+#
+
+test_description='sign-hmac tests
+
+Test basic functionality of sign-hmac mechanism.
+'
+
+# Append --logfile option if FLUX_TESTS_LOGFILE is set in environment:
+test -n "$FLUX_TESTS_LOGFILE" && set -- "$@" --logfile
+. `dirname $0`/sharness.sh
+
+sign=${SHARNESS_BUILD_DIRECTORY}/t/src/sign
+verify=${SHARNESS_BUILD_DIRECTORY}/t/src/verify
+xsign=${SHARNESS_BUILD_DIRECTORY}/t/src/xsign_hmac
+
+export FLUX_IMP_CONFIG_PATTERN=${SHARNESS_TRASH_DIRECTORY}/conf.d/*.toml
+
+config_sign() {
+	cat <<-EOT
+	[sign]
+	max-ttl = ${1:-60}
+	default-type = "hmac"
+	allowed-types = [ "hmac" ]
+	EOT
+}
+
+config_sign_hmac() {
+	cat <<-EOT
+	[sign.hmac]
+	key-path = "${SHARNESS_TRASH_DIRECTORY}/${1:-hmac.key}"
+	EOT
+}
+
+newkey() {
+	head -c 32 /dev/urandom | base64
+}
+
+test_expect_success 'create keys and config' '
+	k1=$(newkey) &&
+	k2=$(newkey) &&
+	echo "# test key" >hmac.key &&
+	echo "k1 $k1" >>hmac.key &&
+	chmod 600 hmac.key &&
+	mkdir -p conf.d &&
+	config_sign >conf.d/sign.toml &&
+	config_sign_hmac >>conf.d/sign.toml
+'
+
+test_expect_success 'sign/verify zero length payload' '
+	cat /dev/null >zsign.in &&
+	${sign} <zsign.in >zsign.out &&
+	${verify} <zsign.out >zverify.out &&
+	test_cmp zsign.in zverify.out
+'
+
+test_expect_success 'sign/verify a short message' '
+	echo Hello >sign.in &&
+	${sign} <sign.in >sign.out &&
+	${verify} <sign.out >verify.out &&
+	test_cmp sign.in verify.out
+'
+
+test_expect_success 'verify a hand-created test message' '
+	${xsign} k1 $k1 good </dev/null >good.out &&
+	${verify} <good.out
+'
+
+test_expect_success 'message with other userid verifies (key holders are trusted)' '
+	${xsign} k1 $k1 xuser </dev/null >xuser.out &&
+	${verify} <xuser.out
+'
+
+test_expect_success 'message with altered payload fails verify' '
+	${xsign} k1 $k1 xpaychg </dev/null >xpaychg.out &&
+	test_must_fail ${verify} <xpaychg.out 2>xpaychg.err &&
+	grep -q "verification failure" xpaychg.err
+'
+
+test_expect_success 'message with altered MAC fails verify' '
+	${xsign} k1 $k1 xmacchg </dev/null >xmacchg.out &&
+	test_must_fail ${verify} <xmacchg.out 2>xmacchg.err &&
+	grep -q "verification failure" xmacchg.err
+'
+
+test_expect_success 'message signed with wrong key fails verify' '
+	${xsign} k1 $k2 good </dev/null >xkey.out &&
+	test_must_fail ${verify} <xkey.out 2>xkey.err &&
+	grep -q "verification failure" xkey.err
+'
+
+test_expect_success 'message with unknown key id fails verify' '
+	${xsign} k1 $k1 xkeyid </dev/null >xkeyid.out &&
+	test_must_fail ${verify} <xkeyid.out 2>xkeyid.err &&
+	grep -q "unknown key id bogus" xkeyid.err
+'
+
+test_expect_success 'message with future ctime fails verify' '
+	${xsign} k1 $k1 xctime </dev/null >xctime.out &&
+	test_must_fail ${verify} <xctime.out 2>xctime.err &&
+	grep -q "ctime is in the future" xctime.err
+'
+
+test_expect_success 'message with past xtime fails verify' '
+	${xsign} k1 $k1 xxtime </dev/null >xxtime.out &&
+	test_must_fail ${verify} <xxtime.out 2>xxtime.err &&
+	grep -q "xtime or max-ttl exceeded" xxtime.err
+'
+
+test_expect_success 'message with incomplete header fails verify' '
+	${xsign} k1 $k1 xheader </dev/null >xheader.out &&
+	test_must_fail ${verify} <xheader.out 2>xheader.err &&
+	grep -q "incomplete header" xheader.err
+'
+
+test_expect_success 'add second key to key file' '
+	echo "k2 $k2" >>hmac.key
+'
+
+test_expect_success 'message signed with either key verifies' '
+	${xsign} k1 $k1 good </dev/null >rot1.out &&
+	${verify} <rot1.out &&
+	${xsign} k2 $k2 good </dev/null >rot2.out &&
+	${verify} <rot2.out
+'
+
+test_expect_success 'move second key to the top of key file' '
+	echo "k2 $k2" >hmac.key &&
+	echo "k1 $k1" >>hmac.key
+'
+
+test_expect_success 'sign with the new key' '
+	${sign} <sign.in >rot3.out
+'
+
+test_expect_success 'remove old key from key file' '
+	echo "k2 $k2" >hmac.key
+'
+
+test_expect_success 'message signed with the new key verifies' '
+	${verify} <rot3.out >rot3.verify &&
+	test_cmp sign.in rot3.verify
+'
+
+test_expect_success 'message signed with old key fails verify' '
+	test_must_fail ${verify} <sign.out 2>xold.err &&
+	grep -q "unknown key id k1" xold.err
+'
+
+test_expect_success 'message verifies with shared verify cache' '
+	VERIFY_CACHE=$(pwd)/verify.cache ${verify} <rot3.out >rot3.cache &&
+	test_cmp sign.in rot3.cache
+'
+
+test_expect_success 'replace key under the same key id' '
+	echo "k2 $k1" >hmac.key
+'
+
+test_expect_success 'cached message fails verify after key is replaced' '
+	test_must_fail env VERIFY_CACHE=$(pwd)/verify.cache \
+		${verify} <rot3.out 2>xreplace.err &&
+	grep -q "verification failure" xreplace.err
+'
+
+test_expect_success 'restore key' '
+	echo "k2 $k2" >hmac.key
+'
+
+test_expect_success 'sign fails with key file readable by others' '
+	chmod 644 hmac.key &&
+	test_must_fail ${sign} </dev/null 2>xmode.err &&
+	grep -q "insecure owner or mode" xmode.err &&
+	chmod 600 hmac.key
+'
+
+test_expect_success 'sign fails with short key' '
+	echo "k3 $(head -c 16 /dev/urandom | base64)" >short.key &&
+	chmod 600 short.key &&
+	config_sign >conf.d/sign.toml &&
+	config_sign_hmac short.key >>conf.d/sign.toml &&
+	test_must_fail ${sign} </dev/null 2>xshort.err &&
+	grep -q "short.key:1: invalid key" xshort.err
+'
+
+test_expect_success 'sign fails with missing key file' '
+	config_sign >conf.d/sign.toml &&
+	config_sign_hmac noexist >>conf.d/sign.toml &&
+	test_must_fail ${sign} </dev/null 2>xnokey.err &&
+	grep -q "open" xnokey.err
+'
+
+test_expect_success 'sign fails with missing [sign.hmac] config' '
+	config_sign >conf.d/sign.toml &&
+	test_must_fail ${sign} </dev/null 2>xconfig.err &&
+	grep -q "config missing" xconfig.err
+'
+
+# N.B. max-ttl = (exactly) -100 is allowed for testing
+test_expect_success 'message with expired TTL fails verify' '
+	config_sign -100 >conf.d/sign.toml &&
+	config_sign_hmac >>conf.d/sign.toml &&
+	${sign} </dev/null >zttl.out &&
+	test_must_fail ${verify} <zttl.out 2>zttl.err &&
+	grep -q "max-ttl exceeded" zttl.err
+'
+
+test_done
@@ -355,6 +355,28 @@ test_expect_success SUDO,CGROUPFS,NO_CHAIN_LINT,CGROUP_WRITABLE \
 	test_must_be_empty ${CGROUP_PATH}/cgroup.procs
 '
 
+test_expect_success SUDO 'flux-imp exec works with verify cache' '
+	cp sign-none.toml verify-cache.toml &&
+	cat <<-EOF >>verify-cache.toml &&
+	verify-cache-path = "$(pwd)/verify.cache"
+	verify-cache-size = 16
+	EOF
+	fake_input_sign_none | \
+	  $SUDO FLUX_IMP_CONFIG_PATTERN=verify-cache.toml \
+	    $flux_imp exec id -u >id-cache.out &&
+	id -u >id-cache.expected &&
+	test_cmp id-cache.expected id-cache.out &&
+	test "$(stat -c %u:%a verify.cache)" = "0:600"
+'
+test_expect_success SUDO 'flux-imp exec warns if verify cache cannot be used' '
+	$SUDO chmod 644 verify.cache &&
+	fake_input_sign_none | \
+	  $SUDO FLUX_IMP_CONFIG_PATTERN=verify-cache.toml \
+	    $flux_imp exec id -u >id-cache2.out 2>id-cache2.err &&
+	test_cmp id-cache.expected id-cache2.out &&
+	grep "verify cache disabled" id-cache2.err
+'
+
 $flux_imp version | grep -q pam || test_set_prereq NO_PAM
 test_expect_success NO_PAM,SUDO 'flux-imp exec: fails if not built with PAM but pam-support=true' '
 	( export FLUX_IMP_CONFIG_PATTERN=pam-test.toml &&